@@ -20,6 +20,7 @@
  *   - BOOK:   Book content viewer
  *   - OPTION: Application options viewer and edition
  *   - TOC:    Currsent book Table of Content
+ *   - SEARCH: Search inside the current book
  * 
  * Each Controller must implements the following methods (No use of abstract class):
  * 
@@ -43,7 +44,7 @@ class AppController
      * LAST allows for the
      * selection of the last controller in charge before the current one.
      */
-    enum class Ctrl { NONE, DIR, PARAM, BOOK, OPTION, TOC, LAST };
+    enum class Ctrl { NONE, DIR, PARAM, BOOK, OPTION, TOC, SEARCH, LAST };
     
     AppController();
 
@@ -76,6 +77,19 @@ class AppController
      */
     void input_event(const EventMgr::Event & event);
 
+    /**
+     * @brief Work ahead while the user is not interacting
+     * 
+     * Called by the EventMgr when no event is waiting. The current controller
+     * does a single step of work per call (the BOOK controller prepares pages,
+     * the DIR controller retrieves new books, the SEARCH controller goes
+     * through the book). When it has nothing left to do,
+     * the books directory database is compacted.
+     * 
+     * @return true Some work was done, there may be more.
+     */
+    bool idle();
+
     void going_to_deep_sleep();
     void launch();
 
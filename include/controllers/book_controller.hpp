@@ -19,11 +19,19 @@ class BookController
     void input_event(const EventMgr::Event & event);
     void enter();
     void leave(bool going_to_deep_sleep = false);
+    bool idle();
     bool open_book_file(const std::string & book_title, 
                         const std::string & book_filename, 
                         const PageLocs::PageId & page_id);
     void put_str(const char * str, int xpos, int ypos);
 
+    /**
+     * @brief Going to deep sleep while a book menu, the TOC or search results are shown
+     * 
+     * The book is shown again at wake time, as when leaving the book itself.
+     */
+    void menu_going_to_deep_sleep();
+
     inline const PageLocs::PageId & get_current_page_id() { return current_page_id; }
     inline void set_current_page_id(const PageLocs::PageId & page_id) { current_page_id = page_id; }
 
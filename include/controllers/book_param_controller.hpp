@@ -13,12 +13,14 @@ class BookParamController
     static constexpr char const * TAG = "BookParamController";
 
     bool book_params_form_is_shown;
+    bool search_form_is_shown;
     bool wait_for_key_after_wifi;
     bool delete_current_book;
 
   public:
     BookParamController() : 
       book_params_form_is_shown(false), 
+           search_form_is_shown(false),
         wait_for_key_after_wifi(false),
             delete_current_book(false) { };
 
@@ -28,6 +30,7 @@ class BookParamController
     void set_font_count(uint8_t count);
 
     inline void set_book_params_form_is_shown() { book_params_form_is_shown = true; }
+    inline void      set_search_form_is_shown() { search_form_is_shown      = true; }
     inline void   set_wait_for_key_after_wifi() { wait_for_key_after_wifi   = true; }
     inline void       set_delete_current_book() { delete_current_book       = true; }
 };
@@ -10,6 +10,8 @@
 #include "models/page_locs.hpp"
 #include "viewers/books_dir_viewer.hpp"
 
+#include <vector>
+
 class BooksDirController
 {
   private:
@@ -21,6 +23,8 @@ class BooksDirController
     int32_t     book_offset;
     int16_t     current_book_index;
     int16_t     last_read_book_index;
+    uint32_t    last_read_id;
+    bool        last_read_hidden;     ///< The last book read is not in the filtered list
     std::string book_filename;
     bool        book_was_shown;
 
@@ -28,15 +32,36 @@ class BooksDirController
     BooksDirViewer * books_dir_viewer;
     int8_t viewer_id;
 
+    typedef std::vector<std::pair<uint32_t, bool>> ShownBooks; ///< Id and placeholder state
+
+    void get_shown_books(ShownBooks & shown);
+
   public:
     BooksDirController() {};
     void setup();
     void input_event(const EventMgr::Event & event);
     void enter();
     void leave(bool going_to_deep_sleep = false);
+
+    /**
+     * @brief Retrieve new books while the user is not interacting
+     *
+     * @return true Some work was done, there may be more.
+     */
+    bool idle();
     void save_last_book(const PageLocs::PageId & page_id, bool going_to_deep_sleep);
     void show_last_book();
     void new_orientation() { if (books_dir_viewer != nullptr) books_dir_viewer->setup(); }
+    void new_sort_order(BooksDir::SortOrder order);
+
+    /**
+     * @brief Limit the books list to the books matching a query
+     *
+     * @param query Words to search in the books title, author and description.
+     *              If empty, all books are shown.
+     * @return true The list was changed. False if no book was found.
+     */
+    bool search(const std::string & query);
 
     inline int16_t get_current_book_index() { return current_book_index; }
     inline void    set_current_book_index(int16_t idx) { current_book_index = idx; }
@@ -78,6 +78,10 @@ class EventMgr
     void loop();
 
     const Event & get_event();
+
+    #if EPUB_INKPLATE_BUILD
+      bool event_pending();
+    #endif
     
     #if EPUB_LINUX_BUILD
       #if TOUCH_TRIAL
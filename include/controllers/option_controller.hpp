@@ -14,6 +14,7 @@ class OptionController
 
     bool main_form_is_shown;
     bool font_form_is_shown;
+    bool search_form_is_shown;
     bool books_refresh_needed;
 
     #if DATE_TIME_RTC
@@ -28,6 +29,7 @@ class OptionController
   public:
     OptionController() : main_form_is_shown(false), 
                          font_form_is_shown(false),
+                         search_form_is_shown(false),
                          books_refresh_needed(false), 
                          #if DATE_TIME_RTC
                            date_time_form_is_shown(false),
@@ -44,6 +46,7 @@ class OptionController
      
     inline void        set_main_form_is_shown() { main_form_is_shown      = true; }
     inline void        set_font_form_is_shown() { font_form_is_shown      = true; }
+    inline void      set_search_form_is_shown() { search_form_is_shown    = true; }
 
     #if DATE_TIME_RTC
       inline void set_date_time_form_is_shown() { date_time_form_is_shown = true; }
@@ -57,6 +60,7 @@ class OptionController
       wait_for_key_after_wifi   = true; 
       main_form_is_shown        = false;
       font_form_is_shown        = false;
+      search_form_is_shown      = false;
       #if DATE_TIME_RTC
         date_time_form_is_shown = false;
       #endif
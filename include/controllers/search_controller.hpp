@@ -0,0 +1,54 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include "controllers/event_mgr.hpp"
+
+#include <string>
+
+/**
+ * @brief Search inside the current e-book
+ *
+ * The search runs while the user is not interacting (see idle()). Any
+ * input stops it, and the hits found so far are shown. Selecting a hit
+ * shows its page in the book. If the page is not located yet (the pages
+ * location being computed), a message is shown instead, up to the next
+ * input.
+ */
+class SearchController
+{
+  private:
+    static constexpr char const * TAG = "SearchController";
+
+    std::string query;
+    int16_t     current_entry_index;
+    bool        msg_shown;
+
+    void show_results();
+    void show_hit(int16_t entry_index);
+
+  public:
+    SearchController() : current_entry_index(-1), msg_shown(false) {}
+
+    void input_event(const EventMgr::Event & event);
+    void enter();
+    void leave(bool going_to_deep_sleep = false);
+
+    /**
+     * @brief Search in the next part of the book
+     *
+     * @return true Some work was done, there may be more.
+     */
+    bool idle();
+
+    inline void set_query(const char * the_query) { query = the_query; }
+};
+
+#if __SEARCH_CONTROLLER__
+  SearchController search_controller;
+#else
+  extern SearchController search_controller;
+#endif
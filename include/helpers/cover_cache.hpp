@@ -0,0 +1,67 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include <list>
+
+/**
+ * @brief Book cover bitmaps of recently shown books
+ *
+ * A small least recently used cache of fixed size entries, keyed by the
+ * book id. The capacity is set by the books list viewers to the number of
+ * books shown on a page, such that going back and forth between a page
+ * entries (highlighting) doesn't read the covers again from the SD card.
+ *
+ * Buffers are reused when an entry is evicted: no memory allocation is
+ * done once the cache is full.
+ */
+class CoverCache
+{
+  public:
+    CoverCache(uint32_t the_entry_size) : entry_size(the_entry_size), capacity(1) { }
+   ~CoverCache() { clear(); }
+
+    /**
+     * @brief Set the number of covers kept
+     *
+     * Least recently used entries are removed if there is more than that.
+     */
+    void set_capacity(uint16_t count);
+
+    /**
+     * @brief Retrieve a cover
+     *
+     * @return The cover buffer, or nullptr if not in the cache.
+     */
+    const uint8_t * get(uint32_t id);
+
+    /**
+     * @brief Get a buffer to receive a cover
+     *
+     * The buffer is recorded as the most recently used entry. If the cover
+     * cannot be loaded, the entry must be removed with forget().
+     *
+     * @return The buffer of entry_size bytes, or nullptr if out of memory.
+     */
+    uint8_t * make_room(uint32_t id);
+
+    void forget(uint32_t id);
+    void clear();
+
+    inline uint16_t get_count() const { return entries.size(); }
+
+  private:
+    static constexpr char const * TAG = "CoverCache";
+
+    struct Entry {
+      uint32_t  id;
+      uint8_t * data;
+    };
+
+    std::list<Entry> entries; ///< Most recently used first
+    uint32_t         entry_size;
+    uint16_t         capacity;
+};
@@ -0,0 +1,181 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include <climits>
+
+/**
+ * @brief Screen regions modified since the last update
+ *
+ * The Screen drawing methods report the rectangles they touch. Rectangles
+ * close to each other are merged, such that a page of text ends up as a
+ * few regions. When MAX_REGIONS is reached, the new rectangle is merged
+ * with the region growing the least.
+ *
+ * The ghosting budget (the number of partial updates allowed before a full
+ * update is required) is accounted per horizontal band of the screen: a
+ * partial update only consumes the budget of the bands it touches. This
+ * way, a menu highlight moving back and forth doesn't force a full update
+ * of the whole screen sooner than a regular page turn would.
+ *
+ * Coordinates are in the screen (user) orientation.
+ */
+class DirtyRegions
+{
+  public:
+    static constexpr uint8_t MAX_REGIONS = 8;
+    static constexpr uint8_t BAND_COUNT  = 16;
+    static constexpr int16_t MERGE_GAP   = 16;  ///< Rectangles closer than this are merged
+
+    struct Region { int16_t x_min, y_min, x_max, y_max; };  ///< max values are exclusive
+
+    DirtyRegions() : count(0), width(0), height(0) {
+      for (auto & c : partial_counts) c = 0;
+    }
+
+    inline void set_screen_size(uint16_t w, uint16_t h) { width = w; height = h; count = 0; }
+
+    inline bool            is_empty() const { return count == 0; }
+    inline uint8_t        get_count() const { return count;      }
+    inline const Region * begin()     const { return regions;    }
+    inline const Region * end()       const { return regions + count; }
+
+    inline void clear() { count = 0; }
+
+    inline void set_all() {
+      regions[0] = { 0, 0, (int16_t) width, (int16_t) height };
+      count = 1;
+    }
+
+    void add(Dim dim, Pos pos) {
+      Region r = {
+        (int16_t) pos.x,
+        (int16_t) pos.y,
+        (int16_t) (((pos.x + dim.width ) > width ) ? width  : (pos.x + dim.width )),
+        (int16_t) (((pos.y + dim.height) > height) ? height : (pos.y + dim.height))
+      };
+      if ((r.x_min >= r.x_max) || (r.y_min >= r.y_max)) return;
+
+      // Most of the time, the rectangle is next to the last one added (same line of text).
+
+      for (int8_t i = count - 1; i >= 0; i--) {
+        if (close(regions[i], r)) {
+          merge(regions[i], r);
+          absorb(i);
+          return;
+        }
+      }
+
+      if (count < MAX_REGIONS) {
+        regions[count++] = r;
+        return;
+      }
+
+      uint8_t best      = 0;
+      int32_t best_cost = INT32_MAX;
+      for (uint8_t i = 0; i < count; i++) {
+        Region  m    = regions[i];
+        merge(m, r);
+        int32_t cost = area(m) - area(regions[i]);
+        if (cost < best_cost) { best = i; best_cost = cost; }
+      }
+      merge(regions[best], r);
+      absorb(best);
+    }
+
+    /**
+     * @brief Bounding rectangle of all regions
+     */
+    Region bounds() const {
+      Region b = { (int16_t) width, (int16_t) height, 0, 0 };
+      for (auto & r : *this) merge(b, r);
+      return b;
+    }
+
+    /**
+     * @brief Check if a band touched by the regions has exhausted its budget
+     */
+    bool full_update_required() const {
+      bool touched[BAND_COUNT];
+      get_touched_bands(touched);
+      for (uint8_t i = 0; i < BAND_COUNT; i++) {
+        if (touched[i] && (partial_counts[i] <= 0)) return true;
+      }
+      return false;
+    }
+
+    /**
+     * @brief Account for a partial update of the regions
+     *
+     * @param exhaust If true, the touched bands will require a full update next time.
+     */
+    void partial_update_done(bool exhaust = false) {
+      bool touched[BAND_COUNT];
+      get_touched_bands(touched);
+      for (uint8_t i = 0; i < BAND_COUNT; i++) {
+        if (touched[i]) partial_counts[i] = exhaust ? 0 : (partial_counts[i] - 1);
+      }
+      count = 0;
+    }
+
+    void full_update_done(int16_t partial_count_allowed) {
+      for (auto & c : partial_counts) c = partial_count_allowed;
+      count = 0;
+    }
+
+    inline void force_full_update() {
+      for (auto & c : partial_counts) c = 0;
+    }
+
+  private:
+    Region   regions[MAX_REGIONS];
+    int16_t  partial_counts[BAND_COUNT];
+    uint8_t  count;
+    uint16_t width, height;
+
+    static inline int32_t area(const Region & r) {
+      return (int32_t) (r.x_max - r.x_min) * (r.y_max - r.y_min);
+    }
+
+    static inline bool close(const Region & a, const Region & b) {
+      return (a.x_min <= (b.x_max + MERGE_GAP)) && (b.x_min <= (a.x_max + MERGE_GAP)) &&
+             (a.y_min <= (b.y_max + MERGE_GAP)) && (b.y_min <= (a.y_max + MERGE_GAP));
+    }
+
+    static inline void merge(Region & a, const Region & b) {
+      if (b.x_min < a.x_min) a.x_min = b.x_min;
+      if (b.y_min < a.y_min) a.y_min = b.y_min;
+      if (b.x_max > a.x_max) a.x_max = b.x_max;
+      if (b.y_max > a.y_max) a.y_max = b.y_max;
+    }
+
+    // A region that grew can now be close to others: merge them into it.
+    void absorb(uint8_t idx) {
+      bool merged = true;
+      while (merged) {
+        merged = false;
+        for (uint8_t i = 0; i < count; i++) {
+          if ((i != idx) && close(regions[idx], regions[i])) {
+            merge(regions[idx], regions[i]);
+            regions[i] = regions[--count];
+            if (idx == count) idx = i;
+            merged = true;
+            break;
+          }
+        }
+      }
+    }
+
+    void get_touched_bands(bool * touched) const {
+      for (uint8_t i = 0; i < BAND_COUNT; i++) touched[i] = false;
+      if (height == 0) return;
+      for (auto & r : *this) {
+        uint8_t first = (r.y_min * BAND_COUNT) / height;
+        uint8_t last  = ((r.y_max - 1) * BAND_COUNT) / height;
+        for (uint8_t i = first; (i <= last) && (i < BAND_COUNT); i++) touched[i] = true;
+      }
+    }
+};
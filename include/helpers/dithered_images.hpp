@@ -0,0 +1,92 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include <list>
+#include <vector>
+
+/**
+ * @brief Gray images dithered to 1 bit per pixel, kept for repaint
+ *
+ * In 1 bit resolution, an image must be dithered before being drawn. The
+ * same images are painted again and again (a page shown again, book covers
+ * in the books directory viewers): the dithered result is kept, such that
+ * a repaint is a straight copy to the frame buffer.
+ *
+ * Images are identified by a hash of their gray pixels and dimensions: the
+ * bitmaps are copied in the page display list each time a page is built,
+ * so their address is not a good key. The dithered image is kept in
+ * screen coordinates, one bit per pixel, bit 7 being the leftmost pixel and
+ * 1 being black. The Screen blitter takes care of the orientation.
+ *
+ * The least recently used images are removed when MAX_SIZE is reached. An
+ * image that can't be kept (larger than MAX_SIZE, or out of memory) is
+ * dithered again at each paint, a row at a time (see dither_row()).
+ */
+class DitheredImages
+{
+  public:
+    static constexpr uint32_t MAX_SIZE = 256 * 1024; ///< Bytes of dithered pixels kept
+
+    DitheredImages() : size(0) { }
+    ~DitheredImages() { clear(); }
+
+    /**
+     * @brief Retrieve the dithered version of a gray image
+     *
+     * @param gray 8 bits per pixel image, 0 being black.
+     * @param dim Image dimensions.
+     * @param pitch Returned number of bytes per dithered image row.
+     * @return The dithered image, nullptr if it can't be kept. It stays
+     *         valid until the next call.
+     */
+    const uint8_t * get(const uint8_t * gray, Dim dim, uint16_t & pitch);
+
+    /**
+     * @brief Dither an image a row at a time, without keeping it
+     *
+     * To be used when get() returns nullptr. start_rows() is called once
+     * for the image, then dither_row() for each row, from the top.
+     *
+     * @param gray The gray pixels of the row.
+     * @return The dithered row. It stays valid until the next call.
+     */
+    void start_rows(uint16_t width);
+    const uint8_t * dither_row(const uint8_t * gray, uint16_t width);
+
+    void clear();
+
+    /**
+     * @brief Floyd-Steinberg dithering to 1 bit per pixel
+     *
+     * Errors are kept in fixed point (1/16 units) in a single row buffer of
+     * width + 1 entries.
+     */
+    static void dither(const uint8_t * gray, Dim dim, uint8_t * out, int16_t * errors);
+
+    /**
+     * @brief A row of dither(), the errors coming from the previous one
+     */
+    static void dither_row(const uint8_t * gray, uint16_t width, uint8_t * out, int16_t * errors);
+
+    static inline uint16_t get_pitch(Dim dim) { return (dim.width + 7) >> 3; }
+
+  private:
+    static constexpr char const * TAG = "DitheredImages";
+
+    struct Image {
+      uint64_t  hash;
+      Dim       dim;
+      uint8_t * bits;
+    };
+
+    std::list<Image>     images; ///< Most recently used first
+    uint32_t             size;
+    std::vector<int16_t> errors;
+    std::vector<uint8_t> row;    ///< Output of dither_row()
+
+    static uint64_t hash(const uint8_t * gray, Dim dim);
+};
@@ -0,0 +1,313 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include "models/glyph_rle.hpp"
+
+/**
+ * @brief Frame buffer pixel addressing and blitters
+ *
+ * The e-ink frame buffers are organized in panel lines, the panel being in
+ * landscape mode. Depending on the screen orientation, a screen row is either
+ * a panel line (BOTTOM, TOP) or a panel column (LEFT, RIGHT).
+ *
+ * The set_pixel methods are the reference, one pixel at a time, addressing.
+ * The blitters draw a whole glyph or image row at once. They rely on the fact
+ * that, for a given orientation, the pixels along a panel line are at
+ * consecutive bit (1 bit resolution) or nibble (3 bits resolution)
+ * positions in memory, going forward or backward:
+ *
+ *   - 1 bit: bit index q = (byte_index * 8) + bit_number, bit 0 being 0x01;
+ *   - 3 bits: nibble index q = (byte_index * 2) + 1 for the low nibble.
+ *
+ * In 1 bit resolution, 8 pixels are written at once. For LEFT and RIGHT
+ * orientations, glyphs are transposed 8x8 pixels at a time, such that each
+ * glyph column is written along the panel line it belongs to.
+ *
+ * Writes are byte-wide: the InkPlate-10 line size is not a multiple of 4
+ * bytes and the ESP32 doesn't allow for unaligned 32 bits accesses.
+ *
+ * The FB class must supply get_data(), get_data_size() and get_line_size().
+ */
+class FrameBlitter
+{
+  public:
+    enum class Orientation : int8_t { LEFT, RIGHT, BOTTOM, TOP };
+
+    // ----- Reference addressing -----
+
+    template <Orientation O, class FB>
+    static inline void set_pixel_1bit(FB & fb, uint32_t col, uint32_t row, uint8_t color) {
+      uint8_t * temp;
+      uint8_t   mask;
+      if (O == Orientation::LEFT) {
+        temp = &(fb.get_data())[fb.get_data_size() - (fb.get_line_size() * (col + 1)) + (row >> 3)];
+        mask = LUT1BIT_INV[row & 7];
+      }
+      else if (O == Orientation::RIGHT) {
+        temp = &(fb.get_data())[(fb.get_line_size() * (col + 1)) - (row >> 3) - 1];
+        mask = LUT1BIT[row & 7];
+      }
+      else if (O == Orientation::BOTTOM) {
+        temp = &(fb.get_data())[fb.get_line_size() * row + (col >> 3)];
+        mask = LUT1BIT_INV[col & 7];
+      }
+      else {
+        temp = &(fb.get_data())[fb.get_data_size() - (fb.get_line_size() * row) - (col >> 3)];
+        mask = LUT1BIT[col & 7];
+      }
+      if (color == 1)
+        *temp = *temp | mask;
+      else
+        *temp = (*temp & ~mask);
+    }
+
+    template <Orientation O, class FB>
+    static inline void set_pixel_3bit(FB & fb, uint32_t col, uint32_t row, uint8_t color) {
+      if (O == Orientation::LEFT) {
+        uint8_t * temp = &(fb.get_data())[fb.get_data_size() - (fb.get_line_size() * (col + 1)) + (row >> 1)];
+        if (row & 1)
+          *temp = (*temp & 0xF0) | color;
+        else
+          *temp = (*temp & 0x0F) | (color << 4);
+      }
+      else if (O == Orientation::RIGHT) {
+        uint8_t * temp = &(fb.get_data())[(fb.get_line_size() * (col + 1)) - (row >> 1) - 1];
+        if (row & 1)
+          *temp = (*temp & 0x0F) | (color << 4);
+        else
+          *temp = (*temp & 0xF0) | color;
+      }
+      else if (O == Orientation::BOTTOM) {
+        uint8_t * temp = &(fb.get_data())[fb.get_line_size() * row + (col >> 1)];
+        if (col & 1)
+          *temp = (*temp & 0xF0) | color;
+        else
+          *temp = (*temp & 0x0F) | (color << 4);
+      }
+      else {
+        uint8_t * temp = &(fb.get_data())[fb.get_data_size() - (fb.get_line_size() * row) - (col >> 1)];
+        if (col & 1)
+          *temp = (*temp & 0x0F) | (color << 4);
+        else
+          *temp = (*temp & 0xF0) | color;
+      }
+    }
+
+    // ----- Blitters -----
+
+    /**
+     * @brief Draw a 1 bit per pixel glyph (bit 7 of a byte is the leftmost pixel)
+     *
+     * Only the black pixels are drawn. x_max and y_max are the screen limits,
+     * already clipped.
+     */
+    template <Orientation O, class FB>
+    static inline void glyph_1bit(FB & fb, const uint8_t * bitmap, Pos pos, uint16_t pitch,
+                                  uint32_t x_max, uint32_t y_max) {
+      blit_1bit<O, false>(fb, bitmap, pos, pitch, x_max, y_max);
+    }
+
+    /**
+     * @brief Draw a 1 bit per pixel image, as prepared by DitheredImages
+     *
+     * Same as glyph_1bit, but the white pixels are drawn too.
+     */
+    template <Orientation O, class FB>
+    static inline void image_1bit(FB & fb, const uint8_t * bitmap, Pos pos, uint16_t pitch,
+                                  uint32_t x_max, uint32_t y_max) {
+      blit_1bit<O, true>(fb, bitmap, pos, pitch, x_max, y_max);
+    }
+
+    /**
+     * @brief Draw a glyph kept as runs of screen levels (see GlyphRLE)
+     */
+    template <Orientation O, class FB>
+    static void glyph_3bit(FB & fb, const uint8_t * runs, Dim dim, Pos pos,
+                           uint32_t x_max, uint32_t y_max) {
+      uint8_t * data = fb.get_data();
+      int32_t   step = 2 * line_step<O>(fb);
+
+      GlyphRLE::decode(runs, dim.height,
+        [&](uint16_t x, uint16_t y, uint8_t length, uint8_t level) {
+          uint32_t j   = pos.y + y;
+          uint32_t i   = pos.x + x;
+          if ((j >= y_max) || (i >= x_max)) return;
+          uint32_t n   = ((i + length) > x_max) ? (x_max - i) : length;
+          int32_t  q   = nibble_index<O>(fb, i, j);
+          if (along_x<O>()) {
+            fill_nibbles(data, forward<O>() ? q : (q - (int32_t) n + 1), n, level);
+          }
+          else {
+            for (; n > 0; n--, q += step) set_nibble(data, q, level);
+          }
+        });
+    }
+
+    /**
+     * @brief Draw an 8 bits per pixel gray image in 3 bits resolution
+     */
+    template <Orientation O, class FB>
+    static void bitmap_3bit(FB & fb, const uint8_t * bitmap, Dim dim, Pos pos,
+                            uint32_t x_max, uint32_t y_max) {
+      uint8_t * data  = fb.get_data();
+      int32_t   along = along_x<O>() ? (forward<O>() ? 1 : -1) : (2 * line_step<O>(fb));
+
+      for (uint32_t j = pos.y; j < y_max; j++, bitmap += dim.width) {
+        int32_t q = nibble_index<O>(fb, pos.x, j);
+        for (uint32_t i = pos.x, p = 0; i < x_max; i++, p++, q += along) {
+          set_nibble(data, q, bitmap[p] >> 5);
+        }
+      }
+    }
+
+  private:
+    template <Orientation O, bool OPAQUE, class FB>
+    static void blit_1bit(FB & fb, const uint8_t * bitmap, Pos pos, uint16_t pitch,
+                          uint32_t x_max, uint32_t y_max) {
+      uint8_t * data = fb.get_data();
+
+      if (along_x<O>()) {
+        uint32_t width = x_max - pos.x;
+        for (uint32_t j = pos.y; j < y_max; j++, bitmap += pitch) {
+          int32_t q0 = bit_index<O>(fb, pos.x, j);
+          for (uint32_t k = 0, i = 0; i < width; k++, i += 8) {
+            uint8_t bits = bitmap[k];
+            if (!OPAQUE && (bits == 0)) continue;
+            uint8_t mask = ((width - i) < 8) ? (0xFF << (8 - (width - i))) : 0xFF;
+            put_bits<O, OPAQUE>(data, q0, i, bits & mask, mask);
+          }
+        }
+      }
+      else {
+        // A bitmap column goes along a panel line: blocks of 8x8 pixels are transposed
+        uint32_t width  = x_max - pos.x;
+        uint32_t height = y_max - pos.y;
+        int32_t  step   = 8 * line_step<O>(fb);
+        for (uint32_t c = 0; c < width; c += 8) {
+          uint8_t         col_mask  = ((width - c) < 8) ? (0xFF << (8 - (width - c))) : 0xFF;
+          uint32_t        col_count = ((width - c) < 8) ? (width - c) : 8;
+          int32_t         q0        = bit_index<O>(fb, pos.x + c, pos.y);
+          const uint8_t * src       = bitmap + (c >> 3);
+          for (uint32_t j = 0; j < height; j += 8) {
+            uint8_t block[8];
+            uint8_t any = 0;
+            for (uint32_t r = 0; r < 8; r++) {
+              if ((j + r) < height) { block[r] = *src & col_mask; src += pitch; }
+              else block[r] = 0;
+              any |= block[r];
+            }
+            if (!OPAQUE && (any == 0)) continue;
+            uint8_t row_mask = ((height - j) < 8) ? (0xFF << (8 - (height - j))) : 0xFF;
+            transpose8(block);
+            int32_t q = q0;
+            for (uint32_t k = 0; k < col_count; k++, q += step) {
+              if (OPAQUE || (block[k] != 0)) put_bits<O, OPAQUE>(data, q, j, block[k], row_mask);
+            }
+          }
+        }
+      }
+    }
+
+    static constexpr uint8_t LUT1BIT[8]     = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+    static constexpr uint8_t LUT1BIT_INV[8] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+    static constexpr uint8_t REVERSE4[16]   = { 0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+                                                0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF };
+
+    /// Screen rows are panel lines
+    template <Orientation O> static constexpr bool along_x() {
+      return (O == Orientation::BOTTOM) || (O == Orientation::TOP);
+    }
+
+    /// Memory position increases with the screen coordinate along a panel line
+    template <Orientation O> static constexpr bool forward() {
+      return (O == Orientation::BOTTOM) || (O == Orientation::LEFT);
+    }
+
+    template <Orientation O, class FB>
+    static inline int32_t bit_index(FB & fb, uint32_t col, uint32_t row) {
+      int32_t s = fb.get_data_size();
+      int32_t l = fb.get_line_size();
+      if      (O == Orientation::LEFT  ) return (8 * (s - (l * (col + 1)))) + row;
+      else if (O == Orientation::RIGHT ) return (8 * ((l * (col + 1)) - 1)) + 7 - row;
+      else if (O == Orientation::BOTTOM) return (8 * l * row) + col;
+      else                               return (8 * (s - (l * row))) + 7 - col;
+    }
+
+    template <Orientation O, class FB>
+    static inline int32_t nibble_index(FB & fb, uint32_t col, uint32_t row) {
+      int32_t s = fb.get_data_size();
+      int32_t l = fb.get_line_size();
+      if      (O == Orientation::LEFT  ) return (2 * (s - (l * (col + 1)))) + row;
+      else if (O == Orientation::RIGHT ) return (2 * l * (col + 1)) - 1 - row;
+      else if (O == Orientation::BOTTOM) return (2 * l * row) + col;
+      else                               return (2 * (s - (l * row))) + 1 - col;
+    }
+
+    /// Byte address change when the screen column increases, for LEFT and RIGHT
+    template <Orientation O, class FB>
+    static inline int32_t line_step(FB & fb) {
+      return (O == Orientation::LEFT) ? -(int32_t) fb.get_line_size() : (int32_t) fb.get_line_size();
+    }
+
+    /**
+     * @brief Transpose a block of 8x8 pixels, bit 7 being the leftmost pixel
+     * 
+     * On return, byte k contains column k, bit 7 being the top pixel.
+     */
+    static inline void transpose8(uint8_t * block) {
+      uint32_t x = (block[0] << 24) | (block[1] << 16) | (block[2] << 8) | block[3];
+      uint32_t y = (block[4] << 24) | (block[5] << 16) | (block[6] << 8) | block[7];
+      uint32_t t;
+
+      t = (x ^ (x >>  7)) & 0x00AA00AA; x = x ^ t ^ (t <<  7);
+      t = (y ^ (y >>  7)) & 0x00AA00AA; y = y ^ t ^ (t <<  7);
+      t = (x ^ (x >> 14)) & 0x0000CCCC; x = x ^ t ^ (t << 14);
+      t = (y ^ (y >> 14)) & 0x0000CCCC; y = y ^ t ^ (t << 14);
+      t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+      y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+
+      block[0] = t >> 24; block[1] = t >> 16; block[2] = t >> 8; block[3] = t;
+      block[4] = y >> 24; block[5] = y >> 16; block[6] = y >> 8; block[7] = y;
+    }
+
+    static inline uint8_t reverse(uint8_t b) { return (REVERSE4[b & 0x0F] << 4) | REVERSE4[b >> 4]; }
+
+    /**
+     * @brief Put 8 pixels (bit 7 first) located at offset along the panel line starting at q0
+     *
+     * Pixels outside of mask are left untouched. If not OPAQUE, only the black
+     * pixels are written.
+     */
+    template <Orientation O, bool OPAQUE>
+    static inline void put_bits(uint8_t * data, int32_t q0, uint32_t offset, uint8_t bits, uint8_t mask) {
+      // Bytes without any pixel in mask are not accessed: near a panel line end,
+      // they could be outside of the frame buffer.
+      int32_t  q = forward<O>() ? (q0 + offset) : (q0 - offset - 7);
+      int32_t  b = q >> 3;
+      uint16_t v = (forward<O>() ? reverse(bits) : bits) << (q & 7);
+      uint16_t m = OPAQUE ? ((forward<O>() ? reverse(mask) : mask) << (q & 7)) : v;
+      if (m & 0xFF) data[b]     = (OPAQUE ? (data[b]     & ~m)        : data[b]    ) | v;
+      if (m >> 8)   data[b + 1] = (OPAQUE ? (data[b + 1] & ~(m >> 8)) : data[b + 1]) | (v >> 8);
+    }
+
+    static inline void set_nibble(uint8_t * data, int32_t q, uint8_t level) {
+      uint8_t * temp = &data[q >> 1];
+      if (q & 1)
+        *temp = (*temp & 0xF0) | level;
+      else
+        *temp = (*temp & 0x0F) | (level << 4);
+    }
+
+    static inline void fill_nibbles(uint8_t * data, int32_t q, uint32_t count, uint8_t level) {
+      if ((q & 1) && (count > 0)) { set_nibble(data, q++, level); count--; }
+      if (count >= 2) {
+        memset(&data[q >> 1], (level << 4) | level, count >> 1);
+        q += count & ~1;
+      }
+      if (count & 1) set_nibble(data, q, level);
+    }
+};
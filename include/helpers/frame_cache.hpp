@@ -0,0 +1,75 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include <list>
+
+/**
+ * @brief Rendered frame buffers of recently shown pages
+ *
+ * Each frame buffer is kept packed (see FramePacker) with the identification
+ * of the page it is showing. Getting back to one of these pages is then a
+ * copy to the screen frame buffer, without having to load, layout and paint
+ * the page again.
+ *
+ * The key is made of the page location (itemref index and offset) and of a
+ * format hash covering everything else having an impact on the rendering
+ * (book file, format parameters, pixel resolution).
+ */
+class FrameCache
+{
+  public:
+    static constexpr uint8_t  MAX_FRAMES = 4;
+    static constexpr uint32_t MAX_SIZE   = 512 * 1024; ///< Bytes of packed frames kept
+
+    struct Key {
+      int16_t  itemref_index;
+      int32_t  offset;
+      uint32_t format_hash;
+      inline bool operator==(const Key & other) const {
+        return (itemref_index == other.itemref_index) &&
+               (offset        == other.offset       ) &&
+               (format_hash   == other.format_hash  );
+      }
+    };
+
+    FrameCache() : size(0) { }
+   ~FrameCache() { clear(); }
+
+    /**
+     * @brief Keep a copy of a frame buffer
+     *
+     * Replaces a frame with the same key. The least recently used frames are
+     * removed to make room.
+     */
+    void keep(const Key & key, const uint8_t * frame, uint32_t frame_size);
+
+    /**
+     * @brief Copy back a kept frame buffer
+     *
+     * @return true The frame was found and is of the same size.
+     */
+    bool restore(const Key & key, uint8_t * frame, uint32_t frame_size);
+
+    bool contains(const Key & key) const;
+
+    void clear();
+
+  private:
+    static constexpr char const * TAG = "FrameCache";
+
+    struct Frame {
+      Key       key;
+      uint32_t  frame_size;
+      uint32_t  packed_size;
+      uint8_t * data;
+    };
+
+    std::list<Frame> frames; ///< Most recently used first
+    uint32_t         size;
+
+    void remove(std::list<Frame>::iterator it);
+};
@@ -0,0 +1,90 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include <cstring>
+
+/**
+ * @brief Frame buffer compression
+ *
+ * A rendered page is mostly made of long runs of white bytes. The PackBits
+ * scheme is used: a control byte n followed by n + 1 literal bytes
+ * (n <= 127), or by a single byte to be repeated 257 - n times (n >= 129).
+ * In the worst case, the packed size is size + (size / 128) + 1.
+ */
+class FramePacker
+{
+  public:
+    static constexpr uint32_t max_packed_size(uint32_t size) { return size + (size / 128) + 1; }
+
+    /**
+     * @brief Pack a frame
+     *
+     * @param dst Destination, at least max_packed_size() long. If nullptr,
+     *            only the packed size is computed.
+     * @return The packed size.
+     */
+    static uint32_t pack(const uint8_t * src, uint32_t size, uint8_t * dst) {
+      uint32_t out = 0;
+      uint32_t i   = 0;
+
+      while (i < size) {
+        uint32_t run = 1;
+        while (((i + run) < size) && (run < 128) && (src[i + run] == src[i])) run++;
+
+        if (run >= 2) {
+          if (dst != nullptr) { dst[out] = 257 - run; dst[out + 1] = src[i]; }
+          out += 2;
+          i   += run;
+        }
+        else {
+          // Literals up to the next run of at least 3 bytes
+          uint32_t count = 1;
+          while (((i + count) < size) && (count < 128)) {
+            if (((i + count + 2) < size) &&
+                (src[i + count] == src[i + count + 1]) &&
+                (src[i + count] == src[i + count + 2])) break;
+            count++;
+          }
+          if (dst != nullptr) {
+            dst[out] = count - 1;
+            memcpy(&dst[out + 1], &src[i], count);
+          }
+          out += count + 1;
+          i   += count;
+        }
+      }
+      return out;
+    }
+
+    /**
+     * @brief Unpack a frame
+     *
+     * @return true The packed data was exactly expanding to size bytes.
+     */
+    static bool unpack(const uint8_t * src, uint32_t packed_size, uint8_t * dst, uint32_t size) {
+      uint32_t in  = 0;
+      uint32_t out = 0;
+
+      while (in < packed_size) {
+        uint8_t n = src[in++];
+        if (n < 128) {
+          uint32_t count = n + 1;
+          if (((in + count) > packed_size) || ((out + count) > size)) return false;
+          memcpy(&dst[out], &src[in], count);
+          in  += count;
+          out += count;
+        }
+        else if (n > 128) {
+          uint32_t count = 257 - n;
+          if ((in >= packed_size) || ((out + count) > size)) return false;
+          memset(&dst[out], src[in++], count);
+          out += count;
+        }
+      }
+      return out == size;
+    }
+};
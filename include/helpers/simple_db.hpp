@@ -6,6 +6,9 @@
 #include "global.hpp"
 
 #include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
 
 /**
  * @brief Very simple database tool
@@ -13,20 +16,38 @@
  * A *very* simple, one table database tool. Each record is having a single size that can
  * be different from each other. 
  * 
- * The tool maintains the location of each record in an array in RAM. No
- * index beyond that. When a database file is open, the tool computes the
- * location of each record. All record in file are considered valid.
+ * The tool maintains the location and size of each record in vectors in RAM.
+ * No index beyond that. The number of records is only limited by the memory
+ * available for these vectors (8 bytes per record).
  * 
- * A record can be marked as deleted using the set_deleted() method. This
- * will only mark it as deleted in memory. A new database needs to be
- * created and filled with valid records by the application to get rid of
- * marked as deleted records.
+ * A record can be marked as deleted using the set_deleted() method. The
+ * space of a deleted record is reused by the next record added with the
+ * same size. The compact_step() method is moving, one at a time, the last
+ * records of the file in the space of deleted ones, such that the file
+ * doesn't grow with the deletions. A record keeps its index while the
+ * database is open, whatever its location in the file.
  * 
- * No memory allocation is done in the tool. This is the responsability
- * of the calling application.
+ * No memory allocation is done in the tool for the records. This is the 
+ * responsability of the calling application.
  * 
- * Each record is preceeded with its size in file. Nothing else is kept in file
- * then the data associated with the record.
+ * Each record is preceeded with its size in file, with the DELETED_FLAG set
+ * if the record has been deleted. When the database is closed, the record
+ * locations and sizes are saved in a footer after the last record, validated
+ * with a checksum. Opening the database is then a matter of reading the
+ * footer. If the footer is missing or invalid (older database, or the device
+ * was reset before the database was closed), the records are retrieved
+ * scanning the file.
+ * 
+ * File layout:
+ * 
+ *     [size][record data] ... [FOOTER_MARK][FooterHeader][offsets][sizes][deleted bitmap][Trailer]
+ * 
+ * The footer is invalidated with the first change made to the file. When
+ * records are added, they are written over the footer, followed by a
+ * FOOTER_MARK such that a file scan will stop at the end of the last record.
+ * 
+ * Moving a record is done through a journal file, such that a reset in the
+ * middle of it doesn't leave the record twice (or not at all) in the file.
  * 
  * (c) 2020, Guy Turcotte
  */
@@ -36,35 +57,80 @@ class SimpleDB
   private:
     static constexpr char const * TAG = "SimpleDB";
 
-    static const uint16_t MAX_RECORD_COUNT = 1000;
-
-    FILE * db_file;
-
-    bool     db_is_open;
-    bool     some_record_deleted;
-    int32_t  record_offset[MAX_RECORD_COUNT]; ///< record offset in file 
-    bool     is_deleted[MAX_RECORD_COUNT];    ///< true if record is deleted
-    uint16_t record_count;
-    uint32_t file_size;
-    uint16_t current_record_idx; ///< Index of current record in record_offset
+    static constexpr uint8_t FOOTER_VERSION = 2;
+    static constexpr int32_t FOOTER_MARK    = -1;          ///< In place of a record size: no more records
+    static constexpr int32_t DELETED_FLAG   = 0x40000000;  ///< Set in the record size of a deleted record
+    static constexpr int32_t VACANT         = -1;          ///< Offset of an index not used by a record
+
+    #pragma pack(push, 1)
+      struct FooterHeader {
+        int32_t  mark;                ///< FOOTER_MARK
+        uint8_t  version;
+        uint32_t record_count;
+        uint32_t data_size;           ///< Where the footer starts in file
+      };
+      struct Journal {
+        char     magic[4];
+        int32_t  from;                ///< Offset of the record being moved
+        int32_t  to;                  ///< Offset of the deleted record it is replacing
+        int32_t  size;
+      };
+      struct Trailer {
+        uint32_t checksum;            ///< Of the footer, from FooterHeader to the bitmap
+        uint32_t footer_size;         ///< Including the Trailer
+        char     magic[4];
+      };
+    #pragma pack(pop)
+
+    FILE *      db_file;
+    std::string journal_filename;
+
+    bool                 db_is_open;
+    bool                 compaction_blocked;  ///< No deleted record of the size of the last one
+    bool                 footer_is_valid;     ///< The footer in file reflects the records and deleted bitmap
+    std::vector<int32_t> record_offset;       ///< record offset in file, VACANT if index not used
+    std::vector<int32_t> record_size;
+    std::vector<uint8_t> deleted_bits;        ///< One bit per record, set if deleted (or vacant)
+    uint32_t             added_idx;           ///< Index of the last record added
+    uint32_t             data_size;           ///< Size of the records part of the file
+    uint32_t             file_size;
+    uint32_t             current_record_idx;  ///< Index of current record in record_offset
+
+    std::multimap<int32_t, uint32_t> free_records;  ///< Deleted records by size, to be reused
+    std::vector<uint32_t>            vacant_idxs;   ///< Indexes to be reused
+
+    bool load_footer();
+    bool scan();
+    bool save_footer();
+    void invalidate_footer();
+    void build_free_lists();
+    bool write_size(int32_t offset, int32_t size);
+    bool replay_journal();  ///< Returns true if there was a journal
+    void set_deleted(uint32_t idx, bool deleted);
+
+    static uint32_t checksum(const uint8_t * data, uint32_t size);
+
+    inline bool is_deleted(uint32_t idx) const {
+      return (deleted_bits[idx >> 3] >> (idx & 7)) & 1;
+    }
 
   public:
-    SimpleDB() : db_is_open(false), record_count(0), current_record_idx(0) {};
-   ~SimpleDB() { if (db_is_open) fclose(db_file); }
+    SimpleDB() : db_is_open(false), added_idx(0), data_size(0), file_size(0), current_record_idx(0) {};
+   ~SimpleDB() { close(); }
 
     /**
      * @brief Open an existing database file.
      * 
-     * Once opened, the record_offsets vector is builts, scanning
-     * the file to recover each record size. If the db file doesn't exists,
-     * it will be created.
+     * Once opened, the record_offsets vector is retrieved from the footer or,
+     * if not valid, builts scanning the file to recover each record size.
+     * If the db file doesn't exists, it will be created.
      * 
      * @param filename 
      * @return true The file has been opened.
      * @return false 
      */
     bool open(std::string filename);
-    
+
     /**
      * @brief Create a new database.
      * 
@@ -77,19 +143,26 @@ class SimpleDB
      */
     bool create(std::string filename);
 
+    /**
+     * @brief Close the database, saving the footer if required.
+     */
     void close();
-    
-    inline uint16_t             get_current_idx() { return current_record_idx;  }
-    inline void    set_current_idx(int16_t index) { current_record_idx = index; }
-    inline uint16_t            get_record_count() { return record_count;        }
-    inline uint16_t               get_file_size() { return file_size;           }
-    inline bool          is_some_record_deleted() { return some_record_deleted; }
-    inline bool                      is_db_open() { return db_is_open;          }
+
+    inline uint32_t             get_current_idx() { return current_record_idx;   }
+    inline void   set_current_idx(uint32_t index) { current_record_idx = index;  }
+    inline uint32_t            get_record_count() { return record_offset.size(); }
+    inline uint32_t               get_added_idx() { return added_idx;            }
+    inline uint32_t               get_data_size() { return data_size;            }
+    inline bool          is_some_record_deleted() { return !free_records.empty(); }
+    inline bool                      is_db_open() { return db_is_open;           }
+    inline bool                 is_footer_valid() { return footer_is_valid;      }
 
     /**
-     * @brief Add a record at the end of the file.
+     * @brief Add a record.
      * 
-     * Does not change current location.
+     * The record is written in the space of a deleted record of the same 
+     * size if there is one, at the end of the file otherwise. Its index is
+     * then given by get_added_idx(). Does not change current location.
      * 
      * @param record 
      * @param size 
@@ -103,38 +176,40 @@ class SimpleDB
     bool get_partial_record(void * record, int32_t size, int32_t offset);
 
     void show();
-    
+
+    /**
+     * @brief Reclaim the space of deleted records, one step at a time
+     * 
+     * A step is either moving the last record of the file in the space of
+     * a deleted record of the same size, or dropping a deleted record at the 
+     * end of the file. 
+     * 
+     * @return true A step was done, there may be more.
+     */
+    bool compact_step();
+
     /**
      * @brief Get size of the current record.
      * 
      * Returns 0 if at end of the database
      */
     int32_t get_record_size() {
-      if ((current_record_idx >= record_count) || 
-          is_deleted[current_record_idx]) return 0;
-      if (current_record_idx == (record_count - 1)) {
-        return file_size - 
-               record_offset[current_record_idx] - 
-               sizeof(int32_t);
-      }
-      return record_offset[current_record_idx + 1] - 
-             record_offset[current_record_idx] - 
-             sizeof(int32_t);
+      if ((current_record_idx >= record_offset.size()) || 
+          is_deleted(current_record_idx)) return 0;
+      return record_size[current_record_idx];
     }
 
     /**
      * @brief Set current record as deleted.
      * 
      */
-    void set_deleted() { 
-      is_deleted[current_record_idx] = true;
-      some_record_deleted = true; 
-    }
+    void set_deleted();
 
     bool goto_first() {
-      uint16_t idx = 0;
-      while ((idx < record_count) && is_deleted[idx]) idx++;
-      if ((idx < record_count)  && !is_deleted[idx]) {
+      uint32_t idx   = 0;
+      uint32_t count = record_offset.size();
+      while ((idx < count) && is_deleted(idx)) idx++;
+      if (idx < count) {
         current_record_idx = idx;
         return true;
       }
@@ -142,9 +217,10 @@ class SimpleDB
     }
 
     bool goto_next() {
-      uint16_t idx = current_record_idx + 1;
-      while ((idx < record_count) && is_deleted[idx]) idx++;
-      if ((idx < record_count) && !is_deleted[idx]) {
+      uint32_t idx   = current_record_idx + 1;
+      uint32_t count = record_offset.size();
+      while ((idx < count) && is_deleted(idx)) idx++;
+      if (idx < count) {
         current_record_idx = idx;
         return true;
       }
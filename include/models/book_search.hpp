@@ -0,0 +1,149 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include "models/books_search.hpp"
+#include "models/epub.hpp"
+#include "models/page_locs.hpp"
+#include "viewers/page.hpp"
+
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Text search inside the current e-book
+ *
+ * The spine items are retrieved one at a time (through the EPub class and
+ * Unzip) and their text is walked by the HTMLInterpreter, without any layout.
+ * The hits are then located with the same offsets as the pages location, and
+ * are mapped to the page showing them through PageLocs.
+ *
+ * The query words must start consecutive words of the book, in the same
+ * order. Case and accents are ignored (see BooksSearch::tokenize()).
+ *
+ * The search is done in steps, an item per step, while the user is not
+ * interacting (see AppController::idle()), and can be canceled between
+ * them. Only one item is in memory at a time, and at most MAX_HITS hits
+ * are kept.
+ *
+ * When a search goes through the whole book, the items containing each word
+ * are kept in a per-book index (the .sidx file next to the book). The next
+ * searches in that book only walk the items containing all the query words.
+ * The index keeps the book size and modification time: it is built again
+ * if the book is replaced.
+ */
+class BookSearch
+{
+  public:
+    static constexpr uint8_t  MAX_HITS           =    50;
+    static constexpr uint8_t  SNIPPET_SIZE       =    60; ///< Bytes of text around a hit, at most
+    static constexpr uint32_t MAX_INDEX_POSTINGS = 60000; ///< Above, the per-book index is not kept
+
+    struct Hit {
+      PageLocs::PageId location; ///< Item and offset of the hit
+      std::string      snippet;  ///< Text around the hit
+    };
+    typedef std::vector<Hit> Hits;
+
+    BookSearch() : running(false), truncated(false), next_item(0), index_building(false) {
+      item_info.data = nullptr;
+      item_info.css  = nullptr;
+    }
+
+    /**
+     * @brief Prepare a search in the currently opened book
+     *
+     * @param query The words to search for.
+     * @return false The query has no word.
+     */
+    bool start(const std::string & query);
+
+    /**
+     * @brief Search in the next item of the book
+     *
+     * @return true There is more to do.
+     */
+    bool step();
+
+    /**
+     * @brief Stop the search, keeping the hits found so far
+     */
+    void cancel();
+
+    /**
+     * @brief Forget the hits and give the memory back
+     */
+    void clear();
+
+    /**
+     * @brief Page showing a hit
+     *
+     * @return The page id from PageLocs, nullptr if not found.
+     */
+    const PageLocs::PageId * get_page_id(int16_t hit_idx);
+
+    inline const Hits      &     get_hits() const { return hits;      }
+    inline const std::string &  get_query() const { return query;     }
+    inline bool                is_running() const { return running;   }
+    inline bool              is_truncated() const { return truncated; }
+
+    /**
+     * @brief Part of the book searched, in percent
+     */
+    inline int8_t get_progress() const {
+      return items.empty() ? 100 : (next_item * 100) / items.size();
+    }
+
+    static std::string index_filename(const std::string & epub_filename);
+
+    /**
+     * @brief Size and modification time of a book, kept in its index
+     */
+    static uint64_t book_stamp(const std::string & epub_filename);
+
+  private:
+    static constexpr char const * TAG = "BookSearch";
+
+    friend class BookSearchInterp;
+
+    struct Word {
+      std::string  token;
+      int32_t      offset;       ///< Of the word in the item
+      const char * str;          ///< Text containing the word
+      const char * pos;          ///< Start of the word in str
+    };
+
+    std::string              query;
+    std::vector<std::string> query_words;
+    bool                     running;
+    bool                     truncated;
+    Hits                     hits;
+
+    std::vector<uint32_t>    items;        ///< Items to be searched, in book order
+    uint16_t                 next_item;
+
+    EPub::ItemInfo           item_info;
+    Page                     page_out;
+    std::deque<Word>         window;       ///< The last words met, as many as in the query
+
+    BooksSearch              index;        ///< Items containing each word
+    bool                     index_building;
+    std::set<std::string>    item_tokens;  ///< Words of the current item, for the index
+
+    void  search_item(int16_t itemref_index);
+    void   text_found(const char * str, int32_t offset);
+    void     add_word(std::string & token, int32_t offset, const char * str, const char * pos);
+    void     add_hit(const Word & word);
+    void     complete();
+};
+
+#if __BOOK_SEARCH__
+  BookSearch book_search;
+#else
+  extern BookSearch book_search;
+#endif
@@ -6,14 +6,21 @@
 #include "global.hpp"
 
 #include "models/epub.hpp"
+#include "models/epub_probe.hpp"
+#include "models/books_index.hpp"
+#include "models/books_search.hpp"
 
 #include <vector>
+#include <deque>
 #include <map>
+#include <set>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <mutex>
 
 #include "helpers/simple_db.hpp"
+#include "helpers/cover_cache.hpp"
 
 /**
  * @brief Books Directory class
@@ -22,11 +29,25 @@
  * methods to read the directory from a database file located in the same folder 
  * as the books themselves, refresh the list reading again all file content
  * not found in the database to retrieve meta-data.
+ * 
+ * The meta-data and the cover bitmaps are kept in two different databases.
+ * The title and author of each book are kept in memory with the index (see
+ * BooksIndex), such that the books list can be shown without reading the
+ * meta-data records. The covers are read when required, and kept in a small
+ * cache sized to the number of books shown on a page.
+ * 
+ * Covers are prepared at refresh time in the form they are painted: resized,
+ * in 8 bits gray for the 3 bits resolution, and dithered for the 1 bit
+ * resolution. Painting the books list is then a sequence of blits.
+ * 
+ * The title, author and description of the books are indexed for the search
+ * (see BooksSearch). The search index is kept in a file updated at the end
+ * of each refresh, and is in memory only while searching.
  */
 class BooksDir
 {
   public:
-    static const uint16_t BOOKS_DIR_DB_VERSION =   6;
+    static const uint16_t BOOKS_DIR_DB_VERSION =   7;
 
     static const uint8_t  FILENAME_SIZE        = 128;
     static const uint8_t  TITLE_SIZE           = 128;
@@ -35,15 +56,14 @@ class BooksDir
 
     static const uint8_t  MAX_COVER_WIDTH      =  70;
     static const uint8_t  MAX_COVER_HEIGHT     =  90;
+    static const uint16_t COVER_DITHERED_SIZE  = ((MAX_COVER_WIDTH + 7) >> 3) * MAX_COVER_HEIGHT;
 
     /**
      * @brief Single EBook Record
      * 
      * This represents the meta-data contained in the database for each epub book.
-     * These are required to present the list of books to the user.
-     * One element is not present in the structure: the list of pages location.
-     * The *get_page_locs()* method is retrieving the pages location when required
-     * by the epub class.
+     * The cover bitmap is not part of it: it is in a CoverRecord of the covers
+     * database, retrieved with *get_cover()*.
      */
     #pragma pack(push, 1)
     struct EBookRecord {
@@ -54,9 +74,14 @@ class BooksDir
       char     title[TITLE_SIZE];             ///< Title from epub meta-data
       char     author[AUTHOR_SIZE];           ///< Author from epub meta-data
       char     description[DESCRIPTION_SIZE]; ///< Description from epub meta-data
-      uint8_t  cover_bitmap[MAX_COVER_WIDTH][MAX_COVER_HEIGHT];  ///< Cover bitmap shrinked for books list presentation
+    };
+
+    struct CoverRecord {
+      uint32_t id;                            ///< Id of the book, MUST STAY AS FIRST ITEM IN CoverRecord
       uint8_t  cover_width;                   ///< Width of the cover bitmap
       uint8_t  cover_height;                  ///< Height of the cover bitmap
+      uint8_t  cover_bitmap[MAX_COVER_WIDTH * MAX_COVER_HEIGHT];  ///< Cover bitmap shrinked for books list presentation
+      uint8_t  cover_dithered[COVER_DITHERED_SIZE];               ///< The same, dithered to 1 bit per pixel (see DitheredImages)
     };
 
     struct VersionRecord {
@@ -65,28 +90,89 @@ class BooksDir
     };
     #pragma pack(pop)
 
+    /**
+     * @brief What is required to show a book in the books list
+     */
+    struct BookSummary {
+      uint32_t     id;
+      const char * title;
+      const char * author;
+      const char * filename;
+    };
+
   private:
     static constexpr char const * TAG            = "BooksDir";
     static constexpr char const * BOOKS_DIR_FILE = MAIN_FOLDER "/books_dir.db";
-    static constexpr char const * NEW_DIR_FILE   = MAIN_FOLDER "/new_dir.db";
+    static constexpr char const * COVERS_FILE    = MAIN_FOLDER "/covers.db";
+    static constexpr char const * INDEX_FILE     = MAIN_FOLDER "/books_dir.idx";
+    static constexpr char const * SEARCH_FILE    = MAIN_FOLDER "/books_search.idx";
     static constexpr char const * APP_NAME       = "EPUB-INKPLATE";
 
     SimpleDB db;                       ///< The SimpleDB database
+    SimpleDB covers_db;                ///< The book covers, one CoverRecord per book
 
-    struct IndexInfo {
-      uint32_t id;
-      uint16_t db_index;
-    };
-
-    typedef std::map<std::string, IndexInfo> SortedIndex;  ///< Sorted map of book names and indexes.
-    SortedIndex sorted_index;          ///< Books index pointing at the db index of each book
+    BooksIndex  index;                 ///< Books index pointing at the db index of each book
+    bool        index_file_valid;      ///< INDEX_FILE reflects the database content
     EBookRecord book;                  ///< Book Record structure prepared to return to the caller
     int16_t current_book_idx;          ///< Current book index present in the book structure
 
+    std::map<uint32_t, uint16_t> cover_index;  ///< Book id to covers_db index
+    CoverCache                   cover_cache;
+
+    std::deque<uint32_t> pending;      ///< Id of the books to be retrieved by refresh_step()
+
+    /**
+     * @brief Background verification of the books folder (see verify_step())
+     */
+    enum class VerifyState : uint8_t { NONE, COVERS, FILES, FOLDER };
+
+    static const uint8_t VERIFY_BATCH_SIZE = 16;  ///< Files verified per verify_step() call
+
+    VerifyState verify_state;
+    uint16_t    verify_idx;            ///< Next entry to verify is at verify_idx - 1
+    bool        covers_indexed;        ///< cover_index reflects the covers database
+
+    BooksSearch search_index;          ///< Full-text index, in memory while searching
+    bool        search_loaded;         ///< search_index is loaded and synchronized
+    bool        search_outdated;       ///< Books were added or removed since SEARCH_FILE was saved
+
+    /**
+     * @brief Held by the methods that may run in the web server task
+     * 
+     * The web server search (see *search()*) reads the database while the
+     * main task may step through the background work (*refresh_step()*,
+     * *verify_step()*, *compact_step()*). These are serialized by this mutex.
+     */
+    std::mutex  mutex;
+
+    static bool get_folder_stamp(uint32_t & stamp);
+    void     use_manifest(char * book_filename, int16_t & book_index);
+    bool     verify_entry(uint16_t entry_idx);
+    void     queue_missing_covers();
+    bool     add_new_books(const std::set<std::string> & known_files);
+    bool     open_covers(bool create);
+    void     index_covers();
+    bool     add_cover(uint32_t id, EPubProbe & probe);
+    bool     retrieve_book(uint32_t id);
+    static void dither_cover(CoverRecord & cover);
+    void     invalidate_index();
+    bool     sync_search_index();
+    void     update_search_index();
+
   public:
-    BooksDir() : current_book_idx(-1) { }
+    typedef BooksIndex::SortOrder SortOrder;
+
+    BooksDir() :
+      index_file_valid(false),
+      current_book_idx(-1),
+      cover_cache(sizeof(CoverRecord)),
+      verify_state(VerifyState::NONE),
+      verify_idx(0),
+      covers_indexed(false),
+      search_loaded(false),
+      search_outdated(false) { }
    ~BooksDir() {
-      sorted_index.clear();
+      index.clear();
       close_db(); 
     }
 
@@ -95,7 +181,15 @@ class BooksDir
      * 
      * @return int16_t The number of ebooks present in the database
      */
-    inline int16_t get_book_count() const { return sorted_index.size(); }
+    inline int16_t get_book_count() const { return index.get_count(); }
+
+    /**
+     * @brief Select the order of the books list
+     * 
+     * All orders are computed at refresh time: no database access.
+     */
+    inline void      set_sort_order(SortOrder order) { index.set_sort_order(order); }
+    inline SortOrder          get_sort_order() const { return index.get_sort_order(); }
 
     /**
      * @brief Get an ebook meta-data
@@ -107,32 +201,44 @@ class BooksDir
      * @return const EBookRecord* Pointer to an EBookRecord structure, or NULL if not able to retrieve the data.
      */
     const EBookRecord *               get_book_data(uint16_t idx);
+
+    /**
+     * @brief Get an ebook title and author
+     * 
+     * No database access: these are kept in memory with the index.
+     * 
+     * @param idx The index in the sorted list of ebooks.
+     * @param summary Receives the book id, title and author. Pointers stay valid until the next refresh.
+     * @return true The index is valid.
+     */
+    bool                           get_book_summary(uint16_t idx, BookSummary & summary);
+    bool                   get_book_summary_from_id(uint32_t id, BookSummary & summary);
+
+    /**
+     * @brief Get an ebook cover bitmap
+     * 
+     * The cover is retrieved from the cover cache, or read from the covers
+     * database. If the book has no cover record, the default cover is returned.
+     * 
+     * @param idx The index in the sorted list of ebooks.
+     * @return const CoverRecord* The cover, valid until the next call, or NULL if not able to retrieve it.
+     */
+    const CoverRecord *                   get_cover(uint16_t idx);
+
+    /**
+     * @brief Set the number of covers kept in memory
+     * 
+     * Called by the books list viewers with the number of books shown on a page.
+     */
+    void            set_cover_cache_size(uint16_t count) { cover_cache.set_capacity(count); }
+
     const EBookRecord * get_book_data_from_db_index(uint16_t idx);
     bool                                get_book_id(uint16_t idx, uint32_t & id );
     bool                             get_book_index(uint32_t id,  uint16_t & idx);
     void                            set_track_order(uint32_t id,  int8_t     pos);
 
-    int16_t get_sorted_idx(uint16_t db_idx) {
-      int i = 0;
-      for (auto entry : sorted_index) {
-        if (entry.second.db_index == db_idx) {
-          return i;
-        }
-        i++;
-      }
-      return -1;
-    }
-
-    int16_t get_sorted_idx_from_id(uint32_t id) {
-      int i = 0;
-      for (auto entry : sorted_index) {
-        if (entry.second.id == id) {
-          return i;
-        }
-        i++;
-      }
-      return -1;
-    }
+    inline int16_t         get_sorted_idx(uint16_t db_idx) { return index.position_of_db_index(db_idx); }
+    inline int16_t get_sorted_idx_from_id(uint32_t id)     { return index.position_of_id(id);           }
 
     static const int16_t max_cover_width  = MAX_COVER_WIDTH;  ///< Bitmap width in pixels to present a book cover in the list
     static const int16_t max_cover_height = MAX_COVER_HEIGHT; ///< Bitmap height in pixels
@@ -144,7 +250,13 @@ class BooksDir
      * books present in the database. If the database does not exists, it will be created. The refresh
      * process is used to update the database in case books have been added or removed to/from the book
      * folder. It has been optimized to limit the time required to refresh (books already seen in the 
-     * database are not scanned again).
+     * database are not scanned again). New books are retrieved afterward, in the background
+     * (see *refresh_step()*): the books list can be used right away.
+     * 
+     * If the books folder stamp is the same as the one saved with the index, the
+     * index is used as is and the folder is not read: the files are verified
+     * afterward, in the background (see *verify_step()*). The startup time
+     * is then not related to the number of books.
      * 
      * A version record is present in the database. In case of structure update, the version will be changed in
      * the application and will trigger the reconstruction of the database.
@@ -164,19 +276,112 @@ class BooksDir
      * This method is called by the *read_books_directory()* method to refresh the database. It can also
      * be called by the user through some option menu entry to request a database refresh.
      * 
+     * New books are added to the list as placeholders, showing their filename and
+     * the default cover. Their meta-data and cover are retrieved one book at a time
+     * by *refresh_step()*.
+     * 
      * @param book_filename Filename for wich the calling method needs the index for
      * @param book_index    The index corresponding to the book filename
      * @param force_init    Remove all entries and reindex all books
+     * @param background    Leave the new books retrieval to *refresh_step()* calls. If
+     *                      false, all books are retrieved before returning.
      * @return true  The refresh process completed successfully.
      * @return false Some error happened.
      */
-    bool refresh(char * book_filename, int16_t & book_index, bool force_init = false);
+    bool refresh(char * book_filename, int16_t & book_index, bool force_init = false, bool background = false);
+
+    /**
+     * @brief Retrieve the meta-data and cover of the next new book
+     * 
+     * Each book is committed to the database once retrieved. If the
+     * refresh is interrupted (power loss, deep sleep), the books already
+     * retrieved are not retrieved again at the next start. The list is sorted
+     * again: the books positions may change. The book last shown stays
+     * open (see EPubProbe).
+     * 
+     * @return true Some work was done, there may be more.
+     */
+    bool refresh_step();
+
+    inline bool is_refreshing() const { return !pending.empty(); }
+
+    /**
+     * @brief Verify the books folder against the index, a few files at a time
+     * 
+     * Started by *read_books_directory()* when the folder was not read. The
+     * first step indexes the covers, the following ones verify the size and
+     * modification time of VERIFY_BATCH_SIZE books each, and the last one reads
+     * the folder for new books. These are added as placeholders, to be
+     * retrieved by *refresh_step()*. Some file systems (FAT) do not update the
+     * folder stamp when books are added or removed: this is where such
+     * changes are found.
+     * 
+     * To be called once *refresh_step()* has nothing left to do.
+     * 
+     * @param list_changed Set to true if books were added or removed from the list.
+     * @return true Some work was done, there may be more.
+     */
+    bool verify_step(bool & list_changed);
+
+    /**
+     * @brief The book at a position in the list is a placeholder
+     * 
+     * Its meta-data is not retrieved yet: *get_book_data()* returns NULL.
+     */
+    bool is_placeholder(uint16_t idx) const;
+
+    /**
+     * @brief Retrieve a placeholder book right away
+     * 
+     * Used when the user selects a book not yet retrieved.
+     * 
+     * @param idx The book position in the list.
+     * @return int16_t The new position of the book in the list, -1 if it is no longer there.
+     */
+    int16_t retrieve_now(uint16_t idx);
+
+    /**
+     * @brief Search the books title, author and description
+     * 
+     * The search index is loaded from its file with the first search, and
+     * brought up to date with the books list if required. It stays in memory
+     * up to *release_search_index()*.
+     * 
+     * @param query Words to search for, each one being a prefix (see BooksSearch::search()).
+     * @param ids Receives the id of the books found.
+     * @return true Some books were found.
+     */
+    bool search(const std::string & query, std::vector<uint32_t> & ids);
+    void release_search_index() {
+      std::scoped_lock guard(mutex);
+      search_index.clear();
+      search_loaded = false;
+    }
+
+    /**
+     * @brief Limit the books list to some books (see BooksIndex::set_filter())
+     */
+    inline void set_filter(const std::vector<uint32_t> & ids) { index.set_filter(ids); }
+    inline void clear_filter()                                { index.clear_filter();   }
+    inline bool is_filtered() const                           { return index.is_filtered(); }
 
     /**
      * @brief Close the SimpleDB database
      * 
      */
-    void close_db() { db.close(); }
+    void close_db() { db.close(); covers_db.close(); }
+
+    /**
+     * @brief Reclaim the space of deleted books in the database
+     * 
+     * A single record is moved per call (see SimpleDB::compact_step()).
+     * 
+     * @return true Some work was done, there may be more.
+     */
+    bool compact_step() {
+      std::scoped_lock guard(mutex);
+      return db.compact_step() || covers_db.compact_step();
+    }
 
     void show_db();
 };
@@ -0,0 +1,181 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/**
+ * @brief Sorted list of the books in the books directory
+ *
+ * The entries are kept in a vector, in no particular order. For each sort
+ * order, a vector gives the entry index at each position of the list, such
+ * that the books list viewers reach the n-th book of the list directly. The
+ * orders are all computed once (sort()), switching from one to the other
+ * is then a matter of computing the position of each entry in the new order.
+ *
+ * The index is saved in a file next to the books database, with the orders.
+ * It is loaded at startup in place of reading every book record, if the
+ * database was properly closed with the same number of records.
+ *
+ * With the filename, size and modification time of each book, the index is
+ * also the manifest of the books folder. The folder stamp saved with it
+ * tells if the folder changed since the manifest was built (see
+ * BooksDir::read_books_directory()).
+ */
+class BooksIndex
+{
+  public:
+    enum class SortOrder : uint8_t { TITLE, AUTHOR, RECENTLY_READ, ADDED };
+    static constexpr uint8_t SORT_ORDER_COUNT = 4;
+
+    static constexpr uint16_t NO_DB_INDEX = 0xFFFF; ///< Placeholder: the book record is not in the database yet
+
+    struct Entry {
+      uint32_t    id;          ///< Book id (see BooksDir::EBookRecord)
+      uint16_t    db_index;    ///< Index of the book record in the books database
+      int32_t     file_size;
+      uint32_t    added;       ///< File modification time, for the ADDED sort order
+      int8_t      track_pos;   ///< Position in the list of books being read, -1 if not being read
+      std::string filename;
+      std::string title;
+      std::string author;
+    };
+
+    BooksIndex() : order(SortOrder::RECENTLY_READ), folder_stamp(0), filtered(false) { }
+
+    void clear();
+
+    /**
+     * @brief Add an entry
+     *
+     * sort() must be called once all entries have been added or removed.
+     */
+    inline void add(const Entry & entry) { entries.push_back(entry); }
+    void remove(uint16_t entry_idx);
+
+    inline uint16_t          get_entry_count() const { return entries.size(); }
+    inline Entry &     get_entry(uint16_t entry_idx) { return entries[entry_idx]; }
+
+    /**
+     * @brief Index of the entry of a book, -1 if not found
+     *
+     * Entries added since the last sort() are not accounted for.
+     */
+    int16_t entry_index_of_id(uint32_t id) const;
+
+    /**
+     * @brief Compute all sort orders and the id lookup table
+     */
+    void sort();
+
+    void set_sort_order(SortOrder the_order);
+    inline SortOrder get_sort_order() const { return order; }
+
+    /**
+     * @brief Limit the sorted list to some books
+     *
+     * Used to show the result of a search. The filter stays in place through
+     * sort() and set_sort_order(), up to clear_filter().
+     *
+     * @param ids The books to keep in the list.
+     */
+    void set_filter(const std::vector<uint32_t> & ids);
+    void clear_filter();
+    inline bool is_filtered() const { return filtered; }
+
+    /**
+     * @brief Number of books in the sorted list
+     *
+     * Entries added or removed since the last sort() are not accounted for.
+     */
+    inline uint16_t get_count() const { return filtered ? view.size() : orders[0].size(); }
+
+    /**
+     * @brief Entry at a position in the current sort order
+     *
+     * @return The entry, or nullptr if pos is out of range.
+     */
+    inline const Entry * at(uint16_t pos) const {
+      if (pos >= get_count()) return nullptr;
+      return &entries[filtered ? view[pos] : orders[(uint8_t) order][pos]];
+    }
+
+    /**
+     * @brief Position of a book in the sorted list, -1 if not in the list
+     */
+    int16_t       position_of_id(uint32_t id) const;
+    int16_t position_of_db_index(uint16_t db_index) const;
+
+    /**
+     * @brief Change the position of a book in the list of books being read
+     *
+     * Only the RECENTLY_READ order is computed again.
+     *
+     * @param pos Position, -1 if no longer being read.
+     * @return true The book was found.
+     */
+    bool set_track_pos(uint32_t id, int8_t pos);
+
+    /**
+     * @brief Books folder stamp at the time the entries were verified
+     *
+     * Saved and retrieved with the index. Reset to 0 by clear().
+     */
+    inline void set_folder_stamp(uint32_t stamp) { folder_stamp = stamp; }
+    inline uint32_t       get_folder_stamp() const { return folder_stamp; }
+
+    /**
+     * @brief Save/retrieve the entries and orders
+     *
+     * @param db_record_count The books database record count. The index is
+     *                        not loaded if the count is not the same.
+     */
+    bool save(const std::string & filename, uint32_t db_record_count) const;
+    bool load(const std::string & filename, uint32_t db_record_count);
+
+  private:
+    static constexpr char const * TAG = "BooksIndex";
+
+    static constexpr uint8_t VERSION = 2;
+
+    static constexpr uint16_t NO_POSITION = 0xFFFF;  ///< Entry filtered out of the list
+
+    #pragma pack(push, 1)
+      struct Header {
+        char     magic[4];
+        uint8_t  version;
+        uint32_t db_record_count;
+        uint32_t entry_count;
+        uint32_t folder_stamp;
+        uint32_t checksum;        ///< Of everything following the header
+      };
+      struct EntryHeader {
+        uint32_t id;
+        uint16_t db_index;
+        int32_t  file_size;
+        uint32_t added;
+        int8_t   track_pos;
+        uint8_t  filename_size;
+        uint8_t  title_size;
+        uint8_t  author_size;
+      };
+    #pragma pack(pop)
+
+    std::vector<Entry>    entries;
+    std::vector<uint16_t> orders[SORT_ORDER_COUNT]; ///< Entry index at each position, for each sort order
+    std::vector<uint16_t> positions;                ///< Position of each entry in the current sort order
+    std::vector<uint16_t> view;                     ///< Entry index at each position, if filtered
+    std::vector<uint32_t> filter_ids;               ///< Books kept in the list if filtered, sorted
+    std::unordered_map<uint32_t, uint16_t> id_map;  ///< Book id to entry index
+    SortOrder             order;
+    uint32_t              folder_stamp;
+    bool                  filtered;
+
+    void sort(SortOrder the_order);
+    void compute_positions();
+};
@@ -0,0 +1,149 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Full-text index of the books title, author and description
+ *
+ * An inverted index: each normalized token refers to the books containing
+ * it. Tokens are lower case, with the accents of the latin letters removed.
+ * Markup found in descriptions is ignored.
+ *
+ * The tokens text is kept in a pool, one after the other. A vector of
+ * their pool offset in alphabetical order allows for the prefix queries,
+ * and the postings (token offset, book id) are sorted by token. Books are
+ * added and removed individually, as they are found or removed by the books
+ * directory refresh. Many books are added at once in a batch (see
+ * start_batch()), the postings being sorted only once at its end.
+ *
+ * The index is saved in a file next to the books database. It is not
+ * required at startup: it is loaded when a query is done, and synchronized
+ * with the books list (see BooksDir::search()).
+ */
+class BooksSearch
+{
+  public:
+    static constexpr uint8_t MIN_TOKEN_SIZE =  2;  ///< Shorter words are not indexed
+    static constexpr uint8_t MAX_TOKEN_SIZE = 15;  ///< Bytes, longer words are truncated
+
+    BooksSearch() : batch(false) { }
+
+    void clear();
+
+    /**
+     * @brief Add a book to the index
+     *
+     * The book must not be in the index already.
+     */
+    void add_book(uint32_t id, const char * title, const char * author, const char * description);
+
+    /**
+     * @brief Add a document already tokenized
+     *
+     * Same as add_book(), for the other kinds of documents (the items of a
+     * book, see BookSearch). The words are sorted and made unique in place.
+     */
+    void add_tokens(uint32_t id, std::vector<std::string> & words);
+
+    /**
+     * @brief Start adding many books
+     *
+     * Until end_batch() is called, the new postings are only appended and
+     * the new tokens are kept apart. The index can't be searched or saved
+     * before the end of the batch.
+     */
+    void start_batch() { batch = true; }
+
+    /**
+     * @brief Sort the books added since start_batch()
+     */
+    void end_batch();
+
+    /**
+     * @brief Remove books from the index
+     *
+     * The tokens no longer referred to are removed from the pool.
+     */
+    void remove_books(std::vector<uint32_t> the_ids);
+
+    bool contains(uint32_t id) const;
+
+    /**
+     * @brief Books in the index, sorted by id
+     */
+    inline const std::vector<uint32_t> & get_ids() const { return ids; }
+
+    inline uint32_t   get_token_count() const { return tokens.size();   }
+    inline uint32_t get_posting_count() const { return postings.size(); }
+
+    /**
+     * @brief Retrieve the books matching a query
+     *
+     * Each word of the query is a prefix: a book is retained if each of them
+     * starts a token of its title, author or description.
+     *
+     * @param query The words to search for, in any case, with or without accents.
+     * @param result Receives the id of the books found, sorted by id.
+     */
+    void search(const std::string & query, std::vector<uint32_t> & result) const;
+
+    /**
+     * @brief Split a string into normalized tokens
+     *
+     * The tokens are appended to result. Tokens shorter than MIN_TOKEN_SIZE
+     * are kept if min_size is 0 (used for the query words).
+     */
+    static void tokenize(const char * str, std::vector<std::string> & result, uint8_t min_size = MIN_TOKEN_SIZE);
+
+    /**
+     * @brief Save and load the index
+     *
+     * @param stamp Identifies what the index was built from (e.g. the size and
+     *        modification time of a book). The index is not loaded if it differs.
+     */
+    bool save(const std::string & filename, uint64_t stamp = 0) const;
+    bool load(const std::string & filename, uint64_t stamp = 0);
+
+  private:
+    static constexpr char const * TAG = "BooksSearch";
+
+    static constexpr uint8_t VERSION = 2;
+
+    #pragma pack(push, 1)
+      struct Header {
+        char     magic[4];
+        uint8_t  version;
+        uint32_t pool_size;
+        uint32_t token_count;
+        uint32_t posting_count;
+        uint32_t id_count;
+        uint64_t stamp;           ///< Given to save()
+        uint32_t checksum;        ///< Of everything following the header
+      };
+    #pragma pack(pop)
+
+    struct Posting {
+      uint32_t token;             ///< Offset of the token in the pool
+      uint32_t id;                ///< Book id
+      bool operator<(const Posting & other) const {
+        return (token != other.token) ? (token < other.token) : (id < other.id);
+      }
+    };
+
+    std::string           pool;     ///< Tokens text, each one followed by a 0
+    std::vector<uint32_t> tokens;   ///< Pool offset of each token, in alphabetical order
+    std::vector<Posting>  postings; ///< Sorted by token offset, then by book id
+    std::vector<uint32_t> ids;      ///< Books in the index, sorted
+
+    bool                            batch;
+    std::map<std::string, uint32_t> batch_tokens; ///< Tokens added by the batch, with their pool offset
+
+    uint32_t token_offset(const std::string & token);
+};
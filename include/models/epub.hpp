@@ -77,8 +77,6 @@ class EPub
   
     bool               file_is_open;
     bool               encryption_present;
-    bool               fonts_size_too_large;
-    int32_t            fonts_size;
 
     const char *             get_meta(const std::string    & name         );
     bool                      get_opf(std::string          & filename     );
@@ -119,6 +117,19 @@ class EPub
     bool                    load_font(const std::string      filename, 
                                       const std::string      font_family, 
                                       const Fonts::FaceStyle style        );
+
+    /**
+     * @brief Extract a font file from the book
+     * 
+     * The font is deobfuscated and saved in the BOOK_FONTS_FOLDER, such
+     * that it can be read on demand by the font engine.
+     * 
+     * @param filename The font file location in the book.
+     * @param font_path The extracted font file name.
+     * @return true The font was extracted.
+     */
+    bool                 extract_font(const std::string    & filename,
+                                      std::string          & font_path    );
     /**
      * @brief Retrieve cover's filename
      *
@@ -0,0 +1,73 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include "models/image.hpp"
+#include "helpers/unzip.hpp"
+
+#include <string>
+
+/**
+ * @brief EPub metadata retrieval for the books directory
+ *
+ * Retrieves the title, author, description and cover image filename of an
+ * epub file, without the EPub class machinery: the OPF file is not loaded
+ * in a pugixml document, and no CSS, font or book parameters are set up.
+ * The OPF is decompressed in small chunks and scanned for the <metadata>
+ * part and the cover entry of the <manifest>. The scan stops as soon as
+ * everything is known, usually well before the <spine>.
+ *
+ * The epub file is kept open up to close_file() such that the cover image
+ * can be retrieved. It is read through an Unzip instance of its own: the
+ * book opened by the EPub instance is not disturbed.
+ */
+class EPubProbe
+{
+  public:
+    EPubProbe() : file_is_open(false), zip(nullptr) { }
+   ~EPubProbe() { close_file(); if (zip != nullptr) delete zip; }
+
+    /**
+     * @brief Open an epub file and retrieve its metadata
+     *
+     * @param epub_filename Full path of the epub file.
+     * @return true The file is an epub book this application can show.
+     */
+    bool open_file(const std::string & epub_filename);
+    void close_file();
+
+    inline const std::string &          get_title() const { return title;          }
+    inline const std::string &         get_author() const { return author;         }
+    inline const std::string &    get_description() const { return description;    }
+
+    /**
+     * @brief Cover image filename, relative to the epub root, empty if none
+     */
+    inline const std::string & get_cover_filename() const { return cover_filename; }
+
+    /**
+     * @brief Retrieve the cover image
+     *
+     * @param max Maximum dimensions of the image once loaded.
+     * @return The image (to be deleted by the caller), or nullptr if not available.
+     */
+    Image * get_cover_image(Dim max);
+
+  private:
+    static constexpr char const * TAG = "EPubProbe";
+
+    static constexpr uint32_t CHUNK_SIZE = 2048;  ///< OPF decompression chunk size
+
+    bool        file_is_open;
+    Unzip     * zip;          ///< Allocated with the first file, as its buffer is large
+    std::string title;
+    std::string author;
+    std::string description;
+    std::string cover_filename;
+
+    bool get_opf_filename(std::string & filename);
+    bool scan_opf(const std::string & filename);
+};
@@ -5,12 +5,16 @@
 #pragma once
 #include "global.hpp"
 
+#include "models/glyph_table.hpp"
+#include "models/font_coverage.hpp"
 #include "memory_pool.hpp"
 
-#include <unordered_map>
+#include <atomic>
 #include <forward_list>
 #include <mutex>
 
+class GlyphAtlas;
+
 class Font
 {
   public:
@@ -21,24 +25,35 @@ class Font
       int16_t         pitch;
       int16_t         line_height;
       int16_t         ligature_and_kern_pgm_index;
-      unsigned char * buffer;
+      uint16_t        bitmap_size;  ///< Bytes used by the bitmap in buffer
+      uint32_t        generation;   ///< Last page generation this glyph was used in (LRU)
+      unsigned char * buffer;       ///< 1 bit per pixel, or GlyphRLE runs in 3 bits resolution
       void clear() {
         dim.height = dim.width = 0;
         xoff = yoff = 0;
         advance = pitch = line_height = 0;
         ligature_and_kern_pgm_index = 255;
+        bitmap_size = 0;
+        generation = 0;
         buffer = nullptr;
       }
     };
+
+    struct CacheStats {
+      uint32_t hits;
+      uint32_t misses;
+      uint32_t evictions;
+      uint32_t compactions;
+      uint32_t bytes;       ///< Bytes used by glyphs bitmap pools, all fonts
+      uint32_t budget;
+    };
     
   private:
     static constexpr char const * TAG = "Font";
 
-    std::mutex mutex;
-
   public:
     Font();
-    virtual ~Font() {};
+    virtual ~Font();
 
     inline bool is_ready() const { return ready; }
 
@@ -66,8 +81,35 @@ class Font
 
     void clear_cache();
 
+    /**
+     * @brief Check if the font has a glyph for a character
+     * 
+     * Doesn't require the glyph to be rendered: the font coverage, 
+     * built when the font was loaded, is consulted.
+     */
+    inline bool covers(uint32_t charcode) const { return coverage.covers(charcode); }
+
     void get_size(const char * str, Dim * dim, int16_t glyph_size);
 
+    /**
+     * @brief Start a new page generation
+     * 
+     * Called once for each book page shown, restored from the frames
+     * cache or not. Glyphs not used during the last KEPT_GENERATIONS generations are candidates for
+     * eviction when the glyphs memory budget is exhausted.
+     */
+    static inline void next_generation() { generation.fetch_add(1, std::memory_order_relaxed); }
+
+    static void get_cache_stats(CacheStats & stats);
+
+    /**
+     * @brief Write glyphs rendered since the last call to their atlas
+     * 
+     * Called once a page has been displayed, such that SD card writes 
+     * are not interleaved with the page rendering.
+     */
+    void flush_atlases();
+
     inline void    set_fonts_cache_index(int16_t index) { fonts_cache_index = index; }
     inline int16_t get_fonts_cache_index()              { return fonts_cache_index;  }
     uint8_t      * byte_pool_alloc(uint16_t size);
@@ -85,7 +127,7 @@ class Font
      * 
      */
     virtual int32_t get_chars_height(int16_t glyph_size)  {
-      const Glyph * g = get_glyph_internal('E', glyph_size);
+      const Glyph * g = get_glyph('E', glyph_size);
       return (g == nullptr) ? 0 : (g->dim.height - get_descender_height(glyph_size));
     };
  
@@ -97,14 +139,38 @@ class Font
     virtual int32_t get_descender_height(int16_t glyph_size) = 0;
 
 protected:
-    static constexpr uint16_t BYTE_POOL_SIZE = 16384*2;
+    static constexpr uint16_t BYTE_POOL_SIZE   = 16384*2;
+    static constexpr uint8_t  KEPT_GENERATIONS = 2;  ///< Generations protected from eviction
 
-    typedef std::unordered_map<uint32_t, Glyph *> Glyphs; ///< Cache for the glyphs' bitmap 
-    typedef std::unordered_map<int16_t,  Glyphs>  GlyphsCache;
+    typedef GlyphTable<Glyph>                    Glyphs; ///< Cache for the glyphs' bitmap of one size
     typedef uint8_t                              BytePool[BYTE_POOL_SIZE];
-    typedef std::forward_list<BytePool *>        BytePools;
+
+    struct BytePoolEntry {
+      BytePool * pool;
+      uint16_t   live;          ///< Bytes still used by cached glyphs
+    };
+    typedef std::forward_list<BytePoolEntry> BytePools;  ///< Front entry is the current pool
+
+    /**
+     * Evicted glyphs and compacted pools could still be referenced by a 
+     * reader. They are freed only once KEPT_GENERATIONS generations have passed.
+     */
+    struct RetiredGlyph { uint32_t generation; Glyph    * glyph; };
+    struct RetiredPool  { uint32_t generation; BytePool * pool;  };
+
+    static std::atomic<uint32_t> generation;
+    static std::atomic<uint32_t> pools_bytes;
+    static std::atomic<uint32_t> hits, misses, evictions, compactions;
+    
+    /**
+     * Glyph insertions, face access and size changes are serialized by this
+     * mutex. Cache lookups done through find_glyph() are lock-free.
+     */
+    std::mutex         mutex;
+
+    std::atomic<Glyphs *> glyphs_tables;     ///< One table per glyph size
+    std::atomic<Glyphs *> last_glyphs_table; ///< Lookup hint: last table used
     
-    GlyphsCache        cache;
     int16_t            fonts_cache_index;
     int8_t             current_font_size;
     bool               ready;
@@ -114,7 +180,95 @@ protected:
     BytePools          byte_pools;
     uint16_t           byte_pool_idx;
 
+    std::forward_list<RetiredGlyph> retired_glyphs;
+    std::forward_list<RetiredPool>  retired_pools;
+
+    uint32_t           font_hash;     ///< Font content signature for atlases. 0 = no atlas
+    GlyphAtlas       * atlases;       ///< One atlas per glyph size, created on demand
+    FontCoverage       coverage;      ///< Characters supported by the font
+
     void      add_buff_to_byte_pool();
+    
+    static inline uint32_t glyph_bytes(const Glyph * glyph) {
+      return (glyph->buffer == nullptr) ? 0 : glyph->bitmap_size;
+    }
+
+    BytePoolEntry * pool_of(const unsigned char * buffer);
+    void         release_retired();
+
+    /**
+     * @brief Reduce the memory used by this font's glyphs cache
+     * 
+     * Least recently used glyphs are evicted, and pools that became sparse
+     * are compacted. The mutex must be held by the caller.
+     * 
+     * @return uint32_t Number of pool bytes released.
+     */
+    uint32_t reclaim();
+    void     reclaim_all();
+
+    /**
+     * @brief Retrieve a glyph from the cache
+     * 
+     * Lock-free, can be called while another thread is adding glyphs.
+     * 
+     * @param code Character code (or font specific glyph code) used as cache key.
+     * @return Glyph* The glyph, or nullptr if not in the cache.
+     */
+    inline Glyph * find_glyph(uint32_t code, int16_t glyph_size) {
+      Glyphs * table = last_glyphs_table.load(std::memory_order_acquire);
+      if ((table == nullptr) || (table->get_glyph_size() != glyph_size)) {
+        table = glyphs_tables.load(std::memory_order_acquire);
+        while ((table != nullptr) && (table->get_glyph_size() != glyph_size)) table = table->next;
+        if (table == nullptr) return nullptr;
+        last_glyphs_table.store(table, std::memory_order_release);
+      }
+      Glyph * glyph = table->find(code);
+      if (glyph != nullptr) {
+        __atomic_store_n(&glyph->generation, generation.load(std::memory_order_relaxed), __ATOMIC_RELAXED);
+        hits.fetch_add(1, std::memory_order_relaxed);
+      }
+      return glyph;
+    }
+
+    /**
+     * @brief Add a glyph to the cache
+     * 
+     * The mutex must be held by the caller.
+     */
+    void add_glyph(uint32_t code, int16_t glyph_size, Glyph * glyph);
+
+    static constexpr int32_t HASH_SAMPLE_SIZE = 8192;
+
+    /**
+     * @brief Compute the font signature used to retrieve its atlases
+     * 
+     * The font size and the first and last HASH_SAMPLE_SIZE bytes of the font 
+     * content are hashed (FNV-1a), which is enough to discriminate fonts 
+     * without having to go through the whole content. Head and tail must not
+     * overlap: for small fonts, the tail is what remains after the head.
+     */
+    static uint32_t compute_font_hash(const uint8_t * head, int32_t head_size,
+                                      const uint8_t * tail, int32_t tail_size,
+                                      int32_t size);
+
+    GlyphAtlas * get_atlas(int16_t glyph_size);
+
+    /**
+     * @brief Retrieve a glyph from the atlas and add it to the cache
+     * 
+     * The mutex must be held by the caller.
+     * 
+     * @return Glyph* The glyph, or nullptr if not present in the atlas.
+     */
+    Glyph * load_from_atlas(uint32_t code, int16_t glyph_size);
+
+    /**
+     * @brief Add a newly rendered glyph to the atlas
+     * 
+     * The mutex must be held by the caller.
+     */
+    void save_to_atlas(uint32_t code, int16_t glyph_size, const Glyph * glyph);
 
     unsigned char * memory_font;  ///< Buffer for memory fonts
 
@@ -0,0 +1,92 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Unicode characters supported by a font
+ *
+ * The coverage is built once when the font is loaded, as a list of
+ * code ranges. For the Basic Multilingual Plane, a page table (256 codes
+ * per page) is computed from the ranges: a page is either empty, full, or
+ * pointing to a 256 bits map. A lookup is then a single table access,
+ * without having to ask the font to render the character. Codes above
+ * 0xFFFF are searched in the ranges.
+ *
+ * The ranges can be saved in the ATLAS_FOLDER, under the font hash, such
+ * that the font character map is only scanned the first time the font is
+ * seen.
+ *
+ * A font without coverage information is considered covering everything.
+ */
+class FontCoverage
+{
+  public:
+    FontCoverage();
+
+    void clear();
+
+    /**
+     * @brief Add a code to the coverage
+     *
+     * Codes must be added in increasing order. build() must be called
+     * once all codes have been added.
+     */
+    void add(uint32_t code);
+
+    /**
+     * @brief Compute the lookup pages from the ranges
+     */
+    void build();
+
+    /**
+     * @brief Retrieve the coverage saved for a font
+     *
+     * @return true The coverage was retrieved and built.
+     */
+    bool load(uint32_t font_hash);
+    void save(uint32_t font_hash) const;
+
+    inline bool is_known() const { return known; }
+
+    inline bool covers(uint32_t code) const {
+      if (!known) return true;
+      if (code > 0xFFFF) return covers_above_bmp(code);
+      uint16_t page = pages[code >> 8];
+      if (page < FIRST_MAP) return page == FULL_PAGE;
+      return (maps[page - FIRST_MAP][(code >> 5) & 7] >> (code & 31)) & 1;
+    }
+
+  private:
+    static constexpr char const * TAG = "FontCoverage";
+
+    static constexpr uint8_t  VERSION    = 1;
+    static constexpr uint16_t EMPTY_PAGE = 0;
+    static constexpr uint16_t FULL_PAGE  = 1;
+    static constexpr uint16_t FIRST_MAP  = 2;  ///< Page values from here are indexes in maps
+
+    #pragma pack(push, 1)
+      struct Header {
+        char     magic[4];
+        uint8_t  version;
+        uint32_t count;
+      };
+    #pragma pack(pop)
+
+    struct Range { uint32_t first, last; };
+    typedef std::array<uint32_t, 8> PageMap;
+
+    std::vector<Range>   ranges;
+    std::vector<PageMap> maps;
+    uint16_t             pages[256];
+    bool                 known;
+
+    bool covers_above_bmp(uint32_t code) const;
+    static std::string filename(uint32_t font_hash);
+};
@@ -0,0 +1,90 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include <ft2build.h>
+
+#include FT_FREETYPE_H
+#include FT_SYSTEM_H
+
+#include <atomic>
+#include <string>
+
+/**
+ * @brief Font file access for FreeType, without loading the file in memory
+ *
+ * FreeType is given an FT_Stream that reads the font file from the SD card
+ * on demand. Reads go through a small page cache (PAGE_COUNT pages of
+ * PAGE_SIZE bytes, least recently used page replaced), such that the table
+ * headers and the glyphs outlines of a page being rendered are read only once.
+ * Reads larger than the cache are done directly.
+ *
+ * The file descriptor is kept opened between reads when allowed: only
+ * MAX_OPEN_FILES streams, all fonts together, can keep their file opened.
+ * Others open and close the file on each cache miss.
+ */
+class FontStream
+{
+  public:
+    FontStream();
+   ~FontStream();
+
+    /**
+     * @brief Prepare the stream to be used by FreeType
+     *
+     * @param font_filename The font file name.
+     * @return true The file exists.
+     */
+    bool open(const std::string & font_filename);
+
+    /**
+     * @brief Release the file and the page cache
+     */
+    void close();
+
+    /**
+     * @brief Read bytes from the font file
+     *
+     * @return uint32_t The number of bytes read.
+     */
+    uint32_t read(uint32_t offset, uint8_t * buffer, uint32_t count);
+
+    inline FT_Stream get_ft_stream() { return &ft_stream; }
+    inline uint32_t  get_size() const { return size;       }
+
+  private:
+    static constexpr char const * TAG = "FontStream";
+
+    static constexpr uint16_t PAGE_SIZE      = 2048;
+    static constexpr uint8_t  PAGE_COUNT     =    8;
+    static constexpr int8_t   MAX_OPEN_FILES =    3;
+
+    struct Page {
+      uint32_t  offset;
+      uint32_t  last_use;
+      uint16_t  length;
+      uint8_t * data;
+    };
+
+    static std::atomic<int8_t> open_files;
+
+    std::string  filename;
+    FILE       * file;        ///< Kept opened between reads if allowed
+    uint32_t     size;
+    uint32_t     use_count;
+
+    Page         pages[PAGE_COUNT];
+    FT_StreamRec ft_stream;
+
+    uint32_t read_file(uint32_t offset, uint8_t * buffer, uint32_t count);
+    Page *    get_page(uint32_t page_offset);
+
+    static unsigned long ft_read(FT_Stream       stream,
+                                 unsigned long   offset,
+                                 unsigned char * buffer,
+                                 unsigned long   count);
+    static void         ft_close(FT_Stream       stream);
+};
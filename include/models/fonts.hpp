@@ -25,15 +25,18 @@ class Fonts
     enum class FaceStyle : uint8_t { NORMAL = 0, BOLD, ITALIC, BOLD_ITALIC };
     struct FontEntry {
       std::string name;
-      Font *      font;
+      Font *      font;      ///< nullptr until first required for a book font
       FaceStyle   style;
+      std::string source;    ///< Font file location in the book, until loaded
+      std::string path;      ///< Font file extracted from the book
+      bool        failed = false; ///< Could not be loaded, replaced by a default font
     };
 
     /**
      * @brief Clear fonts loaded from a book
      * 
-     * This will keep the default fonts loaded from the application folder. It will clean
-     * all glyphs in all fonts caches.
+     * This will keep the default fonts loaded from the application folder, with
+     * their glyphs cache.
      * 
      * @param all If true, default fonts will also be removed
      */
@@ -52,8 +55,8 @@ class Fonts
         LOG_E("Fonts.get(): Wrong index: %d vs size: %u", index, font_cache.size());
         f = font_cache.at(1).font;
       }
-      else {
-        f = font_cache.at(index).font;
+      else if ((f = font_cache.at(index).font) == nullptr) {
+        f = font_cache.at(index).failed ? get_default(font_cache.at(index).style) : load(index);
       }
       return f;
     };
@@ -115,6 +118,32 @@ class Fonts
              int32_t             size,
              const std::string & filename);
 
+    /**
+     * @brief Add a font located in the current book
+     * 
+     * The font is not retrieved from the book until a glyph is required from it.
+     * 
+     * @param name Font name
+     * @param style Font style (bold, italic, normal)
+     * @param source Font file location in the book
+     */
+    void add_deferred(const std::string & name,
+                      FaceStyle           style,
+                      const std::string & source);
+
+    /**
+     * @brief Find a font to draw a character missing from another font
+     * 
+     * The loaded fonts are checked in order through their coverage, fonts 
+     * of the same style first. Book fonts not yet retrieved and the icons 
+     * font are not considered.
+     * 
+     * @param charcode The character missing from the font at index.
+     * @param index The font index.
+     * @return Font* The first font covering the character, or nullptr.
+     */
+    Font * get_fallback(uint32_t charcode, int16_t index);
+
     FaceStyle adjust_font_style(FaceStyle style, FaceStyle font_style, FaceStyle font_weight) const;
 
     void check(int16_t index, FaceStyle style) const {
@@ -125,6 +154,11 @@ class Fonts
 
     void clear_glyph_caches();
 
+    /**
+     * @brief Save newly rendered glyphs of all fonts to their atlas
+     */
+    void flush_atlases();
+
     void adjust_default_font(uint8_t font_index);
 
     bool replace(int16_t             index,
@@ -146,6 +180,21 @@ class Fonts
     CharPool char_pool;
 
     char * get_file(const char * filename, uint32_t size);
+
+    /**
+     * @brief Retrieve a deferred font from the book
+     * 
+     * @return Font* The font. If it cannot be retrieved, the default font of
+     *               the same style is returned.
+     */
+    Font * load(int16_t index);
+
+    /**
+     * @brief Default font replacing a book font of some style
+     */
+    inline Font * get_default(FaceStyle style) {
+      return (font_cache.size() > 6) ? font_cache.at(3 + (int) style).font : font_cache.at(1).font;
+    }
     std::string & filter_filename(std::string & fname);
 };
 
@@ -0,0 +1,110 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include "models/font.hpp"
+
+#include <unordered_map>
+#include <vector>
+#include <atomic>
+
+/**
+ * @brief Pre-rendered glyphs persisted on the SD card
+ *
+ * An atlas keeps the rendered glyphs of a single (font, size) combination,
+ * for the device resolution and the current pixel resolution (1 or 8 bits
+ * per pixel). Fonts are identified through a hash of their content, such
+ * that the same font embedded in several books shares the same atlas.
+ *
+ * An atlas is made of two files located in the ATLAS_FOLDER:
+ *
+ *   - the data file (.gad) contains a header followed by glyph records
+ *     (metrics and bitmap) appended as they get rendered;
+ *   - the index file (.gai) contains a header followed by (code, offset)
+ *     entries into the data file.
+ *
+ * The index is loaded in memory the first time a glyph is requested. Each
+ * glyph is then read from the data file on demand. New glyphs are kept in
+ * memory and appended to the files when flush() is called, data first, so
+ * that a power loss can only lose index entries.
+ */
+class GlyphAtlas
+{
+  public:
+    GlyphAtlas(uint32_t font_hash, int16_t glyph_size);
+   ~GlyphAtlas();
+
+    inline int16_t get_glyph_size() const { return glyph_size; }
+
+    /**
+     * @brief Retrieve a glyph from the atlas
+     *
+     * @param code The glyph code.
+     * @param glyph The glyph to be filled. Bitmap space is allocated from the font byte pools.
+     * @param font The font requesting the glyph.
+     * @return true The glyph was found and retrieved.
+     */
+    bool load(uint32_t code, Font::Glyph & glyph, Font & font);
+
+    /**
+     * @brief Add a glyph to the atlas
+     *
+     * The glyph is kept in memory until the next flush().
+     */
+    void save(uint32_t code, const Font::Glyph & glyph);
+
+    /**
+     * @brief Write pending glyphs to the SD card and release the opened file.
+     */
+    void flush();
+
+    GlyphAtlas * next; ///< Used by the Font class to link the atlases of all sizes
+
+  private:
+    static constexpr char const * TAG = "GlyphAtlas";
+
+    static constexpr uint8_t  VERSION         =   2;
+    static constexpr uint32_t MAX_DATA_SIZE   = 1024 * 1024; ///< No more glyphs saved past this size
+    static constexpr uint32_t MAX_PENDING     = 8 * 1024;    ///< Flush when this much data is pending
+    static constexpr int8_t   MAX_OPEN_FILES  =   2;         ///< Data files kept opened, all atlases
+
+    #pragma pack(push, 1)
+      struct Header {
+        char    magic[4];
+        uint8_t version;
+      };
+      struct IndexEntry {
+        uint32_t code;
+        uint32_t offset;
+      };
+      struct Record {
+        uint32_t code;
+        uint16_t width, height;
+        int16_t  xoff, yoff;
+        int16_t  advance;
+        int16_t  pitch;
+        int16_t  line_height;
+        int16_t  ligature_and_kern_pgm_index;
+        uint16_t bitmap_size;
+      };
+    #pragma pack(pop)
+
+    static std::atomic<int8_t> open_files;
+
+    const int16_t glyph_size;
+    std::string   filename;       ///< Without extension
+
+    bool          index_loaded;
+    uint32_t      data_size;      ///< Size of the data file on the SD card
+    FILE *        data_file;      ///< Kept opened between flushes if allowed
+
+    std::unordered_map<uint32_t, uint32_t> index;
+    std::vector<uint8_t>                   pending_data;
+    std::vector<IndexEntry>                pending_index;
+
+    bool load_index();
+    bool read_at(uint32_t offset, uint8_t * buffer, uint32_t size);
+};
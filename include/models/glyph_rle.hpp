@@ -0,0 +1,106 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+/**
+ * @brief Run-length representation of grayscale glyphs
+ *
+ * In 3 bits pixel resolution, the screen only uses 8 gray levels. Glyph bitmaps
+ * are kept in the cache as runs of pixels of the same level, already converted
+ * to the screen value (0 = black, 7 = white). Each run is a single byte:
+ *
+ *     bits 7..5 : level
+ *     bits 4..0 : run length - 1 (1 to 32 pixels)
+ *
+ * Runs never span two rows. Blank (white) runs are at most 31 pixels long,
+ * such that 0xFF is free to mark the end of a row. The blank pixels at the end
+ * of a row are not encoded: the end of row marker follows the last inked run.
+ *
+ * Drawing only visits the inked runs.
+ */
+class GlyphRLE
+{
+  public:
+    static constexpr uint8_t BLANK      =    7;
+    static constexpr uint8_t END_OF_ROW = 0xFF;
+
+    /**
+     * @brief Screen level of an 8 bits gray value (0 = white, 255 = black)
+     */
+    static inline uint8_t level(uint8_t gray) { return 7 - (gray >> 5); }
+
+    /**
+     * @brief Encode an 8 bits per pixel bitmap
+     *
+     * @param bitmap The bitmap to encode.
+     * @param width Bitmap width in pixels.
+     * @param height Bitmap height in pixels.
+     * @param pitch Bytes per bitmap row.
+     * @param out Where to put the encoded runs. If nullptr, only the size is computed.
+     * @return uint32_t Encoded size in bytes.
+     */
+    static uint32_t encode(const uint8_t * bitmap,
+                           uint16_t        width,
+                           uint16_t        height,
+                           int16_t         pitch,
+                           uint8_t       * out) {
+      uint32_t size = 0;
+
+      auto put = [&size, out](uint8_t b) { if (out != nullptr) out[size] = b; size++; };
+
+      for (uint16_t y = 0; y < height; y++) {
+        const uint8_t * row    = bitmap + (y * pitch);
+        uint16_t        blanks = 0;
+        uint16_t        x      = 0;
+
+        while (x < width) {
+          uint8_t  lvl = level(row[x]);
+          uint16_t len = 1;
+          while (((x + len) < width) && (level(row[x + len]) == lvl)) len++;
+          x += len;
+
+          if (lvl == BLANK) {
+            blanks += len; // Only written if inked pixels follow
+            continue;
+          }
+          while (blanks > 0) {
+            uint8_t n = (blanks > 31) ? 31 : blanks;
+            put((BLANK << 5) | (n - 1));
+            blanks -= n;
+          }
+          while (len > 0) {
+            uint8_t n = (len > 32) ? 32 : len;
+            put((lvl << 5) | (n - 1));
+            len -= n;
+          }
+        }
+        put(END_OF_ROW);
+      }
+
+      return size;
+    }
+
+    /**
+     * @brief Visit the inked runs of an encoded glyph
+     *
+     * @param data The encoded glyph.
+     * @param height Glyph height in pixels.
+     * @param run Called as run(x, y, length, level) for each inked run, in
+     *            row order.
+     */
+    template <typename F>
+    static inline void decode(const uint8_t * data, uint16_t height, F run) {
+      for (uint16_t y = 0; y < height; y++) {
+        uint16_t x = 0;
+        uint8_t  b;
+        while ((b = *data++) != END_OF_ROW) {
+          uint8_t len = (b & 0x1F) + 1;
+          if ((b >> 5) != BLANK) run(x, y, len, b >> 5);
+          x += len;
+        }
+      }
+    }
+};
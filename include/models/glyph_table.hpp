@@ -0,0 +1,215 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include "alloc.hpp"
+
+#include <atomic>
+#include <new>
+
+/**
+ * @brief Glyphs cache for a single (font, size) pair
+ *
+ * Glyph lookup is the innermost call of both the page layout and the painting
+ * code. Codes 0 to 0x24F (Latin-1, Latin Extended-A and B) are retrieved
+ * through a direct-indexed array. Other codes are kept in a compact
+ * open-addressed map (linear probing).
+ *
+ * Readers never take a lock. Insertions must be done by a single writer at a
+ * time (the owning Font mutex is used for that). An entry is published with
+ * release semantic once completely filled; readers use acquire semantic. When
+ * the map must grow, a new one is built and published. The old one is retired
+ * and only freed with the table, as a reader may still be probing it.
+ *
+ * Removing an entry leaves its code in the map with a null item: a later
+ * insertion of the same code reuses the slot.
+ */
+template <typename T>
+class GlyphTable
+{
+  public:
+    static constexpr uint32_t DIRECT_COUNT = 0x250;
+
+    GlyphTable(int16_t size) : next(nullptr), glyph_size(size), map(nullptr), retired(nullptr) {
+      for (auto & item : direct) item.store(nullptr, std::memory_order_relaxed);
+    }
+
+   ~GlyphTable() {
+      free_map(map.load(std::memory_order_relaxed));
+      while (retired != nullptr) {
+        Map * m = retired;
+        retired = m->next_retired;
+        free_map(m);
+      }
+    }
+
+    inline int16_t get_glyph_size() const { return glyph_size; }
+
+    /**
+     * @brief Retrieve the item associated with a code
+     *
+     * Lock-free. Can be called concurrently with a writer.
+     *
+     * @param code The code (unicode or font specific glyph code)
+     * @return T* The item, or nullptr if not present.
+     */
+    inline T * find(uint32_t code) const {
+      if (code < DIRECT_COUNT) return direct[code].load(std::memory_order_acquire);
+      const Map * m = map.load(std::memory_order_acquire);
+      return (m == nullptr) ? nullptr : find_in_map(m, code);
+    }
+
+    /**
+     * @brief Add or replace the item associated with a code
+     *
+     * Writer side. The caller must ensure that only one writer at a time is
+     * modifying the table.
+     *
+     * @return false if no memory was available to grow the map.
+     */
+    bool insert(uint32_t code, T * item) {
+      if (code < DIRECT_COUNT) {
+        direct[code].store(item, std::memory_order_release);
+        return true;
+      }
+
+      Map * m = map.load(std::memory_order_relaxed);
+      if ((m == nullptr) || (((m->count + 1) << 2) > ((m->mask + 1) * 3))) {
+        if ((m = grow(m)) == nullptr) return false;
+      }
+
+      Slot * slot = probe(m, code);
+      if (slot->code.load(std::memory_order_relaxed) == EMPTY) {
+        slot->item.store(item, std::memory_order_relaxed);
+        slot->code.store(code, std::memory_order_release);
+        m->count++;
+      }
+      else {
+        slot->item.store(item, std::memory_order_release);
+      }
+      return true;
+    }
+
+    /**
+     * @brief Remove the item associated with a code. Writer side.
+     */
+    inline void remove(uint32_t code) {
+      if (code < DIRECT_COUNT) {
+        direct[code].store(nullptr, std::memory_order_release);
+      }
+      else {
+        Map * m = map.load(std::memory_order_relaxed);
+        if (m != nullptr) {
+          Slot * slot = probe(m, code);
+          if (slot->code.load(std::memory_order_relaxed) == code) {
+            slot->item.store(nullptr, std::memory_order_release);
+          }
+        }
+      }
+    }
+
+    /**
+     * @brief Visit every (code, item) pair present. Writer side.
+     */
+    template <typename F>
+    void for_each(F f) const {
+      for (uint32_t code = 0; code < DIRECT_COUNT; code++) {
+        T * item = direct[code].load(std::memory_order_relaxed);
+        if (item != nullptr) f(code, item);
+      }
+      const Map * m = map.load(std::memory_order_relaxed);
+      if (m != nullptr) {
+        for (uint32_t i = 0; i <= m->mask; i++) {
+          T * item = m->slots[i].item.load(std::memory_order_relaxed);
+          if (item != nullptr) f(m->slots[i].code.load(std::memory_order_relaxed), item);
+        }
+      }
+    }
+
+    GlyphTable * next; ///< Used by the Font class to link the tables of all sizes
+
+  private:
+    static constexpr uint32_t EMPTY            = 0xFFFFFFFF;
+    static constexpr uint8_t  INITIAL_CAPACITY = 6;  ///< log2 of the initial map capacity
+
+    struct Slot {
+      std::atomic<uint32_t> code;
+      std::atomic<T *>      item;
+    };
+
+    struct Map {
+      uint32_t mask;         ///< capacity - 1
+      uint32_t count;        ///< Number of codes present (including removed items)
+      uint8_t  shift;        ///< 32 - log2(capacity)
+      Map    * next_retired;
+      Slot     slots[1];
+    };
+
+    const int16_t      glyph_size;
+    std::atomic<T *>   direct[DIRECT_COUNT];
+    std::atomic<Map *> map;
+    Map *              retired;
+
+    static inline uint32_t hash(const Map * m, uint32_t code) {
+      return (code * 0x9E3779B1U) >> m->shift;
+    }
+
+    static T * find_in_map(const Map * m, uint32_t code) {
+      uint32_t idx = hash(m, code);
+      while (true) {
+        uint32_t c = m->slots[idx].code.load(std::memory_order_acquire);
+        if (c == code ) return m->slots[idx].item.load(std::memory_order_acquire);
+        if (c == EMPTY) return nullptr;
+        idx = (idx + 1) & m->mask;
+      }
+    }
+
+    static Slot * probe(Map * m, uint32_t code) {
+      uint32_t idx = hash(m, code);
+      while (true) {
+        uint32_t c = m->slots[idx].code.load(std::memory_order_relaxed);
+        if ((c == code) || (c == EMPTY)) return &m->slots[idx];
+        idx = (idx + 1) & m->mask;
+      }
+    }
+
+    static Map * new_map(uint8_t log2_capacity) {
+      uint32_t capacity = 1UL << log2_capacity;
+      Map * m = (Map *) allocate(sizeof(Map) + (sizeof(Slot) * (capacity - 1)));
+      if (m == nullptr) return nullptr;
+      m->mask         = capacity - 1;
+      m->count        = 0;
+      m->shift        = 32 - log2_capacity;
+      m->next_retired = nullptr;
+      for (uint32_t i = 0; i < capacity; i++) {
+        new (&m->slots[i].code) std::atomic<uint32_t>(EMPTY);
+        new (&m->slots[i].item) std::atomic<T *>(nullptr);
+      }
+      return m;
+    }
+
+    static inline void free_map(Map * m) { if (m != nullptr) free(m); }
+
+    Map * grow(Map * old) {
+      Map * m = new_map((old == nullptr) ? INITIAL_CAPACITY : (33 - old->shift));
+      if (m == nullptr) return nullptr;
+      if (old != nullptr) {
+        for (uint32_t i = 0; i <= old->mask; i++) {
+          T * item = old->slots[i].item.load(std::memory_order_relaxed);
+          if (item != nullptr) {
+            Slot * slot = probe(m, old->slots[i].code.load(std::memory_order_relaxed));
+            slot->item.store(item, std::memory_order_relaxed);
+            slot->code.store(old->slots[i].code.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            m->count++;
+          }
+        }
+        old->next_retired = retired;
+        retired = old;
+      }
+      map.store(m, std::memory_order_release);
+      return m;
+    }
+};
@@ -10,8 +10,6 @@
 #include "memory_pool.hpp"
 
 
-#include <unordered_map>
-#include <forward_list>
 #include <mutex>
 
 class IBMF : public Font
@@ -20,7 +18,6 @@ class IBMF : public Font
     static constexpr char const * TAG = "IBMF";
 
     IBMFFont            * face;
-    std::mutex            mutex;
     IBMFFont::GlyphInfo * glyph_data;
 
   public:
@@ -107,5 +104,25 @@ class IBMF : public Font
 
     Glyph * get_glyph_internal(uint32_t charcode, int16_t glyph_size);
 
+    /**
+     * @brief Compute the characters coverage from the translation tables
+     * 
+     * Only a few hundred characters are translated: the coverage is cheap 
+     * to build and is not saved.
+     */
+    void build_coverage();
+
     inline uint32_t translate(uint32_t charcode) { return face->translate(charcode); }
+
+    /**
+     * @brief Glyph code to cache key
+     * 
+     * Glyph codes without accent (0xFFnn) are folded to nn, to get them in the 
+     * direct-indexed part of the glyphs table. The other codes (accented glyphs,
+     * whose accent byte may be 0, as for À: 0x0041) are moved above 0xFF, such 
+     * that they never share a key with the folded ones.
+     */
+    static inline uint32_t cache_key(uint32_t glyph_code) { 
+      return ((glyph_code & 0xFF00) == 0xFF00) ? (glyph_code & 0xFF) : (0x100 + glyph_code); 
+    }
 };
@@ -6,7 +6,9 @@
 
 #include "global.hpp"
 #include "models/font.hpp"
+#include "models/glyph_rle.hpp"
 #include "screen.hpp"
+#include "alloc.hpp"
 
 #include "sys/stat.h"
 
@@ -987,7 +989,7 @@ class IBMFFont
         else if ((charcode >= 0xA1) && (charcode <= 0xFF)) {
           glyph_code = set2_translation_latin_1[charcode - 0xA1];
         }
-        else if ((charcode >= 0x100) && (charcode <= 0x1FF)) {
+        else if ((charcode >= 0x100) && (charcode <= 0x17F)) {
           glyph_code = set2_translation_latin_A[charcode - 0x100];
         }
         else {
@@ -1022,6 +1024,16 @@ class IBMFFont
       return glyph_code;
     }
 
+    /**
+     * @brief Check if a unicode character can be drawn with the font glyphs
+     */
+    inline bool is_supported(uint32_t charcode) {
+      uint32_t glyph_code = translate(charcode);
+      return (glyph_code != 0xFFFE) &&
+             ((glyph_code & 0xFF) != 0xFF) &&
+             (glyph_info_table[glyph_code & 0xFF] != nullptr);
+    }
+
     bool
     get_glyph(uint32_t      glyph_code,
               Font::Glyph & app_glyph,
@@ -1117,21 +1129,36 @@ class IBMFFont
         // }
       }
 
-      uint16_t size = (screen.get_pixel_resolution() == Screen::PixelResolution::ONE_BIT) ?
-          dim.height * ((dim.width + 7) >> 3) : dim.height * dim.width;
+      // In 3 bits resolution, the glyph is composed in a work bitmap, then kept as 
+      // runs of screen levels (see GlyphRLE).
+
+      bool     rle  = screen.get_pixel_resolution() != Screen::PixelResolution::ONE_BIT;
+      uint16_t size = rle ? dim.height * dim.width : dim.height * ((dim.width + 7) >> 3);
 
-      glyph.buffer = font.byte_pool_alloc(size);
-      memset(glyph.buffer, 0, size);
+      uint8_t * bitmap = rle ? (uint8_t *) allocate(size + 1) : font.byte_pool_alloc(size);
+      if (bitmap == nullptr) return false;
+      memset(bitmap, 0, size);
 
       if (accent_info != nullptr) {
-        if (load_bitmap) retrieve_bitmap(accent_info, glyph.buffer, dim, offsets);
+        if (load_bitmap) retrieve_bitmap(accent_info, bitmap, dim, offsets);
 
         offsets.y = (accent_info->vertical_offset >=  (header->x_height >> 6)) ?
           (accent_info->vertical_offset - (header->x_height >> 6)) : 0;
         offsets.x = added_left;
       }
 
-      if (load_bitmap) retrieve_bitmap(glyph_info, glyph.buffer, dim, offsets);
+      if (load_bitmap) retrieve_bitmap(glyph_info, bitmap, dim, offsets);
+
+      if (rle) {
+        glyph.bitmap_size = GlyphRLE::encode(bitmap, dim.width, dim.height, dim.width, nullptr);
+        glyph.buffer      = font.byte_pool_alloc(glyph.bitmap_size);
+        GlyphRLE::encode(bitmap, dim.width, dim.height, dim.width, glyph.buffer);
+        free(bitmap);
+      }
+      else {
+        glyph.bitmap_size = size;
+        glyph.buffer      = bitmap;
+      }
 
       glyph.dim      =   dim;
       glyph.xoff     =  -(glyph_info->horizontal_offset + offsets.x);
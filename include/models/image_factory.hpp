@@ -8,15 +8,19 @@
 #include "models/image.hpp"
 #include "models/png_image.hpp"
 #include "models/jpeg_image.hpp"
+#include "helpers/unzip.hpp"
 
 class ImageFactory {
 
   public:
-    static Image * create(std::string filename, Dim max, bool load_bitmap) {
+    /**
+     * @brief Load an image from the zip file opened in zip
+     */
+    static Image * create(std::string filename, Dim max, bool load_bitmap, Unzip & zip = unzip) {
       std::string ext = filename.substr(filename.find_last_of(".") + 1);
-      if (ext == "png") return new PngImage(filename, max, load_bitmap);
+      if (ext == "png") return new PngImage(filename, max, load_bitmap, zip);
       else if ((ext == "jpg" ) || 
-              (ext == "jpeg")) return new JPegImage(filename, max, load_bitmap);
+              (ext == "jpeg")) return new JPegImage(filename, max, load_bitmap, zip);
       return nullptr;
     }
 }; 
\ No newline at end of file
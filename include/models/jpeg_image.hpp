@@ -7,10 +7,12 @@
 
 #include "image.hpp"
 
+class Unzip;
+
 class JPegImage : public Image
 {
   public:
-    JPegImage(std::string filename, Dim max, bool load_bitmap);
+    JPegImage(std::string filename, Dim max, bool load_bitmap, Unzip & zip);
 
   private:
     static constexpr char const * TAG = "JPegImage";
@@ -7,10 +7,12 @@
 
 #include "image.hpp"
 
+class Unzip;
+
 class PngImage : public Image
 {
   public:
-    PngImage(std::string filename, Dim max, bool load_bitmap);
+    PngImage(std::string filename, Dim max, bool load_bitmap, Unzip & zip);
 
     inline int8_t get_scale_factor() { return scale; }
   private:
@@ -6,14 +6,15 @@
 #include "global.hpp"
 
 #include "models/font.hpp"
+#include "models/font_stream.hpp"
 #include "memory_pool.hpp"
 
 #include <ft2build.h>
 
 #include FT_FREETYPE_H
 #include FT_GLYPH_H
+#include FT_SIZES_H
 
-#include <unordered_map>
 #include <forward_list>
 #include <mutex>
 
@@ -22,8 +23,24 @@ class TTF : public Font
   private:
     static constexpr char const * TAG = "TTF";
 
-    FT_Face    face;
-    std::mutex mutex;
+    FT_Face      face;
+    FontStream * stream;     ///< Font file access when not loaded in memory
+
+    /**
+     * Each glyph size in use gets its own FreeType size object, such that
+     * switching between sizes doesn't require the scaled metrics to be 
+     * recomputed. The line metrics are kept with it.
+     */
+    struct SizeEntry {
+      int16_t glyph_size;
+      FT_Size ft_size;
+      int32_t line_height;
+      int32_t descender_height;
+    };
+    typedef std::forward_list<SizeEntry> Sizes;
+
+    Sizes       sizes;
+    SizeEntry * current_size;
 
   public:
     TTF(const std::string & filename);
@@ -62,8 +79,8 @@ class TTF : public Font
      */
     int32_t get_line_height(int16_t glyph_size)  {
       std::scoped_lock guard(mutex);
-      if (current_font_size != glyph_size) set_font_size(glyph_size); 
-      return (face == nullptr) ? 0 : (face->size->metrics.height >> 6); 
+      const SizeEntry * entry = get_size_entry(glyph_size);
+      return (entry == nullptr) ? 0 : entry->line_height; 
     }
 
     /**
@@ -74,8 +91,8 @@ class TTF : public Font
      */
     int32_t get_descender_height(int16_t glyph_size) {
       std::scoped_lock guard(mutex);
-      if (current_font_size != glyph_size) set_font_size(glyph_size);
-      return (face == nullptr) ? 0 : (face->size->metrics.descender >> 6); 
+      const SizeEntry * entry = get_size_entry(glyph_size);
+      return (entry == nullptr) ? 0 : entry->descender_height; 
     }
 
   private:
@@ -95,6 +112,18 @@ class TTF : public Font
      */
     bool set_font_face_from_memory(unsigned char * buffer, int32_t size);
 
+    /**
+     * @brief Set the font face object from a file
+     * 
+     * The font file is not loaded in memory: FreeType reads it through 
+     * a FontStream as glyphs are required.
+     * 
+     * @param font_filename The font file name.
+     * @return true The font was found and retrieved.
+     * @return false Some error (file not found, unsupported format).
+     */
+    bool set_font_face_from_stream(const std::string & font_filename);
+
     /**
      * @brief Set the font size
      * 
@@ -107,5 +136,22 @@ class TTF : public Font
      */
     bool set_font_size(int16_t size);
 
+    /**
+     * @brief Retrieve the size object, creating it if required
+     * 
+     * The mutex must be held by the caller. The size is not activated.
+     * 
+     * @return SizeEntry* The size entry, or nullptr if not available.
+     */
+    SizeEntry * get_size_entry(int16_t glyph_size);
+
+    /**
+     * @brief Retrieve the characters coverage
+     * 
+     * The coverage is read from the ATLAS_FOLDER if this font was already 
+     * seen. If not, it is computed from the font character map and saved.
+     */
+    void build_coverage();
+
     Glyph * get_glyph_internal(uint32_t charcode, int16_t glyph_size);
 };
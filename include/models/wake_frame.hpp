@@ -0,0 +1,65 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#pragma once
+#include "global.hpp"
+
+#include "helpers/frame_cache.hpp"
+
+/**
+ * @brief Book page shown when entering deep sleep
+ *
+ * Just before deep sleep, if a book page is on screen, its frame buffer is
+ * saved (packed) on the SD card with its FrameCache key. At wake time, the
+ * frame buffer is put back on screen as soon as the screen is set up, such
+ * that the user gets the page back while the application is initializing.
+ * The BookViewer then uses the frame instead of building the page again.
+ *
+ * The file is removed once read: it is only valid for the wake that
+ * immediately follows the deep sleep it was saved for.
+ */
+class WakeFrame
+{
+  public:
+    WakeFrame() : shown(false) { }
+
+    bool save(const FrameCache::Key & key, const uint8_t * frame, uint32_t frame_size);
+
+    /**
+     * @brief Retrieve the saved frame buffer, removing the file
+     *
+     * @param key The key of the frame, for the BookViewer.
+     * @return true The frame buffer was retrieved and is of frame_size.
+     */
+    bool restore(FrameCache::Key & key, uint8_t * frame, uint32_t frame_size);
+
+    void remove();
+
+    /// The restored frame is still on screen: messages that would overwrite it are not shown.
+    inline bool    is_shown() const { return shown;  }
+    inline void set_shown(bool value) { shown = value; }
+
+  private:
+    static constexpr char const * TAG      = "WakeFrame";
+    static constexpr char const * FILENAME = MAIN_FOLDER "/wake_frame.bin";
+    static constexpr uint8_t      VERSION  = 1;
+
+    #pragma pack(push, 1)
+      struct Header {
+        char            magic[4];
+        uint8_t         version;
+        FrameCache::Key key;
+        uint32_t        frame_size;
+        uint32_t        packed_size;
+      };
+    #pragma pack(pop)
+
+    bool shown;
+};
+
+#if __WAKE_FRAME__
+  WakeFrame wake_frame;
+#else
+  extern WakeFrame wake_frame;
+#endif
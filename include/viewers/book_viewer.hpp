@@ -16,6 +16,7 @@
 #endif
 
 #include "pugixml.hpp"
+#include "helpers/frame_cache.hpp"
 #include "viewers/page.hpp"
 #include "models/epub.hpp"
 #include "models/page_locs.hpp"
@@ -37,9 +38,14 @@ class BookViewer
     std::mutex        mutex;
     int16_t           page_bottom;
     PageLocs::PageId  current_page_id;
+    FrameCache        frames;         ///< Recently shown pages, ready to be put back on screen
 
     void build_page_at(const PageLocs::PageId & page_id);
 
+    FrameCache::Key frame_key(const PageLocs::PageId & page_id);
+    void           keep_frame(const PageLocs::PageId & page_id);
+    bool        restore_frame(const PageLocs::PageId & page_id);
+
     struct PageEnd {
       bool operator()(Page::Format & fmt) const {
         return false;
@@ -62,6 +68,31 @@ class BookViewer
     void show_page(const PageLocs::PageId & page_id);
 
     void show_fake_cover();
+
+    /**
+     * @brief Save the current page for the next wake from deep sleep (see WakeFrame)
+     * 
+     * @param page_is_shown false if a menu is on screen: the frame kept for the
+     *                      current page is saved, if any.
+     */
+    void save_wake_frame(bool page_is_shown = true);
+
+    /**
+     * @brief The frame buffer on screen is for the page identified by key
+     * 
+     * Called at wake time, once the WakeFrame has been restored on screen.
+     */
+    void adopt_frame(const FrameCache::Key & key);
+
+    /**
+     * @brief Build a page the user is likely to ask for next
+     * 
+     * The next page, then the previous one, are built and kept in the
+     * frame cache, without being shown. Called when the user is idle.
+     * 
+     * @return true A page was built. There may be more to do.
+     */
+    bool prepare_next_page();
 };
 
 #if __BOOK_VIEWER__
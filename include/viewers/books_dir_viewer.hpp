@@ -25,4 +25,12 @@ class BooksDirViewer
     virtual int16_t  prev_column() = 0;
 
     virtual int16_t get_index_at(uint16_t x, uint16_t y) = 0;
+
+    /**
+     * @brief Books shown on the current page
+     * 
+     * @param first Receives the index of the first book shown.
+     * @return The number of books shown, 0 if no page is shown.
+     */
+    virtual int16_t get_shown_books(int16_t & first) = 0;
 };
@@ -9,12 +9,13 @@
 #include "models/fonts.hpp"
 #include "viewers/page.hpp"
 #include "viewers/keypad_viewer.hpp"
+#include "viewers/keyboard_viewer.hpp"
 #include "viewers/screen_bottom.hpp"
 #include "memory_pool.hpp"
 
 #include <list>
 
-enum class FormEntryType { HORIZONTAL, VERTICAL, UINT16
+enum class FormEntryType { HORIZONTAL, VERTICAL, UINT16, TEXT
   #if INKPLATE_6PLUS || TOUCH_TRIAL
     , DONE
   #endif
@@ -40,6 +41,10 @@ struct FormEntry {
       uint16_t   min;
       uint16_t   max;
     } val;
+    struct {
+      char     * value;
+      uint16_t   size;
+    } str;
   } u;
   FormEntryType      entry_type;
 };
@@ -139,6 +144,13 @@ class FormChoiceField : public FormField
       { "MATRIX",     1 }
     };
 
+    static constexpr FormChoice dir_sort_choices[4] = {
+      { "TITLE",      0 },
+      { "AUTHOR",     1 },
+      { "LAST READ",  2 },
+      { "ADDED",      3 }
+    };
+
     static constexpr FormChoice ok_cancel_choices[2] = {
       { "OK",         1 },
       { "CANCEL",     0 }
@@ -463,6 +475,70 @@ class FormUInt16 : public FormField
     }
 };
 
+class FormText : public FormField
+{
+
+  public:
+    using FormField::FormField;
+
+    bool form_refresh_required() { return true; }
+
+    void compute_field_pos(Pos from_pos) {
+      field_pos = from_pos;
+    }
+
+    void paint(Page::Format & fmt) {
+      Font::Glyph * glyph  =  font.get_glyph('M', FORM_FONT_SIZE);
+      uint8_t       offset = -glyph->yoff;
+
+      // Only the start of the value is shown if it doesn't fit
+
+      std::string val = form_entry.u.str.value;
+      Dim         dim;
+      font.get_size(val.c_str(), &dim, FORM_FONT_SIZE);
+      while (!val.empty() && (dim.width > field_dim.width)) {
+        val.pop_back();
+        font.get_size(val.c_str(), &dim, FORM_FONT_SIZE);
+      }
+      if (val.empty()) val = "-";
+
+      page.put_str_at(form_entry.caption,
+                      Pos(caption_pos.x, caption_pos.y + offset),
+                      fmt);
+      page.put_str_at(val,
+                      Pos(field_pos.x, field_pos.y + offset),
+                      fmt);
+   }
+
+    bool event(const EventMgr::Event & event) {
+      if (!event_control) {
+        keyboard_viewer.show(form_entry.u.str.value, form_entry.caption);
+        event_control = true;
+      }
+      else {
+        if (!keyboard_viewer.event(event)) {
+          strlcpy(form_entry.u.str.value,
+                  keyboard_viewer.get_value().c_str(),
+                  form_entry.u.str.size);
+          event_control = false;
+
+          return false; // release events control
+        }
+      }
+      return true; // keep events control
+    }
+
+    void update_highlight() {
+    }
+
+    void save_value() {
+    }
+
+    void compute_field_dim() {
+      font.get_size("XXXXXXXXXX", &field_dim, FORM_FONT_SIZE);
+    }
+};
+
 #if INKPLATE_6PLUS || TOUCH_TRIAL
 class FormDone : public FormField
 {
@@ -524,6 +600,8 @@ class FieldFactory
           }
         case FormEntryType::UINT16:
           return new FormUInt16(entry, font);
+        case FormEntryType::TEXT:
+          return new FormText(entry, font);
       #if INKPLATE_6PLUS || TOUCH_TRIAL
         case FormEntryType::DONE:
           return new FormDone(entry, font);
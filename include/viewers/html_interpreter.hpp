@@ -49,6 +49,12 @@ class HTMLInterpreter
     // and the page location computation processes.
     virtual bool page_end(const Page::Format & fmt) = 0;
 
+    // The text_found method receives every string of characters met in the item
+    // (text and image alternate text), with the offset of its first character. It
+    // is called even before the start of the page. Used by the search inside a
+    // book (see the BookSearch class).
+    virtual void text_found(const char * str, int32_t offset) { }
+
   public:
     HTMLInterpreter(Page & the_page, DOM & the_dom, Page::ComputeMode the_comp_mode, const EPub::ItemInfo & the_item) 
       :           page(the_page), 
@@ -67,6 +73,13 @@ class HTMLInterpreter
 
     virtual ~HTMLInterpreter() {}
 
+    /**
+     * @brief An offset past the end of any item
+     * 
+     * Given as the start offset to set_limits(), no page is ever started.
+     */
+    static constexpr int32_t PAST_END = INT32_MAX;
+
     void set_limits(int32_t start, int32_t end, bool show_imgs) {
       started            = false;
       //beginning_of_page  = false;
@@ -2,60 +2,111 @@
 //
 // MIT License. Look at file licenses.txt for details.
 
-// Not ready yet... not sure it will be used in the future...
-#if 0
 #pragma once
 #include "global.hpp"
 
-#include "screen.hpp"
+#include "controllers/event_mgr.hpp"
 #include "viewers/page.hpp"
+#include "models/fonts.hpp"
+
+#include <string>
 
 /**
- * @brief Message presentation class
- * 
- * This class supply a screen keyboard to be used with a touch screen.
+ * @brief On-screen keyboard
  * 
+ * A minimal keyboard to enter a line of text: lower case letters, digits
+ * and a few signs. Used by the form text fields, as the KeypadViewer is
+ * used by the numeric fields. With the buttons, keys are selected moving
+ * through the lines and columns. On a touch screen, they are tapped.
  */
 class KeyboardViewer
 {
+  public:
+    static constexpr uint8_t MAX_SIZE = 40; ///< Characters at most in the value
+
+    inline const std::string & get_value() { return client_value; }
+
+    void show(const char * value, const char * caption);
+
+    /**
+     * @brief Event processing
+     *
+     * @param event Event coming from the user interaction
+     * @return true The Keyboard must keep control of events
+     * @return false Events processing is complete
+     */
+    bool event(const EventMgr::Event & event);
+
   private:
     static constexpr char const * TAG = "KeyboardViewer";
-    Page::Format fmt;
     
-    enum class KBType : int8_t { ALFA, ALFA_SHIFTED, NUMBERS, SPECIAL };
-
-    KBType         current_kb_type;
-    uint16_t       width;
-    const uint16_t HEIGHT = 240;
-
-    static constexpr char const * alfa_line_1_low = "qwertyuiop" ;
-    static constexpr char const * alfa_line_2_low = "asdfghjkl"  ;
-    static constexpr char const * alfa_line_3_low = "\1zxcvbnm\b"; // \1 == 'shift', \b == 'backspace'
-    static constexpr char const * alfa_line_4     = "\2 \r"      ; // \2 == '123', ' ' == 'space', \r == 'return'
-
-    static constexpr char const * alfa_line_1_upp = "QWERTYUIOP" ;
-    static constexpr char const * alfa_line_2_upp = "ASDFGHJKL"  ;
-    static constexpr char const * alfa_line_3_upp = "\1ZXCVBNM\b"; // \1 == 'shift', \b == 'backspace'
-
-    static constexpr char const * num_line_1      = "1234567890" ;
-    static constexpr char const * num_line_2      = "-/:;()$&@\"";
-    static constexpr char const * num_line_3      = "\3.,?!'\b"  ; // \3 == '#+=', \b == 'backspace'
-    static constexpr char const * num_line_4      = "\4 \r"      ; // \4 == 'ABC', 
-
-    static constexpr char const * special_line_1  = "[]{}#%^*+=" ;
-    static constexpr char const * special_line_2  = "_\\|~<>`/\"@";
-    static constexpr char const * special_line_3  = "\2.,?!'";
-    static constexpr char const * special_line_4  = "\4 \r";     ; // \4 == 'ABC', ' ' == 'space', \4 == 'return'
-
-    void show_kb(KBType kb_type);
-    void show_char(char           ch, uint16_t & x, uint16_t y);
-    void show_line(const char * line, uint16_t & x, uint16_t y);
-  public:
-    KeyboardViewer() : current_kb_type(KBType::ALFA) {};
+    static const uint8_t LINE_COUNT       =  5;
+    static const uint8_t COLUMN_COUNT     = 10;
+    static const uint8_t FONT_SIZE        =  9;
+    static const uint8_t KEY_ADDED_WIDTH  = 16;
+    static const uint8_t KEY_ADDED_HEIGHT = 30;
+
+    // Special keys
+    static const char SPACE  = ' ';
+    static const char BSP    = '\b';
+    static const char CLEAR  = '\f';
+    static const char OK     = '\r';
+    static const char CANCEL = '\x1b';
 
-    typedef void (* UpdateHandler)(char ch);
-    bool get_alfanum(char * str, uint16_t len, UpdateHandler handler);
-    bool get_num(int32_t & val);
+    // One character per column. A key repeated on consecutive columns is
+    // a larger key.
+    static constexpr char const * lines[LINE_COUNT] = {
+      "1234567890",
+      "abcdefghij",
+      "klmnopqrst",
+      "uvwxyz-' \b",
+      "\f\f\r\r\r\r\x1b\x1b\x1b\x1b"
+    };
+
+    struct KeyLocation {
+      Pos     pos;
+      Dim     dim;
+      char    code;
+      uint8_t first_col, last_col;
+    };
+
+    static const uint8_t MAX_KEY_COUNT = LINE_COUNT * COLUMN_COUNT;
+
+    KeyLocation   key_locs[MAX_KEY_COUNT];
+    uint8_t       key_count;
+    KeyLocation * matrix[LINE_COUNT][COLUMN_COUNT];
+
+    #if !(INKPLATE_6PLUS || TOUCH_TRIAL)
+      KeyLocation * current_key;
+      KeyLocation * previous_key;
+      uint8_t       line, col;
+    #endif
+
+    Dim           keyboard_dim;
+    Pos           keyboard_pos;
+    Dim           key_dim;
+    Pos           field_pos;    // Where to put the value on screen
+    std::string   value;        // Value being edited
+    std::string   client_value; // Value once OK is pressed
+    Page::Format  fmt;
+    Font *        font;
+    Font::Glyph * glyph;
+
+    const char * label(char code) const;
+    void update_value();
+    void paint_key(const KeyLocation & key);
+    void highlight_key(const KeyLocation & key, bool show_it);
+
+    /**
+     * @brief Act on a key
+     *
+     * @return false The OK or CANCEL key was pressed.
+     */
+    bool key_pressed(char code);
+
+    #if INKPLATE_6PLUS || TOUCH_TRIAL
+      KeyLocation * get_key(uint16_t x, uint16_t y);
+    #endif
 };
 
 #if __KEYBOARD_VIEWER__
@@ -63,5 +114,3 @@ class KeyboardViewer
 #else
   extern KeyboardViewer keyboard_viewer;
 #endif
-
-#endif
\ No newline at end of file
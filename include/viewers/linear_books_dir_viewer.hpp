@@ -52,6 +52,13 @@ class LinearBooksDirViewer : public BooksDirViewer
       int16_t idx = (y - FIRST_ENTRY_YPOS) / (BooksDir::max_cover_height + SPACE_BETWEEN_ENTRIES);
       return (idx >= books_per_page) ? -1 : (current_page_nbr * books_per_page) + idx;
     }
+
+    int16_t get_shown_books(int16_t & first) {
+      if (current_page_nbr < 0) return 0;
+      first = current_page_nbr * books_per_page;
+      int16_t count = books_dir.get_book_count() - first;
+      return (count < 0) ? 0 : ((count > books_per_page) ? books_per_page : count);
+    }
 };
 
 #if __LINEAR_BOOKS_DIR_VIEWER__
@@ -64,6 +64,13 @@ class MatrixBooksDirViewer : public BooksDirViewer
       if ((line_idx >= line_count) || (column_idx >= column_count)) return -1;
       return (current_page_nbr * books_per_page) + (column_idx * line_count) + line_idx;
     }
+
+    int16_t get_shown_books(int16_t & first) {
+      if (current_page_nbr < 0) return 0;
+      first = current_page_nbr * books_per_page;
+      int16_t count = books_dir.get_book_count() - first;
+      return (count < 0) ? 0 : ((count > books_per_page) ? books_per_page : count);
+    }
 };
 
 #if __MATRIX_BOOKS_DIR_VIEWER__
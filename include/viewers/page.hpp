@@ -70,7 +70,7 @@ class Page
   private:
     static constexpr char const * TAG = "Page";
 
-    enum class DisplayListCommand { GLYPH = 1, IMAGE, HIGHLIGHT, CLEAR_HIGHLIGHT, CLEAR_REGION, SET_REGION, ROUNDED, CLEAR_ROUNDED };
+    enum class DisplayListCommand { GLYPH = 1, IMAGE, DITHERED_IMAGE, HIGHLIGHT, CLEAR_HIGHLIGHT, CLEAR_REGION, SET_REGION, ROUNDED, CLEAR_ROUNDED };
     struct DisplayListEntry {
       union Kind {
         struct GryphEntry {            ///< Used for GLYPH
@@ -78,7 +78,7 @@ class Page
           int16_t       kern;
           bool          is_space;
         } glyph_entry;
-        struct ImageEntry {            ///< Used for IMAGE
+        struct ImageEntry {            ///< Used for IMAGE and DITHERED_IMAGE
           Image::ImageData image;       
           int16_t          advance;    ///< Horizontal advance on the baseline
         } image_entry;
@@ -126,6 +126,14 @@ class Page
     void clear_display_list();
     void           add_line(const Format & fmt, bool justifyable);
     void  add_glyph_to_line(Font::Glyph * glyph, const Format & fmt, Font & font, bool is_space);
+
+    /**
+     * @brief Glyph of a character not covered by the current font
+     * 
+     * @return Font::Glyph* The glyph from the first font covering the character, 
+     *                      or nullptr if none.
+     */
+    Font::Glyph * get_fallback_glyph(uint32_t charcode, const Format & fmt);
     void  add_image_to_line(Image & image, int16_t advance, const Format & fmt);
     int32_t      to_unicode(const char *str, CSS::TextTransform transform, bool first, const char **str2) const;
 
@@ -303,7 +311,15 @@ class Page
 
     void show_display_list(const DisplayList & list, const char * title) const;
     bool        show_cover(Image & img);
-    void         put_image(Image::ImageData & image, Pos pos); 
+
+    /**
+     * @brief Put an image in the display list
+     *
+     * @param dithered The same image already dithered to 1 bit per pixel (see
+     *                 DitheredImages), or nullptr. In 1 bit resolution, it is
+     *                 put in the display list in place of the gray image.
+     */
+    void         put_image(Image::ImageData & image, Pos pos, const uint8_t * dithered = nullptr);
     void     put_highlight(Dim dim, Pos pos);  
     void   clear_highlight(Dim dim, Pos pos);  
     void       put_rounded(Dim dim, Pos pos);  
@@ -37,8 +37,22 @@
   #define LOG_LOCAL_LEVEL EPUB_LOG_LEVEL
 #endif
 
+// Memory budget (in bytes) for the glyphs bitmap cache, shared by all fonts.
+// When exhausted, least recently used glyphs are evicted. Can be set 
+// through the build flags.
+
+#ifndef GLYPH_CACHE_BUDGET
+  #if INKPLATE_10 || INKPLATE_6PLUS
+    #define GLYPH_CACHE_BUDGET (1536 * 1024)
+  #else
+    #define GLYPH_CACHE_BUDGET (1024 * 1024)
+  #endif
+#endif
+
 #define FONTS_FOLDER MAIN_FOLDER "/fonts"
 #define BOOKS_FOLDER MAIN_FOLDER "/books"
+#define ATLAS_FOLDER MAIN_FOLDER "/atlas"
+#define BOOK_FONTS_FOLDER MAIN_FOLDER "/book_fonts"
 
 #ifndef DEBUGGING
   #define DEBUGGING 0
@@ -14,6 +14,7 @@
 #include "esp.hpp"
 
 #include <iomanip>
+#include <esp_pthread.h>
 
 #define BYTES_PER_PIXEL 3
 
@@ -22,9 +23,6 @@ Screen Screen::singleton;
 uint16_t Screen::width;
 uint16_t Screen::height;
 
-const uint8_t Screen::LUT1BIT[8]     = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
-const uint8_t Screen::LUT1BIT_INV[8] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
-
 #define SELECT(resolution)                         \
   if (orientation == Orientation::LEFT) {          \
     CODE(resolution, left);                        \
@@ -36,6 +34,16 @@ const uint8_t Screen::LUT1BIT_INV[8] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x4
     CODE(resolution, top);                         \
   }
 
+// Calls the FrameBlitter function specialized for the current orientation
+
+#define BLIT(function, ...)                                                                                  \
+  switch (orientation) {                                                                                     \
+    case Orientation::LEFT:   FrameBlitter::function<FrameBlitter::Orientation::LEFT  >(__VA_ARGS__); break; \
+    case Orientation::RIGHT:  FrameBlitter::function<FrameBlitter::Orientation::RIGHT >(__VA_ARGS__); break; \
+    case Orientation::BOTTOM: FrameBlitter::function<FrameBlitter::Orientation::BOTTOM>(__VA_ARGS__); break; \
+    case Orientation::TOP:    FrameBlitter::function<FrameBlitter::Orientation::TOP   >(__VA_ARGS__); break; \
+  }
+
 void 
 Screen::draw_bitmap(
   const unsigned char * bitmap_data, 
@@ -63,50 +71,51 @@ Screen::draw_bitmap(
   if (y_max > height) y_max = height;
   if (x_max > width ) x_max = width;
 
+  dirty.add(dim, pos);
+
   if (pixel_resolution == PixelResolution::ONE_BIT) {
-    static int16_t err[1201]; // This is the maximum width of all Inkplate devices + 1
-    int16_t error;
-    memset(err, 0, 1201*2);
-
-    #define CODE(resolution, orientation)                      \
-      for (int j = pos.y, q = 0; j < y_max; j++, q++) {        \
-        for (int i = pos.x, p = q * dim.width, k = 0;          \
-             i < (x_max - 1);                                  \
-             i++, p++, k++) {                                  \
-          int32_t v = bitmap_data[p] + err[k + 1];             \
-          if (v > 128) {                                       \
-            error = (v - 255);                                 \
-            set_pixel_o_##orientation##_##resolution(i, j, 0); \
-          }                                                    \
-          else {                                               \
-            error = v;                                         \
-            set_pixel_o_##orientation##_##resolution(i, j, 1); \
-          }                                                    \
-          if (k != 0) {                                        \
-            err[k - 1] += error / 8;                           \
-          }                                                    \
-          err[k]     += 3 * error / 8;                         \
-          err[k + 1]  =     error / 8;                         \
-          err[k + 2] += 3 * error / 8;                         \
-        }                                                      \
+    // The dithered image is kept for the next time the image is painted
+    uint16_t        pitch;
+    const uint8_t * bits = dithered_images.get(bitmap_data, dim, pitch);
+    if (bits != nullptr) {
+      BLIT(image_1bit, *frame_buffer_1bit, bits, pos, pitch, x_max, y_max);
+    }
+    else {
+      // Can't be kept: dithered a row at a time, each one drawn right away
+      dithered_images.start_rows(dim.width);
+      for (uint16_t y = pos.y; y < y_max; y++, bitmap_data += dim.width) {
+        const uint8_t * row = dithered_images.dither_row(bitmap_data, dim.width);
+        BLIT(image_1bit, *frame_buffer_1bit, row, Pos(pos.x, y), pitch, x_max, y + 1);
       }
-
-    SELECT(1bit);
-    #undef CODE
+    }
   }
   else {
-    #define CODE(resolution, orientation)                              \
-      for (int j = pos.y, q = 0; j < y_max; j++, q++) {                \
-        for (int i = pos.x, p = q * dim.width; i < x_max; i++, p++) {  \
-          int8_t v = bitmap_data[p] >> 5;                              \
-          set_pixel_o_##orientation##_##resolution(i, j, v);           \
-        }                                                              \
-      }
-    SELECT(3bit);
-    #undef CODE
+    BLIT(bitmap_3bit, *frame_buffer_3bit, bitmap_data, dim, pos, x_max, y_max);
   }
 }
 
+void
+Screen::draw_dithered_bitmap(
+  const uint8_t * bits,
+  Dim             dim,
+  Pos             pos)
+{
+  if ((bits == nullptr) || (pixel_resolution != PixelResolution::ONE_BIT)) return;
+
+  if (pos.x > width ) pos.x = 0;
+  if (pos.y > height) pos.y = 0;
+
+  uint32_t x_max = pos.x + dim.width;
+  uint32_t y_max = pos.y + dim.height;
+
+  if (y_max > height) y_max = height;
+  if (x_max > width ) x_max = width;
+
+  dirty.add(dim, pos);
+
+  BLIT(image_1bit, *frame_buffer_1bit, bits, pos, DitheredImages::get_pitch(dim), x_max, y_max);
+}
+
 void 
 Screen::draw_rectangle(
   Dim     dim,
@@ -118,6 +127,8 @@ Screen::draw_rectangle(
 
   if (y_max > height) y_max = height;
   if (x_max > width ) x_max = width;
+
+  dirty.add(dim, pos);
   
   #define CODE(resolution, orientation)                              \
     for (int i = pos.x; i < x_max; i++) {                            \
@@ -199,6 +210,8 @@ Screen::draw_round_rectangle(
   if (y_max > height) y_max = height;
   if (x_max > width ) x_max = width;
 
+  dirty.add(dim, pos);
+
   #define CODE(resolution, orientation)                            \
   for (int i = pos.x + 10; i < x_max - 10; i++) {                  \
     set_pixel_o_##orientation##_##resolution(i, pos.y,     color); \
@@ -336,6 +349,8 @@ Screen::colorize_region(
   Pos     pos,
   uint8_t color) //, bool show)
 {
+  dirty.add(dim, pos);
+
   #if !defined(INKPLATE_10)
   if (pixel_resolution == PixelResolution::ONE_BIT) {
     color = color == BLACK_COLOR ? 1 : 0;
@@ -412,27 +427,98 @@ Screen::draw_glyph(
   if (y_max > height) y_max = height;
   if (x_max > width ) x_max = width;
 
+  dirty.add(dim, pos);
+
   if (pixel_resolution == PixelResolution::ONE_BIT) {
-    #define CODE(resolution, orientation)                                     \
-      for (uint32_t j = pos.y, q = 0; j < y_max; j++, q++) {                  \
-        for (uint32_t i = pos.x, p = (q * pitch) << 3; i < x_max; i++, p++) { \
-          uint8_t v = bitmap_data[p >> 3] & LUT1BIT[p & 7];                   \
-          if (v) set_pixel_o_##orientation##_##resolution(i, j, 1);           \
-        }                                                                     \
-      }
-    SELECT(1bit);
-    #undef CODE
+    BLIT(glyph_1bit, *frame_buffer_1bit, bitmap_data, pos, pitch, x_max, y_max);
   }
   else {
-    #define CODE(resolution, orientation)                                     \
-      for (uint32_t j = pos.y, q = 0; j < y_max; j++, q++) {                  \
-        for (uint32_t i = pos.x, p = q * pitch; i < x_max; i++, p++) {        \
-          uint8_t v = 7 - (bitmap_data[p] >> 5);                              \
-          if (v != 7) set_pixel_o_##orientation##_##resolution(i, j, v);      \
-        }                                                                     \
+    // Glyph is made of runs of pixels (see GlyphRLE), only inked ones are visited
+    BLIT(glyph_3bit, *frame_buffer_3bit, bitmap_data, dim, pos, x_max, y_max);
+  }
+}
+
+Screen::Fence
+Screen::update(bool no_full)
+{
+  if (on_hold || dirty.is_empty()) return requested_fence;
+
+  UpdateKind kind = UpdateKind::FULL;
+
+  if (pixel_resolution == PixelResolution::ONE_BIT) {
+    if (no_full) {
+      kind = UpdateKind::PARTIAL;
+      dirty.partial_update_done(true);
+    }
+    else if (dirty.full_update_required()) {
+      dirty.full_update_done(PARTIAL_COUNT_ALLOWED);
+    }
+    else {
+      kind = UpdateKind::PARTIAL;
+      dirty.partial_update_done();
+    }
+  }
+  else {
+    dirty.full_update_done(PARTIAL_COUNT_ALLOWED);
+  }
+
+  std::unique_lock<std::mutex> lock(update_mutex);
+  update_cond.wait(lock, [this] { return done_fence == requested_fence; });
+
+  if (pixel_resolution == PixelResolution::ONE_BIT) {
+    if ((frame_buffer_1bit == nullptr) || (panel_buffer_1bit == nullptr)) return requested_fence;
+    memcpy(panel_buffer_1bit->get_data(), frame_buffer_1bit->get_data(), frame_buffer_1bit->get_data_size());
+  }
+  else {
+    if ((frame_buffer_3bit == nullptr) || (panel_buffer_3bit == nullptr)) return requested_fence;
+    memcpy(panel_buffer_3bit->get_data(), frame_buffer_3bit->get_data(), frame_buffer_3bit->get_data_size());
+  }
+
+  update_kind = kind;
+  requested_fence++;
+  update_cond.notify_all();
+
+  return requested_fence;
+}
+
+void
+Screen::wait_for(Fence fence)
+{
+  std::unique_lock<std::mutex> lock(update_mutex);
+  update_cond.wait(lock, [this, fence] { return (int32_t)(done_fence - fence) >= 0; });
+}
+
+void
+Screen::update_task()
+{
+  std::unique_lock<std::mutex> lock(update_mutex);
+
+  while (true) {
+    update_cond.wait(lock, [this] { return done_fence != requested_fence; });
+
+    // The panel buffer is not touched by update() until the fence is reached:
+    // no need to keep the lock while the waveform is running.
+
+    UpdateKind kind = update_kind;
+    lock.unlock();
+
+    if (panel_buffer_1bit != nullptr) {
+      if (kind == UpdateKind::PARTIAL) {
+        e_ink.partial_update(*panel_buffer_1bit);
       }
-    SELECT(3bit);
-    #undef CODE
+      else {
+        //e_ink.clean();
+        e_ink.update(*panel_buffer_1bit);
+      }
+    }
+    else if (panel_buffer_3bit != nullptr) {
+      e_ink.update(*panel_buffer_3bit);
+    }
+
+    lock.lock();
+
+    done_fence = requested_fence;
+    update_cond.notify_all();
   }
 }
 
@@ -442,32 +528,56 @@ Screen::setup(PixelResolution resolution, Orientation orientation)
   set_orientation(orientation);
   set_pixel_resolution(resolution, true);
   clear();
+
+  if (!update_thread.joinable()) {
+    // The waveform timing is tight: the task is given its own core.
+    auto default_cfg = esp_pthread_get_default_config();
+    auto cfg         = default_cfg;
+    cfg.thread_name  = "updateTask";
+    cfg.pin_to_core  = 1;
+    cfg.stack_size   = 8 * 1024;
+    cfg.prio         = configMAX_PRIORITIES - 1;
+    esp_pthread_set_cfg(&cfg);
+    update_thread = std::thread(&Screen::update_task, this);
+    esp_pthread_set_cfg(&default_cfg);
+  }
+}
+
+void
+Screen::free_frame_buffers()
+{
+  if (frame_buffer_1bit != nullptr) { free(frame_buffer_1bit); frame_buffer_1bit = nullptr; }
+  if (panel_buffer_1bit != nullptr) { free(panel_buffer_1bit); panel_buffer_1bit = nullptr; }
+  if (frame_buffer_3bit != nullptr) { free(frame_buffer_3bit); frame_buffer_3bit = nullptr; }
+  if (panel_buffer_3bit != nullptr) { free(panel_buffer_3bit); panel_buffer_3bit = nullptr; }
 }
 
 void 
 Screen::set_pixel_resolution(PixelResolution resolution, bool force)
 {
   if (force || (pixel_resolution != resolution)) {
+    // The update task must be done with the panel buffer before it is freed
+    wait_for_update();
+
     pixel_resolution = resolution;
+    free_frame_buffers();
     if (pixel_resolution == PixelResolution::ONE_BIT) {
-      if (frame_buffer_3bit != nullptr) {
-        free(frame_buffer_3bit);
-        frame_buffer_3bit = nullptr;
-      }
       if ((frame_buffer_1bit = e_ink.new_frame_buffer_1bit()) != nullptr) {
         frame_buffer_1bit->clear();
       }
-      partial_count = 0;
+      panel_buffer_1bit = e_ink.new_frame_buffer_1bit();
     }
     else {
-      if (frame_buffer_1bit != nullptr) {
-        free(frame_buffer_1bit);
-        frame_buffer_1bit = nullptr;
-      }
       if ((frame_buffer_3bit = e_ink.new_frame_buffer_3bit()) != nullptr) {
         frame_buffer_3bit->clear();
       }
+      panel_buffer_3bit = e_ink.new_frame_buffer_3bit();
+      dithered_images.clear();
+    }
+    if ((panel_buffer_1bit == nullptr) && (panel_buffer_3bit == nullptr)) {
+      LOG_E("Unable to allocate the panel buffer.");
     }
+    dirty.force_full_update();
   }
 }
 
@@ -483,4 +593,6 @@ Screen::set_orientation(Orientation orient)
     width  = e_ink.get_width();
     height = e_ink.get_height();
   }
+  dirty.set_screen_size(width, height);
+  dirty.force_full_update();
 }
\ No newline at end of file
@@ -7,6 +7,13 @@
 
 #include "non_copyable.hpp"
 #include "inkplate_platform.hpp"
+#include "helpers/dirty_regions.hpp"
+#include "helpers/dithered_images.hpp"
+#include "helpers/frame_blitter.hpp"
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 /**
  * @brief Low level logical Screen display
@@ -41,6 +48,16 @@ class Screen : NonCopyable
     enum class PixelResolution : int8_t { ONE_BIT, THREE_BITS };
 
     void          draw_bitmap(const unsigned char * bitmap_data, Dim dim, Pos pos);
+
+    /**
+     * @brief Draw an image already dithered to 1 bit per pixel
+     *
+     * Used in 1 bit resolution only, in place of draw_bitmap(), for images
+     * dithered in advance (see DitheredImages for the format): no dithering
+     * is done at paint time.
+     */
+    void draw_dithered_bitmap(const uint8_t * bits, Dim dim, Pos pos);
+
     void           draw_glyph(const unsigned char * bitmap_data, Dim dim, Pos pos, uint16_t pitch);
     void       draw_rectangle(Dim dim, Pos pos, uint8_t color);
     void draw_round_rectangle(Dim dim, Pos pos, uint8_t color);
@@ -56,116 +73,100 @@ class Screen : NonCopyable
       else {
         frame_buffer_3bit->clear();
       } 
+      dirty.set_all();
     }
     
-    inline void update(bool no_full = false) { 
-      if (pixel_resolution == PixelResolution::ONE_BIT) {
-        if (no_full) {
-          e_ink.partial_update(*frame_buffer_1bit);
-          partial_count = 0;
-        }
-        else {
-          if (partial_count <= 0) {
-            //e_ink.clean();
-            e_ink.update(*frame_buffer_1bit);
-            partial_count = PARTIAL_COUNT_ALLOWED;
-          }
-          else {
-            e_ink.partial_update(*frame_buffer_1bit);
-            partial_count--;
-          }
-        }
-      }
-      else {
-        e_ink.update(*frame_buffer_3bit);
-      }
-    }
+    typedef uint32_t Fence;  ///< Identifies an update, in the order they were requested
+
+    /**
+     * @brief Show the frame buffer changes on the panel
+     * 
+     * Nothing is done if nothing was drawn since the last update. In 1 bit
+     * resolution, a partial update is done, unless a screen band touched by 
+     * the changes has exhausted its ghosting budget (see DirtyRegions).
+     * 
+     * The frame buffer is copied to the panel buffer and the update task 
+     * drives the panel from there: the call returns without waiting for the 
+     * waveform to complete, and the next frame can be composed meanwhile. 
+     * If the previous update is still under way, it is waited for first.
+     * 
+     * @param no_full If true, a partial update is done and the touched bands 
+     *                will require a full update next time.
+     * @return The fence of the update (see wait_for()).
+     */
+    Fence update(bool no_full = false);
+
+    /**
+     * @brief Wait until an update has been done on the panel
+     * 
+     * Required before anything that would stop the update task: deep or
+     * light sleep, restart.
+     */
+    void wait_for(Fence fence);
+    inline void wait_for_update() { wait_for(requested_fence); }
 
   private:
     static constexpr char const * TAG = "Screen";
-    static const uint8_t          LUT1BIT[8];
-    static const uint8_t          LUT1BIT_INV[8];
     
     static uint16_t width;
     static uint16_t height;
 
     static Screen singleton;
-    Screen() : partial_count(0), 
-               frame_buffer_1bit(nullptr), 
-               frame_buffer_3bit(nullptr) { };
-
-    int16_t           partial_count;
+    Screen() : frame_buffer_1bit(nullptr), 
+               frame_buffer_3bit(nullptr),
+               on_hold(false),
+               panel_buffer_1bit(nullptr), 
+               panel_buffer_3bit(nullptr),
+               update_kind(UpdateKind::FULL),
+               requested_fence(0),
+               done_fence(0) { };
+
+    DirtyRegions      dirty;
+    DitheredImages    dithered_images;
     FrameBuffer1Bit * frame_buffer_1bit;
     FrameBuffer3Bit * frame_buffer_3bit;
     PixelResolution   pixel_resolution;
     Orientation       orientation;
+    bool              on_hold;
 
-    enum class Corner : uint8_t { TOP_LEFT, TOP_RIGHT, LOWER_LEFT, LOWER_RIGHT };
-    void draw_arc(uint16_t x_mid,  uint16_t y_mid,  uint8_t radius, Corner corner, uint8_t color);
+    // The update task drives the panel from its own copy of the frame buffer.
+    // Only one update is in flight at a time.
 
-    inline void set_pixel_o_left_1bit(uint32_t col, uint32_t row, uint8_t color) {
-      uint8_t * temp = &(frame_buffer_1bit->get_data())[frame_buffer_1bit->get_data_size() - (frame_buffer_1bit->get_line_size() * (col + 1)) + (row >> 3)];
-      if (color == 1)
-        *temp = *temp | LUT1BIT_INV[row & 7];
-      else
-        *temp = (*temp & ~LUT1BIT_INV[row & 7]);
-    }
+    enum class UpdateKind : uint8_t { PARTIAL, FULL };
 
-    inline void set_pixel_o_right_1bit(uint32_t col, uint32_t row, uint8_t color) {
-      uint8_t * temp = &(frame_buffer_1bit->get_data())[(frame_buffer_1bit->get_line_size() * (col + 1)) - (row >> 3) - 1];
-      if (color == 1)
-        *temp = *temp | LUT1BIT[row & 7];
-      else
-        *temp = (*temp & ~LUT1BIT[row & 7]);
-    }
+    FrameBuffer1Bit *       panel_buffer_1bit;
+    FrameBuffer3Bit *       panel_buffer_3bit;
+    UpdateKind              update_kind;
+    Fence                   requested_fence;
+    Fence                   done_fence;
+    std::mutex              update_mutex;
+    std::condition_variable update_cond;
+    std::thread             update_thread;
 
-    inline void set_pixel_o_bottom_1bit(uint32_t col, uint32_t row, uint8_t color) {
-      uint8_t * temp = &(frame_buffer_1bit->get_data())[frame_buffer_1bit->get_line_size() * row + (col >> 3)];
-      if (color == 1)
-        *temp = *temp | LUT1BIT_INV[col & 7];
-      else
-        *temp = (*temp & ~LUT1BIT_INV[col & 7]);
-    }
+    void update_task();
+    void free_frame_buffers();
 
-    inline void set_pixel_o_top_1bit(uint32_t col, uint32_t row, uint8_t color) {
-      uint8_t * temp = &(frame_buffer_1bit->get_data())[frame_buffer_1bit->get_data_size() - (frame_buffer_1bit->get_line_size() * row) - (col >> 3)];
-      if (color == 1)
-        *temp = *temp | LUT1BIT[col & 7];
-      else
-        *temp = (*temp & ~LUT1BIT[col & 7]);
-    }
+    enum class Corner : uint8_t { TOP_LEFT, TOP_RIGHT, LOWER_LEFT, LOWER_RIGHT };
+    void draw_arc(uint16_t x_mid,  uint16_t y_mid,  uint8_t radius, Corner corner, uint8_t color);
 
-    inline void set_pixel_o_left_3bit(uint32_t col, uint32_t row, uint8_t color) {
-      uint8_t * temp = &(frame_buffer_3bit->get_data())[frame_buffer_3bit->get_data_size() - (frame_buffer_3bit->get_line_size() * (col + 1)) + (row >> 1)];
-      if (row & 1)
-        *temp = (*temp & 0xF0) | color;
-      else
-        *temp = (*temp & 0x0F) | (color << 4);
-    }
+    // Per pixel access, used when drawing lines and arcs. See FrameBlitter.
 
-    inline void set_pixel_o_right_3bit(uint32_t col, uint32_t row, uint8_t color) {
-      uint8_t * temp = &(frame_buffer_3bit->get_data())[(frame_buffer_3bit->get_line_size() * (col + 1)) - (row >> 1) - 1];
-      if (row & 1)
-        *temp = (*temp & 0x0F) | (color << 4);
-      else
-        *temp = (*temp & 0xF0) | color;
-    }
+    #define SET_PIXEL(orient, resolution, ORIENT)                                                  \
+      inline void set_pixel_o_##orient##_##resolution(uint32_t col, uint32_t row, uint8_t color) { \
+        FrameBlitter::set_pixel_##resolution<FrameBlitter::Orientation::ORIENT>(                   \
+          *frame_buffer_##resolution, col, row, color);                                            \
+      }
+
+    SET_PIXEL(left,   1bit, LEFT  )
+    SET_PIXEL(right,  1bit, RIGHT )
+    SET_PIXEL(bottom, 1bit, BOTTOM)
+    SET_PIXEL(top,    1bit, TOP   )
+    SET_PIXEL(left,   3bit, LEFT  )
+    SET_PIXEL(right,  3bit, RIGHT )
+    SET_PIXEL(bottom, 3bit, BOTTOM)
+    SET_PIXEL(top,    3bit, TOP   )
 
-    inline void set_pixel_o_bottom_3bit(uint32_t col, uint32_t row, uint8_t color) {
-      uint8_t * temp = &(frame_buffer_3bit->get_data())[frame_buffer_3bit->get_line_size() * row + (col >> 1)];
-      if (col & 1)
-        *temp = (*temp & 0xF0) | color;
-      else
-        *temp = (*temp & 0x0F) | (color << 4);
-     }
-
-    inline void set_pixel_o_top_3bit(uint32_t col, uint32_t row, uint8_t color) {
-      uint8_t * temp = &(frame_buffer_3bit->get_data())[frame_buffer_3bit->get_data_size() - (frame_buffer_3bit->get_line_size() * row) - (col >> 1)];
-      if (col & 1)
-        *temp = (*temp & 0x0F) | (color << 4);
-      else
-        *temp = (*temp & 0xF0) | color;
-     }
+    #undef SET_PIXEL
 
   public:
     static Screen & get_singleton() noexcept { return singleton; }
@@ -174,7 +175,36 @@ class Screen : NonCopyable
     void set_orientation(Orientation orient);
     inline Orientation get_orientation() { return orientation; }
     inline PixelResolution get_pixel_resolution() { return pixel_resolution; }
-    inline void force_full_update() { partial_count = 0; }
+    inline void force_full_update() { dirty.force_full_update(); }
+
+    /**
+     * @brief Raw access to the current frame buffer
+     * 
+     * Used to keep a copy of a rendered page. Once a copy has been put back in 
+     * the frame buffer, frame_restored() must be called before update().
+     */
+    inline uint8_t * get_frame_data() {
+      if (pixel_resolution == PixelResolution::ONE_BIT) {
+        return (frame_buffer_1bit == nullptr) ? nullptr : frame_buffer_1bit->get_data();
+      }
+      return (frame_buffer_3bit == nullptr) ? nullptr : frame_buffer_3bit->get_data();
+    }
+    inline uint32_t get_frame_size() {
+      if (pixel_resolution == PixelResolution::ONE_BIT) {
+        return (frame_buffer_1bit == nullptr) ? 0 : frame_buffer_1bit->get_data_size();
+      }
+      return (frame_buffer_3bit == nullptr) ? 0 : frame_buffer_3bit->get_data_size();
+    }
+    inline void frame_restored() { dirty.set_all(); }
+
+    /**
+     * @brief Compose in the frame buffer without showing it
+     * 
+     * While on hold, update() does nothing. When released, the changes made
+     * meanwhile are forgotten: the caller must have put back in the frame 
+     * buffer what is shown on the panel.
+     */
+    inline void hold_updates(bool hold) { on_hold = hold; if (!hold) dirty.clear(); }
 
     #if INKPLATE_6PLUS
       void to_user_coord(uint16_t & x, uint16_t & y);
@@ -9,6 +9,7 @@
 
 #define __SCREEN__ 1
 #include "screen.hpp"
+#include "models/glyph_rle.hpp"
 
 #include <iomanip>
 
@@ -43,7 +44,7 @@ Screen::draw_bitmap(
 {
   if (bitmap_data == nullptr) return;
   
-  GdkPixbuf * pb = gtk_image_get_pixbuf(image_data.image);
+  GdkPixbuf * pb = image_data.canvas;
   guchar    * g  = gdk_pixbuf_get_pixels(pb);
   
   if (pos.x > width) pos.x = 0;
@@ -55,28 +56,20 @@ Screen::draw_bitmap(
   if (y_max > height) y_max = height;
   if (x_max > width ) x_max = width;
 
+  dirty.add(dim, pos);
+
   if (pixel_resolution == PixelResolution::ONE_BIT) {
-    static int16_t err[601];
-    int16_t error;
-    memset(err, 0, 601*2);
+    uint16_t        pitch;
+    const uint8_t * bits = dithered_images.get(bitmap_data, dim, pitch);
+
+    // If it can't be kept, it is dithered a row at a time
+    if (bits == nullptr) dithered_images.start_rows(dim.width);
 
     for (int j = pos.y, q = 0; j < y_max; j++, q++) {
-      for (int i = pos.x, p = q * dim.width, k = 0; i < (x_max - 1); i++, p++, k++) {
-        int32_t v = bitmap_data[p] + err[k + 1];
-        if (v > 128) {
-          error = (v - 255);
-          setrgb(g, j, i, image_data.stride, 255);
-        }
-        else {
-          error = v;
-          setrgb(g, j, i, image_data.stride, 0);
-        }
-        if (k != 0) {
-          err[k - 1] += error / 8;
-        }
-        err[k]     += 3 * error / 8;
-        err[k + 1]  =     error / 8;
-        err[k + 2] += 3 * error / 8;
+      const uint8_t * row = (bits != nullptr) ? &bits[q * pitch]
+                                              : dithered_images.dither_row(&bitmap_data[q * dim.width], dim.width);
+      for (int i = pos.x, k = 0; i < x_max; i++, k++) {
+        setrgb(g, j, i, image_data.stride, (row[k >> 3] & (0x80 >> (k & 7))) ? 0 : 255);
       }
     }
   }
@@ -85,6 +78,38 @@ Screen::draw_bitmap(
       for (int i = pos.x, p = q * dim.width; i < x_max; i++, p++) {
         setrgb(g, j, i, image_data.stride, bitmap_data[p]);
       }
+    }
+  }
+}
+
+void
+Screen::draw_dithered_bitmap(
+  const uint8_t * bits,
+  Dim             dim,
+  Pos             pos)
+{
+  if ((bits == nullptr) || (pixel_resolution != PixelResolution::ONE_BIT)) return;
+
+  GdkPixbuf * pb = image_data.canvas;
+  guchar    * g  = gdk_pixbuf_get_pixels(pb);
+
+  if (pos.x > width) pos.x = 0;
+  if (pos.y > height) pos.y = 0;
+
+  int16_t x_max = pos.x + dim.width;
+  int16_t y_max = pos.y + dim.height;
+
+  if (y_max > height) y_max = height;
+  if (x_max > width ) x_max = width;
+
+  dirty.add(dim, pos);
+
+  uint16_t pitch = DitheredImages::get_pitch(dim);
+
+  for (int j = pos.y, q = 0; j < y_max; j++, q++) {
+    const uint8_t * row = &bits[q * pitch];
+    for (int i = pos.x, k = 0; i < x_max; i++, k++) {
+      setrgb(g, j, i, image_data.stride, (row[k >> 3] & (0x80 >> (k & 7))) ? 0 : 255);
     }    
   }
 }
@@ -95,7 +120,7 @@ Screen::draw_rectangle(
   Pos      pos,
   uint8_t  color) //, bool show)
 {
-  GdkPixbuf * pb = gtk_image_get_pixbuf(image_data.image);
+  GdkPixbuf * pb = image_data.canvas;
   guchar    * g  = gdk_pixbuf_get_pixels(pb);
   
   int16_t x_max = pos.x + dim.width;
@@ -104,6 +129,8 @@ Screen::draw_rectangle(
   if (y_max > height) y_max = height;
   if (x_max > width ) x_max = width;
 
+  dirty.add(dim, pos);
+
   for (int i = pos.x; i < x_max; i++) {
     setrgb(g, pos.y, i, image_data.stride, color);
     setrgb(g, y_max - 1, i, image_data.stride, color);
@@ -123,7 +150,7 @@ Screen::draw_arc(uint16_t x_mid,  uint16_t y_mid,  uint8_t radius, Corner corner
   int16_t x     =           0;
   int16_t y     =      radius;
     
-  GdkPixbuf * pb = gtk_image_get_pixbuf(image_data.image);
+  GdkPixbuf * pb = image_data.canvas;
   guchar    * g  = gdk_pixbuf_get_pixels(pb);
 
   //Bottom middle
@@ -178,7 +205,7 @@ Screen::draw_round_rectangle(
   Pos      pos,
   uint8_t  color) //, bool show)
 {
-  GdkPixbuf * pb = gtk_image_get_pixbuf(image_data.image);
+  GdkPixbuf * pb = image_data.canvas;
   guchar    * g  = gdk_pixbuf_get_pixels(pb);
   
   int16_t x_max = pos.x + dim.width;
@@ -187,6 +214,8 @@ Screen::draw_round_rectangle(
   if (y_max > height) y_max = height;
   if (x_max > width ) x_max = width;
 
+  dirty.add(dim, pos);
+
   for (int i = pos.x + 10; i < x_max - 10; i++) {
     setrgb(g, pos.y, i, image_data.stride, color);
     setrgb(g, y_max - 1, i, image_data.stride, color);
@@ -208,7 +237,7 @@ Screen::colorize_region(
   Pos      pos,
   uint8_t  color)
 {
-  GdkPixbuf * pb = gtk_image_get_pixbuf(image_data.image);
+  GdkPixbuf * pb = image_data.canvas;
   guchar    * g  = gdk_pixbuf_get_pixels(pb);
   
   int16_t x_max = pos.x + dim.width;
@@ -217,6 +246,8 @@ Screen::colorize_region(
   if (y_max > height) y_max = height;
   if (x_max > width ) x_max = width;
 
+  dirty.add(dim, pos);
+
   for (int j = pos.y; j < y_max; j++) {
     for (int i = pos.x; i < x_max; i++) {
       setrgb(g, j, i, image_data.stride, color);
@@ -231,7 +262,7 @@ Screen::draw_glyph(
   Pos                   pos,  
   uint16_t              pitch)
 {
-  GdkPixbuf * pb = gtk_image_get_pixbuf(image_data.image);
+  GdkPixbuf * pb = image_data.canvas;
   guchar    * g  = gdk_pixbuf_get_pixels(pb);
 
   int x_max = pos.x + dim.width;
@@ -240,39 +271,43 @@ Screen::draw_glyph(
   if (y_max > height) y_max = height;
   if (x_max > width ) x_max = width;
 
+  dirty.add(dim, pos);
+
   if (pixel_resolution == PixelResolution::ONE_BIT) {
+    // Blank bytes (8 pixels) are skipped
     for (int j = pos.y, q = 0; j < y_max; j++, q++) {
-      for (int i = pos.x, p = (q * pitch) << 3; i < x_max; i++, p++) {
-        // int v = (255 - bitmap_data[p]);
-        // if (v != 255) {
-        //   v &= 0xE0; // 8 levels of grayscale
-        //   setrgb(g, j, i, image_data.stride, v);
-        // }
-        uint8_t v = bitmap_data[p >> 3] & LUT1BIT[p & 7];
-        if (v) setrgb(g, j, i, image_data.stride, 0);
+      const unsigned char * row = &bitmap_data[q * pitch];
+      for (int i = pos.x, k = 0; i < x_max; i += 8, k++) {
+        uint8_t bits = row[k];
+        if (bits == 0) continue;
+        int end = ((i + 8) < x_max) ? (i + 8) : x_max;
+        for (int x = i; x < end; x++, bits <<= 1) {
+          if (bits & 0x80) setrgb(g, j, x, image_data.stride, 0);
+        }
       }
     }
   }
   else {
-    for (int j = pos.y, q = 0; j < y_max; j++, q++) {
-      for (int i = pos.x, p = q * pitch; i < x_max; i++, p++) {
-        // int v = (255 - bitmap_data[p]);
-        // if (v != 255) {
-        //   v &= 0xE0; // 8 levels of grayscale
-        //   setrgb(g, j, i, image_data.stride, v);
-        // }
-        uint8_t v = (255 - bitmap_data[p]) & 0xE0;
-        if (v != 0xE0) setrgb(g, j, i, image_data.stride, v);
-      }
-    }
+    // Glyph is made of runs of pixels (see GlyphRLE), only inked ones are visited
+    GlyphRLE::decode(bitmap_data, dim.height, 
+      [&](uint16_t x, uint16_t y, uint8_t length, uint8_t level) {
+        int j = pos.y + y;
+        if (j >= y_max) return;
+        int end = pos.x + x + length;
+        if (end > x_max) end = x_max;
+        for (int i = pos.x + x; i < end; i++) {
+          setrgb(g, j, i, image_data.stride, level << 5);
+        }
+      });
   }
 }
 
 void 
 Screen::clear()
 {
-  GdkPixbuf * pb = gtk_image_get_pixbuf(image_data.image);
+  GdkPixbuf * pb = image_data.canvas;
   gdk_pixbuf_fill(pb, 0xFFFFFFFF); // clear to white
+  dirty.set_all();
 }
 
 void 
@@ -280,7 +315,7 @@ Screen::test()
 {
   static int N = 0;
 
-  GdkPixbuf * pb = gtk_image_get_pixbuf(image_data.image);
+  GdkPixbuf * pb = image_data.canvas;
 
   gdk_pixbuf_fill(pb, 0xFFFFFFFF); // clear to white
 
@@ -293,13 +328,91 @@ Screen::test()
 
   N = (N + 1) % 100;
 
+  dirty.set_all();
   update();
 }
 
-void 
+Screen::Fence
 Screen::update(bool no_full)
 {
-  gtk_image_set_from_pixbuf(GTK_IMAGE(image_data.image), gtk_image_get_pixbuf(image_data.image));
+  if (on_hold || dirty.is_empty()) return requested_fence;
+
+  // Only one update in flight, as on the InkPlate
+  
+  wait_for(requested_fence);
+
+  // Same decision as the InkPlate version
+
+  bool full = !no_full && dirty.full_update_required();
+
+  // The canvas can be changed while the update is emulated: a copy is shown
+  
+  GdkPixbuf * shown = gdk_pixbuf_copy(image_data.canvas);
+
+  #if SHOW_DIRTY_REGIONS
+    // The regions of a partial update are outlined
+    if (!full) {
+      guchar * g = gdk_pixbuf_get_pixels(shown);
+      auto red = [&](int row, int col) {
+        guchar * p = &g[row * image_data.stride + col * BYTES_PER_PIXEL];
+        p[0] = 255; p[1] = p[2] = 0;
+      };
+      for (auto & r : dirty) {
+        for (int i = r.x_min; i < r.x_max; i++) { red(r.y_min, i); red(r.y_max - 1, i); }
+        for (int j = r.y_min; j < r.y_max; j++) { red(j, r.x_min); red(j, r.x_max - 1); }
+      }
+    }
+  #endif
+
+  if (full) {
+    dirty.full_update_done(PARTIAL_COUNT_ALLOWED);
+  }
+  else {
+    dirty.partial_update_done(no_full);
+  }
+
+  int16_t latency = full ? FULL_UPDATE_LATENCY : PARTIAL_UPDATE_LATENCY;
+
+  pending_image  = shown;
+  pending_due    = g_get_monotonic_time() + (latency * 1000);
+  pending_source = g_timeout_add(latency, update_done, nullptr);
+
+  return ++requested_fence;
+}
+
+gboolean
+Screen::update_done(gpointer data)
+{
+  screen.pending_source = 0;
+  screen.show_pending_image();
+  return G_SOURCE_REMOVE;
+}
+
+void
+Screen::show_pending_image()
+{
+  gtk_image_set_from_pixbuf(GTK_IMAGE(image_data.image), pending_image);
+  g_object_unref(pending_image);
+  pending_image = nullptr;
+  done_fence    = requested_fence;
+}
+
+void
+Screen::wait_for(Fence fence)
+{
+  if ((pending_image == nullptr) || ((int32_t)(done_fence - fence) >= 0)) return;
+
+  // The gtk loop is not run from here: the caller is blocked as it would be 
+  // on the InkPlate, for the remaining of the update time.
+
+  gint64 remaining = pending_due - g_get_monotonic_time();
+  if (remaining > 0) g_usleep(remaining);
+
+  if (pending_source != 0) {
+    g_source_remove(pending_source);
+    pending_source = 0;
+  }
+  show_pending_image();
 }
 
 extern void exit_app();
@@ -348,7 +461,8 @@ Screen::setup(PixelResolution resolution, Orientation orientation)
     nullptr             // destroy_fn_data
   );
 
-  image_data.image = GTK_IMAGE(gtk_image_new_from_pixbuf(pb));
+  image_data.canvas = pb;
+  image_data.image  = GTK_IMAGE(gtk_image_new_from_pixbuf(pb));
 
   window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
 
@@ -399,6 +513,7 @@ Screen::set_pixel_resolution(PixelResolution resolution, bool force)
 {
   if (force || (pixel_resolution != resolution)) {
     pixel_resolution = resolution;
+    if (pixel_resolution != PixelResolution::ONE_BIT) dithered_images.clear();
   }
 }
 
@@ -414,4 +529,6 @@ Screen::set_orientation(Orientation orient)
     width  = 800;
     height = 600;
   }
+  dirty.set_screen_size(width, height);
+  dirty.force_full_update();
 }
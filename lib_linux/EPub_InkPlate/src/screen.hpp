@@ -6,9 +6,19 @@
 #include "global.hpp"
 
 #include "non_copyable.hpp"
+#include "helpers/dirty_regions.hpp"
+#include "helpers/dithered_images.hpp"
 
 #include <gtk/gtk.h>
 
+#ifndef SHOW_DIRTY_REGIONS
+  #define SHOW_DIRTY_REGIONS 0  ///< 1: Outline in red the regions of partial updates
+#endif
+
+#ifndef UPDATE_LATENCY
+  #define UPDATE_LATENCY 0      ///< 1: Show an update after the time the panel would take
+#endif
+
 /**
  * @brief Low level logical Screen display
  * 
@@ -28,38 +38,81 @@ class Screen : NonCopyable
     static constexpr uint16_t RESOLUTION  =  166;  ///< Pixels per inch
     static constexpr uint8_t  BLACK_COLOR = 0x00;
     static constexpr uint8_t  WHITE_COLOR = 0xFF;
+    static constexpr int8_t   PARTIAL_COUNT_ALLOWED = 10;
     
     enum class Orientation     : int8_t { LEFT, RIGHT, BOTTOM };
     enum class PixelResolution : int8_t { ONE_BIT, THREE_BITS };
 
     void           draw_bitmap(const unsigned char * bitmap_data, Dim dim, Pos pos);
+
+    /**
+     * @brief Draw an image already dithered to 1 bit per pixel
+     *
+     * Used in 1 bit resolution only, in place of draw_bitmap(), for images
+     * dithered in advance (see DitheredImages for the format): no dithering
+     * is done at paint time.
+     */
+    void draw_dithered_bitmap(const uint8_t * bits, Dim dim, Pos pos);
+
     void            draw_glyph(const unsigned char * bitmap_data, Dim dim, Pos pos, uint16_t pitch);
     void        draw_rectangle(Dim dim, Pos pos, uint8_t color);
     void  draw_round_rectangle(Dim dim, Pos pos, uint8_t color);
     void       colorize_region(Dim dim, Pos pos, uint8_t color);
     void                 clear();
-    void                update(bool no_full = false); // Parameter only used by the InkPlate version
     void                  test();
 
+    // Updates are asynchronous. See the InkPlate version.
+    typedef uint32_t Fence;
+    Fence               update(bool no_full = false);
+    void              wait_for(Fence fence);
+    inline void wait_for_update() { wait_for(requested_fence); }
+
   private:
     static constexpr char const * TAG = "Screen";
 
     static const uint8_t LUT1BIT[8];
 
+    #if UPDATE_LATENCY
+      static constexpr int16_t PARTIAL_UPDATE_LATENCY =  300;  ///< In ms
+      static constexpr int16_t    FULL_UPDATE_LATENCY = 1000;
+    #else
+      static constexpr int16_t PARTIAL_UPDATE_LATENCY =    0;
+      static constexpr int16_t    FULL_UPDATE_LATENCY =    0;
+    #endif
+
     static Screen singleton;
-    Screen() {};
+    Screen() : on_hold(false), 
+               requested_fence(0), 
+               done_fence(0), 
+               pending_image(nullptr), 
+               pending_source(0) {};
 
     static uint16_t width;
     static uint16_t height;
 
     struct ImageData {
-      GtkImage * image;
+      GtkImage  * image;
+      GdkPixbuf * canvas;    ///< Drawing surface, shown in image on update
       int rows, cols, stride;
     };
 
     ImageData       image_data;
+    DirtyRegions    dirty;
+    DitheredImages  dithered_images;
     PixelResolution pixel_resolution;
     Orientation     orientation;
+    bool            on_hold;
+
+    // The update being emulated: the image to be shown once the panel would be done.
+
+    Fence           requested_fence;
+    Fence           done_fence;
+    GdkPixbuf     * pending_image;
+    guint           pending_source;
+    gint64          pending_due;     ///< Monotonic time, in us
+
+    static gboolean update_done(gpointer data);
+    void            show_pending_image();
 
     enum class Corner : uint8_t { TOP_LEFT, TOP_RIGHT, LOWER_LEFT, LOWER_RIGHT };
     void draw_arc(uint16_t x_mid,  uint16_t y_mid,  uint8_t radius, Corner corner, uint8_t color);
@@ -73,7 +126,13 @@ class Screen : NonCopyable
     inline PixelResolution get_pixel_resolution() { return pixel_resolution; }
     GtkImage *                        get_image() { return image_data.image; }
     void                          to_user_coord(uint16_t & x, uint16_t & y) {}
-    inline void               force_full_update() { }
+    inline void               force_full_update() { dirty.force_full_update(); }
+
+    // Raw access to the frame buffer. See the InkPlate version.
+    inline uint8_t *             get_frame_data() { return gdk_pixbuf_get_pixels(image_data.canvas); }
+    inline uint32_t              get_frame_size() { return image_data.rows * image_data.stride; }
+    inline void                  frame_restored() { dirty.set_all(); }
+    inline void                    hold_updates(bool hold) { on_hold = hold; if (!hold) dirty.clear(); } ///< See the InkPlate version
 
     inline static uint16_t get_width() { return width; }
     inline static uint16_t get_height() { return height; }
@@ -10,7 +10,9 @@
 #include "controllers/book_param_controller.hpp"
 #include "controllers/option_controller.hpp"
 #include "controllers/toc_controller.hpp"
+#include "controllers/search_controller.hpp"
 #include "controllers/event_mgr.hpp"
+#include "models/books_dir.hpp"
 
 #if INKPLATE_6PLUS
   #include "controllers/back_lit.hpp"
@@ -69,6 +71,7 @@ void AppController::launch()
       case Ctrl::PARAM:  book_param_controller.leave(); break;
       case Ctrl::OPTION:     option_controller.leave(); break;
       case Ctrl::TOC:           toc_controller.leave(); break;
+      case Ctrl::SEARCH:     search_controller.leave(); break;
       case Ctrl::NONE:
       case Ctrl::LAST:                                  break;
     }
@@ -91,6 +94,7 @@ void AppController::launch()
       case Ctrl::PARAM:  book_param_controller.enter(); break;
       case Ctrl::OPTION:     option_controller.enter(); break;
       case Ctrl::TOC:           toc_controller.enter(); break;
+      case Ctrl::SEARCH:     search_controller.enter(); break;
       case Ctrl::NONE:
       case Ctrl::LAST:                                  break;
     }
@@ -119,11 +123,34 @@ AppController::input_event(const EventMgr::Event & event)
     case Ctrl::PARAM:  book_param_controller.input_event(event); break;
     case Ctrl::OPTION:     option_controller.input_event(event); break;
     case Ctrl::TOC:           toc_controller.input_event(event); break;
+    case Ctrl::SEARCH:     search_controller.input_event(event); break;
     case Ctrl::NONE:
     case Ctrl::LAST:                                             break;
   }
 }
 
+bool
+AppController::idle()
+{
+  if (next_ctrl != Ctrl::NONE) return false;
+
+  bool done = false;
+  switch (current_ctrl) {
+    case Ctrl::BOOK: done = book_controller.idle(); break;
+    case Ctrl::DIR:  done = books_dir_controller.idle(); break;
+    case Ctrl::SEARCH: done = search_controller.idle(); break;
+    default:         break;
+  }
+
+  // Housekeeping, once the current controller has nothing left to do. Only
+  // with the books list or a book shown: the web server and the other wifi
+  // tasks are run from the options menu.
+
+  if (done) return true;
+  if ((current_ctrl == Ctrl::BOOK) || (current_ctrl == Ctrl::DIR)) return books_dir.compact_step();
+  return false;
+}
+
 void
 AppController::going_to_deep_sleep()
 {
@@ -135,12 +162,13 @@ AppController::going_to_deep_sleep()
   #endif
 
   switch (current_ctrl) {
-    case Ctrl::DIR:     books_dir_controller.leave(true); break;
-    case Ctrl::BOOK:         book_controller.leave(true); break;
-    case Ctrl::PARAM:  book_param_controller.leave(true); break;
-    case Ctrl::OPTION:     option_controller.leave(true); break;
-    case Ctrl::TOC:           toc_controller.leave(true); break;
+    case Ctrl::DIR:     books_dir_controller.leave(true);                                            break;
+    case Ctrl::BOOK:         book_controller.leave(true);                                            break;
+    case Ctrl::PARAM:  book_param_controller.leave(true); book_controller.menu_going_to_deep_sleep(); break;
+    case Ctrl::OPTION:     option_controller.leave(true);                                            break;
+    case Ctrl::TOC:           toc_controller.leave(true); book_controller.menu_going_to_deep_sleep(); break;
+    case Ctrl::SEARCH:     search_controller.leave(true); book_controller.menu_going_to_deep_sleep(); break;
     case Ctrl::NONE:
-    case Ctrl::LAST:                                      break;
+    case Ctrl::LAST:                                                                                 break;
   }
 }
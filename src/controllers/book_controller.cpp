@@ -8,6 +8,7 @@
 #include "controllers/app_controller.hpp"
 #include "controllers/books_dir_controller.hpp"
 #include "models/epub.hpp"
+#include "models/wake_frame.hpp"
 #include "viewers/book_viewer.hpp"
 #include "viewers/page.hpp"
 #include "viewers/msg_viewer.hpp"
@@ -32,6 +33,7 @@ BookController::enter()
     current_page_id.offset        = 0;
   }
   book_viewer.show_page(current_page_id);
+  wake_frame.set_shown(false);
 }
 
 void 
@@ -40,6 +42,22 @@ BookController::leave(bool going_to_deep_sleep)
   LOG_D("===> leave()...");
   
   books_dir_controller.save_last_book(current_page_id, going_to_deep_sleep);
+  if (going_to_deep_sleep) book_viewer.save_wake_frame();
+}
+
+void
+BookController::menu_going_to_deep_sleep()
+{
+  books_dir_controller.save_last_book(current_page_id, true);
+  book_viewer.save_wake_frame(false);
+}
+
+bool
+BookController::idle()
+{
+  // The pages around the current one are prepared, such that turning to them
+  // only costs the panel update.
+  return book_viewer.prepare_next_page();
 }
 
 bool
@@ -50,8 +68,11 @@ BookController::open_book_file(
 {
   LOG_D("===> open_book_file()...");
 
-  msg_viewer.show(MsgViewer::MsgType::BOOK, false, false, "Loading a book",
-     "The book \" %s \" is loading. Please wait.", book_title.c_str());
+  // At wake time, the page is already on screen
+  if (!wake_frame.is_shown()) {
+    msg_viewer.show(MsgViewer::MsgType::BOOK, false, false, "Loading a book",
+       "The book \" %s \" is loading. Please wait.", book_title.c_str());
+  }
 
   bool new_document = book_filename != epub.get_current_filename();
 
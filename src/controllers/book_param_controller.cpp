@@ -9,6 +9,7 @@
 #include "controllers/common_actions.hpp"
 #include "controllers/books_dir_controller.hpp"
 #include "controllers/book_controller.hpp"
+#include "controllers/search_controller.hpp"
 #include "models/books_dir.hpp"
 #include "models/epub.hpp"
 #include "models/config.hpp"
@@ -16,6 +17,7 @@
 #include "models/toc.hpp"
 #include "viewers/menu_viewer.hpp"
 #include "viewers/form_viewer.hpp"
+#include "viewers/keyboard_viewer.hpp"
 #include "viewers/msg_viewer.hpp"
 
 #if EPUB_INKPLATE_BUILD
@@ -53,6 +55,21 @@ static FormEntry book_params_form_entries[BOOK_PARAMS_FORM_SIZE] = {
   #endif
 };
 
+static char search_text[KeyboardViewer::MAX_SIZE + 1] = { 0 };
+
+#if INKPLATE_6PLUS || TOUCH_TRIAL
+  static constexpr int8_t SEARCH_FORM_SIZE = 2;
+#else
+  static constexpr int8_t SEARCH_FORM_SIZE = 1;
+#endif
+
+static FormEntry search_form_entries[SEARCH_FORM_SIZE] = {
+  { .caption = "Search for :", .u = { .str = { .value = search_text, .size = sizeof(search_text) } }, .entry_type = FormEntryType::TEXT },
+  #if INKPLATE_6PLUS || TOUCH_TRIAL
+    { .caption = " DONE ",     .u = { .ch  = { .value = &done_res, .choice_count = 0, .choices = nullptr } }, .entry_type = FormEntryType::DONE }
+  #endif
+};
+
 static void
 book_parameters()
 {
@@ -116,7 +133,6 @@ revert_to_defaults()
     }
     else {
       fonts.clear();
-      fonts.clear_glyph_caches();
     }
   }
 
@@ -147,6 +163,19 @@ toc_ctrl()
   app_controller.set_controller(AppController::Ctrl::TOC);
 }
 
+static void
+search_book()
+{
+  done_res = 1;
+
+  form_viewer.show(
+    search_form_entries,
+    SEARCH_FORM_SIZE,
+    "Words to find in the e-book, one after the other.");
+
+  book_param_controller.set_search_form_is_shown();
+}
+
 extern bool start_web_server();
 extern bool  stop_web_server();
 
@@ -169,17 +198,19 @@ wifi_mode()
 static void
 power_off()
 {
-  books_dir_controller.save_last_book(book_controller.get_current_page_id(), true); 
-  
+  // The book location and the page frame are saved for the wake by
+  // AppController::going_to_deep_sleep(), through BookController.
+
   CommonActions::power_it_off();
 }
 
 // IMPORTANT!!
 // The first (menu[0]) and the last menu entry (the one before END_MENU) MUST ALWAYS BE VISIBLE!!!
 
-static MenuViewer::MenuEntry menu[10] = {
+static MenuViewer::MenuEntry menu[11] = {
   { MenuViewer::Icon::RETURN,      "Return to the e-books reader",         CommonActions::return_to_last, true , true },
   { MenuViewer::Icon::TOC,         "Table of Content",                     toc_ctrl                     , false, true },
+  { MenuViewer::Icon::TOC,         "Search in the e-book",                 search_book                  , true , true },
   { MenuViewer::Icon::BOOK_LIST,   "E-Books list",                         books_list                   , true , true },
   { MenuViewer::Icon::FONT_PARAMS, "Current e-book parameters",            book_parameters              , true , true },
   { MenuViewer::Icon::REVERT,      "Revert e-book parameters to "
@@ -203,6 +234,7 @@ BookParamController::enter()
   menu[1].visible = toc.is_ready() && !toc.is_empty();
   menu_viewer.show(menu);
   book_params_form_is_shown = false;
+  search_form_is_shown      = false;
 }
 
 void 
@@ -235,7 +267,6 @@ BookParamController::input_event(const EventMgr::Event & event)
           }
           else {
             fonts.clear();
-            fonts.clear_glyph_caches();
           }
         }
  
@@ -246,6 +277,18 @@ BookParamController::input_event(const EventMgr::Event & event)
       menu_viewer.clear_highlight();
     }
   }
+  else if (search_form_is_shown) {
+    if (form_viewer.event(event)) {
+      search_form_is_shown = false;
+      if (search_text[0] != 0) {
+        search_controller.set_query(search_text);
+        app_controller.set_controller(AppController::Ctrl::SEARCH);
+      }
+      else {
+        menu_viewer.clear_highlight();
+      }
+    }
+  }
   else if (delete_current_book) {
     bool ok;
     if (msg_viewer.confirm(event, ok)) {
@@ -282,6 +325,13 @@ BookParamController::input_event(const EventMgr::Event & event)
             unlink(filepath.c_str());
           }
 
+          filepath.replace(pos, 5, ".sidx");
+
+          if (stat(filepath.c_str(), &file_stat) != -1) {
+            LOG_I("Deleting file : %s", filepath.c_str());
+            unlink(filepath.c_str());
+          }
+
           int16_t dummy;
           books_dir.refresh(nullptr, dummy, false);
 
@@ -303,6 +353,7 @@ BookParamController::input_event(const EventMgr::Event & event)
                       "The device is now restarting. Please wait.");
       wait_for_key_after_wifi = false;
       stop_web_server();
+      screen.wait_for_update();
       esp_restart();
     }
   #endif
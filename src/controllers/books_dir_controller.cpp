@@ -10,6 +10,7 @@
 #include "models/books_dir.hpp"
 #include "models/config.hpp"
 #include "models/nvs_mgr.hpp"
+#include "models/wake_frame.hpp"
 #include "viewers/book_viewer.hpp"
 #include "viewers/linear_books_dir_viewer.hpp"
 #include "viewers/matrix_books_dir_viewer.hpp"
@@ -28,10 +29,14 @@ BooksDirController::setup()
 
   current_book_index         = -1;
   last_read_book_index       = -1;
+  last_read_hidden           = false;
   book_page_id.itemref_index = -1;
   book_page_id.offset        = -1;
   book_was_shown             = false;
 
+  int8_t dir_sort;
+  config.get(Config::Ident::DIR_SORT, &dir_sort);
+  books_dir.set_sort_order((BooksDir::SortOrder) dir_sort);
   
   #if EPUB_INKPLATE_BUILD
 
@@ -165,6 +170,45 @@ BooksDirController::save_last_book(const PageLocs::PageId & page_id, bool going_
   #endif  
 }
 
+void
+BooksDirController::new_sort_order(BooksDir::SortOrder order)
+{
+  // The last book read stays the same, at a new position in the list.
+
+  uint32_t id;
+  bool     last_read = (last_read_book_index != -1) && books_dir.get_book_id(last_read_book_index, id);
+
+  books_dir.set_sort_order(order);
+
+  if (last_read) last_read_book_index = books_dir.get_sorted_idx_from_id(id);
+  current_book_index = -1;
+}
+
+bool
+BooksDirController::search(const std::string & query)
+{
+  // The last book read may not be part of the result: it is found again
+  // once the filter is removed.
+
+  bool last_read = last_read_hidden ||
+                   ((last_read_book_index != -1) && books_dir.get_book_id(last_read_book_index, last_read_id));
+
+  if (query.empty()) {
+    books_dir.clear_filter();
+  }
+  else {
+    std::vector<uint32_t> ids;
+    if (!books_dir.search(query, ids)) return false;
+    books_dir.set_filter(ids);
+  }
+
+  last_read_book_index = last_read ? books_dir.get_sorted_idx_from_id(last_read_id) : -1;
+  last_read_hidden     = last_read && (last_read_book_index == -1);
+  current_book_index   = -1;
+
+  return true;
+}
+
 void
 BooksDirController::show_last_book()
 {
@@ -185,8 +229,10 @@ BooksDirController::show_last_book()
     book_title  = book->title;
     if (book_controller.open_book_file(book_title, book_fname, book_page_id)) {
       app_controller.set_controller(AppController::Ctrl::BOOK);
+      return;
     }
   }
+  wake_frame.set_shown(false);
 }
 
 void 
@@ -213,7 +259,60 @@ BooksDirController::enter()
 void 
 BooksDirController::leave(bool going_to_deep_sleep)
 {
+  books_dir.release_search_index();
+}
+
+void
+BooksDirController::get_shown_books(ShownBooks & shown)
+{
+  shown.clear();
+
+  int16_t first;
+  int16_t count = books_dir_viewer->get_shown_books(first);
+
+  for (int16_t idx = first; idx < (first + count); idx++) {
+    uint32_t id;
+    if (books_dir.get_book_id(idx, id)) shown.push_back({ id, books_dir.is_placeholder(idx) });
+  }
+}
+
+bool
+BooksDirController::idle()
+{
+  // New books are retrieved one at a time while the books list is shown,
+  // their placeholder being replaced as soon as they are retrieved. The
+  // books may move in the list: the current and last read books are kept.
+  // Once all books are retrieved, the books folder is verified, if this was
+  // not done at startup.
+  //
+  // The page is painted again only if the books it shows, or their
+  // placeholder state, have changed.
+
+  uint32_t current_id, last_read_id;
+  bool     current   = (current_book_index   != -1) && books_dir.get_book_id(current_book_index,   current_id  );
+  bool     last_read = (last_read_book_index != -1) && books_dir.get_book_id(last_read_book_index, last_read_id);
+
+  ShownBooks before, after;
+  get_shown_books(before);
+
+  bool list_changed = false;
+  if (!books_dir.refresh_step()) {
+    if (!books_dir.verify_step(list_changed)) return false;
+    if (!list_changed) return true;
+  }
+
+  if (current  ) current_book_index   = books_dir.get_sorted_idx_from_id(current_id  );
+  if (last_read) last_read_book_index = books_dir.get_sorted_idx_from_id(last_read_id);
+
+  if (current_book_index == -1) current_book_index = 0;
 
+  get_shown_books(after);
+  if (list_changed || (before != after)) {
+    books_dir_viewer->setup();
+    current_book_index = books_dir_viewer->show_page_and_highlight(current_book_index);
+  }
+
+  return true;
 }
 
 #if INKPLATE_6PLUS || TOUCH_TRIAL
@@ -237,6 +336,9 @@ BooksDirController::leave(bool going_to_deep_sleep)
       case EventMgr::EventKind::TAP:
         if ((viewer_id == MATRIX_VIEWER) || (event.x < (Screen::get_width() / 3))) {
           current_book_index = books_dir_viewer->get_index_at(event.x, event.y);
+          if ((current_book_index >= 0) && books_dir.is_placeholder(current_book_index)) {
+            current_book_index = books_dir.retrieve_now(current_book_index);
+          }
           if ((current_book_index >= 0) && (current_book_index < books_dir.get_book_count())) {
             book = books_dir.get_book_data(current_book_index);
             if (book != nullptr) {
@@ -334,7 +436,10 @@ BooksDirController::leave(bool going_to_deep_sleep)
         break;
 
       case EventMgr::EventKind::SELECT:
-        if (current_book_index < books_dir.get_book_count()) {
+        if (books_dir.is_placeholder(current_book_index)) {
+          current_book_index = books_dir.retrieve_now(current_book_index);
+        }
+        if ((current_book_index >= 0) && (current_book_index < books_dir.get_book_count())) {
           book = books_dir.get_book_data(current_book_index);
           if (book != nullptr) {
             last_read_book_index = current_book_index;
@@ -61,6 +61,7 @@ CommonActions::power_it_off()
     screen.force_full_update();
     msg_viewer.show(MsgViewer::MsgType::INFO, false, true, "Power OFF",
       "Entering Deep Sleep mode. " MSG);
+    screen.wait_for_update();
     ESP::delay(1000);
     inkplate_platform.deep_sleep(INT_PIN, LEVEL);
   #else
@@ -221,6 +221,12 @@
     }
   #endif
 
+  bool
+  EventMgr::event_pending()
+  {
+    return uxQueueMessagesWaiting(touchpad_event_queue) > 0;
+  }
+
   const EventMgr::Event & 
   EventMgr::get_event() 
   {
@@ -243,12 +249,15 @@
 
   #include "screen.hpp"
 
-  void EventMgr::left()   { Event event; event.kind = EventKind::PREV      ; app_controller.input_event(event); app_controller.launch(); }
-  void EventMgr::right()  { Event event; event.kind = EventKind::NEXT      ; app_controller.input_event(event); app_controller.launch(); }
-  void EventMgr::up()     { Event event; event.kind = EventKind::DBL_PREV  ; app_controller.input_event(event); app_controller.launch(); }
-  void EventMgr::down()   { Event event; event.kind = EventKind::DBL_NEXT  ; app_controller.input_event(event); app_controller.launch(); }
-  void EventMgr::select() { Event event; event.kind = EventKind::SELECT    ; app_controller.input_event(event); app_controller.launch(); }
-  void EventMgr::home()   { Event event; event.kind = EventKind::DBL_SELECT; app_controller.input_event(event); app_controller.launch(); }
+  // Work ahead when gtk has nothing else to do (see AppController::idle())
+  static gboolean idle_work(gpointer data) { return app_controller.idle() ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE; }
+
+  void EventMgr::left()   { Event event; event.kind = EventKind::PREV      ; app_controller.input_event(event); app_controller.launch(); g_idle_add(idle_work, nullptr); }
+  void EventMgr::right()  { Event event; event.kind = EventKind::NEXT      ; app_controller.input_event(event); app_controller.launch(); g_idle_add(idle_work, nullptr); }
+  void EventMgr::up()     { Event event; event.kind = EventKind::DBL_PREV  ; app_controller.input_event(event); app_controller.launch(); g_idle_add(idle_work, nullptr); }
+  void EventMgr::down()   { Event event; event.kind = EventKind::DBL_NEXT  ; app_controller.input_event(event); app_controller.launch(); g_idle_add(idle_work, nullptr); }
+  void EventMgr::select() { Event event; event.kind = EventKind::SELECT    ; app_controller.input_event(event); app_controller.launch(); g_idle_add(idle_work, nullptr); }
+  void EventMgr::home()   { Event event; event.kind = EventKind::DBL_SELECT; app_controller.input_event(event); app_controller.launch(); g_idle_add(idle_work, nullptr); }
 
   #define BUTTON_EVENT(button, msg) \
     static void button##_clicked(GObject * button, GParamSpec * property, gpointer data) { \
@@ -264,6 +273,7 @@
 
   void EventMgr::loop()
   {
+    g_idle_add(idle_work, nullptr);
     gtk_main(); // never return
   }
 
@@ -278,6 +288,9 @@
   {
     LOG_D("===> Loop...");
     while (1) {
+      // Work ahead while the user is reading
+      while (!event_pending() && app_controller.idle());
+
       const EventMgr::Event & event = get_event();
 
       if (event.kind != EventKind::NONE) {
@@ -296,6 +309,7 @@
           config.get(Config::Ident::TIMEOUT, &light_sleep_duration);
 
           LOG_I("Light Sleep for %d minutes...", light_sleep_duration);
+          screen.wait_for_update();
           ESP::delay(500);
 
           #if EXTENDED_CASE
@@ -317,6 +331,7 @@
               "Timeout period exceeded (%d minutes). The device is now "
               "entering into Deep Sleep mode. Please press a key to restart.",
               light_sleep_duration);
+            screen.wait_for_update();
             ESP::delay(1000);
             inkplate_platform.deep_sleep(INT_PIN, 1);
           }
@@ -35,6 +35,7 @@ static int8_t use_fonts_in_books;
 static int8_t default_font;
 static int8_t show_title;
 static int8_t dir_view;
+static int8_t dir_sort;
 static int8_t done;
 
 static Screen::Orientation     old_orientation;
@@ -45,6 +46,7 @@ static int8_t old_use_fonts_in_books;
 static int8_t old_default_font;
 static int8_t old_show_title;
 static int8_t old_dir_view;
+static int8_t old_dir_sort;
 
 #if DATE_TIME_RTC
   static int8_t show_heap_or_rtc;
@@ -55,14 +57,15 @@ static int8_t old_dir_view;
 #endif
 
 #if INKPLATE_6PLUS || TOUCH_TRIAL
-  static constexpr int8_t MAIN_FORM_SIZE = 8;
+  static constexpr int8_t MAIN_FORM_SIZE = 9;
 #else
-  static constexpr int8_t MAIN_FORM_SIZE = 7;
+  static constexpr int8_t MAIN_FORM_SIZE = 8;
 #endif
 
 static FormEntry main_params_form_entries[MAIN_FORM_SIZE] = {
   { .caption = "Minutes Before Sleeping :",  .u = { .ch = { .value = &timeout,                .choice_count = 3, .choices = FormChoiceField::timeout_choices        } }, .entry_type = FormEntryType::HORIZONTAL  },
   { .caption = "Books Directory View :",     .u = { .ch = { .value = &dir_view,               .choice_count = 2, .choices = FormChoiceField::dir_view_choices       } }, .entry_type = FormEntryType::HORIZONTAL  },
+  { .caption = "Books Directory Order :",    .u = { .ch = { .value = &dir_sort,               .choice_count = 4, .choices = FormChoiceField::dir_sort_choices       } }, .entry_type = FormEntryType::VERTICAL    },
   #if INKPLATE_6PLUS || TOUCH_TRIAL
     { .caption = "uSDCard Position (*):",    .u = { .ch = { .value = (int8_t *) &orientation, .choice_count = 4, .choices = FormChoiceField::orientation_choices    } }, .entry_type = FormEntryType::VERTICAL    },
   #else
@@ -117,6 +120,21 @@ static FormEntry font_params_form_entries[FONT_FORM_SIZE] = {
   };
 #endif
 
+static char search_text[KeyboardViewer::MAX_SIZE + 1] = { 0 };
+
+#if INKPLATE_6PLUS || TOUCH_TRIAL
+  static constexpr int8_t SEARCH_FORM_SIZE = 2;
+#else
+  static constexpr int8_t SEARCH_FORM_SIZE = 1;
+#endif
+
+static FormEntry search_form_entries[SEARCH_FORM_SIZE] = {
+  { .caption = "Search for :", .u = { .str = { .value = search_text, .size = sizeof(search_text) } }, .entry_type = FormEntryType::TEXT },
+  #if INKPLATE_6PLUS || TOUCH_TRIAL
+    { .caption = " DONE ",     .u = { .ch  = { .value = &done, .choice_count = 0, .choices = nullptr } }, .entry_type = FormEntryType::DONE }
+  #endif
+};
+
 extern bool start_web_server();
 extern bool  stop_web_server();
 
@@ -125,6 +143,7 @@ main_parameters()
 {
   config.get(Config::Ident::ORIENTATION,      (int8_t *) &orientation);
   config.get(Config::Ident::DIR_VIEW,         &dir_view              );
+  config.get(Config::Ident::DIR_SORT,         &dir_sort              );
   config.get(Config::Ident::PIXEL_RESOLUTION, (int8_t *) &resolution );
   config.get(Config::Ident::BATTERY,          &show_battery          );
   config.get(Config::Ident::SHOW_TITLE,       &show_title            );
@@ -142,6 +161,7 @@ main_parameters()
 
   old_orientation = orientation;
   old_dir_view    = dir_view;
+  old_dir_sort    = dir_sort;
   old_resolution  = resolution;
   old_show_title  = show_title;
   done            = 1;
@@ -176,6 +196,19 @@ default_parameters()
   option_controller.set_font_form_is_shown();
 }
 
+static void
+search_books()
+{
+  done = 1;
+
+  form_viewer.show(
+    search_form_entries,
+    SEARCH_FORM_SIZE,
+    "Words in titles, authors and descriptions. Empty to show all e-books.");
+
+  option_controller.set_search_form_is_shown();
+}
+
 static void
 wifi_mode()
 {
@@ -322,6 +355,7 @@ static MenuViewer::MenuEntry menu[] = {
 
   { MenuViewer::Icon::RETURN,        "Return to the e-books list",           CommonActions::return_to_last    , true,  true  },
   { MenuViewer::Icon::BOOK,          "Return to the last e-book being read", CommonActions::show_last_book    , true,  true  },
+  { MenuViewer::Icon::BOOK_LIST,     "Search the e-books list",              search_books                     , true,  true  },
   { MenuViewer::Icon::MAIN_PARAMS,   "Main parameters",                      main_parameters                  , true,  true  },
   { MenuViewer::Icon::FONT_PARAMS,   "Default e-books parameters",           default_parameters               , true,  true  },
   { MenuViewer::Icon::WIFI,          "WiFi Access to the e-books folder",    wifi_mode                        , true,  true  },
@@ -380,8 +414,9 @@ void
 OptionController::enter()
 {
   menu_viewer.show(menu);
-  main_form_is_shown = false;
-  font_form_is_shown = false;
+  main_form_is_shown   = false;
+  font_form_is_shown   = false;
+  search_form_is_shown = false;
 }
 
 #if INKPLATE_6PLUS || MENU_6PLUS
@@ -412,6 +447,7 @@ OptionController::input_event(const EventMgr::Event & event)
       // if (ok) {
         config.put(Config::Ident::ORIENTATION,      (int8_t) orientation);
         config.put(Config::Ident::DIR_VIEW,         dir_view            );
+        config.put(Config::Ident::DIR_SORT,         dir_sort            );
         config.put(Config::Ident::PIXEL_RESOLUTION, (int8_t) resolution );
         config.put(Config::Ident::BATTERY,          show_battery        );
         config.put(Config::Ident::SHOW_TITLE,       show_title          );
@@ -436,6 +472,10 @@ OptionController::input_event(const EventMgr::Event & event)
           books_dir_controller.set_current_book_index(-1);
         }
 
+        if (old_dir_sort != dir_sort) {
+          books_dir_controller.new_sort_order((BooksDir::SortOrder) dir_sort);
+        }
+
         if (old_resolution != resolution) {
           fonts.clear_glyph_caches();
           screen.set_pixel_resolution(resolution);
@@ -480,7 +520,6 @@ OptionController::input_event(const EventMgr::Event & event)
         if (old_use_fonts_in_books != use_fonts_in_books) {
           if (use_fonts_in_books == 0) {
             fonts.clear();
-            fonts.clear_glyph_caches();
           }
         }
       // }
@@ -488,6 +527,24 @@ OptionController::input_event(const EventMgr::Event & event)
     }
   }
 
+  else if (search_form_is_shown) {
+    if (form_viewer.event(event)) {
+      search_form_is_shown = false;
+      if (books_dir_controller.search(search_text)) {
+        app_controller.set_controller(AppController::Ctrl::DIR);
+      }
+      else {
+        menu_viewer.clear_highlight();
+        msg_viewer.show(
+          MsgViewer::MsgType::ALERT,
+          false,
+          false,
+          "No E-Book Found",
+          "No e-book is matching all the words of: %s", search_text);
+      }
+    }
+  }
+
   #if DATE_TIME_RTC
     else if (date_time_form_is_shown) {
       if (form_viewer.event(event)) {
@@ -511,6 +568,7 @@ OptionController::input_event(const EventMgr::Event & event)
         int16_t dummy;
         books_dir.refresh(nullptr, dummy, true);
       }
+      screen.wait_for_update();
       esp_restart();
     }
   #endif
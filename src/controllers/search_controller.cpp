@@ -0,0 +1,188 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#define __SEARCH_CONTROLLER__ 1
+#include "controllers/search_controller.hpp"
+
+#include "controllers/app_controller.hpp"
+#include "controllers/book_controller.hpp"
+#include "models/book_search.hpp"
+#include "viewers/msg_viewer.hpp"
+#include "viewers/search_viewer.hpp"
+
+#if INKPLATE_6PLUS || TOUCH_TRIAL
+  #define STOP_MSG "Tap the screen to stop it."
+#else
+  #define STOP_MSG "Press a key to stop it."
+#endif
+
+void 
+SearchController::enter()
+{
+  current_entry_index = -1;
+  msg_shown           = false;
+
+  if (book_search.start(query)) {
+    msg_viewer.show(MsgViewer::MsgType::INFO, false, false,
+                    "Searching",
+                    "Searching the e-book for: %s. " STOP_MSG, query.c_str());
+  }
+  else {
+    show_results();
+  }
+}
+
+void 
+SearchController::leave(bool going_to_deep_sleep)
+{
+  book_search.clear();
+}
+
+bool
+SearchController::idle()
+{
+  if (!book_search.is_running()) return false;
+
+  if (!book_search.step()) show_results();
+  return true;
+}
+
+void
+SearchController::show_results()
+{
+  search_viewer.setup();
+  current_entry_index = search_viewer.show_page_and_highlight((current_entry_index < 0) ? 0 : current_entry_index);
+}
+
+void
+SearchController::show_hit(int16_t entry_index)
+{
+  if ((entry_index >= 0) && (entry_index < (int16_t) book_search.get_hits().size())) {
+    const PageLocs::PageId * page_id = book_search.get_page_id(entry_index);
+    if (page_id != nullptr) {
+      book_controller.set_current_page_id(*page_id);
+      app_controller.set_controller(AppController::Ctrl::BOOK);
+    }
+    else {
+      msg_viewer.show(MsgViewer::MsgType::INFO, false, false,
+                      "Page not ready",
+                      "The pages location of the e-book is still being computed. "
+                      "Please try again in a few seconds.");
+      msg_shown = true;
+    }
+  }
+}
+
+#if INKPLATE_6PLUS || TOUCH_TRIAL
+  void 
+  SearchController::input_event(const EventMgr::Event & event)
+  {
+    if (msg_shown) {
+      msg_shown = false;
+      show_results();
+      return;
+    }
+
+    if (book_search.is_running()) {
+      if ((event.kind == EventMgr::EventKind::TAP        ) ||
+          (event.kind == EventMgr::EventKind::SWIPE_LEFT ) ||
+          (event.kind == EventMgr::EventKind::SWIPE_RIGHT)) {
+        book_search.cancel();
+        show_results();
+      }
+      return;
+    }
+
+    switch (event.kind) {
+      case EventMgr::EventKind::SWIPE_RIGHT:
+        current_entry_index = search_viewer.prev_page();   
+        break;
+
+      case EventMgr::EventKind::SWIPE_LEFT:
+        current_entry_index = search_viewer.next_page();   
+        break;
+
+      case EventMgr::EventKind::TAP:
+        current_entry_index = search_viewer.get_index_at(event.x, event.y);
+        if ((current_entry_index >= 0) && (current_entry_index < (int16_t) book_search.get_hits().size())) {
+          show_hit(current_entry_index);
+        }
+        else {
+          app_controller.set_controller(AppController::Ctrl::BOOK);
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+#else
+  void 
+  SearchController::input_event(const EventMgr::Event & event)
+  {
+    if (event.kind == EventMgr::EventKind::NONE) return;
+
+    if (msg_shown) {
+      msg_shown = false;
+      show_results();
+      return;
+    }
+
+    if (book_search.is_running()) {
+      book_search.cancel();
+      show_results();
+      return;
+    }
+
+    if (book_search.get_hits().empty()) {
+      app_controller.set_controller(AppController::Ctrl::BOOK);
+      return;
+    }
+
+    switch (event.kind) {
+      #if EXTENDED_CASE
+        case EventMgr::EventKind::PREV:
+      #else
+        case EventMgr::EventKind::DBL_PREV:
+      #endif
+        current_entry_index = search_viewer.prev_column();   
+        break;
+
+      #if EXTENDED_CASE
+        case EventMgr::EventKind::NEXT:
+      #else
+        case EventMgr::EventKind::DBL_NEXT:
+      #endif
+        current_entry_index = search_viewer.next_column();
+        break;
+
+      #if EXTENDED_CASE
+        case EventMgr::EventKind::DBL_PREV:
+      #else
+        case EventMgr::EventKind::PREV:
+      #endif
+        current_entry_index = search_viewer.prev_item();
+        break;
+
+      #if EXTENDED_CASE
+        case EventMgr::EventKind::DBL_NEXT:
+      #else
+        case EventMgr::EventKind::NEXT:
+      #endif
+        current_entry_index = search_viewer.next_item();
+        break;
+
+      case EventMgr::EventKind::SELECT:
+        show_hit(current_entry_index);
+        break;
+
+      case EventMgr::EventKind::DBL_SELECT:
+        app_controller.set_controller(AppController::Ctrl::BOOK);
+        break;
+        
+      case EventMgr::EventKind::NONE:
+        break;
+    }
+  }
+#endif
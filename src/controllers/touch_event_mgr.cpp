@@ -238,6 +238,12 @@ const char * EventMgr::event_str[8] = { "NONE",        "TAP",           "HOLD",
   {
   }
 
+  bool
+  EventMgr::event_pending()
+  {
+    return uxQueueMessagesWaiting(touchscreen_event_queue) > 0;
+  }
+
   const EventMgr::Event & 
   EventMgr::get_event() 
   {
@@ -512,6 +518,9 @@ const char * EventMgr::event_str[8] = { "NONE",        "TAP",           "HOLD",
 
   #include "screen.hpp"
 
+  // Work ahead when gtk has nothing else to do (see AppController::idle())
+  static gboolean idle_work(gpointer data) { return app_controller.idle() ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE; }
+
   static gboolean
   mouse_event_callback(GtkWidget * event_box,
                        GdkEvent  * gdk_event,
@@ -658,6 +667,7 @@ const char * EventMgr::event_str[8] = { "NONE",        "TAP",           "HOLD",
             event.dist);
       app_controller.input_event(event);
       app_controller.launch();
+      g_idle_add(idle_work, nullptr);
       return true;
     }
 
@@ -666,6 +676,7 @@ const char * EventMgr::event_str[8] = { "NONE",        "TAP",           "HOLD",
 
   void EventMgr::loop()
   {
+    g_idle_add(idle_work, nullptr);
     gtk_main(); // never return
   }
 
@@ -679,6 +690,9 @@ const char * EventMgr::event_str[8] = { "NONE",        "TAP",           "HOLD",
   void EventMgr::loop()
   {
     while (1) {
+      // Work ahead while the user is reading
+      while (!event_pending() && app_controller.idle());
+
       const EventMgr::Event & event = get_event();
 
       if (event.kind != EventKind::NONE) {
@@ -697,6 +711,7 @@ const char * EventMgr::event_str[8] = { "NONE",        "TAP",           "HOLD",
           config.get(Config::Ident::TIMEOUT, &light_sleep_duration);
 
           LOG_D("Light Sleep for %d minutes...", light_sleep_duration);
+          screen.wait_for_update();
           ESP::delay(500);
 
           if (inkplate_platform.light_sleep(light_sleep_duration, TouchScreen::INTERRUPT_PIN, 0)) {
@@ -713,6 +728,7 @@ const char * EventMgr::event_str[8] = { "NONE",        "TAP",           "HOLD",
               "Timeout period exceeded (%d minutes). The device is now "
               "entering into Deep Sleep mode. Please press the WakeUp Button to restart.",
               light_sleep_duration);
+            screen.wait_for_update();
             ESP::delay(1000);
 
             inkplate_platform.deep_sleep(TouchScreen::INTERRUPT_PIN, 0);
@@ -11,6 +11,7 @@
 #include "viewers/msg_viewer.hpp"
 #include "models/config.hpp"
 #include "models/page_locs.hpp"
+#include "models/books_dir.hpp"
 
 #include <stdio.h>
 #include <sys/param.h>
@@ -340,6 +341,86 @@ download_handler(httpd_req_t * req)
   return ESP_OK;
 }
 
+// ----- search_handler() -----
+
+static void
+send_html_text(httpd_req_t * req, const char * str)
+{
+  std::string text;
+
+  for (; *str; str++) {
+    switch (*str) {
+      case '<': text += "&lt;";   break;
+      case '>': text += "&gt;";   break;
+      case '&': text += "&amp;";  break;
+      case '"': text += "&quot;"; break;
+      default:  text += *str;     break;
+    }
+  }
+  httpd_resp_sendstr_chunk(req, text.c_str());
+}
+
+// Books matching the words of the "q" query parameter (see BooksDir::search()).
+// Each one is linked to its file.
+
+static esp_err_t
+search_handler(httpd_req_t * req)
+{
+  char        buffer[128];
+  char        value[128];
+  std::string query;
+
+  if ((httpd_req_get_url_query_str(req, buffer, sizeof(buffer)) == ESP_OK) &&
+      (httpd_query_key_value(buffer, "q", value, sizeof(value)) == ESP_OK)) {
+    for (const char * str_in = value; *str_in; str_in++) {
+      if ((str_in[0] == '%') && str_in[1] && str_in[2]) {
+        query.push_back((char)((hex_to_bin(str_in[1]) << 4) + hex_to_bin(str_in[2])));
+        str_in += 2;
+      }
+      else {
+        query.push_back((*str_in == '+') ? ' ' : *str_in);
+      }
+    }
+  }
+
+  LOG_D("search_handler(%s)", query.c_str());
+
+  std::vector<uint32_t> ids;
+  if (!query.empty()) books_dir.search(query, ids);
+
+  httpd_resp_set_type(req, "text/html");
+  httpd_resp_sendstr_chunk(req,
+    "<!DOCTYPE html><html>"
+    "<head>"
+    "<meta charset=\"UTF-8\">"
+    "<title>EPub-InkPlate Books Search</title>"
+    "</head>"
+    "<body>"
+    "<form method=\"get\" action=\"/search\">"
+    "<input type=\"text\" name=\"q\" value=\"");
+  send_html_text(req, query.c_str());
+  httpd_resp_sendstr_chunk(req,
+    "\"/><button type=\"submit\">Search</button> <a href=\"/\">All books</a>"
+    "</form><ul>");
+
+  BooksDir::BookSummary summary;
+  for (auto id : ids) {
+    if (!books_dir.get_book_summary_from_id(id, summary)) continue;
+    httpd_resp_sendstr_chunk(req, "<li><a href=\"/");
+    httpd_resp_sendstr_chunk(req, summary.filename);
+    httpd_resp_sendstr_chunk(req, "\">");
+    send_html_text(req, summary.title);
+    httpd_resp_sendstr_chunk(req, "</a> - ");
+    send_html_text(req, summary.author);
+    httpd_resp_sendstr_chunk(req, "</li>\n");
+  }
+
+  httpd_resp_sendstr_chunk(req, "</ul></body></html>");
+  httpd_resp_sendstr_chunk(req, NULL);
+
+  return ESP_OK;
+}
+
 // ----- upload_handler() -----
 
 static esp_err_t 
@@ -485,6 +566,13 @@ delete_handler(httpd_req_t * req)
       LOG_I("Deleting file : %s", filepath.c_str());
       unlink(filepath.c_str());
     }
+
+    filepath.replace(pos, 5, ".sidx");
+
+    if (stat(filepath.c_str(), &file_stat) != -1) {
+      LOG_I("Deleting file : %s", filepath.c_str());
+      unlink(filepath.c_str());
+    }
   }
 
   /* Redirect onto root to see the updated file list */
@@ -528,6 +616,17 @@ http_server_start()
     return ESP_FAIL;
   }
 
+  // Registered before the download handler, as it is matching all URIs
+
+  httpd_uri_t books_search = {
+    .uri       = "/search",
+    .method    = HTTP_GET,
+    .handler   = search_handler,
+    .user_ctx  = server_data
+  };
+
+  httpd_register_uri_handler(server, &books_search );
+
   httpd_uri_t file_download = {
     .uri       = "/*",  // Match all URIs of type /path/to/file
     .method    = HTTP_GET,
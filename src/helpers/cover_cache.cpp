@@ -0,0 +1,70 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#include "helpers/cover_cache.hpp"
+
+#include "alloc.hpp"
+
+void
+CoverCache::set_capacity(uint16_t count)
+{
+  capacity = (count == 0) ? 1 : count;
+  while (entries.size() > capacity) {
+    free(entries.back().data);
+    entries.pop_back();
+  }
+}
+
+const uint8_t *
+CoverCache::get(uint32_t id)
+{
+  for (auto it = entries.begin(); it != entries.end(); it++) {
+    if (it->id == id) {
+      if (it != entries.begin()) entries.splice(entries.begin(), entries, it);
+      return it->data;
+    }
+  }
+  return nullptr;
+}
+
+uint8_t *
+CoverCache::make_room(uint32_t id)
+{
+  forget(id);
+
+  if (entries.size() >= capacity) {
+    auto last = std::prev(entries.end());
+    last->id  = id;
+    entries.splice(entries.begin(), entries, last);
+    return last->data;
+  }
+
+  uint8_t * data = (uint8_t *) allocate(entry_size);
+  if (data == nullptr) {
+    LOG_E("Unable to allocate cover.");
+    return nullptr;
+  }
+
+  entries.push_front({ .id = id, .data = data });
+  return data;
+}
+
+void
+CoverCache::forget(uint32_t id)
+{
+  for (auto it = entries.begin(); it != entries.end(); it++) {
+    if (it->id == id) {
+      free(it->data);
+      entries.erase(it);
+      return;
+    }
+  }
+}
+
+void
+CoverCache::clear()
+{
+  for (auto & entry : entries) free(entry.data);
+  entries.clear();
+}
@@ -0,0 +1,138 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#include "helpers/dithered_images.hpp"
+
+#include "alloc.hpp"
+
+#include <cstring>
+
+uint64_t
+DitheredImages::hash(const uint8_t * gray, Dim dim)
+{
+  // FNV-1a, 4 pixels at a time
+  uint64_t h     = 0xCBF29CE484222325ULL ^ ((dim.width << 16) | dim.height);
+  uint32_t count = dim.width * dim.height;
+  uint32_t i     = 0;
+
+  for (; (i + 4) <= count; i += 4) {
+    uint32_t w;
+    memcpy(&w, &gray[i], 4);
+    h = (h ^ w) * 0x100000001B3ULL;
+  }
+  for (; i < count; i++) h = (h ^ gray[i]) * 0x100000001B3ULL;
+
+  return h;
+}
+
+void
+DitheredImages::dither(const uint8_t * gray, Dim dim, uint8_t * out, int16_t * errors)
+{
+  uint16_t pitch = get_pitch(dim);
+  memset(errors, 0, (dim.width + 1) * sizeof(int16_t));
+
+  for (uint16_t y = 0; y < dim.height; y++, gray += dim.width, out += pitch) {
+    dither_row(gray, dim.width, out, errors);
+  }
+}
+
+void
+DitheredImages::dither_row(const uint8_t * gray, uint16_t width, uint8_t * out, int16_t * errors)
+{
+  // errors[x + 1] is the error (x16) diffused to column x of the current row
+  // by the previous row. It is replaced by the error for the next row as soon as
+  // it has been used.
+
+  int32_t right       = 0;
+  int32_t below_right = 0;
+  uint8_t bits        = 0;
+
+  errors[0] = 0; // Column -1, not used
+  for (uint16_t x = 0; x < width; x++) {
+    int32_t v = gray[x] + ((errors[x + 1] + right + 8) >> 4);
+    int32_t e;
+    if (v > 128) {
+      e = v - 255;
+    }
+    else {
+      e = v;
+      bits |= 0x80 >> (x & 7);
+    }
+    // Keeps the row buffer within 16 bits
+    if (e > 255) e = 255; else if (e < -255) e = -255;
+
+    right          = 7 * e;
+    errors[x]     += 3 * e;
+    errors[x + 1]  = (5 * e) + below_right;
+    below_right    = e;
+
+    if ((x & 7) == 7) {
+      out[x >> 3] = bits;
+      bits        = 0;
+    }
+  }
+  if (width & 7) out[width >> 3] = bits;
+}
+
+const uint8_t *
+DitheredImages::get(const uint8_t * gray, Dim dim, uint16_t & pitch)
+{
+  pitch = get_pitch(dim);
+
+  uint64_t h = hash(gray, dim);
+
+  for (auto it = images.begin(); it != images.end(); it++) {
+    if ((it->hash == h) && (it->dim.width == dim.width) && (it->dim.height == dim.height)) {
+      if (it != images.begin()) images.splice(images.begin(), images, it);
+      return images.front().bits;
+    }
+  }
+
+  uint32_t bytes = pitch * dim.height;
+  if (bytes > MAX_SIZE) return nullptr;
+
+  while ((size + bytes) > MAX_SIZE) {
+    free(images.back().bits);
+    size -= get_pitch(images.back().dim) * images.back().dim.height;
+    images.pop_back();
+  }
+
+  uint8_t * bits = (uint8_t *) allocate(bytes);
+  if (bits == nullptr) {
+    LOG_E("Unable to allocate dithered image.");
+    return nullptr;
+  }
+
+  if (errors.size() < (uint32_t) (dim.width + 1)) errors.resize(dim.width + 1);
+  dither(gray, dim, bits, errors.data());
+
+  images.push_front({ .hash = h, .dim = dim, .bits = bits });
+  size += bytes;
+
+  return bits;
+}
+
+void
+DitheredImages::start_rows(uint16_t width)
+{
+  if (errors.size() < (uint32_t) (width + 1)) errors.resize(width + 1);
+  if (row.size() < (uint32_t) ((width + 7) >> 3)) row.resize((width + 7) >> 3);
+
+  memset(errors.data(), 0, (width + 1) * sizeof(int16_t));
+}
+
+const uint8_t *
+DitheredImages::dither_row(const uint8_t * gray, uint16_t width)
+{
+  dither_row(gray, width, row.data(), errors.data());
+  return row.data();
+}
+
+void
+DitheredImages::clear()
+{
+  for (auto & image : images) free(image.bits);
+  images.clear();
+  size = 0;
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#include "helpers/frame_cache.hpp"
+#include "helpers/frame_packer.hpp"
+
+#include "alloc.hpp"
+
+void
+FrameCache::remove(std::list<Frame>::iterator it)
+{
+  size -= it->packed_size;
+  free(it->data);
+  frames.erase(it);
+}
+
+void
+FrameCache::keep(const Key & key, const uint8_t * frame, uint32_t frame_size)
+{
+  for (auto it = frames.begin(); it != frames.end(); it++) {
+    if (it->key == key) { remove(it); break; }
+  }
+
+  uint32_t packed_size = FramePacker::pack(frame, frame_size, nullptr);
+  if (packed_size > MAX_SIZE) return;
+
+  while (!frames.empty() &&
+         ((frames.size() >= MAX_FRAMES) || ((size + packed_size) > MAX_SIZE))) {
+    remove(std::prev(frames.end()));
+  }
+
+  uint8_t * data = (uint8_t *) allocate(packed_size);
+  if (data == nullptr) {
+    LOG_E("Unable to allocate frame.");
+    return;
+  }
+  FramePacker::pack(frame, frame_size, data);
+
+  frames.push_front({ .key = key, .frame_size = frame_size, .packed_size = packed_size, .data = data });
+  size += packed_size;
+}
+
+bool
+FrameCache::restore(const Key & key, uint8_t * frame, uint32_t frame_size)
+{
+  for (auto it = frames.begin(); it != frames.end(); it++) {
+    if (it->key == key) {
+      if ((it->frame_size != frame_size) || 
+          !FramePacker::unpack(it->data, it->packed_size, frame, frame_size)) {
+        remove(it);
+        return false;
+      }
+      if (it != frames.begin()) frames.splice(frames.begin(), frames, it);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+FrameCache::contains(const Key & key) const
+{
+  for (auto & frame : frames) {
+    if (frame.key == key) return true;
+  }
+  return false;
+}
+
+void
+FrameCache::clear()
+{
+  for (auto & frame : frames) free(frame.data);
+  frames.clear();
+  size = 0;
+}
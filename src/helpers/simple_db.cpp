@@ -8,71 +8,294 @@
 #include <sys/stat.h>
 #include <iostream>
 
-bool 
-SimpleDB::open(std::string filename) 
+#include "alloc.hpp"
+
+static const char  FOOTER_MAGIC[4] = { 'S', 'D', 'B', 'F' };
+static const char JOURNAL_MAGIC[4] = { 'S', 'D', 'B', 'J' };
+
+uint32_t
+SimpleDB::checksum(const uint8_t * data, uint32_t size)
 {
-  LOG_D("Opening database file: %s", filename.c_str());
+  // FNV-1a
+  uint32_t hash = 2166136261UL;
+  while (size--) {
+    hash ^= *data++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
 
-  if (db_is_open) {
-    fclose(db_file);
-    db_is_open = false;
+bool
+SimpleDB::load_footer()
+{
+  Trailer trailer;
+
+  if (file_size < (sizeof(FooterHeader) + sizeof(Trailer))) return false;
+  if (fseek(db_file, file_size - sizeof(Trailer), SEEK_SET) ||
+      (fread(&trailer, sizeof(Trailer), 1, db_file) != 1)) return false;
+  if ((memcmp(trailer.magic, FOOTER_MAGIC, 4) != 0) ||
+      (trailer.footer_size > file_size) ||
+      (trailer.footer_size < (sizeof(FooterHeader) + sizeof(Trailer)))) return false;
+
+  uint32_t size = trailer.footer_size - sizeof(Trailer);
+  std::vector<uint8_t> footer(size);
+
+  if (fseek(db_file, file_size - trailer.footer_size, SEEK_SET) ||
+      (fread(footer.data(), size, 1, db_file) != 1) ||
+      (checksum(footer.data(), size) != trailer.checksum)) return false;
+
+  FooterHeader * header = (FooterHeader *) footer.data();
+  uint32_t       count  = header->record_count;
+
+  if ((header->mark      != FOOTER_MARK                          ) ||
+      (header->version   != FOOTER_VERSION                       ) ||
+      (header->data_size != (file_size - trailer.footer_size)    ) ||
+      (size < (sizeof(FooterHeader) + (count * 2 * sizeof(int32_t)) + ((count + 7) >> 3)))) return false;
+
+  const uint8_t * offsets = footer.data() + sizeof(FooterHeader);
+  const uint8_t * sizes   = offsets + (count * sizeof(int32_t));
+  const uint8_t * bits    = sizes   + (count * sizeof(int32_t));
+
+  record_offset.resize(count);
+  record_size.resize(count);
+  memcpy(record_offset.data(), offsets, count * sizeof(int32_t));
+  memcpy(record_size.data(),   sizes,   count * sizeof(int32_t));
+  deleted_bits.assign(bits, bits + ((count + 7) >> 3));
+  data_size = header->data_size;
+
+  for (uint32_t idx = 0; idx < count; idx++) {
+    if (record_offset[idx] == VACANT) continue;
+    if ((record_offset[idx] < 0) || (record_size[idx] < 0) ||
+        ((record_offset[idx] + sizeof(int32_t) + record_size[idx]) > data_size)) return false;
   }
 
-  if ((db_file = fopen(filename.c_str(), "r+")) == nullptr) return create(filename);
+  return true;
+}
 
-  bool done = false;
+bool
+SimpleDB::scan()
+{
+  record_offset.clear();
+  record_size.clear();
+  deleted_bits.clear();
 
-  struct stat stat_buf;
-  fstat(fileno(db_file), &stat_buf);
-  file_size = stat_buf.st_size;
+  int32_t offset = 0;
 
-  uint16_t idx    = 0;
-  int32_t  offset = 0;
+  if (fseek(db_file, 0, SEEK_SET)) return false;
 
-  while ((idx < MAX_RECORD_COUNT) && (offset < file_size)) {
-    record_offset[idx] = offset;
-    is_deleted[idx]    = false;
+  while ((offset + sizeof(int32_t)) <= file_size) {
     int32_t size;
-    if (fread(&size, sizeof(int32_t), 1, db_file) != 1) goto error;
+    if (fread(&size, sizeof(int32_t), 1, db_file) != 1) return false;
+
+    // The footer mark, or an incomplete record at the end of the file
+    if (size == FOOTER_MARK) break;
+    bool deleted = (size & DELETED_FLAG) != 0;
+    size &= ~DELETED_FLAG;
+    if ((size < 0) || ((offset + sizeof(int32_t) + size) > file_size)) break;
+
+    if ((record_offset.size() & 7) == 0) deleted_bits.push_back(0);
+    record_offset.push_back(offset);
+    record_size.push_back(size);
+    if (deleted) set_deleted(record_offset.size() - 1, true);
+
     offset += size + sizeof(int32_t);
-    if (offset < file_size) if (fseek(db_file, offset, SEEK_SET)) goto error;
-    idx++;
+    if (fseek(db_file, offset, SEEK_SET)) return false;
   }
-  done = true;
-  record_count = idx;
 
-error:
-  if (!done) {
-    fclose(db_file);
-    LOG_E("Database error!!");
+  data_size = offset;
+
+  return true;
+}
+
+bool
+SimpleDB::save_footer()
+{
+  uint32_t count = record_offset.size();
+  uint32_t size  = sizeof(FooterHeader) + (count * 2 * sizeof(int32_t)) + deleted_bits.size();
+
+  // The file can't be shortened: if there is something after the records
+  // (an incomplete record, what was left from a previous footer), the footer
+  // is padded such that the trailer is at the end of the file.
+
+  if ((data_size + size + sizeof(Trailer)) < file_size) size = file_size - data_size - sizeof(Trailer);
+
+  std::vector<uint8_t> footer(size + sizeof(Trailer), 0);
+
+  FooterHeader header = {
+    .mark         = FOOTER_MARK,
+    .version      = FOOTER_VERSION,
+    .record_count = count,
+    .data_size    = data_size
+  };
+
+  uint8_t * p = footer.data();
+  memcpy(p, &header,              sizeof(FooterHeader));    p += sizeof(FooterHeader);
+  memcpy(p, record_offset.data(), count * sizeof(int32_t)); p += count * sizeof(int32_t);
+  memcpy(p, record_size.data(),   count * sizeof(int32_t)); p += count * sizeof(int32_t);
+  memcpy(p, deleted_bits.data(),  deleted_bits.size());
+
+  Trailer trailer = {
+    .checksum    = checksum(footer.data(), size),
+    .footer_size = (uint32_t) footer.size(),
+    .magic       = { FOOTER_MAGIC[0], FOOTER_MAGIC[1], FOOTER_MAGIC[2], FOOTER_MAGIC[3] }
+  };
+
+  memcpy(footer.data() + size, &trailer, sizeof(Trailer));
+
+  if (fseek(db_file, data_size, SEEK_SET) ||
+      (fwrite(footer.data(), footer.size(), 1, db_file) != 1)) {
+    LOG_E("Unable to save database footer.");
     return false;
   }
+  fflush(db_file);
+  file_size = data_size + footer.size();
+
+  return true;
+}
+
+void
+SimpleDB::invalidate_footer()
+{
+  // Once the file is modified, a reset must end up in a file scan.
+
+  if (footer_is_valid) {
+    footer_is_valid = false;
+    const char magic[4] = { 0, 0, 0, 0 };
+    if (fseek(db_file, file_size - sizeof(magic), SEEK_SET) == 0) {
+      fwrite(magic, sizeof(magic), 1, db_file);
+      fflush(db_file);
+    }
+  }
+}
+
+void
+SimpleDB::set_deleted(uint32_t idx, bool deleted)
+{
+  if (deleted) {
+    deleted_bits[idx >> 3] |=  (1 << (idx & 7));
+  }
   else {
-    db_is_open          = true;
-    some_record_deleted = false;
-    current_record_idx  = 0;
-    LOG_D("Record count: %d", record_count);
-    return true;
+    deleted_bits[idx >> 3] &= ~(1 << (idx & 7));
   }
 }
 
+void
+SimpleDB::build_free_lists()
+{
+  free_records.clear();
+  vacant_idxs.clear();
+  compaction_blocked = false;
+
+  for (uint32_t idx = 0; idx < record_offset.size(); idx++) {
+    if (record_offset[idx] == VACANT) {
+      vacant_idxs.push_back(idx);
+    }
+    else if (is_deleted(idx)) {
+      free_records.insert(std::make_pair(record_size[idx], idx));
+    }
+  }
+}
+
+bool
+SimpleDB::write_size(int32_t offset, int32_t size)
+{
+  bool ok = (fseek(db_file, offset, SEEK_SET) == 0) &&
+            (fwrite(&size, sizeof(int32_t), 1, db_file) == 1);
+  fflush(db_file);
+  return ok;
+}
+
+bool
+SimpleDB::replay_journal()
+{
+  // A move was interrupted after the record was copied: the sizes are
+  // written again to keep the copy only.
+
+  FILE * f = fopen(journal_filename.c_str(), "rb");
+  if (f == nullptr) return false;
+
+  Journal journal;
+  bool    ok = (fread(&journal, sizeof(Journal), 1, f) == 1) &&
+               (memcmp(journal.magic, JOURNAL_MAGIC, 4) == 0);
+  fclose(f);
+
+  // With an incomplete journal, the sizes were not switched yet.
+
+  if (ok) {
+    LOG_I("Completing an interrupted record move.");
+    ok = write_size(journal.to,   journal.size) &&
+         write_size(journal.from, journal.size | DELETED_FLAG);
+    if (!ok) LOG_E("Unable to complete the record move.");
+  }
+  else {
+    ok = true;
+  }
+  if (ok) remove(journal_filename.c_str());
+
+  return true;
+}
+
+bool 
+SimpleDB::open(std::string filename) 
+{
+  LOG_D("Opening database file: %s", filename.c_str());
+
+  close();
+
+  if ((db_file = fopen(filename.c_str(), "r+")) == nullptr) return create(filename);
+
+  journal_filename = filename + ".jnl";
+
+  struct stat stat_buf;
+  fstat(fileno(db_file), &stat_buf);
+  file_size = stat_buf.st_size;
+
+  // The footer is not up to date if a record move was interrupted
+  footer_is_valid = !replay_journal() && load_footer();
+
+  if (!footer_is_valid) {
+    LOG_D("No valid footer, scanning the database.");
+    if (!scan()) {
+      fclose(db_file);
+      LOG_E("Database error!!");
+      return false;
+    }
+  }
+
+  build_free_lists();
+
+  db_is_open          = true;
+  current_record_idx  = 0;
+
+  LOG_D("Record count: %u", (unsigned) record_offset.size());
+  return true;
+}
+
 bool 
 SimpleDB::create(std::string filename) 
 {
   LOG_D("Creating database file: %s", filename.c_str());
-  if (db_is_open) {
-    fclose(db_file);
-    db_is_open = false;
-  }
+
+  close();
 
   if ((db_file = fopen(filename.c_str(), "w+")) == nullptr) return false;
 
+  journal_filename = filename + ".jnl";
+  remove(journal_filename.c_str());
+
   db_is_open          = true;
-  some_record_deleted = false;
+  compaction_blocked  = false;
+  footer_is_valid     = false;
   current_record_idx  = 0;
-  record_count        = 0;
+  data_size           = 0;
   file_size           = 0;
 
+  record_offset.clear();
+  record_size.clear();
+  deleted_bits.clear();
+  free_records.clear();
+  vacant_idxs.clear();
+
   return true;
 }
 
@@ -80,24 +303,172 @@ void
 SimpleDB::close() 
 { 
   if (db_is_open) {
+    if (!footer_is_valid) save_footer();
     db_is_open = false;
     fclose(db_file);
   }
 }
 
+void
+SimpleDB::set_deleted()
+{
+  uint32_t idx = current_record_idx;
+
+  if ((idx >= record_offset.size()) || is_deleted(idx)) return;
+
+  invalidate_footer();
+  write_size(record_offset[idx], record_size[idx] | DELETED_FLAG);
+
+  set_deleted(idx, true);
+  free_records.insert(std::make_pair(record_size[idx], idx));
+  compaction_blocked = false;
+}
+
 bool 
 SimpleDB::add_record(void * record, int32_t size) 
 {
   LOG_D("Adding record of size %d", size);
 
-  if (record_count >= MAX_RECORD_COUNT) return false;
-  if (fseek(db_file, 0, SEEK_END)) return false;
-  record_offset[record_count] = ftell(db_file);
-  is_deleted[record_count++] = false;
+  invalidate_footer();
+
+  auto it = free_records.find(size);
+  if (it != free_records.end()) {
+
+    // The record takes the place of a deleted one. Its size is written last:
+    // up to that point, a reset leaves the deleted record as is.
+
+    uint32_t idx = it->second;
+    if (fseek(db_file, record_offset[idx] + sizeof(int32_t), SEEK_SET) ||
+        ((size != 0) && (fwrite(record, size, 1, db_file) != 1))) return false;
+    fflush(db_file);
+    if (!write_size(record_offset[idx], size)) return false;
+
+    free_records.erase(it);
+    set_deleted(idx, false);
+    added_idx = idx;
+    return true;
+  }
+
+  if (fseek(db_file, data_size, SEEK_SET)) return false;
+
+  // The FOOTER_MARK will stop a file scan if the footer is not saved.
+
   if (fwrite(&size, sizeof(int32_t), 1, db_file) != 1) return false;
   if ((size != 0) && (fwrite(record, size, 1, db_file) != 1)) return false;
+  if (fwrite(&FOOTER_MARK, sizeof(int32_t), 1, db_file) != 1) return false;
   fflush(db_file);
-  file_size += sizeof(int32_t) + size;
+
+  if (vacant_idxs.empty()) {
+    added_idx = record_offset.size();
+    if ((added_idx & 7) == 0) deleted_bits.push_back(0);
+    record_offset.push_back(data_size);
+    record_size.push_back(size);
+  }
+  else {
+    added_idx = vacant_idxs.back();
+    vacant_idxs.pop_back();
+    record_offset[added_idx] = data_size;
+    record_size[added_idx]   = size;
+    set_deleted(added_idx, false);
+  }
+
+  data_size += sizeof(int32_t) + size;
+  if ((data_size + sizeof(int32_t)) > file_size) file_size = data_size + sizeof(int32_t);
+
+  return true;
+}
+
+bool
+SimpleDB::compact_step()
+{
+  if (!db_is_open || free_records.empty() || compaction_blocked) return false;
+
+  // The last record in the file
+
+  int32_t  last_offset = -1;
+  uint32_t last        = 0;
+  for (uint32_t idx = 0; idx < record_offset.size(); idx++) {
+    if (record_offset[idx] > last_offset) { last_offset = record_offset[idx]; last = idx; }
+  }
+  if (last_offset < 0) return false;
+
+  invalidate_footer();
+
+  if (is_deleted(last)) {
+    // Dropped: the space will be used by the next record added at the end.
+
+    if (!write_size(last_offset, FOOTER_MARK)) return false;
+
+    auto range = free_records.equal_range(record_size[last]);
+    for (auto it = range.first; it != range.second; it++) {
+      if (it->second == last) { free_records.erase(it); break; }
+    }
+    record_offset[last] = VACANT;
+    record_size[last]   = 0;
+    vacant_idxs.push_back(last);
+    data_size = last_offset;
+
+    return true;
+  }
+
+  // The deleted record of the same size nearest to the beginning of the file
+
+  int32_t  size  = record_size[last];
+  auto     range = free_records.equal_range(size);
+  auto     to    = free_records.end();
+
+  for (auto it = range.first; it != range.second; it++) {
+    if ((to == free_records.end()) || (record_offset[it->second] < record_offset[to->second])) to = it;
+  }
+  if (to == free_records.end()) {
+    // Nothing else can be done until a record of the same size is deleted.
+    compaction_blocked = true;
+    return false;
+  }
+
+  uint32_t  idx    = to->second;
+  uint8_t * buffer = (uint8_t *) allocate(size + 1);
+  if (buffer == nullptr) return false;
+
+  bool ok = (fseek(db_file, last_offset + sizeof(int32_t), SEEK_SET) == 0) &&
+            ((size == 0) || (fread(buffer, size, 1, db_file) == 1)) &&
+            (fseek(db_file, record_offset[idx] + sizeof(int32_t), SEEK_SET) == 0) &&
+            ((size == 0) || (fwrite(buffer, size, 1, db_file) == 1));
+  fflush(db_file);
+  free(buffer);
+
+  if (ok) {
+    // The record is now in both places. The sizes are switched through the
+    // journal, such that only one of them stays valid.
+
+    Journal journal = {
+      .magic = { JOURNAL_MAGIC[0], JOURNAL_MAGIC[1], JOURNAL_MAGIC[2], JOURNAL_MAGIC[3] },
+      .from  = last_offset,
+      .to    = record_offset[idx],
+      .size  = size
+    };
+
+    FILE * f = fopen(journal_filename.c_str(), "wb");
+    ok = (f != nullptr) && (fwrite(&journal, sizeof(Journal), 1, f) == 1);
+    if (f != nullptr) ok = (fclose(f) == 0) && ok;
+
+    ok = ok && write_size(journal.to,   size) &&
+               write_size(journal.from, size | DELETED_FLAG);
+
+    remove(journal_filename.c_str());
+  }
+
+  if (!ok) {
+    LOG_E("Unable to move a record.");
+    return false;
+  }
+
+  // The moved record keeps its index. The deleted one is now the last in the
+  // file, to be dropped with the next step.
+
+  record_offset[last] = record_offset[idx];
+  record_offset[idx]  = last_offset;
+
   return true;
 }
 
@@ -106,7 +477,8 @@ SimpleDB::get_record(void * record, int32_t size)
 {
   // LOG_D("Reading record of size %d", size);
 
-  if ((size <= 0) || (current_record_idx >= record_count)) return false;
+  if ((size <= 0) || (current_record_idx >= record_offset.size()) ||
+      (record_offset[current_record_idx] == VACANT)) return false;
   if (fseek(db_file, record_offset[current_record_idx] + sizeof(int32_t), SEEK_SET)) return false;
   if (fread(record, size, 1, db_file) != 1) return false;
   return true;
@@ -117,7 +489,8 @@ SimpleDB::get_partial_record(void * record, int32_t size, int32_t offset)
 {
   // LOG_D("Reading partial record of size %d at offset %d", size, offset);
 
-  if ((size <= 0) || (current_record_idx >= record_count)) return false;
+  if ((size <= 0) || (current_record_idx >= record_offset.size()) ||
+      (record_offset[current_record_idx] == VACANT)) return false;
   if (fseek(db_file, record_offset[current_record_idx] + sizeof(int32_t) + offset, SEEK_SET)) return false;
   if (fread(record, size, 1, db_file) != 1) return false;
   return true;
@@ -128,17 +501,17 @@ SimpleDB::show()
 {
   if (db_is_open) {
     std::cout << "===== Database content: ====" << std::endl;
-    std::cout << "Record count: " << record_count << std::endl;
+    std::cout << "Record count: " << record_offset.size() << std::endl;
 
-    for (int16_t idx = 0; idx < record_count; idx++) {
+    for (uint32_t idx = 0; idx < record_offset.size(); idx++) {
       std::cout 
         << idx << ":"
         << " offset: " << record_offset[idx]
-        << " size: "   << record_offset[idx + 1] - record_offset[idx] - sizeof(int32_t)
-        << (is_deleted[idx] ? " DELETED" : "")
+        << " size: "   << record_size[idx]
+        << (is_deleted(idx) ? " DELETED" : "")
         << std::endl;
     }
     
     std::cout << "===== End of database =====" << std::endl;
   }
-}
\ No newline at end of file
+}
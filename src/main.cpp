@@ -17,6 +17,8 @@
   #include "models/epub.hpp"
   #include "models/config.hpp"
   #include "models/nvs_mgr.hpp"
+  #include "models/wake_frame.hpp"
+  #include "viewers/book_viewer.hpp"
   #include "screen.hpp"
   #include "inkplate_platform.hpp"
   #include "helpers/unzip.hpp"
@@ -99,13 +101,26 @@
         #define LEVEL 1
       #endif
 
+      Screen::Orientation    orientation;
+      Screen::PixelResolution resolution;
+      config.get(Config::Ident::ORIENTATION,      (int8_t *) &orientation);
+      config.get(Config::Ident::PIXEL_RESOLUTION, (int8_t *) &resolution);
+      screen.setup(resolution, orientation);
+
+      // If we were reading a book before deep sleep, the page is shown back right away.
+      // Keys pressed during the rest of the initialization are queued by the EventMgr.
+
+      FrameCache::Key wake_key;
+      if (!config_err && wake_frame.restore(wake_key, screen.get_frame_data(), screen.get_frame_size())) {
+        screen.frame_restored();
+        screen.update();
+        book_viewer.adopt_frame(wake_key);
+      }
+      else {
+        screen.clear();
+      }
+
       if (fonts.setup()) {
-        
-        Screen::Orientation    orientation;
-        Screen::PixelResolution resolution;
-        config.get(Config::Ident::ORIENTATION,      (int8_t *) &orientation);
-        config.get(Config::Ident::PIXEL_RESOLUTION, (int8_t *) &resolution);
-        screen.setup(resolution, orientation);
 
         event_mgr.setup();
         event_mgr.set_orientation(orientation);
@@ -119,6 +134,7 @@
             "Failed to initialise NVS Flash. Entering Deep Sleep. " MSG
           );
 
+          screen.wait_for_update();
           ESP::delay(500);
           inkplate_platform.deep_sleep(INT_PIN, LEVEL);
         }
@@ -127,6 +143,7 @@
           msg_viewer.show(MsgViewer::MsgType::ALERT, false, true, "Hardware Problem!",
             "Unable to initialize the InkPlate drivers. Entering Deep Sleep. " MSG
           );
+          screen.wait_for_update();
           ESP::delay(500);
           inkplate_platform.deep_sleep(INT_PIN, LEVEL);
         }
@@ -135,11 +152,14 @@
           msg_viewer.show(MsgViewer::MsgType::ALERT, false, true, "Configuration Problem!",
             "Unable to read/save configuration file. Entering Deep Sleep. " MSG
           );
+          screen.wait_for_update();
           ESP::delay(500);
           inkplate_platform.deep_sleep(INT_PIN, LEVEL);
         }
 
-        msg_viewer.show(MsgViewer::MsgType::INFO, false, true, "Starting", "One moment please...");
+        if (!wake_frame.is_shown()) {
+          msg_viewer.show(MsgViewer::MsgType::INFO, false, true, "Starting", "One moment please...");
+        }
 
         books_dir_controller.setup();
         LOG_D("Initialization completed");
@@ -150,6 +170,7 @@
         msg_viewer.show(MsgViewer::MsgType::ALERT, false, true, "Font Loading Problem!",
           "Unable to read required fonts. Entering Deep Sleep. " MSG
         );
+        screen.wait_for_update();
         ESP::delay(500);
         inkplate_platform.deep_sleep(INT_PIN, LEVEL);
       }
@@ -208,6 +229,8 @@
   #include "models/fonts.hpp"
   #include "models/config.hpp"
   #include "models/page_locs.hpp"
+  #include "models/wake_frame.hpp"
+  #include "viewers/book_viewer.hpp"
   #include "screen.hpp"
 
   #if TESTING
@@ -244,6 +267,16 @@
       config.get(Config::Ident::PIXEL_RESOLUTION, (int8_t *) &resolution);
       screen.setup(resolution, orientation);
 
+      FrameCache::Key wake_key;
+      if (!config_err && wake_frame.restore(wake_key, screen.get_frame_data(), screen.get_frame_size())) {
+        screen.frame_restored();
+        screen.update();
+        book_viewer.adopt_frame(wake_key);
+      }
+      else {
+        screen.clear();
+      }
+
       event_mgr.setup();
       books_dir_controller.setup();
 
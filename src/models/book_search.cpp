@@ -0,0 +1,319 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#define __BOOK_SEARCH__ 1
+#include "models/book_search.hpp"
+
+#include "models/fonts.hpp"
+#include "viewers/book_viewer.hpp"
+#include "viewers/html_interpreter.hpp"
+
+#include <sys/stat.h>
+
+// The item is walked from its beginning without ever reaching the start of
+// a page (see HTMLInterpreter::PAST_END): nothing is laid out, but the
+// offsets are computed the same way as for the pages location, the CSS
+// being applied.
+
+class BookSearchInterp : public HTMLInterpreter
+{
+  public:
+    BookSearchInterp(Page & the_page, DOM & the_dom, const EPub::ItemInfo & the_item, BookSearch & the_search) :
+      HTMLInterpreter(the_page, the_dom, Page::ComputeMode::MOVE, the_item), search(the_search) {}
+    ~BookSearchInterp() {}
+
+  protected:
+    BookSearch & search;
+
+    bool page_end(const Page::Format & fmt) { return true; }
+
+    void text_found(const char * str, int32_t offset) {
+      search.text_found(str, offset);
+      if (search.truncated) end_offset = 0; // Stops the walk
+    }
+};
+
+std::string
+BookSearch::index_filename(const std::string & epub_filename)
+{
+  return epub_filename.substr(0, epub_filename.find_last_of('.')) + ".sidx";
+}
+
+uint64_t
+BookSearch::book_stamp(const std::string & epub_filename)
+{
+  struct stat stat_buffer;
+  if (stat(epub_filename.c_str(), &stat_buffer) != 0) return 0;
+
+  return (((uint64_t) stat_buffer.st_size) << 32) | (uint32_t) stat_buffer.st_mtime;
+}
+
+void
+BookSearch::clear()
+{
+  cancel();
+
+  Hits().swap(hits);
+  query.clear();
+  query_words.clear();
+  std::vector<uint32_t>().swap(items);
+  next_item = 0;
+  truncated = false;
+}
+
+void
+BookSearch::cancel()
+{
+  running        = false;
+  index_building = false;
+
+  index.clear();
+  window.clear();
+  std::set<std::string>().swap(item_tokens);
+}
+
+bool
+BookSearch::start(const std::string & the_query)
+{
+  clear();
+
+  query = the_query;
+  BooksSearch::tokenize(query.c_str(), query_words, 0);
+  if (query_words.empty()) return false;
+
+  int16_t item_count = epub.get_item_count();
+
+  // With the per-book index, only the items containing all the query words
+  // are walked. Short words are not indexed and can't be used for that.
+
+  std::string indexed_words;
+  for (auto & word : query_words) {
+    if (word.size() >= BooksSearch::MIN_TOKEN_SIZE) indexed_words.append(word).push_back(' ');
+  }
+
+  // The index is not used if the book was replaced since it was built.
+
+  const std::string & filename = epub.get_current_filename();
+  bool index_ok = index.load(index_filename(filename), book_stamp(filename)) &&
+                  (index.get_ids().size() == (uint32_t) item_count);
+
+  if (index_ok && !indexed_words.empty()) {
+    index.search(indexed_words, items);
+  }
+  else {
+    for (int16_t i = 0; i < item_count; i++) items.push_back(i);
+  }
+
+  index_building = !index_ok;
+  index.clear();
+  if (index_building) index.start_batch();
+
+  LOG_D("Search of \"%s\" in %d items out of %d", query.c_str(), (int) items.size(), item_count);
+
+  running = true;
+  return true;
+}
+
+bool
+BookSearch::step()
+{
+  if (!running) return false;
+
+  if (next_item < items.size()) search_item(items[next_item++]);
+
+  if (truncated || (next_item >= items.size())) {
+    complete();
+    return false;
+  }
+  return true;
+}
+
+void
+BookSearch::complete()
+{
+  // The per-book index is kept only if all the items went through
+
+  if (index_building) {
+    const std::string & filename = epub.get_current_filename();
+    index.end_batch();
+    index.save(index_filename(filename), book_stamp(filename));
+  }
+
+  cancel();
+}
+
+void
+BookSearch::search_item(int16_t itemref_index)
+{
+  std::scoped_lock guard(book_viewer.get_mutex());
+
+  window.clear();
+
+  if (epub.get_item_at_index(itemref_index, item_info)) {
+
+    xml_node node;
+
+    if ((node = item_info.xml_doc.child("html").child("body"))) {
+
+      int16_t idx;
+
+      if ((idx = fonts.get_index("Fontbase", Fonts::FaceStyle::NORMAL)) == -1) {
+        idx = 3;
+      }
+
+      EPub::BookFormatParams * format_params = epub.get_book_format_params();
+
+      Page::Format fmt = {
+        .line_height_factor = 0.95,
+        .font_index         = idx,
+        .font_size          = format_params->font_size,
+        .indent             = 0,
+        .margin_left        = 0,
+        .margin_right       = 0,
+        .margin_top         = 0,
+        .margin_bottom      = 0,
+        .screen_left        = 10,
+        .screen_right       = 10,
+        .screen_top         = 0,
+        .screen_bottom      = 0,
+        .width              = 0,
+        .height             = 0,
+        .vertical_align     = 0,
+        .trim               = true,
+        .pre                = false,
+        .font_style         = Fonts::FaceStyle::NORMAL,
+        .align              = CSS::Align::LEFT,
+        .text_transform     = CSS::TextTransform::NONE,
+        .display            = CSS::Display::INLINE
+      };
+
+      DOM              * dom    = new DOM;
+      BookSearchInterp * interp = new BookSearchInterp(page_out, *dom, item_info, *this);
+
+      interp->set_limits(HTMLInterpreter::PAST_END, HTMLInterpreter::PAST_END, format_params->show_images != 0);
+
+      page_out.start(fmt);
+
+      #if EPUB_INKPLATE_BUILD
+        esp_task_wdt_reset();
+      #endif
+
+      Page::Format * new_fmt = interp->duplicate_fmt(fmt);
+      interp->build_pages_recurse(node, *new_fmt, dom->body, 1);
+      interp->release_fmt(new_fmt);
+
+      delete interp;
+      delete dom;
+    }
+  }
+
+  epub.clear_item_data(item_info);
+
+  if (item_info.css != nullptr) {
+    delete item_info.css;
+    item_info.css = nullptr;
+  }
+
+  if (index_building) {
+    std::vector<std::string> words(item_tokens.begin(), item_tokens.end());
+    std::set<std::string>().swap(item_tokens);
+
+    index.add_tokens(itemref_index, words);
+
+    if (index.get_posting_count() > MAX_INDEX_POSTINGS) {
+      LOG_D("Book too large for a search index");
+      index.clear();
+      index_building = false;
+    }
+  }
+}
+
+void
+BookSearch::text_found(const char * str, int32_t offset)
+{
+  // Words are separated the same way as by the HTMLInterpreter. Each one
+  // may give more than one token (e.g. "l'élève").
+
+  std::vector<std::string> tokens;
+  const char * p = str;
+
+  while (!truncated) {
+    while ((*p != 0) && ((uint8_t) *p <= ' ')) p++;
+    if (*p == 0) break;
+
+    const char * start = p;
+    while ((uint8_t) *p > ' ') p++;
+
+    tokens.clear();
+    BooksSearch::tokenize(std::string(start, p - start).c_str(), tokens, 0);
+
+    for (auto & token : tokens) {
+      if (index_building && (token.size() >= BooksSearch::MIN_TOKEN_SIZE)) item_tokens.insert(token);
+      add_word(token, offset + (start - str), str, start);
+    }
+  }
+}
+
+void
+BookSearch::add_word(std::string & token, int32_t offset, const char * str, const char * pos)
+{
+  window.push_back({ .token = std::move(token), .offset = offset, .str = str, .pos = pos });
+
+  if (window.size() > query_words.size()) window.pop_front();
+  if (window.size() < query_words.size()) return;
+
+  for (uint8_t i = 0; i < query_words.size(); i++) {
+    if (window[i].token.compare(0, query_words[i].size(), query_words[i]) != 0) return;
+  }
+
+  add_hit(window.front());
+  window.clear();
+}
+
+void
+BookSearch::add_hit(const Word & word)
+{
+  // The snippet starts at a word boundary, a few words before the hit, and
+  // stops at a character boundary. Spaces and new lines are collapsed.
+
+  const char * first = word.pos;
+  while ((first > word.str) && ((word.pos - first) < (SNIPPET_SIZE / 3))) first--;
+  if (first > word.str) {
+    while ((first < word.pos) && ((uint8_t) *first > ' ')) first++;
+  }
+
+  std::string  snippet = (first > word.str) ? "..." : "";
+  const char * p       = first;
+
+  while ((*p != 0) && ((snippet.size() < SNIPPET_SIZE) || (((uint8_t) *p & 0xC0) == 0x80))) {
+    if ((uint8_t) *p <= ' ') {
+      if (!snippet.empty() && (snippet.back() != ' ')) snippet.push_back(' ');
+    }
+    else {
+      snippet.push_back(*p);
+    }
+    p++;
+  }
+
+  while (!snippet.empty() && (snippet.back() == ' ')) snippet.pop_back();
+  if (*p != 0) snippet.append("...");
+
+  hits.push_back({
+    .location = PageLocs::PageId(item_info.itemref_index, word.offset),
+    .snippet  = snippet
+  });
+
+  if (hits.size() >= MAX_HITS) {
+    truncated      = true;
+    index_building = false;
+  }
+}
+
+const PageLocs::PageId *
+BookSearch::get_page_id(int16_t hit_idx)
+{
+  if ((hit_idx < 0) || (hit_idx >= (int16_t) hits.size())) return nullptr;
+
+  return page_locs.get_page_id(hits[hit_idx].location);
+}
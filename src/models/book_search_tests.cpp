@@ -0,0 +1,179 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "models/book_search.hpp"
+#include "models/epub.hpp"
+#include "models/page_locs.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sys/stat.h>
+#include <utime.h>
+
+static const char * ENGLISH_BOOK = BOOKS_FOLDER "/Austen, Jane - Pride and Prejudice.epub";
+static const char * FRENCH_BOOK  = BOOKS_FOLDER "/Austen, Jane - Orgueil et préjugés.epub";
+
+static void
+open_book(const char * filename, bool with_index = false)
+{
+  ASSERT_TRUE(epub.open_file(filename));
+  if (!with_index) ::remove(BookSearch::index_filename(filename).c_str());
+}
+
+static long
+search_all(const char * query)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  EXPECT_TRUE(book_search.start(query));
+  while (book_search.step());
+
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+TEST(BookSearchTest, words_in_sequence) {
+  open_book(ENGLISH_BOOK);
+  search_all("Universally ACKNOWLEDGED");
+
+  ASSERT_LT(0u, book_search.get_hits().size());
+  const BookSearch::Hit & hit = book_search.get_hits()[0];
+  EXPECT_NE(std::string::npos, hit.snippet.find("universally acknowledged"));
+  EXPECT_GE(hit.snippet.size(), BookSearch::SNIPPET_SIZE);
+  EXPECT_FALSE(book_search.is_truncated());
+
+  search_all("acknowledged universally");
+  EXPECT_TRUE(book_search.get_hits().empty());
+
+  book_search.clear();
+}
+
+TEST(BookSearchTest, accents_are_ignored) {
+  open_book(FRENCH_BOOK);
+  search_all("prejuges");
+  size_t count = book_search.get_hits().size();
+  EXPECT_LT(0u, count);
+
+  search_all("PRÉJUGÉS");
+  EXPECT_EQ(count, book_search.get_hits().size());
+
+  book_search.clear();
+}
+
+TEST(BookSearchTest, hits_are_capped) {
+  open_book(ENGLISH_BOOK);
+  search_all("the");
+
+  EXPECT_EQ(BookSearch::MAX_HITS, book_search.get_hits().size());
+  EXPECT_TRUE(book_search.is_truncated());
+  EXPECT_FALSE(book_search.is_running());
+
+  book_search.clear();
+}
+
+TEST(BookSearchTest, cancel) {
+  open_book(ENGLISH_BOOK);
+  ASSERT_TRUE(book_search.start("elizabeth"));
+  EXPECT_FALSE(book_search.start(" ,; "));
+
+  ASSERT_TRUE(book_search.start("elizabeth"));
+  for (int i = 0; i < 5; i++) book_search.step();
+  EXPECT_TRUE(book_search.is_running());
+  EXPECT_GT(100, book_search.get_progress());
+
+  book_search.cancel();
+  EXPECT_FALSE(book_search.is_running());
+  EXPECT_FALSE(book_search.step());
+
+  // The index is kept only after a complete search
+  struct stat file_stat;
+  EXPECT_EQ(-1, stat(BookSearch::index_filename(ENGLISH_BOOK).c_str(), &file_stat));
+
+  book_search.clear();
+}
+
+TEST(BookSearchTest, hit_page) {
+  open_book(ENGLISH_BOOK);
+  page_locs.start_new_document(epub.get_item_count(), 0);
+
+  search_all("Gracechurch");
+  ASSERT_LT(0u, book_search.get_hits().size());
+
+  const PageLocs::PageId & location = book_search.get_hits()[0].location;
+  const PageLocs::PageId * page_id  = book_search.get_page_id(0);
+  ASSERT_NE(nullptr, page_id);
+  EXPECT_EQ(location.itemref_index, page_id->itemref_index);
+  EXPECT_GE(location.offset,        page_id->offset);
+  EXPECT_EQ(nullptr, book_search.get_page_id(book_search.get_hits().size()));
+
+  page_locs.stop_document();
+  book_search.clear();
+}
+
+TEST(BookSearchTest, index_of_replaced_book) {
+  open_book(ENGLISH_BOOK);
+  search_all("Gracechurch");
+  size_t count = book_search.get_hits().size();
+
+  std::string  index_filename = BookSearch::index_filename(ENGLISH_BOOK);
+  BooksSearch  index;
+  EXPECT_TRUE(index.load(index_filename, BookSearch::book_stamp(ENGLISH_BOOK)));
+
+  // The book seems to be replaced: its index is not used, and built again
+
+  struct stat file_stat;
+  ASSERT_EQ(0, stat(ENGLISH_BOOK, &file_stat));
+  struct utimbuf times = { .actime = file_stat.st_atime, .modtime = file_stat.st_mtime + 10 };
+  ASSERT_EQ(0, utime(ENGLISH_BOOK, &times));
+
+  EXPECT_FALSE(index.load(index_filename, BookSearch::book_stamp(ENGLISH_BOOK)));
+
+  open_book(ENGLISH_BOOK, true);
+  search_all("Gracechurch");
+  EXPECT_EQ(count, book_search.get_hits().size());
+  EXPECT_TRUE(index.load(index_filename, BookSearch::book_stamp(ENGLISH_BOOK)));
+
+  times.modtime = file_stat.st_mtime;
+  utime(ENGLISH_BOOK, &times);
+  ::remove(index_filename.c_str());
+  book_search.clear();
+}
+
+// Searches in the sample books, without and with the per-book index built by
+// the first one.
+
+TEST(BookSearchTest, benchmark) {
+  static const struct { const char * book; const char * query; } searches[] = {
+    { ENGLISH_BOOK, "Gracechurch"              },
+    { ENGLISH_BOOK, "universally acknowledged" },
+    { ENGLISH_BOOK, "xylophone"                },
+    { FRENCH_BOOK,  "Gracechurch"              },
+    { FRENCH_BOOK,  "verite universelle"       },
+    { FRENCH_BOOK,  "xylophone"                }
+  };
+
+  for (auto & search : searches) {
+    open_book(search.book);
+    long   full_time  = search_all(search.query);
+    size_t full_count = book_search.get_hits().size();
+
+    // The index is kept only when the search went through the whole book
+    struct stat file_stat;
+    EXPECT_EQ(book_search.is_truncated() ? -1 : 0,
+              stat(BookSearch::index_filename(search.book).c_str(), &file_stat));
+
+    open_book(search.book, true);
+    long indexed_time = search_all(search.query);
+    EXPECT_EQ(full_count, book_search.get_hits().size());
+
+    std::cout << "[ BENCHMARK] " << search.query << " in " << epub.get_title() << ": "
+              << full_count << " hits, "
+              << full_time << " ms, then " << indexed_time << " ms with the index." << std::endl;
+
+    ::remove(BookSearch::index_filename(search.book).c_str());
+  }
+
+  book_search.clear();
+}
+
+#endif
@@ -6,9 +6,11 @@
 #include "models/books_dir.hpp"
 
 #include "models/epub.hpp"
+#include "models/epub_probe.hpp"
 #include "models/default_cover.hpp"
 #include "viewers/book_viewer.hpp"
 #include "viewers/msg_viewer.hpp"
+#include "helpers/dithered_images.hpp"
 #include "alloc.hpp"
 
 #if EPUB_INKPLATE_BUILD
@@ -23,6 +25,7 @@ extern "C" {
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <sstream>
+#include <set>
 
 #if 0
   const uint32_t CRC32_INITIAL    = 0xFFFFFFFFUL;
@@ -116,6 +119,8 @@ BooksDir::read_books_directory(char * book_filename, int16_t & book_index)
     return false;
   }
 
+  bool footer_is_valid = db.is_footer_valid();
+
   // #if DEBUGGING
   //   show_db();
   // #endif
@@ -167,7 +172,20 @@ BooksDir::read_books_directory(char * book_filename, int16_t & book_index)
     }
   }
 
-  if (!refresh(book_filename, book_index)) {
+  if (!open_covers(!version_ok)) return false;
+
+  // The index file is used only if the database was properly closed (see SimpleDB).
+
+  index_file_valid = version_ok && footer_is_valid && index.load(INDEX_FILE, db.get_record_count());
+
+  // If the books folder did not change since the index was saved, the index
+  // is used as the folder manifest: the folder is verified in the background.
+
+  uint32_t stamp;
+  if (index_file_valid && get_folder_stamp(stamp) && (stamp == index.get_folder_stamp())) {
+    use_manifest(book_filename, book_index);
+  }
+  else if (!refresh(book_filename, book_index, false, true)) {
     LOG_E("Unable to complete DB refresh");
     return false;
   }
@@ -207,30 +225,408 @@ std::istream & deserialize(std::istream & is, std::vector<POD> & v)
 }
 #endif
 
+bool
+BooksDir::get_folder_stamp(uint32_t & stamp)
+{
+  // The folder modification time changes when files are added, removed or
+  // renamed. Some file systems (FAT) are not keeping it up to date: the
+  // background verification is finding what the stamp is missing.
+
+  struct stat stat_buffer;
+
+  if (stat(BOOKS_FOLDER, &stat_buffer) != 0) {
+    LOG_E("Unable to get stats for folder: %s", BOOKS_FOLDER);
+    return false;
+  }
+
+  uint32_t values[2] = { (uint32_t) stat_buffer.st_mtime, (uint32_t) stat_buffer.st_size };
+  stamp = generate_id((uint8_t *) values, sizeof(values));
+
+  return true;
+}
+
+void
+BooksDir::use_manifest(char * book_filename, int16_t & book_index)
+{
+  // No file access: the books being read are known by the NVS manager.
+
+  bool track_changed = false;
+
+  for (uint16_t i = 0; i < index.get_entry_count(); i++) {
+    BooksIndex::Entry & entry = index.get_entry(i);
+
+    #if EPUB_INKPLATE_BUILD
+      int8_t pos = nvs_mgr.get_pos(entry.id);
+    #else
+      int8_t pos = -1;
+    #endif
+
+    if (entry.track_pos != pos) {
+      entry.track_pos = pos;
+      track_changed   = true;
+    }
+
+    if (book_filename) {
+      if (strcmp(book_filename, entry.filename.c_str()) == 0) book_index = entry.db_index;
+    }
+  }
+
+  if (track_changed) {
+    index.sort();
+    invalidate_index();
+    index_file_valid = index.save(INDEX_FILE, db.get_record_count());
+  }
+
+  // The covers are indexed by the first verification step, or when a
+  // cover is first needed.
+
+  pending.clear();
+  verify_state = VerifyState::COVERS;
+}
+
+bool
+BooksDir::verify_entry(uint16_t entry_idx)
+{
+  BooksIndex::Entry & entry = index.get_entry(entry_idx);
+
+  std::string fname = BOOKS_FOLDER "/";
+  fname.append(entry.filename);
+
+  struct stat stat_buffer;
+
+  // if file with filename not found or the file size is not the same,
+  // remove the database entry
+  if ((stat(fname.c_str(), &stat_buffer) != 0) ||
+      (stat_buffer.st_size != entry.file_size)) {
+    LOG_D("Book no longer available: %s", entry.filename.c_str());
+    invalidate_index();
+    search_outdated = true;
+    if (entry.db_index != BooksIndex::NO_DB_INDEX) {
+      db.set_current_idx(entry.db_index);
+      db.set_deleted();
+    }
+    index.remove(entry_idx);
+    return false;
+  }
+
+  if (entry.added != (uint32_t) stat_buffer.st_mtime) {
+    invalidate_index();
+    entry.added = stat_buffer.st_mtime;
+  }
+
+  return true;
+}
+
+void
+BooksDir::invalidate_index()
+{
+  if (index_file_valid) {
+    remove(INDEX_FILE);
+    index_file_valid = false;
+  }
+}
+
+bool
+BooksDir::sync_search_index()
+{
+  // Books no longer in the list are removed from the search index, and
+  // books retrieved since the last update are added, their description
+  // being read from the database.
+
+  std::vector<uint32_t> removed;
+  for (auto id : search_index.get_ids()) {
+    int16_t entry_idx = index.entry_index_of_id(id);
+    if ((entry_idx == -1) || (index.get_entry(entry_idx).db_index == BooksIndex::NO_DB_INDEX)) {
+      removed.push_back(id);
+    }
+  }
+
+  bool changed = !removed.empty();
+  if (changed) search_index.remove_books(removed);
+
+  search_index.start_batch();
+
+  for (uint16_t i = 0; i < index.get_entry_count(); i++) {
+    const BooksIndex::Entry & entry = index.get_entry(i);
+    if ((entry.db_index == BooksIndex::NO_DB_INDEX) || search_index.contains(entry.id)) continue;
+
+    db.set_current_idx(entry.db_index);
+    if (!db.get_record(&book, sizeof(EBookRecord))) {
+      LOG_E("Unable to get record at index %d", entry.db_index);
+      continue;
+    }
+    current_book_idx = -1;
+
+    search_index.add_book(entry.id, book.title, book.author, book.description);
+    changed = true;
+  }
+
+  search_index.end_batch();
+
+  return changed;
+}
+
+void
+BooksDir::update_search_index()
+{
+  // Called once the books list is up to date. The search index file is
+  // read only if books were added or removed since it was saved.
+
+  struct stat stat_buffer;
+  bool        file_exists = stat(SEARCH_FILE, &stat_buffer) == 0;
+
+  if (!search_outdated && file_exists) return;
+
+  if (!search_loaded) search_index.load(SEARCH_FILE);  // Empty if not valid
+
+  if (sync_search_index() || !file_exists) {
+    search_outdated = !search_index.save(SEARCH_FILE);
+  }
+  else {
+    search_outdated = false;
+  }
+
+  if (!search_loaded) search_index.clear();
+}
+
+bool
+BooksDir::search(const std::string & query, std::vector<uint32_t> & ids)
+{
+  std::scoped_lock guard(mutex);
+
+  if (!search_loaded) {
+    bool valid = search_index.load(SEARCH_FILE);
+    if (sync_search_index() || !valid) search_outdated = !search_index.save(SEARCH_FILE);
+    search_loaded = true;
+  }
+
+  search_index.search(query, ids);
+
+  return !ids.empty();
+}
+
+bool
+BooksDir::open_covers(bool create)
+{
+  cover_index.clear();
+  cover_cache.clear();
+  covers_indexed = false;
+
+  if (create ? !covers_db.create(COVERS_FILE) : !covers_db.open(COVERS_FILE)) {
+    LOG_E("Can't open database: %s", COVERS_FILE);
+    return false;
+  }
+  return true;
+}
+
+void
+BooksDir::index_covers()
+{
+  // Covers of books no longer in the index are removed. If a book has
+  // more than one cover (it was removed and added back), the last one is kept.
+  // Covers of a previous record format are removed: they will be built again
+  // by refresh_step().
+
+  std::set<uint32_t> ids;
+  for (uint16_t i = 0; i < index.get_entry_count(); i++) ids.insert(index.get_entry(i).id);
+
+  cover_index.clear();
+  covers_indexed = true;
+
+  if (!covers_db.goto_first()) return;
+  do {
+    uint32_t id;
+    if (!covers_db.get_partial_record(&id, sizeof(id), 0)) continue;
+    if ((ids.find(id) == ids.end()) || (covers_db.get_record_size() != sizeof(CoverRecord))) {
+      covers_db.set_deleted();
+    }
+    else {
+      auto it = cover_index.find(id);
+      if (it != cover_index.end()) {
+        uint16_t idx = covers_db.get_current_idx();
+        covers_db.set_current_idx(it->second);
+        covers_db.set_deleted();
+        covers_db.set_current_idx(idx);
+      }
+      cover_index[id] = covers_db.get_current_idx();
+    }
+  } while (covers_db.goto_next());
+}
+
+void
+BooksDir::dither_cover(CoverRecord & cover)
+{
+  int16_t errors[MAX_COVER_WIDTH + 1];
+
+  DitheredImages::dither(cover.cover_bitmap,
+                         Dim(cover.cover_width, cover.cover_height),
+                         cover.cover_dithered,
+                         errors);
+}
+
+bool
+BooksDir::add_cover(uint32_t id, EPubProbe & probe)
+{
+  CoverRecord * cover = (CoverRecord *) allocate(sizeof(CoverRecord));
+
+  if (cover == nullptr) {
+    LOG_E("Not enough memory for book cover: %d bytes required.", sizeof(CoverRecord));
+    return false;
+  }
+
+  memset(cover, 0, sizeof(CoverRecord));
+  cover->id = id;
+
+  // The image is retrieved at twice the cover size at most: the JPEG
+  // decoder is then scaling it down while decompressing.
+
+  Image * img = probe.get_cover_image(Dim(2 * MAX_COVER_WIDTH, 2 * MAX_COVER_HEIGHT));
+
+  if (img == nullptr) {
+    if (!probe.get_cover_filename().empty()) {
+      LOG_D("Unable to retrieve cover file: %s", probe.get_cover_filename().c_str());
+    }
+    memcpy(cover->cover_bitmap, default_cover, default_cover_width * default_cover_height);
+    cover->cover_width  = default_cover_width;
+    cover->cover_height = default_cover_height;
+  }
+  else {
+    LOG_D("Image: width: %d height: %d", img->get_dim().width, img->get_dim().height);
+
+    int32_t w = max_cover_width;
+    int32_t h = img->get_dim().height * max_cover_width / img->get_dim().width;
+
+    if (h > max_cover_height) {
+      h = max_cover_height;
+      w = img->get_dim().width * max_cover_height / img->get_dim().height;
+    }
+
+    img->resize(Dim(w, h));
+    memcpy(cover->cover_bitmap, img->get_bitmap(), w * h);
+
+    cover->cover_width  = w;
+    cover->cover_height = h;
+
+    delete img;
+  }
+
+  dither_cover(*cover);
+
+  auto it = cover_index.find(cover->id);
+  if (it != cover_index.end()) {
+    covers_db.set_current_idx(it->second);
+    covers_db.set_deleted();
+    cover_cache.forget(cover->id);
+  }
+
+  bool result = covers_db.add_record(cover, sizeof(CoverRecord));
+  if (result) {
+    cover_index[cover->id] = covers_db.get_added_idx();
+  }
+  else {
+    LOG_E("Unable to add a new cover to DB file.");
+  }
+
+  free(cover);
+  return result;
+}
+
+bool
+BooksDir::get_book_summary(uint16_t idx, BookSummary & summary)
+{
+  const BooksIndex::Entry * entry = index.at(idx);
+
+  if (entry == nullptr) {
+    LOG_E("Unable to find idx: %d", idx);
+    return false;
+  }
+
+  summary.id       = entry->id;
+  summary.title    = entry->title.c_str();
+  summary.author   = (entry->db_index == BooksIndex::NO_DB_INDEX) ?
+                       "(Retrieving metadata...)" : entry->author.c_str();
+  summary.filename = entry->filename.c_str();
+
+  return true;
+}
+
+bool
+BooksDir::get_book_summary_from_id(uint32_t id, BookSummary & summary)
+{
+  std::scoped_lock guard(mutex);
+
+  int16_t entry_idx = index.entry_index_of_id(id);
+
+  if (entry_idx == -1) {
+    LOG_E("Unable to find id: 0x%08x", id);
+    return false;
+  }
+
+  const BooksIndex::Entry & entry = index.get_entry(entry_idx);
+
+  summary.id       = entry.id;
+  summary.title    = entry.title.c_str();
+  summary.author   = entry.author.c_str();
+  summary.filename = entry.filename.c_str();
+
+  return true;
+}
+
+const BooksDir::CoverRecord *
+BooksDir::get_cover(uint16_t idx)
+{
+  const BooksIndex::Entry * entry = index.at(idx);
+
+  if (entry == nullptr) {
+    LOG_E("Unable to find idx: %d", idx);
+    return nullptr;
+  }
+
+  uint32_t id = entry->id;
+
+  const CoverRecord * cover = (const CoverRecord *) cover_cache.get(id);
+  if (cover != nullptr) return cover;
+
+  if (!covers_indexed) index_covers();
+
+  CoverRecord * new_cover = (CoverRecord *) cover_cache.make_room(id);
+  if (new_cover == nullptr) return nullptr;
+
+  auto it = cover_index.find(id);
+  if (it != cover_index.end()) {
+    covers_db.set_current_idx(it->second);
+    if (covers_db.get_record(new_cover, sizeof(CoverRecord))) return new_cover;
+    LOG_E("Unable to get cover at index %d", it->second);
+  }
+
+  new_cover->id           = id;
+  new_cover->cover_width  = default_cover_width;
+  new_cover->cover_height = default_cover_height;
+  memcpy(new_cover->cover_bitmap, default_cover, default_cover_width * default_cover_height);
+  dither_cover(*new_cover);
+
+  return new_cover;
+}
+
 const BooksDir::EBookRecord * 
 BooksDir::get_book_data(uint16_t idx)
 {
-  if (idx >= sorted_index.size()) {
+  const BooksIndex::Entry * entry = index.at(idx);
+
+  if (entry == nullptr) {
     LOG_E("Idx too large: %d", idx);
     return nullptr;
   }
 
-  int i = 0;
-  int16_t index = -1;
-
-  for (auto & entry : sorted_index) {
-    if (idx == i) { index = entry.second.db_index; break; }
-    i++;
-  }
-  if (index == -1) {
-    LOG_E("Unable to find idx: %d", idx);
+  if (entry->db_index == BooksIndex::NO_DB_INDEX) {
+    LOG_D("Book at idx %d not retrieved yet", idx);
     return nullptr;
   }
 
-  db.set_current_idx(index);
+  db.set_current_idx(entry->db_index);
 
   if (!db.get_record(&book, sizeof(EBookRecord))) {
-    LOG_E("Unable to get record at index %d", index);
+    LOG_E("Unable to get record at index %d", entry->db_index);
     return nullptr;
   }
 
@@ -242,36 +638,29 @@ BooksDir::get_book_data(uint16_t idx)
 bool
 BooksDir::get_book_id(uint16_t idx, uint32_t & id)
 {
-  if (idx >= sorted_index.size()) {
+  const BooksIndex::Entry * entry = index.at(idx);
+
+  if (entry == nullptr) {
     LOG_E("Idx too large: %d", idx);
     return false;
   }
 
-  int i = 0;
-  bool found = false;
-
-  for (auto & entry : sorted_index) {
-    if (idx == i) { id = entry.second.id; found = true; break; }
-    i++;
-  }
-  if (!found) LOG_E("Unable to find idx: %d", idx);
-
-  return found;
+  id = entry->id;
+  return true;
 }
 
 bool
 BooksDir::get_book_index(uint32_t id, uint16_t & idx)
 {
-  int  i     = 0;
-  bool found = false;
+  int16_t pos = index.position_of_id(id);
 
-  for (auto & entry : sorted_index) {
-    if (entry.second.id == id) { idx = i; found = true; break; }
-    i++;
+  if (pos < 0) {
+    LOG_E("Unable to find id: 0x%08x", id);
+    return false;
   }
-  if (!found) LOG_E("Unable to find id: 0x%08x", id);
 
-  return found;
+  idx = pos;
+  return true;
 }
 
 void
@@ -281,30 +670,13 @@ BooksDir::set_track_order(uint32_t id, int8_t pos)
   if (no_recurse) return;
 
   LOG_D("-------------------------> set_track_order(%u, %d)", id, pos);
-  bool found = false;
-
-  for (auto & entry : sorted_index) {
-    if (entry.second.id == id) {
-      char ch = (pos >= 0) ? 'a' + pos : 'z';
-      LOG_D("Old key: %s", entry.first.c_str());
-      if (entry.first.front() != ch) {
-        auto e = sorted_index.extract(entry.first);
-        e.key().front() = ch;
-        LOG_D("New key: %s", e.key().c_str());
-        sorted_index.insert(std::move(e));
-      }
-      found = true;
-      break;
-    }
-  }
-
-  #if EPUB_INKPLATE_BUILD
-    if (!found) {
+  if (!index.set_track_pos(id, pos)) {
+    #if EPUB_INKPLATE_BUILD
       no_recurse = true;
       nvs_mgr.erase(id);
       no_recurse = false;
-    }
-  #endif
+    #endif
+  }
 }
 
 const BooksDir::EBookRecord * 
@@ -322,338 +694,402 @@ BooksDir::get_book_data_from_db_index(uint16_t idx)
   return &book;
 }
 
+void
+BooksDir::queue_missing_covers()
+{
+  for (uint16_t i = 0; i < index.get_entry_count(); i++) {
+    const BooksIndex::Entry & entry = index.get_entry(i);
+    if ((entry.db_index != BooksIndex::NO_DB_INDEX) &&
+        (cover_index.find(entry.id) == cover_index.end())) {
+      pending.push_back(entry.id);
+    }
+  }
+}
+
+bool
+BooksDir::add_new_books(const std::set<std::string> & known_files)
+{
+  struct dirent * de       = nullptr;
+  DIR           * dp       = nullptr;
+
+  uint16_t count = index.get_entry_count();
+
+  LOG_D("Looking at book files in folder %s", BOOKS_FOLDER);
+
+  dp = opendir(BOOKS_FOLDER);
+
+  if (dp != nullptr) {
+
+    while ((de = readdir(dp))) {
+
+      int16_t size = strlen(de->d_name);
+      if ((size > 5) && (strcasecmp(&de->d_name[size - 5], ".epub") == 0)) {
+
+        std::string fname = de->d_name;
+
+        // check if ebook file named fname is in the database
+
+        if (known_files.find(fname) == known_files.end()) {
+
+          LOG_D("New book found: %s", de->d_name);
+
+          fname = BOOKS_FOLDER "/";
+          fname.append(de->d_name);
+
+          struct stat stat_buffer;
+          if (stat(fname.c_str(), &stat_buffer) != 0) {
+            LOG_E("Unable to get stats for file: %s", fname.c_str());
+            continue;
+          }
+
+          char filename[FILENAME_SIZE];
+          strlcpy(filename, de->d_name, FILENAME_SIZE);
+          uint32_t id = generate_id((uint8_t *) filename, strlen(filename));
+
+          index.add({
+            .id        = id,
+            .db_index  = BooksIndex::NO_DB_INDEX,
+            .file_size = (int32_t) stat_buffer.st_size,
+            .added     = (uint32_t) stat_buffer.st_mtime,
+            #if EPUB_INKPLATE_BUILD
+              .track_pos = nvs_mgr.get_pos(id),
+            #else
+              .track_pos = -1,
+            #endif
+            .filename  = filename,
+            .title     = std::string(filename, strlen(filename) - 5),
+            .author    = "" });
+
+          pending.push_back(id);
+        }
+      }
+    }
+
+    closedir(dp);
+  }
+
+  return index.get_entry_count() != count;
+}
+
 bool
-BooksDir::refresh(char * book_filename, int16_t & book_index, bool force_init)
+BooksDir::refresh(char * book_filename, int16_t & book_index, bool force_init, bool background)
 {
   //  First look if existing entries in the database exists as ebook.
   //  Build a list of filenames for next step.
 
   LOG_D("Refreshing database content");
 
-  EBookRecord   * the_book = nullptr;
-  struct dirent * de       = nullptr;
-  DIR           * dp       = nullptr;
-  bool            first    = true;
+  std::set<std::string> temp_index;
 
-  SortedIndex     temp_index;
+  pending.clear();
+  verify_state = VerifyState::NONE;
 
-  bool some_added_record = false;
+  // The stamp is taken before reading the folder: a change made while
+  // reading will be seen at the next start.
 
-  sorted_index.clear();
+  uint32_t stamp;
+  if (!get_folder_stamp(stamp)) stamp = 0;
+  if (stamp != index.get_folder_stamp()) invalidate_index();
 
   if (force_init) {
     // Remove all records
+    invalidate_index();
+    release_search_index();
+    remove(SEARCH_FILE);
+    search_outdated = true;
+    index.clear();
     db.goto_first();
     while (db.goto_next()) {
       db.set_deleted();
     }
   }
   else {
-    struct PartialRecord {
-      char     filename[FILENAME_SIZE];
-      int32_t  file_size;
-      uint32_t id;
-      char     title[TITLE_SIZE];
-    } * partial_record = (PartialRecord *) allocate(sizeof(PartialRecord));
-
-    if (partial_record == nullptr) msg_viewer.out_of_memory("partial record allocation");
+    if (!index_file_valid) {
+
+      // Everything but the description. The title and author are kept in
+      // the index for the books list.
+      struct PartialRecord {
+        char     filename[FILENAME_SIZE];
+        int32_t  file_size;
+        uint32_t id;
+        char     title[TITLE_SIZE];
+        char     author[AUTHOR_SIZE];
+      } * partial_record = (PartialRecord *) allocate(sizeof(PartialRecord));
     
-    db.goto_first(); // Go pass the DB version record
+      if (partial_record == nullptr) msg_viewer.out_of_memory("partial record allocation");
+
+      index.clear();
+      db.goto_first(); // Go pass the DB version record
+
+      while (db.goto_next()) {
+        db.get_record(partial_record, sizeof(PartialRecord));
+        index.add({
+          .id        = partial_record->id,
+          .db_index  = (uint16_t) db.get_current_idx(),
+          .file_size = partial_record->file_size,
+          .added     = 0,
+          .track_pos = -1,
+          .filename  = partial_record->filename,
+          .title     = partial_record->title,
+          .author    = partial_record->author });
+      }
 
-    while (db.goto_next()) {
-      db.get_record(partial_record, sizeof(PartialRecord));
+      free(partial_record);
+    }
 
-      std::string fname = BOOKS_FOLDER "/";
-      fname.append(partial_record->filename);
+    for (int16_t i = index.get_entry_count() - 1; i >= 0; i--) {
+      if (verify_entry(i)) {
+        BooksIndex::Entry & entry = index.get_entry(i);
 
-      struct stat stat_buffer;   
-
-      // if file with filename not found or the file size is not the same, 
-      // remove the database entry
-      if ((stat(fname.c_str(), &stat_buffer) != 0) || 
-          (stat_buffer.st_size != partial_record->file_size)) {
-        LOG_D("Book no longer available: %s", partial_record->filename);
-        db.set_deleted();
-      }
-      else {
-        LOG_D("Title: %s", partial_record->title);
-        temp_index[partial_record->filename] = IndexInfo { 
-          .id = 0, 
-          .db_index = 0 }; 
+        LOG_D("Title: %s", entry.title.c_str());
+        temp_index.insert(entry.filename);
 
         #if EPUB_INKPLATE_BUILD
-          int8_t pos = nvs_mgr.get_pos(partial_record->id);
-          std::string title = " ";
-          title += partial_record->title;
-          title.front() = (pos >= 0) ? 'a' + pos : 'z';
+          int8_t pos = nvs_mgr.get_pos(entry.id);
         #else
-          std::string title = "z";
-          title += partial_record->title;
+          int8_t pos = -1;
         #endif
 
-        sorted_index[title] = IndexInfo {
-          .id      = partial_record->id,
-          .db_index = db.get_current_idx() };
+        if (entry.track_pos != pos) {
+          invalidate_index();
+          entry.track_pos = pos;
+        }
+
+        // Placeholder of a previous refresh not completed yet
+        if (entry.db_index == BooksIndex::NO_DB_INDEX) pending.push_back(entry.id);
+
         if (book_filename) {
-          if (strcmp(book_filename, partial_record->filename) == 0) book_index = db.get_current_idx();
+          if (strcmp(book_filename, entry.filename.c_str()) == 0) book_index = entry.db_index;
         }
       }
     }
-    
-    free(partial_record);
   }
 
-  if (db.is_some_record_deleted()) {
+  // The space of deleted records is reused by the new ones, and reclaimed
+  // while the device is idle (see compact_step()).
 
-    // Some record have been deleted. We have to recreate a database
-    // with the cleaned records
+  index_covers();
 
-    SimpleDB * new_db = new SimpleDB;
-    sorted_index.clear();
+  // Books already in the database with no cover record (the covers database
+  // was lost, or its record format changed): the covers are built again from
+  // the books files. The meta-data is not retrieved again.
 
-    if (new_db->create(NEW_DIR_FILE)) {
-      if (!db.goto_first()) {
-        LOG_E("db.goto_first() failed");
-        goto error_clear;
-      }
-      bool first = true;
-      do {
-        int32_t size = db.get_record_size();
-        if (size <= 0) {
-          LOG_E("Unable to get proper record size: %d from db", size);
-          goto error_clear;
-        }
-        EBookRecord * data = (EBookRecord *) allocate(size);
-        if (data == nullptr) {
-          LOG_E("Unable to allocate %d bytes for ebook record", size);
-          goto error_clear;
-        }
-        if (!db.get_record(data, size)) { 
-          LOG_E("Unable to get record of size %d from db", size);
-          free(data); 
-          goto error_clear; 
-        }
-        if (!new_db->add_record(data, size)) {
-          LOG_E("Unable to add record to db");
-          free(data); 
-          goto error_clear; 
-        }
-        if (!first) {
-          uint16_t idx = new_db->get_record_count() - 1;
-          #if EPUB_INKPLATE_BUILD
-            int8_t pos = nvs_mgr.get_pos(data->id);
-            std::string title = " ";
-            title += data->title;
-            title.front() = (pos >= 0) ? 'a' + pos : 'z';
-          #else
-            std::string title = "z";
-            title += data->title;
-          #endif
-          sorted_index[title] = IndexInfo {
-            .id       = data->id,
-            .db_index = idx };
-          if (book_filename) {
-            if (strcmp(book_filename, data->filename) == 0) book_index = new_db->get_record_count() - 1;
-          }
-        }
-        first = false;
-        free(data);
-      } while (db.goto_next());
+  queue_missing_covers();
 
-      db.close();
-      new_db->close();
+  // Find ebooks that are new since last database refresh. They are added to
+  // the index as placeholders, their meta-data being retrieved by refresh_step().
 
-      delete new_db;
-      if (remove(BOOKS_DIR_FILE)) {
-        LOG_E("Unable to remove directory DB file."); 
-        goto error_clear;
-      }
-      if (rename(NEW_DIR_FILE, BOOKS_DIR_FILE)) {
-        LOG_E("Unable to rename new directory DB file");
-        goto error_clear;
-      }
-      if (!db.open(BOOKS_DIR_FILE)) {
-        LOG_E("Inable to open directory DB File.");
-        goto error_clear;
-      }
+  add_new_books(temp_index);
+
+  temp_index.clear();
+  index.sort();
+  index.set_folder_stamp(stamp);
+
+  if (!background && !pending.empty()) {
+    if (force_init) {
+      msg_viewer.show(MsgViewer::MsgType::INFO, false, true,
+        "E-books metadata retrieval",
+        "System parameters changed requiring metadata retrieval. "
+        "It will take between 5 and 10 seconds for each book.");
+    }
+    else {
+      msg_viewer.show(MsgViewer::MsgType::INFO, false, true,
+        "New e-books metadata retrieval",
+        "New e-books have been found. Please wait while we retrieve some metadata. "
+        "It will take between 5 and 10 seconds for each e-book.");
     }
+    while (refresh_step());
   }
 
-  // Find ebooks that are new since last database refresh
+  if (pending.empty()) {
+    if (!index_file_valid) index_file_valid = index.save(INDEX_FILE, db.get_record_count());
+    update_search_index();
+  }
 
-  LOG_D("Looking at book files in folder %s", BOOKS_FOLDER);
- 
-  #if EPUB_INKPLATE_BUILD && (LOG_LOCAL_LEVEL == ESP_LOG_VERBOSE)
-    ESP::show_heaps_info();
-  #endif
-  
-  dp = opendir(BOOKS_FOLDER);
+  return true;
+}
 
-  if (dp != nullptr) {
+bool
+BooksDir::retrieve_book(uint32_t id)
+{
+  int16_t entry_idx = index.entry_index_of_id(id);
+  if (entry_idx == -1) return false;
 
-    while ((de = readdir(dp))) {
+  EPubProbe   probe;
+  std::string fname = BOOKS_FOLDER "/";
+  fname.append(index.get_entry(entry_idx).filename);
 
-      int16_t size = strlen(de->d_name);
-      if ((size > 5) && (strcasecmp(&de->d_name[size - 5], ".epub") == 0)) {
+  LOG_D("Retrieving metadata of: %s", fname.c_str());
 
-        std::string fname = de->d_name;
+  if (!probe.open_file(fname)) {
+    // Not a book this application can show: the placeholder is removed. It
+    // will be tried again at the next refresh.
+    if (index.get_entry(entry_idx).db_index == BooksIndex::NO_DB_INDEX) {
+      index.remove(entry_idx);
+      index.sort();
+    }
+    return false;
+  }
 
-        // check if ebook file named fname is in the database
+  bool result = false;
+  BooksIndex::Entry & entry = index.get_entry(entry_idx);
 
-        if (temp_index.find(fname) == temp_index.end()) {
-
-          // The book is not in the database, we add it now
-
-          if (first) {
-            first = false;
-            //msg_viewer.show_progress("Computing new books pages location...");
-            if (force_init) {
-              msg_viewer.show(MsgViewer::MsgType::INFO, false, true, 
-                "E-books metadata retrieval", 
-                "System parameters changed requiring metadata retrieval. "
-                "It will take between 5 and 10 seconds for each book.");
-            }
-            else {
-              msg_viewer.show(MsgViewer::MsgType::INFO, false, true, 
-                "New e-books metadata retrieval", 
-                "New e-books have been found. Please wait while we retrieve some metadata. "
-                "It will take between 5 and 10 seconds for each e-book.");
-            }
-          }
-          some_added_record = true;
-          
-          LOG_D("New book found: %s", de->d_name);
+  if (entry.db_index != BooksIndex::NO_DB_INDEX) {
+    result = add_cover(id, probe);
+  }
+  else {
+    EBookRecord * the_book = (EBookRecord *) allocate(sizeof(EBookRecord));
 
-          fname = BOOKS_FOLDER "/";
-          fname.append(de->d_name);
+    if (the_book == nullptr) {
+      LOG_E("Not enough memory for new book: %d bytes required.", sizeof(EBookRecord));
+      return false;
+    }
 
-          int32_t file_size = 0;
-          struct  stat stat_buffer;
-          if (stat(fname.c_str(), &stat_buffer) != 0) {
-            LOG_E("Unable to get stats for file: %s", fname.c_str());
-            goto error_clear;
-          }
-          else {
-            file_size = stat_buffer.st_size;
-          }
-        
-          LOG_D("Opening file through the EPub class: %s", fname.c_str());
-
-          if (epub.open_file(fname)) {
-            const char * str;
-
-            the_book = (EBookRecord *) allocate(sizeof(EBookRecord));
-            
-            if (the_book == nullptr) {
-              LOG_E("Not enough memory for new book: %d bytes required.", sizeof(EBookRecord));
-              goto error_clear;
-            }
-
-            memset(the_book, 0, sizeof(EBookRecord));
-
-            LOG_D("Retrieving metadata and cover");
-            strlcpy(the_book->filename, de->d_name, FILENAME_SIZE);
-            the_book->file_size = file_size;
-            the_book->id        = generate_id((uint8_t *)the_book->filename, strlen(the_book->filename));
-
-            if ((str =       epub.get_title())) strlcpy(the_book->title,       str, TITLE_SIZE      );
-            if ((str =      epub.get_author())) strlcpy(the_book->author,      str, AUTHOR_SIZE     );
-            if ((str = epub.get_description())) strlcpy(the_book->description, str, DESCRIPTION_SIZE);
-
-            std::string filename = epub.get_cover_filename();
-
-            if (!filename.empty()) {
-
-              // LOG_D("Cover filename: %s", filename);
-              Image * img = epub.get_image(filename, true);
-              if (img == nullptr) {
-                LOG_D("Unable to retrieve cover file: %s", filename.c_str());
-                memcpy(the_book->cover_bitmap, default_cover, default_cover_width * default_cover_height);
-                the_book->cover_width     = default_cover_width;
-                the_book->cover_height    = default_cover_height;
-              }
-              else {
-                LOG_D("Image: width: %d height: %d", img->get_dim().width, img->get_dim().height);
-
-                int32_t w = max_cover_width;
-                int32_t h = img->get_dim().height * max_cover_width / img->get_dim().width;
-
-                if (h > max_cover_height) {
-                  h = max_cover_height;
-                  w = img->get_dim().width * max_cover_height / img->get_dim().height;
-                }
-
-                img->resize(Dim(w, h));
-                memcpy(the_book->cover_bitmap, img->get_bitmap(), w * h);
-
-                the_book->cover_width     = w;
-                the_book->cover_height    = h;
-
-                delete img;
-              }
-            }
-            else {
-              memcpy(the_book->cover_bitmap, default_cover, default_cover_width * default_cover_height);
-              the_book->cover_width     = default_cover_width;
-              the_book->cover_height    = default_cover_height;
-            }
-        
-            if (!db.add_record(the_book, sizeof(EBookRecord))) {
-              LOG_E("Unable to add a new record to DB file.");
-              goto error_clear;
-            }
-
-            uint16_t idx = db.get_record_count() - 1;
-            #if EPUB_INKPLATE_BUILD
-              int8_t pos = nvs_mgr.get_pos(the_book->id);
-              std::string title = " ";
-              title += the_book->title;
-              title.front() = (pos >= 0) ? 'a' + pos : 'z';
-            #else
-              std::string title = "z";
-              title += the_book->title;
-            #endif
-            sorted_index[title] = {
-              .id       = the_book->id,
-              .db_index = idx };
+    memset(the_book, 0, sizeof(EBookRecord));
 
-            if (book_filename) {
-              if (strcmp(book_filename, the_book->filename) == 0) book_index = db.get_record_count() - 1;
-            }
+    strlcpy(the_book->filename,    entry.filename.c_str(),          FILENAME_SIZE   );
+    strlcpy(the_book->title,       probe.get_title().c_str(),       TITLE_SIZE      );
+    strlcpy(the_book->author,      probe.get_author().c_str(),      AUTHOR_SIZE     );
+    strlcpy(the_book->description, probe.get_description().c_str(), DESCRIPTION_SIZE);
+    the_book->file_size = entry.file_size;
+    the_book->id        = id;
 
-            epub.close_file();
-            free(the_book);
+    invalidate_index();
 
-            the_book = nullptr;
+    // Each book is committed to the database as soon as it is retrieved: an
+    // interrupted refresh is resumed at the next start.
 
-            #if EPUB_INKPLATE_BUILD && (LOG_LOCAL_LEVEL == ESP_LOG_VERBOSE)
-              ESP::show_heaps_info();
-            #endif
-          }
-        }
-      }
+    if (add_cover(id, probe) && db.add_record(the_book, sizeof(EBookRecord))) {
+      entry.db_index = db.get_added_idx();
+      entry.title    = the_book->title;
+      entry.author   = the_book->author;
+      index.sort();
+      search_outdated = true;
+      result = true;
+    }
+    else {
+      LOG_E("Unable to add a new record to DB file.");
     }
 
-    if (the_book) free(the_book);
-    closedir(dp);
+    free(the_book);
   }
 
-  temp_index.clear();
-  if (some_added_record) {
+  probe.close_file();
+  return result;
+}
+
+bool
+BooksDir::refresh_step()
+{
+  std::scoped_lock guard(mutex);
+
+  if (pending.empty()) return false;
+
+  uint32_t id = pending.front();
+  pending.pop_front();
+
+  retrieve_book(id);
+
+  if (pending.empty()) {
     db.close(); // To ensure that data is well written on SD Card
-    if (!db.open(BOOKS_DIR_FILE)) {
-       LOG_E("Unable to open db file");
-       return false;
+    covers_db.close();
+    if (!db.open(BOOKS_DIR_FILE) || !open_covers(false)) {
+      LOG_E("Unable to open db files");
+      return true;
     }
+    index_covers();
+    if (!index_file_valid) index_file_valid = index.save(INDEX_FILE, db.get_record_count());
+    update_search_index();
   }
 
   return true;
+}
 
-error_clear:
-  temp_index.clear();
-  if (dp) closedir(dp);
-  if (the_book) free(the_book);
-  return false;
+bool
+BooksDir::verify_step(bool & list_changed)
+{
+  std::scoped_lock guard(mutex);
+
+  list_changed = false;
+
+  switch (verify_state) {
+    case VerifyState::NONE:
+      return false;
+
+    case VerifyState::COVERS:
+      if (!covers_indexed) index_covers();
+      queue_missing_covers();
+      verify_idx   = index.get_entry_count();
+      verify_state = VerifyState::FILES;
+      break;
+
+    case VerifyState::FILES:
+      // From the end, such that removing an entry is not moving the ones
+      // still to be verified.
+
+      for (uint8_t count = 0; (count < VERIFY_BATCH_SIZE) && (verify_idx > 0); count++) {
+        verify_idx--;
+        if (!verify_entry(verify_idx)) list_changed = true;
+      }
+      if (list_changed) index.sort();
+      if (verify_idx == 0) verify_state = VerifyState::FOLDER;
+      break;
+
+    case VerifyState::FOLDER:
+      {
+        uint32_t stamp;
+        if (!get_folder_stamp(stamp)) stamp = 0;
+
+        std::set<std::string> known_files;
+        for (uint16_t i = 0; i < index.get_entry_count(); i++) {
+          known_files.insert(index.get_entry(i).filename);
+        }
+
+        if (add_new_books(known_files)) {
+          list_changed = true;
+          index.sort();
+        }
+
+        verify_state = VerifyState::NONE;
+
+        if (stamp != index.get_folder_stamp()) {
+          index.set_folder_stamp(stamp);
+          invalidate_index();
+        }
+
+        // If new books were found, the index is saved once they are retrieved
+        if (pending.empty()) {
+          if (!index_file_valid) index_file_valid = index.save(INDEX_FILE, db.get_record_count());
+          update_search_index();
+        }
+      }
+      break;
+  }
+
+  return true;
+}
+
+bool
+BooksDir::is_placeholder(uint16_t idx) const
+{
+  const BooksIndex::Entry * entry = index.at(idx);
+  return (entry != nullptr) && (entry->db_index == BooksIndex::NO_DB_INDEX);
+}
+
+int16_t
+BooksDir::retrieve_now(uint16_t idx)
+{
+  const BooksIndex::Entry * entry = index.at(idx);
+  if (entry == nullptr) return -1;
+
+  uint32_t id = entry->id;
+  if (entry->db_index == BooksIndex::NO_DB_INDEX) {
+    auto it = std::find(pending.begin(), pending.end(), id);
+    if (it != pending.end()) pending.erase(it);
+    retrieve_book(id);
+  }
+
+  return index.position_of_id(id);
 }
 
 void
@@ -679,9 +1115,7 @@ BooksDir::show_db()
         << "  id: "          << book.id              << std::endl
         << "  title: "       << book.title           << std::endl
         << "  author: "      << book.author          << std::endl
-        << "  description: " << book.description     << std::endl
-        << "  bitmap size: " << +book.cover_width 
-        << " "               << +book.cover_height   << std::endl;
+        << "  description: " << book.description     << std::endl;
     }
   #endif
 }
\ No newline at end of file
@@ -0,0 +1,325 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#include "models/books_index.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+
+static uint32_t
+checksum(const uint8_t * data, uint32_t size)
+{
+  uint32_t hash = 2166136261UL;  // FNV-1a
+  while (size--) {
+    hash ^= *data++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+void
+BooksIndex::clear()
+{
+  entries.clear();
+  for (auto & o : orders) o.clear();
+  positions.clear();
+  id_map.clear();
+  folder_stamp = 0;
+}
+
+void
+BooksIndex::remove(uint16_t entry_idx)
+{
+  if (entry_idx < entries.size()) entries.erase(entries.begin() + entry_idx);
+}
+
+void
+BooksIndex::sort(SortOrder the_order)
+{
+  std::vector<uint16_t> & o = orders[(uint8_t) the_order];
+
+  o.resize(entries.size());
+  for (uint16_t i = 0; i < o.size(); i++) o[i] = i;
+
+  auto by_title = [this](uint16_t a, uint16_t b) {
+    int res = strcasecmp(entries[a].title.c_str(), entries[b].title.c_str());
+    return (res != 0) ? (res < 0) : (entries[a].id < entries[b].id);
+  };
+
+  switch (the_order) {
+    case SortOrder::TITLE:
+      std::sort(o.begin(), o.end(), by_title);
+      break;
+
+    case SortOrder::AUTHOR:
+      std::sort(o.begin(), o.end(), [this, by_title](uint16_t a, uint16_t b) {
+        int res = strcasecmp(entries[a].author.c_str(), entries[b].author.c_str());
+        return (res != 0) ? (res < 0) : by_title(a, b);
+      });
+      break;
+
+    case SortOrder::RECENTLY_READ:
+      // Books being read first, the last one read at the top, then the others by title
+      std::sort(o.begin(), o.end(), [this, by_title](uint16_t a, uint16_t b) {
+        uint8_t pos_a = (uint8_t) entries[a].track_pos; // -1 becomes 255
+        uint8_t pos_b = (uint8_t) entries[b].track_pos;
+        return (pos_a != pos_b) ? (pos_a < pos_b) : by_title(a, b);
+      });
+      break;
+
+    case SortOrder::ADDED:
+      std::sort(o.begin(), o.end(), [this, by_title](uint16_t a, uint16_t b) {
+        return (entries[a].added != entries[b].added) ?
+                  (entries[a].added > entries[b].added) : by_title(a, b);
+      });
+      break;
+  }
+}
+
+void
+BooksIndex::compute_positions()
+{
+  const std::vector<uint16_t> & o = orders[(uint8_t) order];
+
+  positions.resize(o.size());
+
+  if (filtered) {
+    view.clear();
+    for (uint16_t pos = 0; pos < o.size(); pos++) {
+      if (std::binary_search(filter_ids.begin(), filter_ids.end(), entries[o[pos]].id)) {
+        positions[o[pos]] = view.size();
+        view.push_back(o[pos]);
+      }
+      else {
+        positions[o[pos]] = NO_POSITION;
+      }
+    }
+  }
+  else {
+    for (uint16_t pos = 0; pos < o.size(); pos++) positions[o[pos]] = pos;
+  }
+}
+
+void
+BooksIndex::set_filter(const std::vector<uint32_t> & ids)
+{
+  filter_ids = ids;
+  std::sort(filter_ids.begin(), filter_ids.end());
+  filtered = true;
+  compute_positions();
+}
+
+void
+BooksIndex::clear_filter()
+{
+  if (!filtered) return;
+
+  filter_ids.clear();
+  view.clear();
+  filtered = false;
+  compute_positions();
+}
+
+void
+BooksIndex::sort()
+{
+  for (uint8_t i = 0; i < SORT_ORDER_COUNT; i++) sort((SortOrder) i);
+
+  id_map.clear();
+  id_map.reserve(entries.size());
+  for (uint16_t i = 0; i < entries.size(); i++) id_map[entries[i].id] = i;
+
+  compute_positions();
+}
+
+void
+BooksIndex::set_sort_order(SortOrder the_order)
+{
+  if (the_order == order) return;
+  order = the_order;
+  compute_positions();
+}
+
+int16_t
+BooksIndex::position_of_id(uint32_t id) const
+{
+  auto it = id_map.find(id);
+  if ((it == id_map.end()) || (it->second >= positions.size())) return -1;
+  return (positions[it->second] == NO_POSITION) ? -1 : positions[it->second];
+}
+
+int16_t
+BooksIndex::entry_index_of_id(uint32_t id) const
+{
+  auto it = id_map.find(id);
+  return (it == id_map.end()) ? -1 : it->second;
+}
+
+int16_t
+BooksIndex::position_of_db_index(uint16_t db_index) const
+{
+  for (uint16_t i = 0; i < positions.size(); i++) {
+    if (entries[i].db_index == db_index) return (positions[i] == NO_POSITION) ? -1 : positions[i];
+  }
+  return -1;
+}
+
+bool
+BooksIndex::set_track_pos(uint32_t id, int8_t pos)
+{
+  auto it = id_map.find(id);
+  if (it == id_map.end()) return false;
+
+  if (entries[it->second].track_pos != pos) {
+    entries[it->second].track_pos = pos;
+    sort(SortOrder::RECENTLY_READ);
+    if (order == SortOrder::RECENTLY_READ) compute_positions();
+  }
+  return true;
+}
+
+bool
+BooksIndex::save(const std::string & filename, uint32_t db_record_count) const
+{
+  std::vector<uint8_t> data;
+  uint32_t             count = orders[0].size();  // The filter is not saved
+
+  for (auto & idx : orders[0]) {
+    const Entry & e = entries[idx];
+    EntryHeader   h = {
+      .id            = e.id,
+      .db_index      = e.db_index,
+      .file_size     = e.file_size,
+      .added         = e.added,
+      .track_pos     = e.track_pos,
+      .filename_size = (uint8_t) std::min<size_t>(e.filename.size(), 255),
+      .title_size    = (uint8_t) std::min<size_t>(e.title.size(),    255),
+      .author_size   = (uint8_t) std::min<size_t>(e.author.size(),   255)
+    };
+    data.insert(data.end(), (uint8_t *) &h, (uint8_t *) (&h + 1));
+    data.insert(data.end(), e.filename.begin(), e.filename.begin() + h.filename_size);
+    data.insert(data.end(), e.title.begin(),    e.title.begin()    + h.title_size   );
+    data.insert(data.end(), e.author.begin(),   e.author.begin()   + h.author_size  );
+  }
+
+  // Entries are saved in the order of the first sort order: positions are
+  // translated accordingly.
+
+  std::vector<uint16_t> saved_idx(entries.size());
+  for (uint16_t pos = 0; pos < count; pos++) saved_idx[orders[0][pos]] = pos;
+
+  for (auto & o : orders) {
+    for (auto & idx : o) {
+      uint16_t i = saved_idx[idx];
+      data.insert(data.end(), (uint8_t *) &i, (uint8_t *) (&i + 1));
+    }
+  }
+
+  Header header = {
+    .magic           = { 'B', 'I', 'D', 'X' },
+    .version         = VERSION,
+    .db_record_count = db_record_count,
+    .entry_count     = count,
+    .folder_stamp    = folder_stamp,
+    .checksum        = checksum(data.data(), data.size())
+  };
+
+  FILE * f = fopen(filename.c_str(), "wb");
+  if (f == nullptr) {
+    LOG_E("Unable to create %s", filename.c_str());
+    return false;
+  }
+
+  bool ok = (fwrite(&header, sizeof(Header), 1, f) == 1) &&
+            (data.empty() || (fwrite(data.data(), data.size(), 1, f) == 1));
+  fclose(f);
+
+  if (!ok) {
+    LOG_E("Unable to write %s", filename.c_str());
+    ::remove(filename.c_str());
+  }
+  return ok;
+}
+
+bool
+BooksIndex::load(const std::string & filename, uint32_t db_record_count)
+{
+  clear();
+
+  FILE * f = fopen(filename.c_str(), "rb");
+  if (f == nullptr) return false;
+
+  Header               header;
+  std::vector<uint8_t> data;
+  bool                 ok = false;
+
+  if ((fread(&header, sizeof(Header), 1, f) == 1) &&
+      (memcmp(header.magic, "BIDX", 4) == 0) &&
+      (header.version         == VERSION) &&
+      (header.db_record_count == db_record_count)) {
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f) - sizeof(Header);
+    if (size >= (long) (header.entry_count * SORT_ORDER_COUNT * sizeof(uint16_t))) {
+      data.resize(size);
+      fseek(f, sizeof(Header), SEEK_SET);
+      ok = data.empty() || (fread(data.data(), size, 1, f) == 1);
+      ok = ok && (checksum(data.data(), data.size()) == header.checksum);
+    }
+  }
+  fclose(f);
+
+  if (!ok) {
+    LOG_D("Books index not valid: %s", filename.c_str());
+    return false;
+  }
+
+  const uint8_t * p   = data.data();
+  const uint8_t * end = p + data.size() - (header.entry_count * SORT_ORDER_COUNT * sizeof(uint16_t));
+
+  entries.reserve(header.entry_count);
+  for (uint32_t i = 0; i < header.entry_count; i++) {
+    EntryHeader h;
+    if ((p + sizeof(EntryHeader)) > end) break;
+    memcpy(&h, p, sizeof(EntryHeader));
+    p += sizeof(EntryHeader);
+    if ((p + h.filename_size + h.title_size + h.author_size) > end) break;
+    Entry e = {
+      .id        = h.id,
+      .db_index  = h.db_index,
+      .file_size = h.file_size,
+      .added     = h.added,
+      .track_pos = h.track_pos,
+      .filename  = std::string((const char *) p, h.filename_size),
+      .title     = std::string((const char *) p + h.filename_size, h.title_size),
+      .author    = std::string((const char *) p + h.filename_size + h.title_size, h.author_size)
+    };
+    p += h.filename_size + h.title_size + h.author_size;
+    entries.push_back(std::move(e));
+  }
+
+  if ((entries.size() != header.entry_count) || (p != end)) {
+    clear();
+    return false;
+  }
+
+  for (auto & o : orders) {
+    o.resize(header.entry_count);
+    if (header.entry_count > 0) memcpy(o.data(), p, header.entry_count * sizeof(uint16_t));
+    p += header.entry_count * sizeof(uint16_t);
+    for (auto & idx : o) {
+      if (idx >= header.entry_count) { clear(); return false; }
+    }
+  }
+
+  id_map.clear();
+  id_map.reserve(entries.size());
+  for (uint16_t i = 0; i < entries.size(); i++) id_map[entries[i].id] = i;
+
+  folder_stamp = header.folder_stamp;
+
+  compute_positions();
+  return true;
+}
@@ -0,0 +1,239 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "models/books_index.hpp"
+
+#include <cstdio>
+#include <string>
+
+static const std::string INDEX_FILENAME = "/tmp/books_index_test.idx";
+
+static BooksIndex::Entry
+entry(uint32_t id, const char * title, const char * author, uint32_t added, int8_t track_pos = -1)
+{
+  return BooksIndex::Entry {
+    .id        = id,
+    .db_index  = (uint16_t) (id + 100),
+    .file_size = (int32_t) (id * 1000),
+    .added     = added,
+    .track_pos = track_pos,
+    .filename  = std::string("book_") + std::to_string(id) + ".epub",
+    .title     = title,
+    .author    = author
+  };
+}
+
+static void
+fill(BooksIndex & index)
+{
+  index.clear();
+  index.add(entry(1, "Moby Dick",           "Melville, Herman", 300));
+  index.add(entry(2, "anna Karenina",       "Tolstoy, Leo",     100, 1));
+  index.add(entry(3, "The Time Machine",    "Wells, H. G.",     200, 0));
+  index.add(entry(4, "War and Peace",       "Tolstoy, Leo",     400));
+  index.sort();
+}
+
+static std::vector<uint32_t>
+ids(const BooksIndex & index)
+{
+  std::vector<uint32_t> result;
+  for (uint16_t pos = 0; pos < index.get_count(); pos++) result.push_back(index.at(pos)->id);
+  return result;
+}
+
+TEST(BooksIndexTest, sort_orders) {
+  BooksIndex index;
+  fill(index);
+
+  EXPECT_EQ(4, index.get_count());
+
+  index.set_sort_order(BooksIndex::SortOrder::TITLE);
+  EXPECT_EQ(std::vector<uint32_t>({ 2, 1, 3, 4 }), ids(index));
+
+  index.set_sort_order(BooksIndex::SortOrder::AUTHOR);
+  EXPECT_EQ(std::vector<uint32_t>({ 1, 2, 4, 3 }), ids(index));
+
+  index.set_sort_order(BooksIndex::SortOrder::RECENTLY_READ);
+  EXPECT_EQ(std::vector<uint32_t>({ 3, 2, 1, 4 }), ids(index));
+
+  index.set_sort_order(BooksIndex::SortOrder::ADDED);
+  EXPECT_EQ(std::vector<uint32_t>({ 4, 1, 3, 2 }), ids(index));
+
+  EXPECT_EQ(nullptr, index.at(4));
+}
+
+TEST(BooksIndexTest, positions) {
+  BooksIndex index;
+  fill(index);
+
+  index.set_sort_order(BooksIndex::SortOrder::TITLE);
+  EXPECT_EQ( 0, index.position_of_id(2));
+  EXPECT_EQ( 3, index.position_of_id(4));
+  EXPECT_EQ(-1, index.position_of_id(5));
+  EXPECT_EQ( 2, index.position_of_db_index(103));
+  EXPECT_EQ(-1, index.position_of_db_index(3));
+
+  index.set_sort_order(BooksIndex::SortOrder::ADDED);
+  EXPECT_EQ( 3, index.position_of_id(2));
+  EXPECT_EQ( 0, index.position_of_id(4));
+  EXPECT_EQ( 2, index.position_of_db_index(103));
+}
+
+TEST(BooksIndexTest, track_pos) {
+  BooksIndex index;
+  fill(index);
+
+  EXPECT_TRUE(index.set_track_pos(4, 0));
+  EXPECT_TRUE(index.set_track_pos(3, 1));
+  EXPECT_TRUE(index.set_track_pos(2, -1));
+  EXPECT_FALSE(index.set_track_pos(5, 2));
+
+  EXPECT_EQ(std::vector<uint32_t>({ 4, 3, 2, 1 }), ids(index));
+  EXPECT_EQ(0, index.position_of_id(4));
+
+  index.set_sort_order(BooksIndex::SortOrder::TITLE);
+  EXPECT_EQ(std::vector<uint32_t>({ 2, 1, 3, 4 }), ids(index));
+}
+
+TEST(BooksIndexTest, placeholder) {
+  BooksIndex index;
+  fill(index);
+
+  BooksIndex::Entry e = entry(5, "book_5", "", 500);
+  e.db_index = BooksIndex::NO_DB_INDEX;
+  index.add(e);
+  EXPECT_EQ(-1, index.entry_index_of_id(5));
+  index.sort();
+
+  int16_t entry_idx = index.entry_index_of_id(5);
+  ASSERT_NE(-1, entry_idx);
+  EXPECT_EQ(2, index.position_of_id(5)); // After the two books being read, first by title
+
+  index.set_sort_order(BooksIndex::SortOrder::TITLE);
+  EXPECT_EQ(1, index.position_of_id(5));
+
+  // Meta-data retrieved
+  index.get_entry(entry_idx).db_index = 105;
+  index.get_entry(entry_idx).title    = "Walden";
+  index.sort();
+  EXPECT_EQ(std::vector<uint32_t>({ 2, 1, 3, 5, 4 }), ids(index));
+  EXPECT_EQ(3, index.position_of_db_index(105));
+}
+
+TEST(BooksIndexTest, filter) {
+  BooksIndex index;
+  fill(index);
+  index.set_sort_order(BooksIndex::SortOrder::TITLE);
+
+  index.set_filter({ 4, 1, 7 });
+  EXPECT_TRUE(index.is_filtered());
+  EXPECT_EQ(2, index.get_count());
+  EXPECT_EQ(std::vector<uint32_t>({ 1, 4 }), ids(index));
+  EXPECT_EQ( 1, index.position_of_id(4));
+  EXPECT_EQ(-1, index.position_of_id(2));
+  EXPECT_EQ(-1, index.position_of_db_index(102));
+  EXPECT_EQ(nullptr, index.at(2));
+
+  index.set_sort_order(BooksIndex::SortOrder::ADDED);
+  EXPECT_EQ(std::vector<uint32_t>({ 4, 1 }), ids(index));
+
+  EXPECT_TRUE(index.set_track_pos(1, 0));
+  index.set_sort_order(BooksIndex::SortOrder::RECENTLY_READ);
+  EXPECT_EQ(std::vector<uint32_t>({ 1, 4 }), ids(index));
+
+  // Saved without the filter
+  ASSERT_TRUE(index.save(INDEX_FILENAME, 10));
+  BooksIndex loaded;
+  ASSERT_TRUE(loaded.load(INDEX_FILENAME, 10));
+  EXPECT_EQ(4, loaded.get_count());
+  remove(INDEX_FILENAME.c_str());
+
+  index.clear_filter();
+  EXPECT_FALSE(index.is_filtered());
+  EXPECT_EQ(4, index.get_count());
+  EXPECT_EQ(std::vector<uint32_t>({ 1, 3, 2, 4 }), ids(index));
+}
+
+TEST(BooksIndexTest, remove) {
+  BooksIndex index;
+  fill(index);
+
+  index.remove(0);  // Moby Dick
+  index.sort();
+
+  EXPECT_EQ(3,  index.get_count());
+  EXPECT_EQ(-1, index.position_of_id(1));
+  EXPECT_EQ(std::vector<uint32_t>({ 3, 2, 4 }), ids(index));
+}
+
+TEST(BooksIndexTest, save_and_load) {
+  BooksIndex index;
+  fill(index);
+  index.set_sort_order(BooksIndex::SortOrder::AUTHOR);
+  index.set_folder_stamp(0x12345678);
+
+  ASSERT_TRUE(index.save(INDEX_FILENAME, 10));
+
+  BooksIndex loaded;
+  EXPECT_FALSE(loaded.load(INDEX_FILENAME, 11));
+  EXPECT_EQ(0, loaded.get_count());
+
+  ASSERT_TRUE(loaded.load(INDEX_FILENAME, 10));
+  EXPECT_EQ(4, loaded.get_count());
+  EXPECT_EQ(0x12345678u, loaded.get_folder_stamp());
+
+  for (uint8_t i = 0; i < BooksIndex::SORT_ORDER_COUNT; i++) {
+    index.set_sort_order((BooksIndex::SortOrder) i);
+    loaded.set_sort_order((BooksIndex::SortOrder) i);
+    EXPECT_EQ(ids(index), ids(loaded));
+  }
+
+  const BooksIndex::Entry * e = loaded.at(loaded.position_of_id(3));
+  ASSERT_NE(nullptr, e);
+  EXPECT_EQ(103,                e->db_index);
+  EXPECT_EQ(3000,               e->file_size);
+  EXPECT_EQ(200u,               e->added);
+  EXPECT_EQ(0,                  e->track_pos);
+  EXPECT_EQ("book_3.epub",      e->filename);
+  EXPECT_EQ("The Time Machine", e->title);
+  EXPECT_EQ("Wells, H. G.",     e->author);
+
+  remove(INDEX_FILENAME.c_str());
+}
+
+TEST(BooksIndexTest, corrupted_file) {
+  BooksIndex index;
+  fill(index);
+  ASSERT_TRUE(index.save(INDEX_FILENAME, 10));
+
+  FILE * f = fopen(INDEX_FILENAME.c_str(), "r+b");
+  ASSERT_NE(nullptr, f);
+  fseek(f, 40, SEEK_SET);
+  fputc('#', f);
+  fclose(f);
+
+  BooksIndex loaded;
+  EXPECT_FALSE(loaded.load(INDEX_FILENAME, 10));
+  EXPECT_EQ(0, loaded.get_count());
+
+  remove(INDEX_FILENAME.c_str());
+  EXPECT_FALSE(loaded.load(INDEX_FILENAME, 10));
+}
+
+TEST(BooksIndexTest, empty) {
+  BooksIndex index;
+  index.sort();
+  EXPECT_EQ(0, index.get_count());
+  EXPECT_EQ(nullptr, index.at(0));
+
+  ASSERT_TRUE(index.save(INDEX_FILENAME, 1));
+  BooksIndex loaded;
+  EXPECT_TRUE(loaded.load(INDEX_FILENAME, 1));
+  EXPECT_EQ(0, loaded.get_count());
+  EXPECT_EQ(0u, loaded.get_folder_stamp());
+
+  remove(INDEX_FILENAME.c_str());
+}
+
+#endif
@@ -0,0 +1,372 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#include "models/books_search.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static uint32_t
+checksum(const uint8_t * data, uint32_t size)
+{
+  uint32_t hash = 2166136261UL;  // FNV-1a
+  while (size--) {
+    hash ^= *data++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+// Latin-1 supplement letters (U+00C0 to U+00FF) without their accent.
+// 0 for the multiplication and division signs.
+
+static const char latin1_letters[65] =
+  "aaaaaaaceeeeiiii"
+  "dnooooo\0ouuuuyts"
+  "aaaaaaaceeeeiiii"
+  "dnooooo\0ouuuuyty";
+
+void
+BooksSearch::tokenize(const char * str, std::vector<std::string> & result, uint8_t min_size)
+{
+  const uint8_t * p         = (const uint8_t *) str;
+  bool            in_markup = false;
+  std::string     token;
+
+  auto flush = [&]() {
+    if (!token.empty() && (token.size() >= min_size)) result.push_back(token);
+    token.clear();
+  };
+
+  while (*p) {
+    const uint8_t * start = p;
+    uint32_t        ch    = *p++;
+
+    if (ch >= 0x80) {
+      uint8_t extra = ((ch & 0xE0) == 0xC0) ? 1 : (((ch & 0xF0) == 0xE0) ? 2 : (((ch & 0xF8) == 0xF0) ? 3 : 0));
+      ch &= 0x3F >> extra;
+      for (uint8_t i = 0; i < extra; i++) {
+        if ((*p & 0xC0) != 0x80) { extra = 0; break; }
+        ch = (ch << 6) | (*p++ & 0x3F);
+      }
+      if (extra == 0) { flush(); continue; } // Not UTF-8
+    }
+
+    if (in_markup) {
+      if (ch == '>') in_markup = false;
+      continue;
+    }
+
+    char letter = 0;
+
+    if (ch < 0x80) {
+      if (ch == '<') {
+        flush();
+        in_markup = true;
+        continue;
+      }
+      if (((ch >= 'a') && (ch <= 'z')) || ((ch >= '0') && (ch <= '9'))) letter = ch;
+      else if ((ch >= 'A') && (ch <= 'Z')) letter = ch - 'A' + 'a';
+    }
+    else if ((ch >= 0xC0) && (ch <= 0xFF)) {
+      letter = latin1_letters[ch - 0xC0];
+    }
+    else if ((ch >= 0x100) && !((ch >= 0x2000) && (ch <= 0x206F)) && (ch != 0x3000)) {
+      // Other letters are kept as they are, but for the general punctuation
+      if ((token.size() + (p - start)) <= MAX_TOKEN_SIZE) token.append((const char *) start, p - start);
+      continue;
+    }
+
+    if (letter == 0) flush();
+    else if (token.size() < MAX_TOKEN_SIZE) token.push_back(letter);
+  }
+
+  flush();
+}
+
+void
+BooksSearch::clear()
+{
+  // The memory is given back, the index being released when not in use
+
+  std::string().swap(pool);
+  std::vector<uint32_t>().swap(tokens);
+  std::vector<Posting>().swap(postings);
+  std::vector<uint32_t>().swap(ids);
+  std::map<std::string, uint32_t>().swap(batch_tokens);
+  batch = false;
+}
+
+uint32_t
+BooksSearch::token_offset(const std::string & token)
+{
+  auto it = std::lower_bound(tokens.begin(), tokens.end(), token, [this](uint32_t offset, const std::string & t) {
+    return strcmp(pool.data() + offset, t.c_str()) < 0;
+  });
+
+  if ((it != tokens.end()) && (token.compare(pool.data() + *it) == 0)) return *it;
+
+  if (batch) {
+    auto batch_it = batch_tokens.find(token);
+    if (batch_it != batch_tokens.end()) return batch_it->second;
+  }
+
+  uint32_t offset = pool.size();
+  pool.append(token);
+  pool.push_back(0);
+
+  if (batch) batch_tokens[token] = offset;
+  else       tokens.insert(it, offset);
+
+  return offset;
+}
+
+bool
+BooksSearch::contains(uint32_t id) const
+{
+  return std::binary_search(ids.begin(), ids.end(), id);
+}
+
+void
+BooksSearch::add_book(uint32_t id, const char * title, const char * author, const char * description)
+{
+  if (contains(id)) return;
+
+  std::vector<std::string> words;
+  tokenize(title,       words);
+  tokenize(author,      words);
+  tokenize(description, words);
+
+  add_tokens(id, words);
+}
+
+void
+BooksSearch::add_tokens(uint32_t id, std::vector<std::string> & words)
+{
+  if (contains(id)) return;
+
+  std::sort(words.begin(), words.end());
+  words.erase(std::unique(words.begin(), words.end()), words.end());
+
+  // The new postings are sorted apart, then merged with the others. In a
+  // batch, this is done once by end_batch().
+
+  size_t first = postings.size();
+  for (auto & word : words) postings.push_back({ .token = token_offset(word), .id = id });
+
+  if (!batch) {
+    std::sort(postings.begin() + first, postings.end());
+    std::inplace_merge(postings.begin(), postings.begin() + first, postings.end());
+  }
+
+  ids.insert(std::upper_bound(ids.begin(), ids.end(), id), id);
+}
+
+void
+BooksSearch::end_batch()
+{
+  if (!batch) return;
+  batch = false;
+
+  // The batch tokens are already in alphabetical order.
+
+  std::vector<uint32_t> new_tokens;
+  new_tokens.reserve(batch_tokens.size());
+  for (auto & token : batch_tokens) new_tokens.push_back(token.second);
+  std::map<std::string, uint32_t>().swap(batch_tokens);
+
+  size_t first = tokens.size();
+  tokens.insert(tokens.end(), new_tokens.begin(), new_tokens.end());
+  std::inplace_merge(tokens.begin(), tokens.begin() + first, tokens.end(), [this](uint32_t a, uint32_t b) {
+    return strcmp(pool.data() + a, pool.data() + b) < 0;
+  });
+
+  std::sort(postings.begin(), postings.end());
+}
+
+void
+BooksSearch::remove_books(std::vector<uint32_t> the_ids)
+{
+  std::sort(the_ids.begin(), the_ids.end());
+
+  auto removed = [&the_ids](uint32_t id) { return std::binary_search(the_ids.begin(), the_ids.end(), id); };
+
+  postings.erase(std::remove_if(postings.begin(), postings.end(), [&removed](const Posting & p) { return removed(p.id); }),
+                 postings.end());
+  ids.erase(std::remove_if(ids.begin(), ids.end(), removed), ids.end());
+
+  // Tokens still in use, in pool order. As the postings are sorted by token
+  // offset, they stay sorted once the offsets are translated.
+
+  std::vector<uint32_t> used;
+  for (auto & p : postings) {
+    if (used.empty() || (used.back() != p.token)) used.push_back(p.token);
+  }
+
+  if (used.size() == tokens.size()) return;
+
+  std::string           new_pool;
+  std::vector<uint32_t> new_offsets(used.size());
+
+  for (uint32_t i = 0; i < used.size(); i++) {
+    new_offsets[i] = new_pool.size();
+    new_pool.append(pool.data() + used[i]);
+    new_pool.push_back(0);
+  }
+
+  uint32_t i = 0;
+  for (auto & p : postings) {
+    while (used[i] != p.token) i++;
+    p.token = new_offsets[i];
+  }
+
+  std::vector<uint32_t> new_tokens;
+  new_tokens.reserve(used.size());
+  for (auto offset : tokens) {
+    auto it = std::lower_bound(used.begin(), used.end(), offset);
+    if ((it != used.end()) && (*it == offset)) new_tokens.push_back(new_offsets[it - used.begin()]);
+  }
+
+  pool.swap(new_pool);
+  tokens.swap(new_tokens);
+}
+
+void
+BooksSearch::search(const std::string & query, std::vector<uint32_t> & result) const
+{
+  std::vector<std::string> words;
+  tokenize(query.c_str(), words, 0);
+
+  result.clear();
+
+  bool first = true;
+  for (auto & word : words) {
+    std::vector<uint32_t> found;
+
+    auto it = std::lower_bound(tokens.begin(), tokens.end(), word, [this](uint32_t offset, const std::string & w) {
+      return strcmp(pool.data() + offset, w.c_str()) < 0;
+    });
+
+    for (; (it != tokens.end()) && (strncmp(pool.data() + *it, word.c_str(), word.size()) == 0); it++) {
+      auto range = std::equal_range(postings.begin(), postings.end(), Posting { .token = *it, .id = 0 },
+                                    [](const Posting & a, const Posting & b) { return a.token < b.token; });
+      for (auto p = range.first; p != range.second; p++) found.push_back(p->id);
+    }
+
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+
+    if (first) {
+      result.swap(found);
+      first = false;
+    }
+    else {
+      std::vector<uint32_t> both;
+      std::set_intersection(result.begin(), result.end(), found.begin(), found.end(), std::back_inserter(both));
+      result.swap(both);
+    }
+
+    if (result.empty()) break;
+  }
+}
+
+bool
+BooksSearch::save(const std::string & filename, uint64_t stamp) const
+{
+  std::vector<uint8_t> data;
+
+  data.insert(data.end(), pool.begin(), pool.end());
+  data.insert(data.end(), (uint8_t *) tokens.data(),   (uint8_t *) (tokens.data()   + tokens.size()  ));
+  data.insert(data.end(), (uint8_t *) postings.data(), (uint8_t *) (postings.data() + postings.size()));
+  data.insert(data.end(), (uint8_t *) ids.data(),      (uint8_t *) (ids.data()      + ids.size()     ));
+
+  Header header = {
+    .magic         = { 'B', 'S', 'R', 'C' },
+    .version       = VERSION,
+    .pool_size     = (uint32_t) pool.size(),
+    .token_count   = (uint32_t) tokens.size(),
+    .posting_count = (uint32_t) postings.size(),
+    .id_count      = (uint32_t) ids.size(),
+    .stamp         = stamp,
+    .checksum      = checksum(data.data(), data.size())
+  };
+
+  FILE * f = fopen(filename.c_str(), "wb");
+  if (f == nullptr) {
+    LOG_E("Unable to create %s", filename.c_str());
+    return false;
+  }
+
+  bool ok = (fwrite(&header, sizeof(Header), 1, f) == 1) &&
+            (data.empty() || (fwrite(data.data(), data.size(), 1, f) == 1));
+  fclose(f);
+
+  if (!ok) {
+    LOG_E("Unable to write %s", filename.c_str());
+    ::remove(filename.c_str());
+  }
+  return ok;
+}
+
+bool
+BooksSearch::load(const std::string & filename, uint64_t stamp)
+{
+  clear();
+
+  FILE * f = fopen(filename.c_str(), "rb");
+  if (f == nullptr) return false;
+
+  Header               header;
+  std::vector<uint8_t> data;
+  bool                 ok = false;
+
+  if ((fread(&header, sizeof(Header), 1, f) == 1) &&
+      (memcmp(header.magic, "BSRC", 4) == 0) &&
+      (header.version == VERSION) &&
+      (header.stamp == stamp)) {
+    size_t size = header.pool_size +
+                  (header.token_count   * sizeof(uint32_t)) +
+                  (header.posting_count * sizeof(Posting) ) +
+                  (header.id_count      * sizeof(uint32_t));
+    data.resize(size);
+    ok = data.empty() || (fread(data.data(), size, 1, f) == 1);
+    ok = ok && (checksum(data.data(), data.size()) == header.checksum);
+  }
+  fclose(f);
+
+  if (!ok) {
+    LOG_D("Books search index not valid: %s", filename.c_str());
+    return false;
+  }
+
+  const uint8_t * p = data.data();
+
+  pool.assign((const char *) p, header.pool_size);
+  p += header.pool_size;
+
+  tokens.resize(header.token_count);
+  if (header.token_count > 0) memcpy(tokens.data(), p, header.token_count * sizeof(uint32_t));
+  p += header.token_count * sizeof(uint32_t);
+
+  postings.resize(header.posting_count);
+  if (header.posting_count > 0) memcpy(postings.data(), p, header.posting_count * sizeof(Posting));
+  p += header.posting_count * sizeof(Posting);
+
+  ids.resize(header.id_count);
+  if (header.id_count > 0) memcpy(ids.data(), p, header.id_count * sizeof(uint32_t));
+
+  // Offsets must stay in the pool
+
+  ok = pool.empty() || (pool.back() == 0);
+  for (auto offset  : tokens  ) ok = ok && (offset        < pool.size());
+  for (auto & entry : postings) ok = ok && (entry.token   < pool.size());
+
+  if (!ok) {
+    clear();
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,146 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "models/books_search.hpp"
+
+#include <cstdio>
+#include <string>
+
+static const std::string SEARCH_FILENAME = "/tmp/books_search_test.idx";
+
+static void
+fill(BooksSearch & search)
+{
+  search.clear();
+  search.add_book(10, "Moby Dick",           "Melville, Herman", "The voyage of the whaling ship Pequod.");
+  search.add_book(20, "Les Misérables",      "Hugo, Victor",     "<span>Jean Valjean, an ex-convict.</span>");
+  search.add_book(30, "The Time Machine",    "Wells, H. G.",     "A time traveller's voyage to the year 802,701.");
+  search.add_book(40, "Notre-Dame de Paris", "Hugo, Victor",     "");
+}
+
+static std::vector<uint32_t>
+find(const BooksSearch & search, const char * query)
+{
+  std::vector<uint32_t> result;
+  search.search(query, result);
+  return result;
+}
+
+TEST(BooksSearchTest, tokenize) {
+  std::vector<std::string> tokens;
+  BooksSearch::tokenize("L'Élève <b>Noël</b>, À BIENTÔT! x 42", tokens);
+  EXPECT_EQ(std::vector<std::string>({ "eleve", "noel", "bientot", "42" }), tokens);
+
+  tokens.clear();
+  BooksSearch::tokenize("Anticonstitutionnellement", tokens);
+  ASSERT_EQ(1u, tokens.size());
+  EXPECT_EQ(std::string("anticonstitutio"), tokens[0]);
+
+  tokens.clear();
+  BooksSearch::tokenize("x y", tokens, 0);
+  EXPECT_EQ(std::vector<std::string>({ "x", "y" }), tokens);
+}
+
+TEST(BooksSearchTest, prefix_queries) {
+  BooksSearch search;
+  fill(search);
+
+  EXPECT_EQ(std::vector<uint32_t>({ 10 }),         find(search, "moby"));
+  EXPECT_EQ(std::vector<uint32_t>({ 10 }),         find(search, "Whal"));
+  EXPECT_EQ(std::vector<uint32_t>({ 20, 40 }),     find(search, "hugo"));
+  EXPECT_EQ(std::vector<uint32_t>({ 20 }),         find(search, "miserables"));
+  EXPECT_EQ(std::vector<uint32_t>({ 20 }),         find(search, "MISÉ"));
+  EXPECT_EQ(std::vector<uint32_t>({ 10, 30 }),     find(search, "voy"));
+  EXPECT_EQ(std::vector<uint32_t>({ 10, 30 }),     find(search, "the"));
+  EXPECT_EQ(std::vector<uint32_t>({ 20 }),         find(search, "valjean"));
+  EXPECT_EQ(std::vector<uint32_t>({ }),            find(search, "dickens"));
+  EXPECT_EQ(std::vector<uint32_t>({ }),            find(search, ""));
+  EXPECT_EQ(std::vector<uint32_t>({ }),            find(search, "span"));  // Markup
+}
+
+TEST(BooksSearchTest, all_words) {
+  BooksSearch search;
+  fill(search);
+
+  EXPECT_EQ(std::vector<uint32_t>({ 30 }),         find(search, "voyage time"));
+  EXPECT_EQ(std::vector<uint32_t>({ 40 }),         find(search, "hugo notre"));
+  EXPECT_EQ(std::vector<uint32_t>({ }),            find(search, "hugo moby"));
+}
+
+TEST(BooksSearchTest, remove_books) {
+  BooksSearch search;
+  fill(search);
+
+  uint32_t count = search.get_token_count();
+
+  search.remove_books({ 20, 10 });
+  EXPECT_EQ(std::vector<uint32_t>({ 30, 40 }),     search.get_ids());
+  EXPECT_FALSE(search.contains(10));
+  EXPECT_LT(search.get_token_count(), count);
+
+  EXPECT_EQ(std::vector<uint32_t>({ 40 }),         find(search, "hugo"));
+  EXPECT_EQ(std::vector<uint32_t>({ 30 }),         find(search, "voy"));
+  EXPECT_EQ(std::vector<uint32_t>({ }),            find(search, "moby"));
+
+  search.add_book(10, "Moby Dick", "Melville, Herman", "");
+  EXPECT_EQ(std::vector<uint32_t>({ 10 }),         find(search, "dick"));
+  EXPECT_EQ(std::vector<uint32_t>({ 10, 30, 40 }), search.get_ids());
+}
+
+TEST(BooksSearchTest, batch) {
+  BooksSearch search, batched;
+  fill(search);
+
+  batched.add_book(40, "Notre-Dame de Paris", "Hugo, Victor",     "");
+  batched.start_batch();
+  batched.add_book(30, "The Time Machine",    "Wells, H. G.",     "A time traveller's voyage to the year 802,701.");
+  batched.add_book(10, "Moby Dick",           "Melville, Herman", "The voyage of the whaling ship Pequod.");
+  batched.add_book(20, "Les Misérables",      "Hugo, Victor",     "<span>Jean Valjean, an ex-convict.</span>");
+  batched.end_batch();
+
+  EXPECT_EQ(search.get_ids(),                      batched.get_ids());
+  EXPECT_EQ(search.get_token_count(),              batched.get_token_count());
+  EXPECT_EQ(search.get_posting_count(),            batched.get_posting_count());
+  EXPECT_EQ(std::vector<uint32_t>({ 10, 30 }),     find(batched, "voy"));
+  EXPECT_EQ(std::vector<uint32_t>({ 20, 40 }),     find(batched, "vic hug"));
+  EXPECT_EQ(std::vector<uint32_t>({ 30 }),         find(batched, "voyage time"));
+
+  batched.add_book(50, "Twenty Thousand Leagues", "Verne, Jules", "");
+  EXPECT_EQ(std::vector<uint32_t>({ 50 }),         find(batched, "leag"));
+}
+
+TEST(BooksSearchTest, save_and_load) {
+  BooksSearch search;
+  fill(search);
+  search.remove_books({ 30 });
+
+  ASSERT_TRUE(search.save(SEARCH_FILENAME));
+
+  BooksSearch loaded;
+  ASSERT_TRUE(loaded.load(SEARCH_FILENAME));
+  EXPECT_EQ(search.get_ids(),                      loaded.get_ids());
+  EXPECT_EQ(search.get_token_count(),              loaded.get_token_count());
+  EXPECT_EQ(std::vector<uint32_t>({ 20, 40 }),     find(loaded, "vic hug"));
+  EXPECT_EQ(std::vector<uint32_t>({ 10 }),         find(loaded, "voy"));
+
+  // Built from something else
+  ASSERT_TRUE(search.save(SEARCH_FILENAME, 0x123456789ULL));
+  EXPECT_FALSE(loaded.load(SEARCH_FILENAME, 0x123456788ULL));
+  EXPECT_FALSE(loaded.load(SEARCH_FILENAME));
+  ASSERT_TRUE(loaded.load(SEARCH_FILENAME, 0x123456789ULL));
+  EXPECT_EQ(search.get_ids(),                      loaded.get_ids());
+
+  FILE * f = fopen(SEARCH_FILENAME.c_str(), "r+b");
+  ASSERT_NE(nullptr, f);
+  fseek(f, 40, SEEK_SET);
+  fputc('#', f);
+  fclose(f);
+
+  EXPECT_FALSE(loaded.load(SEARCH_FILENAME));
+  EXPECT_EQ(0u, loaded.get_ids().size());
+
+  remove(SEARCH_FILENAME.c_str());
+  EXPECT_FALSE(loaded.load(SEARCH_FILENAME));
+}
+
+#endif
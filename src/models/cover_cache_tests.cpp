@@ -0,0 +1,71 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "helpers/cover_cache.hpp"
+
+#include <cstring>
+
+TEST(CoverCacheTest, get_after_make_room) {
+  CoverCache cache(16);
+  cache.set_capacity(2);
+
+  EXPECT_EQ(nullptr, cache.get(1));
+
+  uint8_t * data = cache.make_room(1);
+  ASSERT_NE(nullptr, data);
+  memset(data, 1, 16);
+
+  const uint8_t * cover = cache.get(1);
+  ASSERT_EQ(data, cover);
+  EXPECT_EQ(1, cover[15]);
+  EXPECT_EQ(1, cache.get_count());
+}
+
+TEST(CoverCacheTest, least_recently_used_is_evicted) {
+  CoverCache cache(16);
+  cache.set_capacity(3);
+
+  for (uint32_t id = 1; id <= 3; id++) memset(cache.make_room(id), id, 16);
+
+  EXPECT_NE(nullptr, cache.get(1)); // 2 is now the least recently used
+
+  uint8_t * data = cache.make_room(4);
+  ASSERT_NE(nullptr, data);
+  memset(data, 4, 16);
+
+  EXPECT_EQ(3,       cache.get_count());
+  EXPECT_EQ(nullptr, cache.get(2));
+  ASSERT_NE(nullptr, cache.get(1));
+  EXPECT_EQ(1,       cache.get(1)[0]);
+  EXPECT_EQ(3,       cache.get(3)[0]);
+  EXPECT_EQ(4,       cache.get(4)[0]);
+}
+
+TEST(CoverCacheTest, capacity_reduced) {
+  CoverCache cache(16);
+  cache.set_capacity(4);
+
+  for (uint32_t id = 1; id <= 4; id++) cache.make_room(id);
+
+  cache.set_capacity(2);
+  EXPECT_EQ(2,       cache.get_count());
+  EXPECT_EQ(nullptr, cache.get(1));
+  EXPECT_EQ(nullptr, cache.get(2));
+  EXPECT_NE(nullptr, cache.get(3));
+  EXPECT_NE(nullptr, cache.get(4));
+}
+
+TEST(CoverCacheTest, forget) {
+  CoverCache cache(16);
+  cache.set_capacity(2);
+
+  cache.make_room(1);
+  cache.make_room(1); // Same id: a single entry
+  EXPECT_EQ(1, cache.get_count());
+
+  cache.forget(1);
+  EXPECT_EQ(0,       cache.get_count());
+  EXPECT_EQ(nullptr, cache.get(1));
+}
+
+#endif
@@ -0,0 +1,120 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "helpers/dithered_images.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+static int
+black_count(const uint8_t * bits, Dim dim)
+{
+  int      count = 0;
+  uint16_t pitch = DitheredImages::get_pitch(dim);
+  for (int j = 0; j < dim.height; j++) {
+    for (int i = 0; i < dim.width; i++) {
+      if (bits[(j * pitch) + (i >> 3)] & (0x80 >> (i & 7))) count++;
+    }
+  }
+  return count;
+}
+
+static std::vector<uint8_t>
+dither(const std::vector<uint8_t> & gray, Dim dim)
+{
+  std::vector<uint8_t> bits(DitheredImages::get_pitch(dim) * dim.height, 0xAA);
+  std::vector<int16_t> errors(dim.width + 1);
+  DitheredImages::dither(gray.data(), dim, bits.data(), errors.data());
+  return bits;
+}
+
+TEST(DitheredImagesTest, solid_levels) {
+  Dim dim(37, 11);
+
+  std::vector<uint8_t> bits = dither(std::vector<uint8_t>(37 * 11, 0), dim);
+  EXPECT_EQ(black_count(bits.data(), dim), 37 * 11); // Last column included
+
+  bits = dither(std::vector<uint8_t>(37 * 11, 255), dim);
+  EXPECT_EQ(black_count(bits.data(), dim), 0);
+}
+
+TEST(DitheredImagesTest, gray_levels_density) {
+  Dim dim(200, 100);
+  for (int level : { 32, 64, 128, 192, 224 }) {
+    std::vector<uint8_t> bits = dither(std::vector<uint8_t>(200 * 100, level), dim);
+    double black = black_count(bits.data(), dim) / (200.0 * 100.0);
+    EXPECT_NEAR(black, 1.0 - (level / 255.0), 0.02) << "level " << level;
+  }
+}
+
+TEST(DitheredImagesTest, extreme_errors_stay_bounded) {
+  // Alternating black and white rows push errors in both directions
+  Dim dim(64, 64);
+  std::vector<uint8_t> gray(64 * 64);
+  for (int j = 0; j < 64; j++) {
+    for (int i = 0; i < 64; i++) gray[(j * 64) + i] = (j & 1) ? 255 : 0;
+  }
+  std::vector<uint8_t> bits = dither(gray, dim);
+  EXPECT_NEAR(black_count(bits.data(), dim), 32 * 64, 64);
+}
+
+TEST(DitheredImagesTest, repaint_uses_cached_image) {
+  DitheredImages images;
+  Dim            dim(50, 30);
+
+  srand(1);
+  std::vector<uint8_t> gray(50 * 30);
+  for (auto & v : gray) v = rand() & 0xFF;
+
+  uint16_t        pitch;
+  const uint8_t * first = images.get(gray.data(), dim, pitch);
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(pitch, 7);
+  EXPECT_EQ(std::vector<uint8_t>(first, first + (pitch * dim.height)), dither(gray, dim));
+
+  // Same pixels at another address, as when a page is built again
+  std::vector<uint8_t> copy = gray;
+  EXPECT_EQ(images.get(copy.data(), dim, pitch), first);
+
+  copy[100] ^= 0x80;
+  EXPECT_NE(images.get(copy.data(), dim, pitch), first);
+}
+
+TEST(DitheredImagesTest, least_recently_used_are_removed) {
+  DitheredImages images;
+  Dim            dim(800, 600); // 60000 bytes each, 4 fit
+  uint16_t       pitch;
+
+  std::vector<std::vector<uint8_t>> grays;
+  for (int n = 0; n < 5; n++) grays.push_back(std::vector<uint8_t>(800 * 600, n * 40));
+
+  const uint8_t * first = images.get(grays[0].data(), dim, pitch);
+  for (int n = 1; n < 4; n++) images.get(grays[n].data(), dim, pitch);
+  EXPECT_EQ(images.get(grays[0].data(), dim, pitch), first); // Now most recently used
+
+  images.get(grays[4].data(), dim, pitch);                   // Removes grays[1]
+  EXPECT_EQ(images.get(grays[0].data(), dim, pitch), first);
+}
+
+TEST(DitheredImagesTest, too_large_dithered_by_rows) {
+  DitheredImages images;
+  Dim            dim(1200, 1800); // 270000 bytes, above MAX_SIZE
+  uint16_t       pitch;
+
+  srand(2);
+  std::vector<uint8_t> gray(1200 * 1800);
+  for (auto & v : gray) v = rand() & 0xFF;
+
+  EXPECT_EQ(images.get(gray.data(), dim, pitch), nullptr);
+
+  std::vector<uint8_t> expected = dither(gray, dim);
+
+  images.start_rows(dim.width);
+  for (int j = 0; j < dim.height; j++) {
+    const uint8_t * row = images.dither_row(&gray[j * dim.width], dim.width);
+    ASSERT_EQ(std::vector<uint8_t>(row, row + pitch),
+              std::vector<uint8_t>(&expected[j * pitch], &expected[(j + 1) * pitch])) << "row " << j;
+  }
+}
+
+#endif
@@ -13,6 +13,7 @@
 #include "viewers/msg_viewer.hpp"
 #include "viewers/book_viewer.hpp"
 #include "helpers/unzip.hpp"
+#include "alloc.hpp"
 
 #include "logging.hpp"
 #if EPUB_INKPLATE_BUILD
@@ -24,6 +25,7 @@
 #include <iterator>
 #include <algorithm>
 #include <cctype>
+#include <sys/stat.h>
 
 using namespace pugi;
 
@@ -106,8 +108,6 @@ EPub::EPub()
   encryption_data        = nullptr;
   current_item_info.data = nullptr;
   file_is_open           = false;
-  fonts_size_too_large   = false;
-  fonts_size             = 0;
   current_itemref        = xml_node(NULL);
   opf_base_path.clear();
   current_filename.clear();
@@ -502,51 +502,82 @@ EPub::load_font(const std::string      filename,
                 const std::string      font_family, 
                 const Fonts::FaceStyle style)
 {
-  uint32_t size;
   LOG_D("Font file name: %s", filename.c_str());
-  if ((size = unzip.get_file_size(filename.c_str())) > 0) {
-    if ((fonts_size + size) > 800000) {
-      fonts_size_too_large = true;
-      LOG_E("Fonts are using too much space (max 800K). Kept the first fonts read.");
+
+  if (unzip.get_file_size(filename.c_str()) <= 0) {
+    LOG_E("Unable to find font file: %s", filename.c_str());
+    return false;
+  }
+
+  if (get_file_obfuscation(filename.c_str()) == ObfuscationType::UNKNOWN) {
+    LOG_E("Font %s obfuscated with an unknown algorithm.", filename.c_str());
+    return false;
+  }
+
+  // The font will be retrieved from the book when first used.
+  fonts.add_deferred(font_family, style, filename);
+  return true;
+}
+
+bool
+EPub::extract_font(const std::string & filename, std::string & font_path)
+{
+  static constexpr uint32_t CHUNK_SIZE = 4096;
+
+  ObfuscationType obf_type = get_file_obfuscation(filename.c_str());
+  if (obf_type == ObfuscationType::UNKNOWN) return false;
+
+  uint32_t hash = 2166136261U;
+  for (char ch : current_filename) hash = (hash ^ (uint8_t) ch) * 16777619U;
+  for (char ch : filename        ) hash = (hash ^ (uint8_t) ch) * 16777619U;
+
+  char name[12];
+  snprintf(name, 12, "/%08X", hash);
+
+  std::size_t pos = filename.find_last_of('.');
+  font_path = std::string(BOOK_FONTS_FOLDER).append(name)
+                .append((pos == std::string::npos) ? "" : filename.substr(pos));
+
+  uint32_t size;
+  if (!unzip.open_stream_file(filename.c_str(), size)) {
+    LOG_E("Unable to retrieve font file: %s", filename.c_str());
+    return false;
+  }
+
+  mkdir(BOOK_FONTS_FOLDER, 0775);
+
+  FILE * f      = fopen(font_path.c_str(), "wb");
+  char * buffer = (char *) allocate(CHUNK_SIZE);
+  bool   ok     = (f != nullptr) && (buffer != nullptr);
+
+  uint32_t total = 0;
+  while (ok && (total < size)) {
+    uint32_t chunk = std::min(CHUNK_SIZE, size - total);
+    uint32_t got   = 0;
+    while (ok && (got < chunk)) {
+      uint32_t s = chunk - got;
+      ok   = unzip.get_stream_data(buffer + got, s) && (s > 0);
+      got += s;
     }
-    else {
-      unsigned char * buffer;
-      ObfuscationType obf_type = get_file_obfuscation(filename.c_str());
-      if (obf_type != ObfuscationType::NONE) {
-        if (obf_type != ObfuscationType::UNKNOWN) {
-          buffer = (unsigned char *) unzip.get_file(filename.c_str(), size);
-          if (buffer == nullptr) {
-            LOG_E("Unable to retrieve font file: %s", filename.c_str());
-          }
-          else {
-            decrypt(buffer, size, obf_type);
-
-            if (fonts.add(font_family, style, buffer, size, filename)) {
-              fonts_size += size;
-              return true;
-            }
-          }   
-        }
-        else {
-          LOG_E("Font %s obfuscated with an unknown algorithm.", filename.c_str());
-        }
-      }
-      else {
-        buffer = (unsigned char *) unzip.get_file(filename.c_str(), size);
-        if (buffer == nullptr) {
-          LOG_E("Unable to retrieve font file: %s", filename.c_str());
-        }
-        else {
-          if (fonts.add(font_family, style, buffer, size, filename)) {
-            fonts_size += size;
-            return true;
-          }
-        }
-      }
+    if (ok) {
+      // The obfuscated part is at the beginning of the file, in the first chunk.
+      if ((total == 0) && (obf_type != ObfuscationType::NONE)) decrypt(buffer, chunk, obf_type);
+      ok     = fwrite(buffer, chunk, 1, f) == 1;
+      total += chunk;
     }
   }
 
-  return false;
+  unzip.close_stream_file();
+
+  if (buffer != nullptr) free(buffer);
+  if (f      != nullptr) fclose(f);
+
+  if (!ok) {
+    LOG_E("Unable to extract font file: %s", filename.c_str());
+    remove(font_path.c_str());
+  }
+
+  return ok;
 }
 
 void
@@ -558,8 +589,7 @@ EPub::retrieve_fonts_from_css(CSS & css)
   #endif
   #if USE_EPUB_FONTS
 
-    if ((book_format_params.use_fonts_in_book == 0) ||
-        (fonts_size_too_large)) return;
+    if (book_format_params.use_fonts_in_book == 0) return;
     
     CSS::RulesMap font_rules;
     DOM * dom = new DOM;
@@ -572,8 +602,6 @@ EPub::retrieve_fonts_from_css(CSS & css)
     
     if (font_rules.empty()) return;
 
-    bool first = true;
-
     for (auto & rule : font_rules) {
       const CSS::Values * values;
       if ((values = css.get_values_from_props(*rule.second, CSS::PropertyId::FONT_FAMILY))) {
@@ -597,22 +625,10 @@ EPub::retrieve_fonts_from_css(CSS & css)
               (!values->empty()) &&
               (values->front()->value_type == CSS::ValueType::URL)) {
 
-            if (first) {
-              first = false;
-              LOG_D("Displaying font loading msg.");
-              msg_viewer.show(
-                MsgViewer::MsgType::INFO, 
-                false, false, 
-                "Retrieving Font(s)", 
-                "The application is retrieving font(s) from the EPub file. Please wait."
-              );
-            }
-
             std::string filename = css.get_folder_path() + values->front()->str;
             filename = filename_locate(filename.c_str());
 
             load_font(filename, font_family, style);
-            if (fonts_size_too_large) break;
           }
         }
       }
@@ -916,8 +932,6 @@ EPub::open_file(const std::string & epub_filename)
 
   current_filename     = epub_filename;
   file_is_open         = true;
-  fonts_size_too_large = false;
-  fonts_size           = 0;
 
   LOG_D("EPub file is now open.");
 
@@ -0,0 +1,490 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#include "models/epub_probe.hpp"
+
+#include "models/image_factory.hpp"
+#include "helpers/unzip.hpp"
+#include "alloc.hpp"
+
+#include <cstring>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Minimal streaming XML scanner
+ *
+ * Data is fed in chunks of any size. For each start or end tag, the
+ * on_tag handler is called. Text between tags is appended raw (entities
+ * not decoded) to *text when text is not nullptr. Comments, processing
+ * instructions and declarations are skipped.
+ */
+class XMLScanner
+{
+  public:
+    struct Tag {
+      std::string name;
+      bool        closing;
+      bool        self_closing;
+      std::vector<std::pair<std::string, std::string>> attributes;
+
+      const char * attribute(const char * attr_name) const {
+        for (auto & attr : attributes) {
+          if (attr.first == attr_name) return attr.second.c_str();
+        }
+        return "";
+      }
+
+      /**
+       * @brief Tag name without the namespace prefix
+       */
+      const char * local_name() const {
+        size_t pos = name.find(':');
+        return (pos == std::string::npos) ? name.c_str() : name.c_str() + pos + 1;
+      }
+    };
+
+    std::function<bool(const Tag &)> on_tag;  ///< Returns false to stop the scan
+    std::string *                    text;
+
+    XMLScanner() : text(nullptr) { }
+
+    /**
+     * @brief Scan the next chunk of data
+     *
+     * @return false The handler stopped the scan.
+     */
+    bool feed(const char * data, uint32_t size);
+
+  private:
+    std::string pending;  ///< Incomplete construct at the end of the last chunk
+
+    static size_t tag_end(const std::string & str, size_t from);
+    static void   parse_tag(const char * str, size_t size, Tag & tag);
+};
+
+size_t
+XMLScanner::tag_end(const std::string & str, size_t from)
+{
+  // '>' within quoted attribute values is not the end of the tag
+
+  char quote = 0;
+  for (size_t i = from; i < str.size(); i++) {
+    char ch = str[i];
+    if (quote) {
+      if (ch == quote) quote = 0;
+    }
+    else if ((ch == '"') || (ch == '\'')) quote = ch;
+    else if (ch == '>') return i;
+  }
+  return std::string::npos;
+}
+
+void
+XMLScanner::parse_tag(const char * str, size_t size, Tag & tag)
+{
+  const char * end = str + size;
+
+  tag.attributes.clear();
+  tag.closing      = (str < end) && (*str == '/');
+  tag.self_closing = (size > 0) && (end[-1] == '/');
+
+  if (tag.closing     ) str++;
+  if (tag.self_closing) end--;
+
+  const char * s = str;
+  while ((s < end) && !isspace(*s)) s++;
+  tag.name.assign(str, s);
+
+  while (s < end) {
+    while ((s < end) && isspace(*s)) s++;
+    const char * name = s;
+    while ((s < end) && (*s != '=') && !isspace(*s)) s++;
+    if (s == name) break;
+    std::string attr_name(name, s);
+    while ((s < end) && isspace(*s)) s++;
+    if ((s >= end) || (*s != '=')) continue;
+    s++;
+    while ((s < end) && isspace(*s)) s++;
+    if ((s >= end) || ((*s != '"') && (*s != '\''))) break;
+    char quote = *s++;
+    const char * value = s;
+    while ((s < end) && (*s != quote)) s++;
+    tag.attributes.push_back(std::make_pair(attr_name, std::string(value, s)));
+    if (s < end) s++;
+  }
+}
+
+bool
+XMLScanner::feed(const char * data, uint32_t size)
+{
+  pending.append(data, size);
+
+  Tag    tag;
+  size_t pos = 0;
+
+  while (pos < pending.size()) {
+    size_t lt = pending.find('<', pos);
+
+    if (lt == std::string::npos) {
+      if (text != nullptr) text->append(pending, pos, std::string::npos);
+      pos = pending.size();
+      break;
+    }
+
+    if ((text != nullptr) && (lt > pos)) text->append(pending, pos, lt - pos);
+    pos = lt;
+
+    size_t end;
+    if (pending.compare(lt, 4, "<!--") == 0) {
+      if ((end = pending.find("-->", lt + 4)) == std::string::npos) break;
+      pos = end + 3;
+    }
+    else if (pending.compare(lt, 9, "<![CDATA[") == 0) {
+      if ((end = pending.find("]]>", lt + 9)) == std::string::npos) break;
+      if (text != nullptr) {
+        // Kept in the raw text such that entities decoding leaves it unchanged
+        for (size_t i = lt + 9; i < end; i++) {
+          if (pending[i] == '&') text->append("&amp;"); else text->push_back(pending[i]);
+        }
+      }
+      pos = end + 3;
+    }
+    else {
+      if ((end = tag_end(pending, lt + 1)) == std::string::npos) break;
+      pos = end + 1;
+      if ((pending[lt + 1] == '?') || (pending[lt + 1] == '!')) continue;
+
+      parse_tag(pending.c_str() + lt + 1, end - lt - 1, tag);
+      if (!on_tag(tag)) {
+        pending.clear();
+        return false;
+      }
+    }
+  }
+
+  pending.erase(0, pos);
+  return true;
+}
+
+static void
+append_utf8(std::string & str, uint32_t code)
+{
+  if (code < 0x80) {
+    str.push_back(code);
+  }
+  else if (code < 0x800) {
+    str.push_back(0xC0 | (code >> 6));
+    str.push_back(0x80 | (code & 0x3F));
+  }
+  else if (code < 0x10000) {
+    str.push_back(0xE0 | (code >> 12));
+    str.push_back(0x80 | ((code >> 6) & 0x3F));
+    str.push_back(0x80 | (code & 0x3F));
+  }
+  else {
+    str.push_back(0xF0 | (code >> 18));
+    str.push_back(0x80 | ((code >> 12) & 0x3F));
+    str.push_back(0x80 | ((code >>  6) & 0x3F));
+    str.push_back(0x80 | (code & 0x3F));
+  }
+}
+
+/**
+ * @brief Decode the XML entities and remove the leading and trailing spaces
+ */
+static std::string
+decode_text(const std::string & raw)
+{
+  static const struct { const char * name; char ch; } entities[] = {
+    { "amp;", '&' }, { "lt;", '<' }, { "gt;", '>' }, { "quot;", '"' }, { "apos;", '\'' }
+  };
+
+  std::string result;
+  size_t      i = 0;
+
+  while ((i < raw.size()) && isspace(raw[i])) i++;
+
+  while (i < raw.size()) {
+    if (raw[i] != '&') {
+      result.push_back(raw[i++]);
+      continue;
+    }
+
+    bool done = false;
+    if ((i + 1 < raw.size()) && (raw[i + 1] == '#')) {
+      size_t   j    = i + 2;
+      bool     hex  = (j < raw.size()) && ((raw[j] == 'x') || (raw[j] == 'X'));
+      uint32_t code = 0;
+      if (hex) j++;
+      size_t start = j;
+      while ((j < raw.size()) && (hex ? isxdigit(raw[j]) : isdigit(raw[j]))) {
+        code = (code * (hex ? 16 : 10)) + (isdigit(raw[j]) ? raw[j] - '0' : (tolower(raw[j]) - 'a' + 10));
+        j++;
+      }
+      if ((j > start) && (j < raw.size()) && (raw[j] == ';') && (code > 0) && (code <= 0x10FFFF)) {
+        append_utf8(result, code);
+        i    = j + 1;
+        done = true;
+      }
+    }
+    else {
+      for (auto & entity : entities) {
+        if (raw.compare(i + 1, strlen(entity.name), entity.name) == 0) {
+          result.push_back(entity.ch);
+          i   += strlen(entity.name) + 1;
+          done = true;
+          break;
+        }
+      }
+    }
+    if (!done) result.push_back(raw[i++]);
+  }
+
+  while (!result.empty() && isspace(result.back())) result.pop_back();
+  return result;
+}
+
+/**
+ * @brief Filename of a manifest item, relative to the epub root
+ *
+ * The href is relative to the OPF folder. It can contain characters as
+ * hexadecimal values starting with '%' and relative folder changes ('../').
+ */
+static std::string
+locate(const std::string & base_path, const std::string & href)
+{
+  std::string filename = base_path;
+
+  for (size_t i = 0; i < href.size(); ) {
+    if ((href[i] == '%') && (i + 2 < href.size()) && isxdigit(href[i + 1]) && isxdigit(href[i + 2])) {
+      filename.push_back((char) strtol(href.substr(i + 1, 2).c_str(), nullptr, 16));
+      i += 3;
+    }
+    else if (href.compare(i, 3, "../") == 0) {
+      if (!filename.empty()) filename.pop_back(); // The trailing '/'
+      size_t pos = filename.find_last_of('/');
+      filename.erase((pos == std::string::npos) ? 0 : pos + 1);
+      i += 3;
+    }
+    else {
+      filename.push_back(href[i++]);
+    }
+  }
+
+  return filename;
+}
+
+bool
+EPubProbe::get_opf_filename(std::string & filename)
+{
+  char     * data;
+  uint32_t   size;
+
+  if (!(data = zip->get_file("mimetype", size))) return false;
+  bool ok = (size >= 20) && (strncmp(data, "application/epub+zip", 20) == 0);
+  free(data);
+
+  if (!ok) {
+    LOG_E("This is not an EPUB ebook format.");
+    return false;
+  }
+
+  if (!(data = zip->get_file("META-INF/container.xml", size))) return false;
+
+  XMLScanner scanner;
+  scanner.on_tag = [&filename](const XMLScanner::Tag & tag) {
+    if ((tag.name == "rootfile") &&
+        (strcmp(tag.attribute("media-type"), "application/oebps-package+xml") == 0)) {
+      filename = tag.attribute("full-path");
+      return false;
+    }
+    return true;
+  };
+  scanner.feed(data, size);
+  free(data);
+
+  return !filename.empty();
+}
+
+bool
+EPubProbe::scan_opf(const std::string & filename)
+{
+  uint32_t size;
+
+  if (!zip->open_stream_file(filename.c_str(), size)) {
+    LOG_E("Unable to retrieve OPF file: %s", filename.c_str());
+    return false;
+  }
+
+  std::string base_path;
+  size_t      pos = filename.find_last_of('/');
+  if (pos != std::string::npos) base_path = filename.substr(0, pos + 1);
+
+  bool          compatible  = false;
+  bool          in_metadata = false;
+  bool          in_manifest = false;
+  std::string   cover_id;          // From <meta name="cover" content="..."/>
+  std::string   cover_href;        // Manifest item designated by cover_id
+  std::string   fallback_href;     // Manifest item with id "cover-image" or "cover"
+  std::string   raw;
+  std::string * field       = nullptr;
+  std::string   field_tag;
+
+  XMLScanner scanner;
+  scanner.on_tag = [&](const XMLScanner::Tag & tag) {
+    const char * name = tag.local_name();
+
+    if (field != nullptr) {
+      if (tag.closing && (tag.name == field_tag)) {
+        *field = decode_text(raw);
+        field  = nullptr;
+        scanner.text = nullptr;
+      }
+      return true;
+    }
+
+    if (tag.closing) {
+      if (strcmp(name, "metadata") == 0) in_metadata = false;
+      else if (strcmp(name, "manifest") == 0) return false;
+      return true;
+    }
+
+    if (strcmp(name, "package") == 0) {
+      // Verify that the OPF is of one of the versions understood by this application
+      const char * xmlns   = tag.attribute("xmlns");
+      const char * version = tag.attribute("version");
+      if (*xmlns == 0) xmlns = tag.attribute("xmlns:opf");
+      compatible = (strcmp(xmlns, "http://www.idpf.org/2007/opf") == 0) &&
+                   ((strcmp(version, "1.0") == 0) ||
+                    (strcmp(version, "2.0") == 0) ||
+                    (strcmp(version, "3.0") == 0));
+      return compatible;
+    }
+    else if (strcmp(name, "metadata") == 0) {
+      in_metadata = !tag.self_closing;
+    }
+    else if (strcmp(name, "manifest") == 0) {
+      in_metadata = false;
+      in_manifest = !tag.self_closing;
+      return in_manifest;
+    }
+    else if (strcmp(name, "spine") == 0) {
+      return false;
+    }
+    else if (in_metadata) {
+      if (strcmp(name, "meta") == 0) {
+        if (strcmp(tag.attribute("name"), "cover") == 0) cover_id = tag.attribute("content");
+      }
+      else if (!tag.self_closing && (tag.name.compare(0, 3, "dc:") == 0)) {
+        std::string * f = nullptr;
+        if      (strcmp(name, "title"      ) == 0) f = &title;
+        else if (strcmp(name, "creator"    ) == 0) f = &author;
+        else if (strcmp(name, "description") == 0) f = &description;
+        if ((f != nullptr) && f->empty()) {
+          field        = f;
+          field_tag    = tag.name;
+          raw.clear();
+          scanner.text = &raw;
+        }
+      }
+    }
+    else if (in_manifest && (strcmp(name, "item") == 0)) {
+      const char * id = tag.attribute("id");
+      if (!cover_id.empty() &&
+          ((cover_id == id) || (cover_id == tag.attribute("properties")))) {
+        cover_href = tag.attribute("href");
+        return false;
+      }
+      if (fallback_href.empty() &&
+          ((strcmp(id, "cover-image") == 0) || (strcmp(id, "cover") == 0))) {
+        fallback_href = tag.attribute("href");
+        if (cover_id.empty()) return false;
+      }
+    }
+    return true;
+  };
+
+  char   * buffer = (char *) allocate(CHUNK_SIZE);
+  bool     ok     = buffer != nullptr;
+  uint32_t total  = 0;
+
+  while (ok && (total < size)) {
+    uint32_t s = std::min(CHUNK_SIZE, size - total);
+    ok = zip->get_stream_data(buffer, s) && (s > 0);
+    if (ok) {
+      total += s;
+      if (!scanner.feed(buffer, s)) break;
+    }
+  }
+
+  zip->close_stream_file();
+  if (buffer != nullptr) free(buffer);
+
+  if (!compatible) {
+    LOG_E("This book is not compatible with this software.");
+    return false;
+  }
+
+  if (cover_href.empty()) cover_href = fallback_href;
+  if (!cover_href.empty()) cover_filename = locate(base_path, cover_href);
+
+  return ok;
+}
+
+bool
+EPubProbe::open_file(const std::string & epub_filename)
+{
+  close_file();
+
+  if ((zip == nullptr) && ((zip = new Unzip) == nullptr)) return false;
+
+  if (!zip->open_zip_file(epub_filename.c_str())) {
+    LOG_E("Unable to open zip file: %s", epub_filename.c_str());
+    return false;
+  }
+
+  file_is_open = true;
+
+  std::string filename;
+  if (!get_opf_filename(filename) || !scan_opf(filename)) {
+    LOG_E("Unable to retrieve metadata of %s", epub_filename.c_str());
+    close_file();
+    return false;
+  }
+
+  return true;
+}
+
+void
+EPubProbe::close_file()
+{
+  if (file_is_open) {
+    zip->close_zip_file();
+    file_is_open = false;
+  }
+
+  title.clear();
+  author.clear();
+  description.clear();
+  cover_filename.clear();
+}
+
+Image *
+EPubProbe::get_cover_image(Dim max)
+{
+  if (!file_is_open || cover_filename.empty()) return nullptr;
+
+  Image * img = ImageFactory::create(cover_filename, max, true, *zip);
+
+  if ((img != nullptr) &&
+      ((img->get_bitmap()      == nullptr) ||
+       (img->get_dim().height  == 0) ||
+       (img->get_dim().width   == 0))) {
+    delete img;
+    img = nullptr;
+  }
+
+  return img;
+}
@@ -0,0 +1,61 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "models/epub_probe.hpp"
+
+TEST(EPubProbeTest, english_book) {
+  EPubProbe probe;
+  ASSERT_TRUE(probe.open_file(BOOKS_FOLDER "/Austen, Jane - Pride and Prejudice.epub"));
+  EXPECT_EQ("Pride and Prejudice", probe.get_title());
+  EXPECT_EQ("Jane Austen",         probe.get_author());
+  EXPECT_EQ("",                    probe.get_description());
+  EXPECT_EQ("OEBPS/@public@vhost@g@gutenberg@html@files@1342@1342-h@images@cover.jpg",
+            probe.get_cover_filename());
+}
+
+TEST(EPubProbeTest, french_book) {
+  EPubProbe probe;
+  ASSERT_TRUE(probe.open_file(BOOKS_FOLDER "/Austen, Jane - Orgueil et préjugés.epub"));
+  EXPECT_EQ("Orgueil et préjugés", probe.get_title());
+  EXPECT_EQ("Austen, Jane",        probe.get_author());
+  EXPECT_EQ(0u, probe.get_description().find("En Angleterre, dans la société provinciale"));
+  EXPECT_EQ("cover.jpeg",          probe.get_cover_filename());
+}
+
+TEST(EPubProbeTest, cover_image) {
+  EPubProbe probe;
+  ASSERT_TRUE(probe.open_file(BOOKS_FOLDER "/Austen, Jane - Pride and Prejudice.epub"));
+
+  Image * img = probe.get_cover_image(Dim(140, 180));
+  ASSERT_NE(nullptr, img);
+  EXPECT_NE(nullptr, img->get_bitmap());
+  EXPECT_GE(140, img->get_dim().width);
+  EXPECT_GE(180, img->get_dim().height);
+  delete img;
+
+  probe.close_file();
+  EXPECT_EQ(nullptr, probe.get_cover_image(Dim(140, 180)));
+  EXPECT_EQ("",      probe.get_title());
+}
+
+TEST(EPubProbeTest, open_book_not_disturbed) {
+  ASSERT_TRUE(unzip.open_zip_file(BOOKS_FOLDER "/Austen, Jane - Pride and Prejudice.epub"));
+
+  EPubProbe probe;
+  ASSERT_TRUE(probe.open_file(BOOKS_FOLDER "/Austen, Jane - Orgueil et préjugés.epub"));
+  Image * img = probe.get_cover_image(Dim(140, 180));
+  EXPECT_NE(nullptr, img);
+  delete img;
+  probe.close_file();
+
+  EXPECT_TRUE(unzip.file_exists("OEBPS/@public@vhost@g@gutenberg@html@files@1342@1342-h@images@cover.jpg"));
+  unzip.close_zip_file();
+}
+
+TEST(EPubProbeTest, not_an_epub) {
+  EPubProbe probe;
+  EXPECT_FALSE(probe.open_file(MAIN_FOLDER "/config.txt"));
+  EXPECT_FALSE(probe.open_file(BOOKS_FOLDER "/no_such_book.epub"));
+}
+
+#endif
@@ -2,6 +2,7 @@
 
 #include "gtest/gtest.h"
 #include "models/epub.hpp"
+#include "models/ttf2.hpp"
 
 TEST(EpubTest, opening_epub_file) {
   EXPECT_TRUE(epub.open_file(BOOKS_FOLDER "/Austen, Jane - Pride and Prejudice.epub"));
@@ -25,6 +26,10 @@ TEST(EpubTest, check_adobe_obfuscated_file) {
   EXPECT_TRUE(epub.encryption_is_present());
   EXPECT_TRUE(epub.get_file_obfuscation("fonts/00005.otf") == EPub::ObfuscationType::ADOBE);
   EXPECT_TRUE(epub.load_font("fonts/00005.otf", "Test", Fonts::FaceStyle::NORMAL));
+  std::string font_path;
+  EXPECT_TRUE(epub.extract_font("fonts/00005.otf", font_path));
+  TTF font(font_path);
+  EXPECT_TRUE(font.is_ready());
   EXPECT_TRUE(epub.get_file_obfuscation("fonts/00000.otf") == EPub::ObfuscationType::NONE);
 }
 
@@ -33,6 +38,10 @@ TEST(EpubTest, check_adobe_idpf_file) {
   EXPECT_TRUE(epub.encryption_is_present());
   EXPECT_TRUE(epub.get_file_obfuscation("OEBPS/Fonts/Palatino-Roman.ttf") == EPub::ObfuscationType::IDPF);
   EXPECT_TRUE(epub.load_font("OEBPS/Fonts/Palatino-Roman.ttf", "Test", Fonts::FaceStyle::NORMAL));
+  std::string font_path;
+  EXPECT_TRUE(epub.extract_font("OEBPS/Fonts/Palatino-Roman.ttf", font_path));
+  TTF font(font_path);
+  EXPECT_TRUE(font.is_ready());
 }
 
 #endif
@@ -4,21 +4,62 @@
 
 #define _FONT_ 1
 #include "models/font.hpp"
+#include "models/glyph_atlas.hpp"
 #include "viewers/msg_viewer.hpp"
 
 #include "screen.hpp"
 #include "alloc.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <ostream>
+#include <vector>
 #include <sys/stat.h>
 
+std::atomic<uint32_t> Font::generation{ 1 };
+std::atomic<uint32_t> Font::pools_bytes{ 0 };
+std::atomic<uint32_t> Font::hits{ 0 };
+std::atomic<uint32_t> Font::misses{ 0 };
+std::atomic<uint32_t> Font::evictions{ 0 };
+std::atomic<uint32_t> Font::compactions{ 0 };
+
+// All fonts are registered, such that a font in need of glyphs memory can
+// reclaim space from the others when the budget is exhausted.
+
+static std::mutex                registry_mutex;
+static std::forward_list<Font *> registry;
+
 Font::Font()
 {
   memory_font       = nullptr;
   current_font_size = -1;
   ready             = false;
- }
+  font_hash         = 0;
+  atlases           = nullptr;
+
+  glyphs_tables.store(nullptr, std::memory_order_relaxed);
+  last_glyphs_table.store(nullptr, std::memory_order_relaxed);
+
+  std::scoped_lock guard(registry_mutex);
+  registry.push_front(this);
+}
+
+Font::~Font()
+{
+  std::scoped_lock guard(registry_mutex);
+  registry.remove(this);
+}
+
+void
+Font::get_cache_stats(CacheStats & stats)
+{
+  stats.hits        = hits.load(std::memory_order_relaxed);
+  stats.misses      = misses.load(std::memory_order_relaxed);
+  stats.evictions   = evictions.load(std::memory_order_relaxed);
+  stats.compactions = compactions.load(std::memory_order_relaxed);
+  stats.bytes       = pools_bytes.load(std::memory_order_relaxed);
+  stats.budget      = GLYPH_CACHE_BUDGET;
+}
 
 void
 Font::add_buff_to_byte_pool()
@@ -28,7 +69,8 @@ Font::add_buff_to_byte_pool()
     LOG_E("Unable to allocated memory for bytes pool.");
     msg_viewer.out_of_memory("ttf pool allocation");
   }
-  byte_pools.push_front(pool);
+  byte_pools.push_front({ .pool = pool, .live = 0 });
+  pools_bytes.fetch_add(BYTE_POOL_SIZE, std::memory_order_relaxed);
 
   byte_pool_idx = 0;
 }
@@ -41,53 +83,342 @@ Font::byte_pool_alloc(uint16_t size)
     std::abort();
   }
   if (byte_pools.empty() || (byte_pool_idx + size) > BYTE_POOL_SIZE) {
-    LOG_D("Adding new Byte Pool buffer.");
-    add_buff_to_byte_pool();
+    release_retired();
+    if ((pools_bytes.load(std::memory_order_relaxed) + BYTE_POOL_SIZE) > GLYPH_CACHE_BUDGET) {
+      reclaim_all();
+    }
+    // The compaction may have added a pool with enough room left
+    if (byte_pools.empty() || (byte_pool_idx + size) > BYTE_POOL_SIZE) {
+      LOG_D("Adding new Byte Pool buffer.");
+      add_buff_to_byte_pool();
+    }
   }
 
-  uint8_t * buff = &(*byte_pools.front())[byte_pool_idx];
+  uint8_t * buff = &(*byte_pools.front().pool)[byte_pool_idx];
   byte_pool_idx += size;
+  byte_pools.front().live += size;
 
   return buff;
 }
 
+Font::BytePoolEntry *
+Font::pool_of(const unsigned char * buffer)
+{
+  for (auto & entry : byte_pools) {
+    if ((buffer >= *entry.pool) && (buffer < (*entry.pool + BYTE_POOL_SIZE))) return &entry;
+  }
+  return nullptr;
+}
+
+void
+Font::release_retired()
+{
+  uint32_t now = generation.load(std::memory_order_relaxed);
+
+  retired_glyphs.remove_if([this, now](const RetiredGlyph & r) {
+    if ((r.generation + KEPT_GENERATIONS) > now) return false;
+    bitmap_glyph_pool.deleteElement(r.glyph);
+    return true;
+  });
+  retired_pools.remove_if([now](const RetiredPool & r) {
+    if ((r.generation + KEPT_GENERATIONS) > now) return false;
+    free(r.pool);
+    return true;
+  });
+}
+
+uint32_t
+Font::reclaim()
+{
+  struct Candidate {
+    uint32_t generation;
+    uint32_t code;
+    Glyphs * table;
+    Glyph  * glyph;
+  };
+
+  uint32_t now      = generation.load(std::memory_order_relaxed);
+  uint32_t released = 0;
+
+  // ----- Evict least recently used glyphs -----
+
+  std::vector<Candidate> candidates;
+  for (Glyphs * table = glyphs_tables.load(std::memory_order_relaxed); table != nullptr; table = table->next) {
+    table->for_each([&](uint32_t code, Glyph * glyph) {
+      if ((glyph->generation + KEPT_GENERATIONS) <= now) {
+        candidates.push_back({ .generation = glyph->generation, .code = code, .table = table, .glyph = glyph });
+      }
+    });
+  }
+
+  if (candidates.empty()) return 0;
+
+  std::sort(candidates.begin(), candidates.end(), 
+            [](const Candidate & a, const Candidate & b) { return a.generation < b.generation; });
+
+  // Evict until at least two pools worth of bitmaps are freed. 
+
+  uint32_t evicted_bytes = 0;
+  for (auto & c : candidates) {
+    if (evicted_bytes >= (BYTE_POOL_SIZE << 1)) break;
+    c.table->remove(c.code);
+    uint32_t size = glyph_bytes(c.glyph);
+    if (size > 0) {
+      BytePoolEntry * entry = pool_of(c.glyph->buffer);
+      if (entry != nullptr) entry->live -= size;
+      evicted_bytes += size;
+    }
+    retired_glyphs.push_front({ .generation = now, .glyph = c.glyph });
+    evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // ----- Compact sparse pools -----
+  //
+  // The current pool (front) is never compacted. Pools less than half full are
+  // retired after their remaining glyphs bitmap have been moved to fresh pools.
+
+  BytePools sparse;
+  auto prev = byte_pools.begin();
+  if (prev == byte_pools.end()) return 0;
+  for (auto it = std::next(prev); it != byte_pools.end(); ) {
+    if (it->live < (BYTE_POOL_SIZE >> 1)) {
+      sparse.push_front(*it);
+      it = byte_pools.erase_after(prev);
+    }
+    else {
+      prev = it++;
+    }
+  }
+
+  if (sparse.empty()) return 0;
+
+  for (Glyphs * table = glyphs_tables.load(std::memory_order_relaxed); table != nullptr; table = table->next) {
+    table->for_each([&](uint32_t code, Glyph * glyph) {
+      uint32_t size = glyph_bytes(glyph);
+      if (size == 0) return;
+      for (auto & entry : sparse) {
+        if ((glyph->buffer >= *entry.pool) && (glyph->buffer < (*entry.pool + BYTE_POOL_SIZE))) {
+          if ((byte_pool_idx + size) > BYTE_POOL_SIZE) add_buff_to_byte_pool();
+          uint8_t * buff = &(*byte_pools.front().pool)[byte_pool_idx];
+          memcpy(buff, glyph->buffer, size);
+          byte_pool_idx += size;
+          byte_pools.front().live += size;
+          __atomic_store_n(&glyph->buffer, buff, __ATOMIC_RELEASE);
+          break;
+        }
+      }
+    });
+  }
+
+  for (auto & entry : sparse) {
+    retired_pools.push_front({ .generation = now, .pool = entry.pool });
+    pools_bytes.fetch_sub(BYTE_POOL_SIZE, std::memory_order_relaxed);
+    released += BYTE_POOL_SIZE;
+  }
+  compactions.fetch_add(1, std::memory_order_relaxed);
+
+  LOG_D("Glyphs cache reclaim: %u glyphs evicted, %u bytes released.", (unsigned) candidates.size(), released);
+
+  return released;
+}
+
+void
+Font::reclaim_all()
+{
+  if (reclaim() > 0) return;
+
+  // Nothing to get from this font. Try the others, without waiting on 
+  // a font that is busy.
+
+  std::scoped_lock guard(registry_mutex);
+
+  for (Font * font : registry) {
+    if ((font != this) && font->mutex.try_lock()) {
+      uint32_t released = font->reclaim();
+      font->mutex.unlock();
+      if (released > 0) return;
+    }
+  }
+
+  LOG_D("Glyphs cache budget exceeded: %u bytes.", pools_bytes.load(std::memory_order_relaxed));
+}
+
 void
 Font::clear_cache()
 {
   std::scoped_lock guard(mutex);
   
   LOG_D("Clear cache...");
-  for (auto const & entry : cache) {
-    for (auto const & glyph : entry.second) {
-      bitmap_glyph_pool.deleteElement(glyph.second);      
-    }
+
+  // Glyph pointers obtained from the cache are not valid anymore after this point.
+  // Callers must not have a layout or paint in progress on this font.
+
+  Glyphs * table = glyphs_tables.exchange(nullptr, std::memory_order_acq_rel);
+  last_glyphs_table.store(nullptr, std::memory_order_release);
+
+  while (table != nullptr) {
+    Glyphs * next = table->next;
+    table->for_each([this](uint32_t code, Glyph * glyph) {
+      bitmap_glyph_pool.deleteElement(glyph);
+    });
+    table->~Glyphs();
+    free(table);
+    table = next;
   }
 
-  for (auto * buff : byte_pools) {
-    free(buff);
+  for (auto & entry : byte_pools) {
+    free(entry.pool);
+    pools_bytes.fetch_sub(BYTE_POOL_SIZE, std::memory_order_relaxed);
   }
   byte_pools.clear();
-  
-  cache.clear();
-  cache.reserve(50);
+
+  for (auto & r : retired_glyphs) bitmap_glyph_pool.deleteElement(r.glyph);
+  for (auto & r : retired_pools ) free(r.pool);
+  retired_glyphs.clear();
+  retired_pools.clear();
+
+  while (atlases != nullptr) {
+    GlyphAtlas * next = atlases->next;
+    delete atlases; // Pending glyphs are flushed
+    atlases = next;
+  }
+}
+
+void
+Font::flush_atlases()
+{
+  std::scoped_lock guard(mutex);
+
+  for (GlyphAtlas * atlas = atlases; atlas != nullptr; atlas = atlas->next) {
+    atlas->flush();
+  }
+}
+
+uint32_t
+Font::compute_font_hash(const uint8_t * head, int32_t head_size,
+                        const uint8_t * tail, int32_t tail_size,
+                        int32_t size)
+{
+  uint32_t hash = 2166136261U;
+
+  auto fnv = [&hash](const uint8_t * data, int32_t length) {
+    while (length-- > 0) hash = (hash ^ *data++) * 16777619U;
+  };
+
+  fnv((const uint8_t *) &size, sizeof(size));
+  fnv(head, head_size);
+  fnv(tail, tail_size);
+
+  return (hash == 0) ? 1 : hash;
+}
+
+GlyphAtlas *
+Font::get_atlas(int16_t glyph_size)
+{
+  if (font_hash == 0) return nullptr;
+
+  GlyphAtlas * atlas = atlases;
+  while ((atlas != nullptr) && (atlas->get_glyph_size() != glyph_size)) atlas = atlas->next;
+
+  if (atlas == nullptr) {
+    atlas = new GlyphAtlas(font_hash, glyph_size);
+    atlas->next = atlases;
+    atlases = atlas;
+  }
+
+  return atlas;
+}
+
+Font::Glyph *
+Font::load_from_atlas(uint32_t code, int16_t glyph_size)
+{
+  GlyphAtlas * atlas = get_atlas(glyph_size);
+  if (atlas == nullptr) return nullptr;
+
+  Glyph * glyph = bitmap_glyph_pool.newElement();
+
+  if (glyph == nullptr) {
+    LOG_E("Unable to allocate memory for glyph.");
+    msg_viewer.out_of_memory("glyph allocation");
+  }
+
+  if (!atlas->load(code, *glyph, *this)) {
+    // Bitmap space possibly taken from a byte pool will be recovered through compaction.
+    if (glyph->buffer != nullptr) {
+      BytePoolEntry * entry = pool_of(glyph->buffer);
+      if (entry != nullptr) entry->live -= glyph_bytes(glyph);
+    }
+    bitmap_glyph_pool.deleteElement(glyph);
+    return nullptr;
+  }
+
+  add_glyph(code, glyph_size, glyph);
+
+  return glyph;
+}
+
+void
+Font::save_to_atlas(uint32_t code, int16_t glyph_size, const Glyph * glyph)
+{
+  GlyphAtlas * atlas = get_atlas(glyph_size);
+  if (atlas != nullptr) atlas->save(code, *glyph);
+}
+
+void
+Font::add_glyph(uint32_t code, int16_t glyph_size, Glyph * glyph)
+{
+  Glyphs * table = glyphs_tables.load(std::memory_order_relaxed);
+  while ((table != nullptr) && (table->get_glyph_size() != glyph_size)) table = table->next;
+
+  if (table == nullptr) {
+    void * mem = allocate(sizeof(Glyphs));
+    if (mem == nullptr) {
+      LOG_E("Unable to allocate memory for glyphs table.");
+      msg_viewer.out_of_memory("glyphs table allocation");
+      return;
+    }
+    table = new (mem) Glyphs(glyph_size);
+    table->next = glyphs_tables.load(std::memory_order_relaxed);
+    glyphs_tables.store(table, std::memory_order_release);
+  }
+
+  glyph->generation = generation.load(std::memory_order_relaxed);
+  misses.fetch_add(1, std::memory_order_relaxed);
+
+  if (!table->insert(code, glyph)) {
+    LOG_E("Unable to allocate memory for glyphs table.");
+    msg_viewer.out_of_memory("glyphs table allocation");
+  }
 }
 
 Font::Glyph *
 Font::get_glyph(uint32_t charcode, int16_t glyph_size)
 {
+  if (!ready) return nullptr;
+
+  Glyph * glyph = find_glyph(charcode, glyph_size);
+  if (glyph != nullptr) return glyph;
+
   std::scoped_lock guard(mutex);
 
-  return ready ? get_glyph_internal(charcode, glyph_size) : nullptr;
+  return get_glyph_internal(charcode, glyph_size);
 }
 
 
 Font::Glyph *
 Font::get_glyph(uint32_t charcode, uint32_t next_charcode, int16_t glyph_size, int16_t & kern, bool & ignore_next)
 {
+  ignore_next = false;
+
+  Font::Glyph * glyph = find_glyph(charcode, glyph_size);
+  if ((glyph != nullptr) && (glyph->ligature_and_kern_pgm_index < 0)) {
+    kern = glyph->advance;
+    return glyph;
+  }
+
   std::scoped_lock guard(mutex);
 
-  ignore_next = false;
-  Font::Glyph * glyph = get_glyph_internal(charcode, glyph_size);
+  glyph = get_glyph_internal(charcode, glyph_size);
 
   if (glyph != nullptr) {
     if (glyph->ligature_and_kern_pgm_index >= 0) {
@@ -0,0 +1,33 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "models/ttf2.hpp"
+
+TEST(FontCacheTest, budget_kept_while_paging) {
+  TTF font(FONTS_FOLDER "/Asap-Regular.otf");
+  ASSERT_TRUE(font.is_ready());
+
+  Font::CacheStats before, stats;
+  Font::get_cache_stats(before);
+
+  // Each page uses glyphs of a size not seen on the last pages, such that 
+  // paging through the book needs much more than the budget.
+
+  uint32_t needed = 0;
+  for (int16_t page = 0; page < 400; page++) {
+    Font::next_generation();
+    int16_t size = 20 + (page % 80);
+    for (uint32_t code = '!'; code <= '~'; code++) {
+      Font::Glyph * glyph = font.get_glyph(code, size);
+      ASSERT_NE(nullptr, glyph);
+      if (page < 80) needed += glyph->bitmap_size;
+    }
+    Font::get_cache_stats(stats);
+    ASSERT_LE(stats.bytes, stats.budget) << "page " << page;
+  }
+
+  EXPECT_GT(needed, stats.budget);
+  EXPECT_GT(stats.evictions, before.evictions);
+}
+
+#endif
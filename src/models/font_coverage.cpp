@@ -0,0 +1,142 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#define _FONT_COVERAGE_ 1
+#include "models/font_coverage.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
+
+static const char MAGIC[4] = { 'G', 'C', 'O', 'V' };
+
+FontCoverage::FontCoverage()
+{
+  clear();
+}
+
+void
+FontCoverage::clear()
+{
+  ranges.clear();
+  maps.clear();
+  memset(pages, 0, sizeof(pages));
+  known = false;
+}
+
+void
+FontCoverage::add(uint32_t code)
+{
+  if (!ranges.empty() && (ranges.back().last + 1 == code)) {
+    ranges.back().last = code;
+  }
+  else if (ranges.empty() || (ranges.back().last < code)) {
+    ranges.push_back({ .first = code, .last = code });
+  }
+}
+
+void
+FontCoverage::build()
+{
+  maps.clear();
+  memset(pages, 0, sizeof(pages));
+
+  for (auto & range : ranges) {
+    if (range.first > 0xFFFF) break;
+    uint32_t last = std::min(range.last, (uint32_t) 0xFFFF);
+
+    for (uint32_t code = range.first; code <= last; ) {
+      uint32_t   page_first = code & 0xFF00;
+      uint16_t & page       = pages[code >> 8];
+
+      if ((code == page_first) && (last >= (page_first + 0xFF))) {
+        page  = FULL_PAGE;
+        code += 0x100;
+        continue;
+      }
+
+      if (page == EMPTY_PAGE) {
+        page = FIRST_MAP + maps.size();
+        maps.push_back(PageMap{});
+      }
+      maps[page - FIRST_MAP][(code >> 5) & 7] |= 1 << (code & 31);
+      code++;
+    }
+  }
+
+  known = true;
+}
+
+bool
+FontCoverage::covers_above_bmp(uint32_t code) const
+{
+  auto it = std::upper_bound(ranges.begin(), ranges.end(), code,
+                             [](uint32_t c, const Range & r) { return c < r.first; });
+  return (it != ranges.begin()) && ((--it)->last >= code);
+}
+
+std::string
+FontCoverage::filename(uint32_t font_hash)
+{
+  char name[20];
+  snprintf(name, 20, "/%08X.gcv", font_hash);
+  return std::string(ATLAS_FOLDER).append(name);
+}
+
+bool
+FontCoverage::load(uint32_t font_hash)
+{
+  clear();
+  if (font_hash == 0) return false;
+
+  FILE * f = fopen(filename(font_hash).c_str(), "rb");
+  if (f == nullptr) return false;
+
+  Header header;
+  bool   ok = (fread(&header, sizeof(Header), 1, f) == 1) &&
+              (memcmp(header.magic, MAGIC, 4) == 0) &&
+              (header.version == VERSION);
+
+  if (ok) {
+    ranges.resize(header.count);
+    ok = fread(ranges.data(), sizeof(Range), header.count, f) == header.count;
+  }
+
+  fclose(f);
+
+  if (!ok) {
+    LOG_E("Font coverage for %08X is corrupted.", font_hash);
+    clear();
+    return false;
+  }
+
+  build();
+  return true;
+}
+
+void
+FontCoverage::save(uint32_t font_hash) const
+{
+  if ((font_hash == 0) || !known) return;
+
+  mkdir(ATLAS_FOLDER, 0775);
+
+  FILE * f = fopen(filename(font_hash).c_str(), "wb");
+  if (f == nullptr) {
+    LOG_E("Unable to save font coverage for %08X.", font_hash);
+    return;
+  }
+
+  const Header header = { 
+    .magic   = { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3] }, 
+    .version = VERSION,
+    .count   = (uint32_t) ranges.size()
+  };
+
+  bool ok = (fwrite(&header, sizeof(Header), 1, f) == 1) &&
+            (fwrite(ranges.data(), sizeof(Range), ranges.size(), f) == ranges.size());
+  fclose(f);
+
+  if (!ok) remove(filename(font_hash).c_str());
+}
@@ -0,0 +1,45 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "models/font_coverage.hpp"
+
+#include <cstdlib>
+#include <set>
+
+TEST(FontCoverageTest, unknown_covers_everything) {
+  FontCoverage coverage;
+  EXPECT_FALSE(coverage.is_known());
+  EXPECT_TRUE(coverage.covers('A'));
+  EXPECT_TRUE(coverage.covers(0x4E00));
+  EXPECT_TRUE(coverage.covers(0x1F600));
+}
+
+TEST(FontCoverageTest, same_as_code_set) {
+  std::set<uint32_t> codes;
+  srand(4321);
+  for (uint32_t code = 0x20; code < 0x250; code++) codes.insert(code);   // Full pages and partial ones
+  for (uint32_t code = 0x370; code < 0x400; code += 1 + (rand() % 3)) codes.insert(code);
+  for (uint32_t code = 0x4E00; code < 0x6000; code++) codes.insert(code);
+  for (int i = 0; i < 500; i++) codes.insert(rand() % 0x10000);
+  for (uint32_t code = 0x1F300; code < 0x1F320; code++) codes.insert(code);
+  codes.insert(0xFFFF);
+  codes.insert(0x10FFFF);
+
+  FontCoverage coverage;
+  for (auto code : codes) coverage.add(code);
+  coverage.build();
+
+  EXPECT_TRUE(coverage.is_known());
+  for (uint32_t code = 0; code <= 0x110000; code++) {
+    ASSERT_EQ(coverage.covers(code), codes.find(code) != codes.end()) << std::hex << code;
+  }
+}
+
+TEST(FontCoverageTest, empty_coverage) {
+  FontCoverage coverage;
+  coverage.build();
+  EXPECT_FALSE(coverage.covers('A'));
+  EXPECT_FALSE(coverage.covers(0x1F600));
+}
+
+#endif
@@ -0,0 +1,174 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#define _FONT_STREAM_ 1
+#include "models/font_stream.hpp"
+
+#include "alloc.hpp"
+
+#include <cstring>
+#include <sys/stat.h>
+
+std::atomic<int8_t> FontStream::open_files{ 0 };
+
+FontStream::FontStream() :
+  file(nullptr),
+  size(0),
+  use_count(0)
+{
+  for (auto & page : pages) {
+    page.offset   = 0;
+    page.last_use = 0;
+    page.length   = 0;
+    page.data     = nullptr;
+  }
+  memset(&ft_stream, 0, sizeof(ft_stream));
+}
+
+FontStream::~FontStream()
+{
+  close();
+}
+
+bool
+FontStream::open(const std::string & font_filename)
+{
+  struct stat file_stat;
+
+  close();
+
+  if (stat(font_filename.c_str(), &file_stat) == -1) {
+    LOG_E("Font file not found: %s", font_filename.c_str());
+    return false;
+  }
+
+  filename = font_filename;
+  size     = file_stat.st_size;
+
+  memset(&ft_stream, 0, sizeof(ft_stream));
+  ft_stream.base               = nullptr;
+  ft_stream.size               = size;
+  ft_stream.pos                = 0;
+  ft_stream.descriptor.pointer = this;
+  ft_stream.read               = ft_read;
+  ft_stream.close              = ft_close;
+
+  return true;
+}
+
+void
+FontStream::close()
+{
+  if (file != nullptr) {
+    fclose(file);
+    file = nullptr;
+    open_files.fetch_sub(1);
+  }
+
+  for (auto & page : pages) {
+    if (page.data != nullptr) {
+      free(page.data);
+      page.data = nullptr;
+    }
+    page.length = 0;
+  }
+}
+
+uint32_t
+FontStream::read_file(uint32_t offset, uint8_t * buffer, uint32_t count)
+{
+  FILE * f = file;
+  if (f == nullptr) {
+    if ((f = fopen(filename.c_str(), "rb")) == nullptr) {
+      LOG_E("Unable to open font file %s", filename.c_str());
+      return 0;
+    }
+    if (open_files.fetch_add(1) < MAX_OPEN_FILES) {
+      file = f;
+    }
+    else {
+      open_files.fetch_sub(1);
+    }
+  }
+
+  uint32_t result = 0;
+  if (fseek(f, offset, SEEK_SET) == 0) result = fread(buffer, 1, count, f);
+
+  if (f != file) fclose(f);
+
+  return result;
+}
+
+FontStream::Page *
+FontStream::get_page(uint32_t page_offset)
+{
+  Page * victim = &pages[0];
+
+  for (auto & page : pages) {
+    if ((page.data != nullptr) && (page.offset == page_offset)) {
+      page.last_use = ++use_count;
+      return &page;
+    }
+    if (page.last_use < victim->last_use) victim = &page;
+  }
+
+  if (victim->data == nullptr) {
+    if ((victim->data = (uint8_t *) allocate(PAGE_SIZE)) == nullptr) return nullptr;
+  }
+
+  victim->offset   = page_offset;
+  victim->length   = read_file(page_offset, victim->data, PAGE_SIZE);
+  victim->last_use = ++use_count;
+
+  return victim;
+}
+
+uint32_t
+FontStream::read(uint32_t offset, uint8_t * buffer, uint32_t count)
+{
+  if (offset >= size) return 0;
+  if ((offset + count) > size) count = size - offset;
+
+  if (count >= (PAGE_SIZE * PAGE_COUNT / 2)) {
+    // Big tables are read directly, the cache would be flushed anyway.
+    return read_file(offset, buffer, count);
+  }
+
+  uint32_t done = 0;
+
+  while (done < count) {
+    uint32_t page_offset = (offset + done) - ((offset + done) % PAGE_SIZE);
+    Page   * page        = get_page(page_offset);
+
+    if (page == nullptr) return done + read_file(offset + done, buffer + done, count - done);
+
+    uint32_t from = (offset + done) - page_offset;
+    if (from >= page->length) break;
+
+    uint32_t length = page->length - from;
+    if (length > (count - done)) length = count - done;
+
+    memcpy(buffer + done, page->data + from, length);
+    done += length;
+  }
+
+  return done;
+}
+
+unsigned long
+FontStream::ft_read(FT_Stream stream, unsigned long offset, unsigned char * buffer, unsigned long count)
+{
+  FontStream * font_stream = (FontStream *) stream->descriptor.pointer;
+
+  // A count of 0 is a seek request: an error is reported with a non-zero value.
+  if (count == 0) return (offset > font_stream->size) ? 1 : 0;
+
+  return font_stream->read(offset, buffer, count);
+}
+
+void
+FontStream::ft_close(FT_Stream stream)
+{
+  ((FontStream *) stream->descriptor.pointer)->close();
+}
@@ -6,6 +6,7 @@
 #include "models/fonts.hpp"
 
 #include "models/config.hpp"
+#include "models/epub.hpp"
 #include "models/font_factory.hpp"
 #include "viewers/msg_viewer.hpp"
 #include "viewers/form_viewer.hpp"
@@ -69,7 +70,6 @@ Fonts::get_file(const char * filename, uint32_t size)
   return buff;
 }
 
-static uint32_t font_size;
 inline bool check_res(xml_parse_result res) { return res.status == status_ok; }
 
 static bool check_file(const std::string & filename) 
@@ -79,11 +79,8 @@ static bool check_file(const std::string & filename)
   if (!filename.empty()) {
     std::string full_name = std::string(FONTS_FOLDER "/").append(filename); 
     if (stat(full_name.c_str(), &file_stat) != -1) {
-      font_size += file_stat.st_size;
-      if (font_size > (1024 * 300)) {
-        LOG_E("Font size too big for %s", filename.c_str());
-      }
-      else return true;
+      // Font files are read on demand: there is no size limit.
+      return true;
     }
     else {
       LOG_E("Font file can't be found: %s", full_name.c_str());
@@ -165,7 +162,6 @@ bool Fonts::setup()
     for (auto fnt : user_group.children("font")) {
       if (font_count >= 8) break;
       std::string str = fnt.attribute("name").value();
-      font_size = 0;
       if (!str.empty()) {
         LOG_D("%s...", str.c_str());
         font_names[font_count] = char_pool.set(str);
@@ -239,12 +235,15 @@ Fonts::clear(bool all)
   std::scoped_lock guard(mutex);
   
   // LOG_D("Fonts Clear!");
-  // Keep the first 7 fonts as they are reused. Caches will be cleared.
+  // Keep the first 7 fonts as they are reused, with their glyphs cache: 
+  // it is trimmed by the memory budget, not by book or format changes.
   #if USE_EPUB_FONTS
     int i = 0;
     for (auto & entry : font_cache) {
-      if ((all && (i >= 3)) || (i >= 7)) delete entry.font;
-      else entry.font->clear_cache();
+      if ((all && (i >= 3)) || (i >= 7)) {
+        delete entry.font;
+        if (!entry.path.empty()) remove(entry.path.c_str());
+      }
       i++;
     }
     font_cache.resize(all ? 3 : 7);
@@ -261,6 +260,7 @@ Fonts::clear_everything()
   // Keep the first 7 fonts as they are reused. Caches will be cleared.
   for (auto & entry : font_cache) {
     delete entry.font;
+    if (!entry.path.empty()) remove(entry.path.c_str());
   }
   font_cache.resize(0);
   font_cache.reserve(20);
@@ -288,7 +288,17 @@ void
 Fonts::clear_glyph_caches()
 {
   for (auto & entry : font_cache) {
-    entry.font->clear_cache();
+    if (entry.font != nullptr) entry.font->clear_cache();
+  }
+}
+
+void
+Fonts::flush_atlases()
+{
+  std::scoped_lock guard(mutex);
+
+  for (auto & entry : font_cache) {
+    if (entry.font != nullptr) entry.font->flush_atlases();
   }
 }
 
@@ -308,6 +318,25 @@ Fonts::get_index(const std::string & name, FaceStyle style)
   return -1;
 }
 
+Font *
+Fonts::get_fallback(uint32_t charcode, int16_t index)
+{
+  std::scoped_lock guard(mutex);
+
+  if (index >= font_cache.size()) return nullptr;
+  FaceStyle style = font_cache[index].style;
+
+  for (int pass = 0; pass < 2; pass++) {
+    for (int16_t idx = 1; idx < font_cache.size(); idx++) {
+      const FontEntry & entry = font_cache[idx];
+      if ((idx == index) || (entry.font == nullptr)) continue;
+      if ((entry.style == style) != (pass == 0)) continue;
+      if (entry.font->covers(charcode)) return entry.font;
+    }
+  }
+  return nullptr;
+}
+
 bool 
 Fonts::replace(int16_t             index,
                const std::string & name, 
@@ -425,6 +454,65 @@ Fonts::add(const std::string & name,
   return false;
 }
 
+void
+Fonts::add_deferred(const std::string & name, 
+                    FaceStyle           style,
+                    const std::string & source)
+{
+  std::scoped_lock guard(mutex);
+  
+  // If the font is already known, return promptly
+  for (auto & font : font_cache) {
+    if ((name.compare(font.name) == 0) && 
+        (font.style == style)) return;
+  }
+
+  FontEntry f;
+  f.name   = name;
+  f.font   = nullptr;
+  f.style  = style;
+  f.source = source;
+  font_cache.push_back(f);
+
+  LOG_D("Font %s deferred at index %d and style %d.",
+    f.name.c_str(), 
+    font_cache.size() - 1,
+    (int)f.style);
+}
+
+Font *
+Fonts::load(int16_t index)
+{
+  std::scoped_lock guard(mutex);
+
+  FontEntry & entry = font_cache.at(index);
+
+  if ((entry.font == nullptr) && !entry.source.empty()) {
+    std::string path;
+    if (epub.extract_font(entry.source, path)) {
+      Font * font = FontFactory::create(path);
+      if ((font != nullptr) && font->is_ready()) {
+        font->set_fonts_cache_index(index);
+        entry.path = path;
+        entry.font = font;
+        LOG_D("Font %s loaded at index %d.", entry.name.c_str(), index);
+      }
+      else {
+        LOG_E("Unable to load font %s from %s.", entry.name.c_str(), entry.source.c_str());
+        delete font;
+        remove(path.c_str());
+      }
+    }
+    entry.source.clear();
+    entry.failed = (entry.font == nullptr); // No retry, get() goes to the default font
+  }
+
+  if (entry.font != nullptr) return entry.font;
+
+  // Replaced by the default font of the same style.
+  return get_default(entry.style);
+}
+
 Fonts::FaceStyle
 Fonts::adjust_font_style(FaceStyle style, FaceStyle font_style, FaceStyle font_weight) const
 {
@@ -0,0 +1,233 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "helpers/frame_blitter.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+// Golden image tests: each blitter is compared with the per-pixel path the
+// InkPlate Screen class was using, for all orientations.
+
+typedef FrameBlitter::Orientation Orientation;
+
+class TestFrameBuffer
+{
+  public:
+    // The panel is PANEL_WIDTH x PANEL_HEIGHT pixels, in landscape mode.
+    static constexpr uint32_t PANEL_WIDTH  = 96;
+    static constexpr uint32_t PANEL_HEIGHT = 64;
+
+    TestFrameBuffer(bool three_bits) :
+      line_size(three_bits ? (PANEL_WIDTH / 2) : (PANEL_WIDTH / 8)),
+      data(line_size * PANEL_HEIGHT + 1, 0) { } // The TOP orientation addresses one byte past the end
+
+    uint8_t * get_data()      { return data.data(); }
+    uint32_t  get_data_size() { return line_size * PANEL_HEIGHT; }
+    uint32_t  get_line_size() { return line_size; }
+
+    void fill_random() { for (auto & v : data) v = rand() & 0xFF; }
+
+    bool operator==(const TestFrameBuffer & other) const { return data == other.data; }
+
+  private:
+    uint32_t             line_size;
+    std::vector<uint8_t> data;
+};
+
+static bool
+portrait(Orientation o)
+{
+  return (o == Orientation::LEFT) || (o == Orientation::RIGHT);
+}
+
+static uint32_t screen_width (Orientation o) { return portrait(o) ? TestFrameBuffer::PANEL_HEIGHT : TestFrameBuffer::PANEL_WIDTH;  }
+static uint32_t screen_height(Orientation o) { return portrait(o) ? TestFrameBuffer::PANEL_WIDTH  : TestFrameBuffer::PANEL_HEIGHT; }
+
+static std::vector<uint8_t>
+random_gray(int width, int height)
+{
+  std::vector<uint8_t> bitmap(width * height);
+  for (auto & v : bitmap) v = (rand() % 3 == 0) ? (rand() & 0xFF) : 0;
+  return bitmap;
+}
+
+template <Orientation O>
+static void
+check_glyph_1bit()
+{
+  srand(100 + (int) O);
+  for (int n = 0; n < 300; n++) {
+    uint16_t width  = 1 + (rand() % 30);
+    uint16_t height = 1 + (rand() % 30);
+    uint16_t pitch  = ((width + 7) >> 3) + (rand() % 2);
+    Pos      pos(rand() % screen_width(O), rand() % screen_height(O));
+
+    std::vector<uint8_t> bitmap(pitch * height);
+    for (auto & v : bitmap) v = rand() & 0xFF;
+
+    uint32_t x_max = pos.x + width;
+    uint32_t y_max = pos.y + height;
+    if (y_max > screen_height(O)) y_max = screen_height(O);
+    if (x_max > screen_width(O) ) x_max = screen_width(O);
+
+    TestFrameBuffer expected(false), result(false);
+
+    // As done by Screen::draw_glyph
+    for (uint32_t j = pos.y, q = 0; j < y_max; j++, q++) {
+      const unsigned char * row = &bitmap[q * pitch];
+      for (uint32_t i = pos.x, k = 0; i < x_max; i += 8, k++) {
+        uint8_t bits = row[k];
+        uint32_t end = ((i + 8) < x_max) ? (i + 8) : x_max;
+        for (uint32_t x = i; x < end; x++, bits <<= 1) {
+          if (bits & 0x80) FrameBlitter::set_pixel_1bit<O>(expected, x, j, 1);
+        }
+      }
+    }
+
+    FrameBlitter::glyph_1bit<O>(result, bitmap.data(), pos, pitch, x_max, y_max);
+
+    ASSERT_TRUE(expected == result) << "glyph " << n;
+  }
+}
+
+template <Orientation O>
+static void
+check_image_1bit()
+{
+  srand(400 + (int) O);
+  for (int n = 0; n < 300; n++) {
+    uint16_t width  = 1 + (rand() % 40);
+    uint16_t height = 1 + (rand() % 40);
+    uint16_t pitch  = (width + 7) >> 3;
+    Pos      pos(rand() % screen_width(O), rand() % screen_height(O));
+
+    std::vector<uint8_t> bitmap(pitch * height);
+    for (auto & v : bitmap) v = rand() & 0xFF;
+
+    uint32_t x_max = pos.x + width;
+    uint32_t y_max = pos.y + height;
+    if (y_max > screen_height(O)) y_max = screen_height(O);
+    if (x_max > screen_width(O) ) x_max = screen_width(O);
+
+    // White pixels must be drawn too, and pixels around left untouched
+    TestFrameBuffer expected(false), result(false);
+    expected.fill_random();
+    result = expected;
+
+    for (uint32_t j = pos.y, q = 0; j < y_max; j++, q++) {
+      for (uint32_t i = pos.x, k = 0; i < x_max; i++, k++) {
+        uint8_t color = (bitmap[(q * pitch) + (k >> 3)] & (0x80 >> (k & 7))) ? 1 : 0;
+        FrameBlitter::set_pixel_1bit<O>(expected, i, j, color);
+      }
+    }
+
+    FrameBlitter::image_1bit<O>(result, bitmap.data(), pos, pitch, x_max, y_max);
+
+    ASSERT_TRUE(expected == result) << "image " << n;
+  }
+}
+
+template <Orientation O>
+static void
+check_glyph_3bit()
+{
+  srand(200 + (int) O);
+  for (int n = 0; n < 300; n++) {
+    uint16_t width  = 1 + (rand() % 40);
+    uint16_t height = 1 + (rand() % 30);
+    Dim      dim(width, height);
+    Pos      pos(rand() % screen_width(O), rand() % screen_height(O));
+
+    std::vector<uint8_t> gray = random_gray(width, height);
+    std::vector<uint8_t> runs(GlyphRLE::encode(gray.data(), width, height, width, nullptr));
+    GlyphRLE::encode(gray.data(), width, height, width, runs.data());
+
+    uint32_t x_max = pos.x + width;
+    uint32_t y_max = pos.y + height;
+    if (y_max > screen_height(O)) y_max = screen_height(O);
+    if (x_max > screen_width(O) ) x_max = screen_width(O);
+
+    TestFrameBuffer expected(true), result(true);
+    for (uint32_t i = 0; i < expected.get_data_size(); i++) {
+      expected.get_data()[i] = result.get_data()[i] = 0x77; // White
+    }
+
+    GlyphRLE::decode(runs.data(), dim.height, 
+      [&](uint16_t x, uint16_t y, uint8_t length, uint8_t level) {
+        uint32_t j = pos.y + y;
+        if (j >= y_max) return;
+        uint32_t end = pos.x + x + length;
+        if (end > x_max) end = x_max;
+        for (uint32_t i = pos.x + x; i < end; i++) {
+          FrameBlitter::set_pixel_3bit<O>(expected, i, j, level);
+        }
+      });
+
+    FrameBlitter::glyph_3bit<O>(result, runs.data(), dim, pos, x_max, y_max);
+
+    ASSERT_TRUE(expected == result) << "glyph " << n;
+  }
+}
+
+template <Orientation O>
+static void
+check_bitmap_3bit()
+{
+  srand(300 + (int) O);
+  for (int n = 0; n < 100; n++) {
+    uint16_t width  = 1 + (rand() % 60);
+    uint16_t height = 1 + (rand() % 60);
+    Dim      dim(width, height);
+    Pos      pos(rand() % screen_width(O), rand() % screen_height(O));
+
+    std::vector<uint8_t> bitmap = random_gray(width, height);
+
+    uint32_t x_max = pos.x + width;
+    uint32_t y_max = pos.y + height;
+    if (y_max > screen_height(O)) y_max = screen_height(O);
+    if (x_max > screen_width(O) ) x_max = screen_width(O);
+
+    TestFrameBuffer expected(true), result(true);
+
+    for (uint32_t j = pos.y, q = 0; j < y_max; j++, q++) {
+      for (uint32_t i = pos.x, p = q * dim.width; i < x_max; i++, p++) {
+        FrameBlitter::set_pixel_3bit<O>(expected, i, j, bitmap[p] >> 5);
+      }
+    }
+
+    FrameBlitter::bitmap_3bit<O>(result, bitmap.data(), dim, pos, x_max, y_max);
+
+    ASSERT_TRUE(expected == result) << "bitmap " << n;
+  }
+}
+
+TEST(FrameBlitterTest, glyph_1bit) {
+  check_glyph_1bit<Orientation::LEFT  >();
+  check_glyph_1bit<Orientation::RIGHT >();
+  check_glyph_1bit<Orientation::BOTTOM>();
+  check_glyph_1bit<Orientation::TOP   >();
+}
+
+TEST(FrameBlitterTest, image_1bit) {
+  check_image_1bit<Orientation::LEFT  >();
+  check_image_1bit<Orientation::RIGHT >();
+  check_image_1bit<Orientation::BOTTOM>();
+  check_image_1bit<Orientation::TOP   >();
+}
+
+TEST(FrameBlitterTest, glyph_3bit) {
+  check_glyph_3bit<Orientation::LEFT  >();
+  check_glyph_3bit<Orientation::RIGHT >();
+  check_glyph_3bit<Orientation::BOTTOM>();
+  check_glyph_3bit<Orientation::TOP   >();
+}
+
+TEST(FrameBlitterTest, bitmap_3bit) {
+  check_bitmap_3bit<Orientation::LEFT  >();
+  check_bitmap_3bit<Orientation::RIGHT >();
+  check_bitmap_3bit<Orientation::BOTTOM>();
+  check_bitmap_3bit<Orientation::TOP   >();
+}
+
+#endif
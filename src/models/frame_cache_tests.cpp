@@ -0,0 +1,110 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "helpers/frame_cache.hpp"
+#include "helpers/frame_packer.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+// A frame looking like a page of text: white lines with some ink
+static std::vector<uint8_t>
+text_frame(uint32_t size, int seed)
+{
+  srand(seed);
+  std::vector<uint8_t> frame(size, 0);
+  for (uint32_t i = 0; i < size; i += 150) {
+    if ((rand() % 3) == 0) {
+      for (uint32_t j = i; (j < (i + 120)) && (j < size); j++) frame[j] = rand() & 0xFF;
+    }
+  }
+  return frame;
+}
+
+static void
+check_round_trip(const std::vector<uint8_t> & frame)
+{
+  std::vector<uint8_t> packed(FramePacker::max_packed_size(frame.size()));
+  uint32_t             size = FramePacker::pack(frame.data(), frame.size(), packed.data());
+
+  EXPECT_EQ(size, FramePacker::pack(frame.data(), frame.size(), nullptr));
+  EXPECT_LE(size, packed.size());
+
+  std::vector<uint8_t> result(frame.size(), 0x55);
+  EXPECT_TRUE(FramePacker::unpack(packed.data(), size, result.data(), result.size()));
+  EXPECT_EQ(frame, result);
+}
+
+TEST(FramePackerTest, round_trip) {
+  check_round_trip(std::vector<uint8_t>(1, 7));
+  check_round_trip(std::vector<uint8_t>(1000, 0));
+  check_round_trip(text_frame(10000, 1));
+
+  srand(2);
+  for (int n = 0; n < 100; n++) {
+    std::vector<uint8_t> frame(1 + (rand() % 600));
+    for (auto & v : frame) v = (rand() % 4 == 0) ? (rand() & 3) : 0; // Short runs and literals mixed
+    check_round_trip(frame);
+  }
+
+  std::vector<uint8_t> noise(5000);
+  for (auto & v : noise) v = rand() & 0xFF;
+  check_round_trip(noise);
+}
+
+TEST(FramePackerTest, white_page_is_small) {
+  std::vector<uint8_t> frame(1200 * 825 / 8, 0);
+  EXPECT_LT(FramePacker::pack(frame.data(), frame.size(), nullptr), 2000u);
+}
+
+TEST(FramePackerTest, wrong_size_is_detected) {
+  std::vector<uint8_t> frame = text_frame(3000, 3);
+  std::vector<uint8_t> packed(FramePacker::max_packed_size(frame.size()));
+  uint32_t             size = FramePacker::pack(frame.data(), frame.size(), packed.data());
+
+  std::vector<uint8_t> result(frame.size() - 1);
+  EXPECT_FALSE(FramePacker::unpack(packed.data(), size, result.data(), result.size()));
+  result.resize(frame.size() + 1);
+  EXPECT_FALSE(FramePacker::unpack(packed.data(), size, result.data(), result.size()));
+}
+
+TEST(FrameCacheTest, restore_kept_frames) {
+  FrameCache cache;
+  uint32_t   size = 60000;
+
+  std::vector<std::vector<uint8_t>> frames;
+  for (int n = 0; n < 6; n++) {
+    frames.push_back(text_frame(size, 10 + n));
+    cache.keep({ .itemref_index = 1, .offset = n * 1000, .format_hash = 42 }, frames[n].data(), size);
+  }
+
+  std::vector<uint8_t> result(size);
+
+  // Only the last MAX_FRAMES are kept
+  for (int n = 0; n < 6; n++) {
+    bool found = cache.restore({ .itemref_index = 1, .offset = n * 1000, .format_hash = 42 }, result.data(), size);
+    EXPECT_EQ(found, n >= (6 - FrameCache::MAX_FRAMES)) << "frame " << n;
+    if (found) {
+      EXPECT_EQ(result, frames[n]);
+    }
+  }
+
+  // Another format, or another frame buffer size
+  EXPECT_FALSE(cache.restore({ .itemref_index = 1, .offset = 5000, .format_hash = 43 }, result.data(), size));
+  result.resize(size / 2);
+  EXPECT_FALSE(cache.restore({ .itemref_index = 1, .offset = 5000, .format_hash = 42 }, result.data(), size / 2));
+}
+
+TEST(FrameCacheTest, same_page_is_replaced) {
+  FrameCache           cache;
+  FrameCache::Key      key = { .itemref_index = 3, .offset = 0, .format_hash = 1 };
+  std::vector<uint8_t> first = text_frame(5000, 20), second = text_frame(5000, 21), result(5000);
+
+  cache.keep(key, first.data(),  first.size());
+  cache.keep(key, second.data(), second.size());
+
+  EXPECT_TRUE(cache.restore(key, result.data(), result.size()));
+  EXPECT_EQ(result, second);
+}
+
+#endif
@@ -0,0 +1,236 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#define _GLYPH_ATLAS_ 1
+#include "models/glyph_atlas.hpp"
+
+#include "screen.hpp"
+
+#include <sys/stat.h>
+
+std::atomic<int8_t> GlyphAtlas::open_files{ 0 };
+
+static const char DATA_MAGIC[4]  = { 'G', 'A', 'D', 'T' };
+static const char INDEX_MAGIC[4] = { 'G', 'A', 'I', 'X' };
+
+GlyphAtlas::GlyphAtlas(uint32_t font_hash, int16_t size) :
+  next(nullptr),
+  glyph_size(size),
+  index_loaded(false),
+  data_size(0),
+  data_file(nullptr)
+{
+  char name[40];
+  snprintf(name, 40, "/%08X_%d_%d_%d",
+           font_hash,
+           glyph_size,
+           Screen::RESOLUTION,
+           (screen.get_pixel_resolution() == Screen::PixelResolution::ONE_BIT) ? 1 : 8);
+  filename = std::string(ATLAS_FOLDER).append(name);
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+  flush();
+}
+
+bool
+GlyphAtlas::load_index()
+{
+  index_loaded = true;
+
+  struct stat file_stat;
+  std::string data_filename = filename + ".gad";
+
+  if (stat(data_filename.c_str(), &file_stat) == -1) return false;
+  data_size = file_stat.st_size;
+
+  FILE * f = fopen((filename + ".gai").c_str(), "rb");
+  if (f == nullptr) {
+    // Without an index, the data file is useless: it will be rewritten.
+    data_size = 0;
+    return false;
+  }
+
+  Header header;
+  bool   ok = (fread(&header, sizeof(Header), 1, f) == 1) &&
+              (memcmp(header.magic, INDEX_MAGIC, 4) == 0) &&
+              (header.version == VERSION);
+
+  if (ok) {
+    IndexEntry entries[32];
+    size_t     count;
+    while ((count = fread(entries, sizeof(IndexEntry), 32, f)) > 0) {
+      for (size_t i = 0; i < count; i++) {
+        // Entries pointing past the data file are the result of an incomplete write.
+        if ((entries[i].offset + sizeof(Record)) <= data_size) {
+          index[entries[i].code] = entries[i].offset;
+        }
+      }
+    }
+    LOG_D("Atlas %s: %u glyphs.", filename.c_str(), (unsigned) index.size());
+  }
+  else {
+    LOG_E("Atlas index %s is corrupted.", filename.c_str());
+    index.clear();
+    data_size = 0;
+  }
+
+  fclose(f);
+  return ok;
+}
+
+bool
+GlyphAtlas::read_at(uint32_t offset, uint8_t * buffer, uint32_t size)
+{
+  if (offset >= data_size) {
+    // Not written to the SD card yet.
+    offset -= data_size;
+    if ((offset + size) > pending_data.size()) return false;
+    memcpy(buffer, &pending_data[offset], size);
+    return true;
+  }
+
+  FILE * f = data_file;
+  if (f == nullptr) {
+    if ((f = fopen((filename + ".gad").c_str(), "rb")) == nullptr) return false;
+    if (open_files.fetch_add(1) < MAX_OPEN_FILES) {
+      data_file = f;
+    }
+    else {
+      open_files.fetch_sub(1);
+    }
+  }
+
+  bool ok = (fseek(f, offset, SEEK_SET) == 0) &&
+            (fread(buffer, size, 1, f) == 1);
+
+  if (f != data_file) fclose(f);
+
+  return ok;
+}
+
+bool
+GlyphAtlas::load(uint32_t code, Font::Glyph & glyph, Font & font)
+{
+  if (!index_loaded) load_index();
+
+  auto it = index.find(code);
+  if (it == index.end()) return false;
+
+  Record record;
+  if (!read_at(it->second, (uint8_t *) &record, sizeof(Record)) || (record.code != code)) {
+    index.erase(it);
+    return false;
+  }
+
+  glyph.dim.width                   = record.width;
+  glyph.dim.height                  = record.height;
+  glyph.xoff                        = record.xoff;
+  glyph.yoff                        = record.yoff;
+  glyph.advance                     = record.advance;
+  glyph.pitch                       = record.pitch;
+  glyph.line_height                 = record.line_height;
+  glyph.ligature_and_kern_pgm_index = record.ligature_and_kern_pgm_index;
+  glyph.bitmap_size                 = record.bitmap_size;
+  glyph.buffer                      = nullptr;
+
+  int32_t size = glyph.bitmap_size;
+
+  if (size > 0) {
+    glyph.buffer = font.byte_pool_alloc(size);
+    if ((glyph.buffer == nullptr) ||
+        !read_at(it->second + sizeof(Record), glyph.buffer, size)) {
+      index.erase(it);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void
+GlyphAtlas::save(uint32_t code, const Font::Glyph & glyph)
+{
+  if (!index_loaded) load_index();
+
+  uint32_t size   = (glyph.buffer == nullptr) ? 0 : glyph.bitmap_size;
+  uint32_t offset = data_size + pending_data.size();
+
+  if ((offset + sizeof(Record) + size) > MAX_DATA_SIZE) return;
+  if (offset == 0) offset = sizeof(Header); // New data file
+
+  Record record = {
+    .code                        = code,
+    .width                       = glyph.dim.width,
+    .height                      = glyph.dim.height,
+    .xoff                        = glyph.xoff,
+    .yoff                        = glyph.yoff,
+    .advance                     = glyph.advance,
+    .pitch                       = glyph.pitch,
+    .line_height                 = glyph.line_height,
+    .ligature_and_kern_pgm_index = glyph.ligature_and_kern_pgm_index,
+    .bitmap_size                 = (uint16_t) size
+  };
+
+  if ((data_size == 0) && pending_data.empty()) {
+    const Header header = { .magic = { DATA_MAGIC[0], DATA_MAGIC[1], DATA_MAGIC[2], DATA_MAGIC[3] }, .version = VERSION };
+    pending_data.insert(pending_data.end(), (const uint8_t *) &header, ((const uint8_t *) &header) + sizeof(Header));
+  }
+
+  pending_data.insert(pending_data.end(), (const uint8_t *) &record, ((const uint8_t *) &record) + sizeof(Record));
+  if (size > 0) pending_data.insert(pending_data.end(), glyph.buffer, glyph.buffer + size);
+
+  pending_index.push_back({ .code = code, .offset = offset });
+  index[code] = offset;
+
+  if (pending_data.size() >= MAX_PENDING) flush();
+}
+
+void
+GlyphAtlas::flush()
+{
+  if (data_file != nullptr) {
+    fclose(data_file);
+    data_file = nullptr;
+    open_files.fetch_sub(1);
+  }
+
+  if (pending_index.empty()) return;
+
+  mkdir(ATLAS_FOLDER, 0775);
+
+  bool new_files = (data_size == 0);
+  bool ok        = false;
+
+  FILE * f = fopen((filename + ".gad").c_str(), new_files ? "wb" : "ab");
+  if (f != nullptr) {
+    ok = fwrite(pending_data.data(), pending_data.size(), 1, f) == 1;
+    fclose(f);
+  }
+
+  if (ok) {
+    if ((f = fopen((filename + ".gai").c_str(), new_files ? "wb" : "ab")) != nullptr) {
+      if (new_files) {
+        const Header header = { .magic = { INDEX_MAGIC[0], INDEX_MAGIC[1], INDEX_MAGIC[2], INDEX_MAGIC[3] }, .version = VERSION };
+        ok = fwrite(&header, sizeof(Header), 1, f) == 1;
+      }
+      ok = ok && (fwrite(pending_index.data(), sizeof(IndexEntry), pending_index.size(), f) == pending_index.size());
+      fclose(f);
+    }
+    else {
+      ok = false;
+    }
+    data_size += pending_data.size();
+  }
+
+  if (!ok) {
+    LOG_E("Unable to save glyphs to atlas %s.", filename.c_str());
+    // Forget about the glyphs that were not saved.
+    for (auto & entry : pending_index) index.erase(entry.code);
+  }
+
+  pending_data.clear();
+  pending_index.clear();
+}
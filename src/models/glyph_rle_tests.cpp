@@ -0,0 +1,98 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "models/glyph_rle.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+// Reference: what Screen::draw_glyph painted from an 8 bits per pixel bitmap
+// before glyphs were kept as runs. 7 (white) is left untouched.
+
+static void
+draw_8bit(std::vector<uint8_t> & canvas, int canvas_width,
+          const uint8_t * bitmap, int width, int height, int pitch, int x_max)
+{
+  for (int j = 0; j < height; j++) {
+    for (int i = 0, p = j * pitch; (i < width) && (i < x_max); i++, p++) {
+      uint8_t v = 7 - (bitmap[p] >> 5);
+      if (v != 7) canvas[j * canvas_width + i] = v;
+    }
+  }
+}
+
+static void
+draw_rle(std::vector<uint8_t> & canvas, int canvas_width,
+         const uint8_t * data, int height, int x_max)
+{
+  GlyphRLE::decode(data, height, [&](uint16_t x, uint16_t y, uint8_t length, uint8_t level) {
+    int end = x + length;
+    if (end > x_max) end = x_max;
+    for (int i = x; i < end; i++) canvas[y * canvas_width + i] = level;
+  });
+}
+
+static void
+check_same_output(const std::vector<uint8_t> & bitmap, int width, int height, int pitch)
+{
+  uint32_t size = GlyphRLE::encode(bitmap.data(), width, height, pitch, nullptr);
+  std::vector<uint8_t> encoded(size + 1, 0xAA);
+  EXPECT_EQ(GlyphRLE::encode(bitmap.data(), width, height, pitch, encoded.data()), size);
+  EXPECT_EQ(encoded[size], 0xAA);
+
+  for (int x_max : { width, width / 2 }) {
+    std::vector<uint8_t> expected(width * height, 7);
+    std::vector<uint8_t> result(width * height, 7);
+
+    draw_8bit(expected, width, bitmap.data(), width, height, pitch, x_max);
+    draw_rle(result, width, encoded.data(), height, x_max);
+
+    EXPECT_EQ(expected, result);
+  }
+}
+
+TEST(GlyphRLETest, random_bitmaps) {
+  srand(1234);
+  for (int n = 0; n < 200; n++) {
+    int width  = 1 + (rand() % 90);
+    int height = 1 + (rand() % 40);
+    int pitch  = width + (rand() % 4);
+    std::vector<uint8_t> bitmap(pitch * height);
+    for (auto & v : bitmap) v = (rand() % 3 == 0) ? (rand() & 0xFF) : 0;
+    check_same_output(bitmap, width, height, pitch);
+  }
+}
+
+TEST(GlyphRLETest, long_runs) {
+  int width  = 100;
+  int height = 4;
+  std::vector<uint8_t> bitmap(width * height, 0);
+  for (int i = 40; i < 100; i++) bitmap[i] = 0xFF;             // Blank then ink to the end
+  for (int i = 0;  i <  70; i++) bitmap[width + i] = 0x80;     // Gray then blank to the end
+  for (int i = 0;  i < 100; i++) bitmap[(3 * width) + i] = 0xFF; // Whole row
+  check_same_output(bitmap, width, height, width);
+}
+
+TEST(GlyphRLETest, blank_rows_are_a_single_byte) {
+  std::vector<uint8_t> bitmap(50 * 10, 0);
+  EXPECT_EQ(GlyphRLE::encode(bitmap.data(), 50, 10, 50, nullptr), 10u);
+}
+
+TEST(GlyphRLETest, smaller_than_8bit_bitmap) {
+  // An anti-aliased disk, representative of a glyph outline
+  int width  = 40;
+  int height = 40;
+  std::vector<uint8_t> bitmap(width * height);
+  for (int j = 0; j < height; j++) {
+    for (int i = 0; i < width; i++) {
+      double d = std::sqrt((i - 19.5) * (i - 19.5) + (j - 19.5) * (j - 19.5));
+      double v = 16.0 - d;
+      bitmap[j * width + i] = (v >= 1.0) ? 255 : ((v <= 0.0) ? 0 : (uint8_t)(v * 255));
+    }
+  }
+  check_same_output(bitmap, width, height, width);
+  EXPECT_LT(GlyphRLE::encode(bitmap.data(), width, height, width, nullptr) * 2, (uint32_t)(width * height));
+}
+
+#endif
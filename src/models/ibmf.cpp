@@ -281,6 +281,7 @@ IBMF::clear_face()
     free(memory_font);
     memory_font = nullptr;
   }
+  coverage.clear();
   
   ready             = false;
   current_font_size = -1;
@@ -408,30 +409,30 @@ IBMF::get_glyph(uint32_t charcode, uint32_t next_charcode, int16_t glyph_size, i
 Font::Glyph *
 IBMF::get_glyph(uint32_t charcode, int16_t glyph_size)
 {
-  std::scoped_lock guard(mutex);
-  
+  if (face == nullptr) return nullptr;
+
   uint32_t glyph_code = translate(charcode);
 
+  Glyph * glyph = find_glyph(cache_key(glyph_code), glyph_size);
+  if (glyph != nullptr) return glyph;
+
+  std::scoped_lock guard(mutex);
+
   return get_glyph_internal(glyph_code, glyph_size);
 }
 
 Font::Glyph *
 IBMF::get_glyph_internal(uint32_t glyph_code, int16_t glyph_size)
 {
-  Glyphs::iterator git;
-
   if (face == nullptr) return nullptr;
 
   if (current_font_size != glyph_size) set_font_size(glyph_size);
 
-  GlyphsCache::iterator cache_it = cache.find(glyph_size);
-
-  bool found = (cache_it != cache.end()) &&
-               ((git = cache_it->second.find(glyph_code)) != cache_it->second.end());
+  Glyph * found = find_glyph(cache_key(glyph_code), glyph_size);
 
-  if (found) {
+  if (found != nullptr) {
     glyph_data = face->get_glyph_info(glyph_code & 0x000000FF);
-    return git->second;
+    return found;
   }
   else {
     Glyph * glyph = bitmap_glyph_pool.newElement();
@@ -448,6 +449,8 @@ IBMF::get_glyph_internal(uint32_t glyph_code, int16_t glyph_size)
       glyph->dim.height  =  0;
       glyph->line_height =  face->get_line_height();
       glyph->pitch       =  0;
+      glyph->bitmap_size =  0;
+      glyph->buffer      =  nullptr;
       glyph->xoff        =  0;
       glyph->yoff        =  0;
       glyph->advance     =  8;
@@ -469,7 +472,7 @@ IBMF::get_glyph_internal(uint32_t glyph_code, int16_t glyph_size)
     //   " y:"  << glyph->yoff <<
     //   " a:"  << glyph->advance << std::endl;
 
-    cache[current_font_size][glyph_code] = glyph;
+    add_glyph(cache_key(glyph_code), glyph_size, glyph);
     return glyph;
   }
 }
@@ -502,9 +505,26 @@ IBMF::set_font_face_from_memory(unsigned char * buffer, int32_t buffer_size)
 
   ready       = true;
   memory_font = buffer;
+
+  build_coverage();
   return true;
 }
 
+void
+IBMF::build_coverage()
+{
+  // Translated characters are all in these two blocks.
+
+  coverage.add(' ');
+  for (uint32_t code = 0x21; code < 0x300; code++) {
+    if (face->is_supported(code)) coverage.add(code);
+  }
+  for (uint32_t code = 0x2000; code < 0x2100; code++) {
+    if (face->is_supported(code)) coverage.add(code);
+  }
+  coverage.build();
+}
+
 Font::Glyph * 
 IBMF::adjust_ligature_and_kern(Glyph   * glyph, 
                                uint16_t  glyph_size, 
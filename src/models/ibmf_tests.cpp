@@ -0,0 +1,29 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "models/ibmf.hpp"
+
+#include <cstring>
+
+TEST(IBMFTest, accented_glyph_not_shared) {
+  IBMF font(FONTS_FOLDER "/EC-Regular_150.ibmf");
+  ASSERT_TRUE(font.is_ready());
+
+  Font::Glyph * a       = font.get_glyph('A',  12);
+  Font::Glyph * a_grave = font.get_glyph(0xC0, 12); // À
+  ASSERT_NE(nullptr, a);
+  ASSERT_NE(nullptr, a_grave);
+  EXPECT_NE(a, a_grave);
+
+  bool same = (a->dim.width  == a_grave->dim.width ) &&
+              (a->dim.height == a_grave->dim.height) &&
+              (a->bitmap_size == a_grave->bitmap_size) &&
+              (memcmp(a->buffer, a_grave->buffer, a->bitmap_size) == 0);
+  EXPECT_FALSE(same);
+
+  // Both are now taken from the cache
+  EXPECT_EQ(a,       font.get_glyph('A',  12));
+  EXPECT_EQ(a_grave, font.get_glyph(0xC0, 12));
+}
+
+#endif
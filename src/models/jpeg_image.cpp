@@ -17,6 +17,14 @@
 static uint32_t  load_start_time;
 static bool      waiting_msg_shown;
 
+// The decompression object device: the image being loaded and the zip file
+// it is read from.
+
+struct Device {
+  Image::ImageData * image_data;
+  Unzip            * zip;
+};
+
 // static bool first = false;
 
 static size_t in_func (     /* Returns number of bytes read (zero on error) */
@@ -27,7 +35,7 @@ static size_t in_func (     /* Returns number of bytes read (zero on error) */
 {
   if (buff) { /* Read data from imput stream */
     uint32_t size = nbyte;
-    size_t res = unzip.get_stream_data((char *) buff, size) ? size : 0;
+    size_t res = ((Device *) jd->device)->zip->get_stream_data((char *) buff, size) ? size : 0;
     // if (first) {
     //   first = false;
     //   std::cout << "----- Unzip content -----" << std::endl;
@@ -39,7 +47,7 @@ static size_t in_func (     /* Returns number of bytes read (zero on error) */
     // }
     return res;
   } else {    /* Remove data from input stream */
-    return unzip.stream_skip(nbyte) ? nbyte : 0;
+    return ((Device *) jd->device)->zip->stream_skip(nbyte) ? nbyte : 0;
   }
 }
 
@@ -55,7 +63,7 @@ static int out_func (       /* Returns 1 to continue, 0 to abort */
 {
   static constexpr char const * TAG = "JPegImageOutFunc";
   
-  Image::ImageData * image_data = (Image::ImageData *) jd->device;
+  Image::ImageData * image_data = ((Device *) jd->device)->image_data;
   uint8_t * src, * dst;
   uint16_t y, bws, bwd;
 
@@ -91,19 +99,20 @@ static int out_func (       /* Returns 1 to continue, 0 to abort */
   return 1;    /* Continue to decompress */
 }
 
-JPegImage::JPegImage(std::string filename, Dim max, bool load_bitmap) : Image(filename)
+JPegImage::JPegImage(std::string filename, Dim max, bool load_bitmap, Unzip & zip) : Image(filename)
 {
   LOG_D("Loading image file %s", filename.c_str());
 
-  if (unzip.open_stream_file(filename.c_str(), file_size)) {
+  if (zip.open_stream_file(filename.c_str(), file_size)) {
     JRESULT   res;                /* Result code of TJpgDec API */
     JDEC      jdec;               /* Decompression object */
     uint8_t * work;
     size_t    sz_work = WORK_SIZE;
+    Device    device  = { .image_data = &image_data, .zip = &zip };
 
     /* Prepare to decompress */
     work = (uint8_t *) allocate(sz_work);
-    res  = jdec_prepare(&jdec, in_func, work, sz_work, &image_data);
+    res  = jdec_prepare(&jdec, in_func, work, sz_work, &device);
     if (res == JDR_OK) {
       uint8_t scale = 0;
       uint16_t width = jdec.width;
@@ -142,6 +151,6 @@ JPegImage::JPegImage(std::string filename, Dim max, bool load_bitmap) : Image(fi
     }
 
     free(work);
-    unzip.close_stream_file();
+    zip.close_stream_file();
   }
 }
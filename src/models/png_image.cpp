@@ -63,11 +63,11 @@ on_draw(pngle_t *pngle, uint32_t x, uint32_t y, uint8_t pix, uint8_t alpha)
   }
 }
 
-PngImage::PngImage(std::string filename, Dim max, bool load_bitmap) : Image(filename)
+PngImage::PngImage(std::string filename, Dim max, bool load_bitmap, Unzip & zip) : Image(filename)
 {
   LOG_I("Loading PNG image file %s", filename.c_str());
 
-  if (unzip.open_stream_file(filename.c_str(), file_size)) {
+  if (zip.open_stream_file(filename.c_str(), file_size)) {
 
     pngle_t * pngle   = mypngle_new();
     size_t    sz_work = WORK_SIZE;
@@ -88,7 +88,7 @@ PngImage::PngImage(std::string filename, Dim max, bool load_bitmap) : Image(file
     /* Prepare to decompress */
 
     uint32_t size = WORK_SIZE;
-    while (unzip.get_stream_data((char *) work, size)) {
+    while (zip.get_stream_data((char *) work, size)) {
       if (size == 0) break;
 
       if (first) {
@@ -155,7 +155,7 @@ PngImage::PngImage(std::string filename, Dim max, bool load_bitmap) : Image(file
 
     free(work);
     mypngle_destroy(pngle);
-    unzip.close_stream_file();
+    zip.close_stream_file();
 
     LOG_I("PNG Image load complete");
   }
@@ -0,0 +1,370 @@
+#if TESTING && EPUB_LINUX_BUILD
+
+#include "gtest/gtest.h"
+#include "helpers/simple_db.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <vector>
+
+static const char * DB_FILE   = "/tmp/simple_db_test.db";
+static const char * COPY_FILE = "/tmp/simple_db_copy.db";
+
+static std::vector<uint8_t>
+record_data(uint32_t idx)
+{
+  std::vector<uint8_t> data(1 + (idx % 37), 0);
+  for (auto & v : data) v = (idx + (&v - data.data())) & 0xFF;
+  return data;
+}
+
+static void
+fill(SimpleDB & db, uint32_t first, uint32_t count)
+{
+  for (uint32_t idx = first; idx < (first + count); idx++) {
+    std::vector<uint8_t> data = record_data(idx);
+    ASSERT_TRUE(db.add_record(data.data(), data.size()));
+  }
+}
+
+// Every record not deleted is retrieved, in order. Records deleted are the
+// ones with an index multiple of deleted_step.
+static void
+check(SimpleDB & db, uint32_t count, uint32_t deleted_step = 0)
+{
+  ASSERT_EQ(db.get_record_count(), count);
+
+  std::vector<uint32_t> expected;
+  for (uint32_t idx = 0; idx < count; idx++) {
+    if ((deleted_step == 0) || ((idx % deleted_step) != 0)) expected.push_back(idx);
+  }
+
+  std::vector<uint32_t> found;
+  for (bool ok = db.goto_first(); ok; ok = db.goto_next()) {
+    uint32_t idx = db.get_current_idx();
+    found.push_back(idx);
+
+    std::vector<uint8_t> data = record_data(idx);
+    std::vector<uint8_t> result(db.get_record_size());
+    ASSERT_EQ(result.size(), data.size());
+    ASSERT_TRUE(db.get_record(result.data(), result.size()));
+    ASSERT_EQ(result, data);
+  }
+
+  EXPECT_EQ(found, expected);
+}
+
+// Records of the same size, as in the books directory
+static const int32_t FIXED_SIZE = 60;
+
+static void
+fill_fixed(SimpleDB & db, uint32_t first, uint32_t count)
+{
+  for (uint32_t id = first; id < (first + count); id++) {
+    uint32_t data[FIXED_SIZE / 4];
+    for (auto & v : data) v = id;
+    ASSERT_TRUE(db.add_record(data, FIXED_SIZE));
+  }
+}
+
+// The ids of the records, by index
+static std::vector<uint32_t>
+fixed_ids(SimpleDB & db)
+{
+  std::vector<uint32_t> ids(db.get_record_count(), UINT32_MAX);
+  for (bool ok = db.goto_first(); ok; ok = db.goto_next()) {
+    uint32_t data[FIXED_SIZE / 4];
+    EXPECT_EQ(db.get_record_size(), FIXED_SIZE);
+    EXPECT_TRUE(db.get_record(data, FIXED_SIZE));
+    for (auto v : data) EXPECT_EQ(v, data[0]);
+    ids[db.get_current_idx()] = data[0];
+  }
+  return ids;
+}
+
+static void
+delete_idx(SimpleDB & db, uint32_t idx)
+{
+  db.set_current_idx(idx);
+  db.set_deleted();
+}
+
+static void
+copy_file(const char * from, const char * to)
+{
+  std::ifstream in(from, std::ios::binary);
+  std::ofstream out(to,  std::ios::binary);
+  out << in.rdbuf();
+}
+
+static uint32_t
+file_size(const char * filename)
+{
+  std::ifstream in(filename, std::ios::binary | std::ios::ate);
+  return in.tellg();
+}
+
+TEST(SimpleDBTest, reopen_from_footer) {
+  SimpleDB db;
+  ASSERT_TRUE(db.create(DB_FILE));
+  fill(db, 0, 500);
+  db.close();
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  EXPECT_TRUE(db.is_footer_valid());
+  check(db, 500);
+  EXPECT_FALSE(db.is_some_record_deleted());
+  db.close();
+}
+
+TEST(SimpleDBTest, more_than_a_thousand_records) {
+  SimpleDB db;
+  ASSERT_TRUE(db.create(DB_FILE));
+  fill(db, 0, 20000);
+  db.close();
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  check(db, 20000);
+  db.close();
+}
+
+TEST(SimpleDBTest, deletions_are_kept) {
+  SimpleDB db;
+  ASSERT_TRUE(db.create(DB_FILE));
+  fill(db, 0, 100);
+  for (bool ok = db.goto_first(); ok; ok = db.goto_next()) {
+    if ((db.get_current_idx() % 3) == 0) db.set_deleted();
+  }
+  db.close();
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  EXPECT_TRUE(db.is_some_record_deleted());
+  check(db, 100, 3);
+  db.close();
+}
+
+TEST(SimpleDBTest, records_added_after_reopen) {
+  SimpleDB db;
+  ASSERT_TRUE(db.create(DB_FILE));
+  fill(db, 0, 10);
+  db.close();
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  fill(db, 10, 290);
+  db.close();
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  check(db, 300);
+  db.close();
+}
+
+TEST(SimpleDBTest, file_without_footer_is_scanned) {
+  // As written by the previous version: sizes and records only
+  {
+    std::ofstream out(DB_FILE, std::ios::binary);
+    for (uint32_t idx = 0; idx < 50; idx++) {
+      std::vector<uint8_t> data = record_data(idx);
+      int32_t size = data.size();
+      out.write((const char *) &size, sizeof(int32_t));
+      out.write((const char *) data.data(), size);
+    }
+  }
+  uint32_t size = file_size(DB_FILE);
+
+  SimpleDB db;
+  ASSERT_TRUE(db.open(DB_FILE));
+  check(db, 50);
+  EXPECT_EQ(db.get_data_size(), size);
+  db.close();
+
+  // The footer has been added
+  EXPECT_GT(file_size(DB_FILE), size);
+  ASSERT_TRUE(db.open(DB_FILE));
+  check(db, 50);
+  db.close();
+}
+
+TEST(SimpleDBTest, not_closed_after_adding_records) {
+  SimpleDB db;
+  ASSERT_TRUE(db.create(DB_FILE));
+  fill(db, 0, 200);
+  db.close();
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  fill(db, 200, 3);
+
+  // What is on the SD card if the device is reset now
+  copy_file(DB_FILE, COPY_FILE);
+  db.close();
+
+  ASSERT_TRUE(db.open(COPY_FILE));
+  EXPECT_FALSE(db.is_footer_valid());
+  check(db, 203);
+  fill(db, 203, 100);
+  db.close();
+
+  ASSERT_TRUE(db.open(COPY_FILE));
+  check(db, 303);
+  db.close();
+}
+
+TEST(SimpleDBTest, incomplete_last_record) {
+  {
+    std::ofstream out(DB_FILE, std::ios::binary);
+    for (uint32_t idx = 0; idx < 20; idx++) {
+      std::vector<uint8_t> data = record_data(idx);
+      int32_t size = data.size();
+      out.write((const char *) &size, sizeof(int32_t));
+      out.write((const char *) data.data(), (idx == 19) ? (size / 2) : size);
+    }
+  }
+
+  SimpleDB db;
+  ASSERT_TRUE(db.open(DB_FILE));
+  check(db, 19);
+  db.close();
+
+  // The footer is padded up to the end of the incomplete record
+  ASSERT_TRUE(db.open(DB_FILE));
+  check(db, 19);
+  fill(db, 19, 5);
+  db.close();
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  check(db, 24);
+  db.close();
+}
+
+TEST(SimpleDBTest, corrupted_footer) {
+  SimpleDB db;
+  ASSERT_TRUE(db.create(DB_FILE));
+  fill(db, 0, 100);
+  uint32_t data_size = db.get_data_size();
+  db.close();
+
+  {
+    std::fstream f(DB_FILE, std::ios::binary | std::ios::in | std::ios::out);
+    f.seekp(data_size + 20);
+    f.put(0x5A);
+  }
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  check(db, 100);
+  db.close();
+}
+
+TEST(SimpleDBTest, deleted_space_is_reused) {
+  SimpleDB db;
+  ASSERT_TRUE(db.create(DB_FILE));
+  fill_fixed(db, 0, 10);
+  uint32_t data_size = db.get_data_size();
+
+  delete_idx(db, 3);
+  delete_idx(db, 7);
+  db.close();
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  EXPECT_TRUE(db.is_some_record_deleted());
+  fill_fixed(db, 100, 1);
+  EXPECT_EQ(db.get_data_size(), data_size);
+  uint32_t idx = db.get_added_idx();
+  EXPECT_TRUE((idx == 3) || (idx == 7));
+  fill_fixed(db, 101, 1);
+  EXPECT_EQ(db.get_data_size(), data_size);
+  EXPECT_FALSE(db.is_some_record_deleted());
+  fill_fixed(db, 102, 1);
+  EXPECT_EQ(db.get_added_idx(), 10u);
+  db.close();
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  std::vector<uint32_t> ids = fixed_ids(db);
+  EXPECT_EQ(ids[idx], 100u);
+  EXPECT_EQ(ids[(idx == 3) ? 7 : 3], 101u);
+  EXPECT_EQ(ids[10], 102u);
+  db.close();
+}
+
+TEST(SimpleDBTest, compaction) {
+  SimpleDB db;
+  ASSERT_TRUE(db.create(DB_FILE));
+  fill_fixed(db, 0, 100);
+  for (uint32_t idx = 0; idx < 100; idx += 3) delete_idx(db, idx);
+
+  std::vector<uint32_t> expected = fixed_ids(db);
+
+  int steps = 0;
+  while (db.compact_step()) {
+    ASSERT_LT(++steps, 200);
+    // Records keep their index
+    ASSERT_EQ(fixed_ids(db), expected);
+  }
+  EXPECT_FALSE(db.is_some_record_deleted());
+  EXPECT_EQ(db.get_data_size(), 66u * (FIXED_SIZE + 4));
+
+  // The indexes of the records dropped are reused
+  fill_fixed(db, 200, 1);
+  EXPECT_LT(db.get_added_idx(), 100u);
+  expected[db.get_added_idx()] = 200;
+  db.close();
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  EXPECT_EQ(fixed_ids(db), expected);
+  db.close();
+}
+
+TEST(SimpleDBTest, compaction_without_footer) {
+  SimpleDB db;
+  ASSERT_TRUE(db.create(DB_FILE));
+  fill_fixed(db, 0, 20);
+  for (uint32_t idx = 0; idx < 20; idx += 2) delete_idx(db, idx);
+  db.close();
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  for (int i = 0; i < 5; i++) ASSERT_TRUE(db.compact_step());
+
+  // A reset now: the records are retrieved from the file, once each
+  copy_file(DB_FILE, COPY_FILE);
+  db.close();
+
+  ASSERT_TRUE(db.open(COPY_FILE));
+  std::vector<uint32_t> ids = fixed_ids(db);
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::remove(ids.begin(), ids.end(), UINT32_MAX), ids.end());
+  EXPECT_EQ(ids, std::vector<uint32_t>({ 1, 3, 5, 7, 9, 11, 13, 15, 17, 19 }));
+  db.close();
+}
+
+TEST(SimpleDBTest, interrupted_move) {
+  SimpleDB db;
+  ASSERT_TRUE(db.create(DB_FILE));
+  fill_fixed(db, 0, 5);
+  delete_idx(db, 1);
+  db.close();
+
+  // Record 4 copied in the place of record 1, journal written, sizes not
+  // switched yet.
+
+  const int32_t RECORD = FIXED_SIZE + 4;
+  {
+    std::fstream f(DB_FILE, std::ios::binary | std::ios::in | std::ios::out);
+    uint32_t data[FIXED_SIZE / 4];
+    f.seekg((4 * RECORD) + 4);
+    f.read((char *) data, FIXED_SIZE);
+    f.seekp((1 * RECORD) + 4);
+    f.write((const char *) data, FIXED_SIZE);
+
+    std::ofstream j(std::string(DB_FILE) + ".jnl", std::ios::binary);
+    struct { char magic[4]; int32_t from, to, size; } journal = { { 'S', 'D', 'B', 'J' }, 4 * RECORD, 1 * RECORD, FIXED_SIZE };
+    j.write((const char *) &journal, sizeof(journal));
+  }
+
+  ASSERT_TRUE(db.open(DB_FILE));
+  EXPECT_EQ(fixed_ids(db), std::vector<uint32_t>({ 0, 4, 2, 3, UINT32_MAX }));
+  db.close();
+
+  std::ifstream j(std::string(DB_FILE) + ".jnl");
+  EXPECT_FALSE(j.good());
+}
+
+#endif
@@ -4,11 +4,13 @@
 
 #define _TTF_ 1
 #include "models/ttf2.hpp"
+#include "models/glyph_rle.hpp"
 #include "viewers/msg_viewer.hpp"
 
 #include "screen.hpp"
 #include "alloc.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <ostream>
 #include <sys/stat.h>
@@ -17,7 +19,9 @@ FT_Library TTF::library{ nullptr };
 
 TTF::TTF(const std::string & filename) : Font()
 {
-  face  = nullptr;
+  face         = nullptr;
+  stream       = nullptr;
+  current_size = nullptr;
 
   if (library == nullptr) {
     int error = FT_Init_FreeType(& library);
@@ -27,12 +31,14 @@ TTF::TTF(const std::string & filename) : Font()
     }
   }
 
-  set_font_face_from_file(filename);
+  set_font_face_from_stream(filename);
 }
 
 TTF::TTF(unsigned char * buffer, int32_t buffer_size) : Font()
 {
-  face  = nullptr;
+  face         = nullptr;
+  stream       = nullptr;
+  current_size = nullptr;
  
   if (library == nullptr) {
     int error = FT_Init_FreeType(& library);
@@ -55,9 +61,16 @@ TTF::clear_face()
 {
   clear_cache();
   if (face != nullptr) {
-    FT_Done_Face(face);
+    FT_Done_Face(face); // Size objects are released with the face
     face = nullptr;
   }
+  sizes.clear();
+  current_size = nullptr;
+  coverage.clear();
+  if (stream != nullptr) {
+    delete stream;
+    stream = nullptr;
+  }
   if (memory_font != nullptr) {
     free(memory_font);
     memory_font = nullptr;
@@ -65,26 +78,26 @@ TTF::clear_face()
   
   ready             = false;
   current_font_size = -1;
+  font_hash         = 0;
 }
 
 Font::Glyph *
 TTF::get_glyph_internal(uint32_t charcode, int16_t glyph_size)
 {
   int error;
-  Glyphs::iterator git;
 
   if (face == nullptr) return nullptr;
 
-  GlyphsCache::iterator cache_it = cache.find(glyph_size);
-
-  bool found = (cache_it != cache.end()) &&
-               ((git = cache_it->second.find(charcode)) != cache_it->second.end());
+  Glyph * found = find_glyph(charcode, glyph_size);
 
-  if (found) {
-    return git->second;
+  if (found != nullptr) {
+    return found;
+  }
+  else if ((found = load_from_atlas(charcode, glyph_size)) != nullptr) {
+    return found;
   }
   else {
-    if (current_font_size != glyph_size) set_font_size(glyph_size);
+    if ((current_font_size != glyph_size) && !set_font_size(glyph_size)) return nullptr;
 
     int glyph_index = FT_Get_Char_Index(face, charcode);
     if (glyph_index == 0) {
@@ -113,7 +126,7 @@ TTF::get_glyph_internal(uint32_t charcode, int16_t glyph_size)
 
     glyph->dim.width   = slot->metrics.width  >> 6;
     glyph->dim.height  = slot->metrics.height >> 6;
-    glyph->line_height = face->size->metrics.height >> 6;
+    glyph->line_height = current_size->line_height;
     glyph->ligature_and_kern_pgm_index = -1;
 
     if (face->glyph->format != FT_GLYPH_FORMAT_BITMAP) {
@@ -135,9 +148,15 @@ TTF::get_glyph_internal(uint32_t charcode, int16_t glyph_size)
     glyph->pitch       = slot->bitmap.pitch;
     glyph->dim.height  = slot->bitmap.rows;
     glyph->dim.width   = slot->bitmap.width;
-    glyph->line_height = face->size->metrics.height >> 6;
 
-    int32_t size = glyph->pitch * glyph->dim.height;
+    // In 3 bits resolution, the 8 bits per pixel bitmap is kept as runs of screen levels.
+
+    bool    rle  = screen.get_pixel_resolution() != Screen::PixelResolution::ONE_BIT;
+    int32_t size = (glyph->dim.height == 0) ? 0 : 
+                   (rle ? GlyphRLE::encode(slot->bitmap.buffer, glyph->dim.width, glyph->dim.height, glyph->pitch, nullptr)
+                        : glyph->pitch * glyph->dim.height);
+
+    glyph->bitmap_size = size;
 
     if (size > 0) {
       glyph->buffer = byte_pool_alloc(size);
@@ -150,7 +169,12 @@ TTF::get_glyph_internal(uint32_t charcode, int16_t glyph_size)
       //   LOG_D("Allocated %d bytes for glyph.", size)
       // }
 
-      memcpy(glyph->buffer, slot->bitmap.buffer, size);
+      if (rle) {
+        GlyphRLE::encode(slot->bitmap.buffer, glyph->dim.width, glyph->dim.height, glyph->pitch, glyph->buffer);
+      }
+      else {
+        memcpy(glyph->buffer, slot->bitmap.buffer, size);
+      }
     }
     else {
       glyph->buffer = nullptr;
@@ -170,27 +194,68 @@ TTF::get_glyph_internal(uint32_t charcode, int16_t glyph_size)
     //   " y:"  << glyph->yoff <<
     //   " a:"  << glyph->advance << std::endl;
 
-    cache[current_font_size][charcode] = glyph;
+    add_glyph(charcode, glyph_size, glyph);
+    save_to_atlas(charcode, glyph_size, glyph);
 
     return glyph;
   }
 }
 
-bool 
-TTF::set_font_size(int16_t size)
+TTF::SizeEntry *
+TTF::get_size_entry(int16_t glyph_size)
 {
+  if (face == nullptr) return nullptr;
+
+  for (auto & entry : sizes) {
+    if (entry.glyph_size == glyph_size) return &entry;
+  }
+
+  FT_Size ft_size;
+  if (FT_New_Size(face, &ft_size)) {
+    LOG_E("Unable to allocate font size.");
+    return nullptr;
+  }
+
+  FT_Size previous = face->size;
+  FT_Activate_Size(ft_size);
+
   int error = FT_Set_Char_Size(
           face,                 // handle to face object
           0,                    // char_width in 1/64th of points
-          size * 64,            // char_height in 1/64th of points
+          glyph_size * 64,      // char_height in 1/64th of points
           Screen::RESOLUTION,   // horizontal device resolution
           Screen::RESOLUTION);  // vertical device resolution
 
+  FT_Activate_Size(previous);
+
   if (error) {
+    LOG_E("Unable to set font size.");
+    FT_Done_Size(ft_size);
+    return nullptr;
+  }
+
+  sizes.push_front({
+    .glyph_size       = glyph_size,
+    .ft_size          = ft_size,
+    .line_height      = (int32_t) (ft_size->metrics.height    >> 6),
+    .descender_height = (int32_t) (ft_size->metrics.descender >> 6)
+  });
+
+  return &sizes.front();
+}
+
+bool 
+TTF::set_font_size(int16_t size)
+{
+  SizeEntry * entry = get_size_entry(size);
+  if (entry == nullptr) return false;
+
+  if (FT_Activate_Size(entry->ft_size)) {
     LOG_E("Unable to set font size.");
     return false;
   }
 
+  current_size      = entry;
   current_font_size = size;
   return true;
 }
@@ -207,7 +272,82 @@ TTF::set_font_face_from_memory(unsigned char * buffer, int32_t buffer_size)
     return false;
   }
 
+  int32_t head_size = std::min(buffer_size, HASH_SAMPLE_SIZE);
+  int32_t tail_size = std::min(buffer_size - head_size, HASH_SAMPLE_SIZE);
+
   ready       = true;
   memory_font = buffer;
+  font_hash   = compute_font_hash(buffer, head_size, buffer + buffer_size - tail_size, tail_size, buffer_size);
+
+  build_coverage();
+  return true;
+}
+
+bool 
+TTF::set_font_face_from_stream(const std::string & font_filename)
+{
+  if ((face != nullptr) || (stream != nullptr)) clear_face();
+
+  if ((stream = new FontStream) == nullptr) {
+    msg_viewer.out_of_memory("font stream allocation");
+  }
+
+  if (!stream->open(font_filename)) {
+    delete stream;
+    stream = nullptr;
+    return false;
+  }
+
+  FT_Open_Args args;
+  args.flags  = FT_OPEN_STREAM;
+  args.stream = stream->get_ft_stream();
+
+  int error = FT_Open_Face(library, &args, 0, &face);
+  if (error) {
+    LOG_E("The font format is unsupported or is broken (%d): %s", error, font_filename.c_str());
+    face = nullptr;
+    delete stream;
+    stream = nullptr;
+    return false;
+  }
+
+  int32_t   size      = stream->get_size();
+  int32_t   head_size = std::min(size, HASH_SAMPLE_SIZE);
+  int32_t   tail_size = std::min(size - head_size, HASH_SAMPLE_SIZE);
+  uint8_t * samples   = (uint8_t *) allocate(head_size + tail_size);
+
+  if (samples != nullptr) {
+    if ((stream->read(0, samples, head_size) == (uint32_t) head_size) &&
+        (stream->read(size - tail_size, samples + head_size, tail_size) == (uint32_t) tail_size)) {
+      font_hash = compute_font_hash(samples, head_size, samples + head_size, tail_size, size);
+    }
+    free(samples);
+  }
+
+  build_coverage();
+
+  ready = true;
   return true;
 }
+
+void
+TTF::build_coverage()
+{
+  // Without a unicode character map, the coverage stays unknown: all 
+  // characters are considered present.
+
+  if ((face->charmap == nullptr) || (face->charmap->encoding != FT_ENCODING_UNICODE)) return;
+
+  if (coverage.load(font_hash)) return;
+
+  FT_UInt  glyph_index;
+  FT_ULong charcode = FT_Get_First_Char(face, &glyph_index);
+
+  while (glyph_index != 0) {
+    coverage.add(charcode);
+    charcode = FT_Get_Next_Char(face, charcode, &glyph_index);
+  }
+
+  coverage.build();
+  coverage.save(font_hash);
+}
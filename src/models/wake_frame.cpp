@@ -0,0 +1,87 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#define __WAKE_FRAME__ 1
+#include "models/wake_frame.hpp"
+
+#include "helpers/frame_packer.hpp"
+#include "alloc.hpp"
+
+#include <cstdio>
+
+static const char MAGIC[4] = { 'W', 'A', 'K', 'E' };
+
+bool
+WakeFrame::save(const FrameCache::Key & key, const uint8_t * frame, uint32_t frame_size)
+{
+  uint8_t * packed = (uint8_t *) allocate(FramePacker::max_packed_size(frame_size));
+  if (packed == nullptr) {
+    LOG_E("Unable to allocate wake frame.");
+    return false;
+  }
+
+  Header header = {
+    .magic       = { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3] },
+    .version     = VERSION,
+    .key         = key,
+    .frame_size  = frame_size,
+    .packed_size = FramePacker::pack(frame, frame_size, packed)
+  };
+
+  bool   ok = false;
+  FILE * f  = fopen(FILENAME, "wb");
+  if (f != nullptr) {
+    ok = (fwrite(&header, sizeof(Header), 1, f) == 1) &&
+         (fwrite(packed, header.packed_size, 1, f) == 1);
+    ok = (fclose(f) == 0) && ok;
+  }
+
+  free(packed);
+
+  if (!ok) {
+    LOG_E("Unable to save wake frame.");
+    remove();
+  }
+  return ok;
+}
+
+bool
+WakeFrame::restore(FrameCache::Key & key, uint8_t * frame, uint32_t frame_size)
+{
+  FILE * f = fopen(FILENAME, "rb");
+  if (f == nullptr) return false;
+
+  Header    header;
+  uint8_t * packed = nullptr;
+
+  bool ok = (fread(&header, sizeof(Header), 1, f) == 1) &&
+            (memcmp(header.magic, MAGIC, 4) == 0) &&
+            (header.version    == VERSION) &&
+            (header.frame_size == frame_size) &&
+            (header.packed_size <= FramePacker::max_packed_size(frame_size)) &&
+            ((packed = (uint8_t *) allocate(header.packed_size)) != nullptr) &&
+            (fread(packed, header.packed_size, 1, f) == 1) &&
+            FramePacker::unpack(packed, header.packed_size, frame, frame_size);
+
+  fclose(f);
+  if (packed != nullptr) free(packed);
+
+  // Only good for one wake
+  remove();
+
+  if (ok) {
+    key   = header.key;
+    shown = true;
+  }
+  else {
+    LOG_E("Wake frame not usable.");
+  }
+  return ok;
+}
+
+void
+WakeFrame::remove()
+{
+  ::remove(FILENAME);
+}
@@ -11,6 +11,7 @@
 #include "viewers/html_interpreter.hpp"
 #include "viewers/screen_bottom.hpp"
 #include "models/image_factory.hpp"
+#include "models/wake_frame.hpp"
 
 #if EPUB_INKPLATE_BUILD
   #include "viewers/battery_viewer.hpp"
@@ -173,6 +174,7 @@ BookViewer::build_page_at(const PageLocs::PageId & page_id)
         ScreenBottom::show(page_locs.get_page_nbr(page_id), page_locs.get_page_count());
 
         page.paint();
+        keep_frame(page_id);
       }
       interp->show_stat();
       interp->release_fmt(new_fmt);
@@ -189,9 +191,130 @@ BookViewer::build_page_at(const PageLocs::PageId & page_id)
   LOG_D("end of build_page_at()");
   #if EPUB_INKPLATE_BUILD && (LOG_LOCAL_LEVEL == ESP_LOG_VERBOSE)
     ESP::show_heaps_info();
+    Font::CacheStats stats;
+    Font::get_cache_stats(stats);
+    LOG_D("Glyphs cache: hits: %u, misses: %u, evictions: %u, compactions: %u, bytes: %u / %u",
+      stats.hits, stats.misses, stats.evictions, stats.compactions, stats.bytes, stats.budget);
   #endif
 }
 
+FrameCache::Key
+BookViewer::frame_key(const PageLocs::PageId & page_id)
+{
+  // Everything that has an impact on the page rendering
+  uint32_t hash = 2166136261U;
+  auto fnv = [&hash](const void * data, int32_t length) {
+    const uint8_t * d = (const uint8_t *) data;
+    while (length-- > 0) hash = (hash ^ *d++) * 16777619U;
+  };
+
+  std::string             filename   = epub.get_current_filename();
+  Screen::PixelResolution resolution = screen.get_pixel_resolution();
+
+  fnv(filename.c_str(), filename.size());
+  fnv(epub.get_book_format_params(), sizeof(EPub::BookFormatParams));
+  fnv(&resolution, sizeof(resolution));
+
+  return { .itemref_index = page_id.itemref_index, .offset = page_id.offset, .format_hash = hash };
+}
+
+void
+BookViewer::keep_frame(const PageLocs::PageId & page_id)
+{
+  uint8_t * frame = screen.get_frame_data();
+  if (frame != nullptr) frames.keep(frame_key(page_id), frame, screen.get_frame_size());
+}
+
+bool
+BookViewer::restore_frame(const PageLocs::PageId & page_id)
+{
+  uint8_t * frame = screen.get_frame_data();
+  if ((frame == nullptr) || !frames.restore(frame_key(page_id), frame, screen.get_frame_size())) {
+    return false;
+  }
+
+  LOG_D("Page frame restored.");
+  screen.frame_restored();
+
+  // The page count, battery level and time may have changed since the page was kept.
+  // ScreenBottom sets its own limits and format.
+
+  page.clean();
+  ScreenBottom::show(page_locs.get_page_nbr(page_id), page_locs.get_page_count());
+  page.paint(false);
+
+  return true;
+}
+
+void
+BookViewer::save_wake_frame(bool page_is_shown)
+{
+  std::scoped_lock guard(mutex);
+
+  if (current_page_id.itemref_index == -1) return;
+
+  FrameCache::Key key        = frame_key(current_page_id);
+  uint32_t        frame_size = screen.get_frame_size();
+
+  if (page_is_shown) {
+    uint8_t * frame = screen.get_frame_data();
+    if (frame != nullptr) wake_frame.save(key, frame, frame_size);
+  }
+  else {
+    uint8_t * frame = (uint8_t *) allocate(frame_size);
+    if (frame != nullptr) {
+      if (frames.restore(key, frame, frame_size)) wake_frame.save(key, frame, frame_size);
+      free(frame);
+    }
+  }
+}
+
+void
+BookViewer::adopt_frame(const FrameCache::Key & key)
+{
+  uint8_t * frame = screen.get_frame_data();
+  if (frame != nullptr) frames.keep(key, frame, screen.get_frame_size());
+}
+
+bool
+BookViewer::prepare_next_page()
+{
+  std::scoped_lock guard(mutex);
+
+  if ((current_page_id.itemref_index == -1) || (screen.get_frame_data() == nullptr)) return false;
+
+  for (bool next : { true, false }) {
+    const PageLocs::PageId * id = next ? page_locs.get_next_page_id(current_page_id) :
+                                         page_locs.get_prev_page_id(current_page_id);
+
+    // The cover is shown through another path
+    if ((id == nullptr) || ((id->itemref_index == 0) && (id->offset == 0))) continue;
+
+    PageLocs::PageId page_id = *id;
+    if (frames.contains(frame_key(page_id))) continue;
+
+    LOG_D("Preparing page (%d, %d).", page_id.itemref_index, page_id.offset);
+
+    // The frame buffer is what is shown on the panel: it is kept to be put
+    // back once the page is built.
+
+    FrameCache::Key shown_key = frame_key(current_page_id);
+    frames.keep(shown_key, screen.get_frame_data(), screen.get_frame_size());
+
+    screen.hold_updates(true);
+    build_page_at(page_id);
+    if (!frames.restore(shown_key, screen.get_frame_data(), screen.get_frame_size())) {
+      build_page_at(current_page_id);
+    }
+    screen.hold_updates(false);
+
+    fonts.flush_atlases();
+    return true;
+  }
+
+  return false;
+}
+
 void
 BookViewer::show_fake_cover()
 {
@@ -246,6 +369,8 @@ BookViewer::show_page(const PageLocs::PageId & page_id)
 {
   std::scoped_lock guard(mutex);
 
+  Font::next_generation();
+
   current_page_id = page_id;
     
 //if (page_locs.get_page_nbr(page_id) == 0) {
@@ -276,7 +401,10 @@ BookViewer::show_page(const PageLocs::PageId & page_id)
       show_fake_cover();
     }
   }
-  else {
+  else if (!restore_frame(page_id)) {
     build_page_at(page_id);
   }
+
+  // Glyphs rendered for this page are saved once it is on screen.
+  fonts.flush_atlases();
 }
@@ -361,6 +361,8 @@ HTMLInterpreter::build_pages_recurse(xml_node       node,
   if (str != nullptr) {
     int16_t size;
 
+    text_found(str, current_offset);
+
     if (current_offset + (size = strlen(str)) <= start_offset) {
       // As we move from the beginning of a file, we bypass everything that is there before
       // the start of the page offset
@@ -2,43 +2,123 @@
 //
 // MIT License. Look at file licenses.txt for details.
 
-#if 0
-
-// Not ready yet
-
 #define __KEYBOARD_VIEWER__ 1
 #include "viewers/keyboard_viewer.hpp"
 
-#if EPUB_INKPLATE_BUILD
-  #include "nvs.h"
-  #include "inkplate_platform.hpp"
-#endif
+#include "viewers/page.hpp"
+#include "models/fonts.hpp"
+
+const char *
+KeyboardViewer::label(char code) const
+{
+  static char str[2] = { 0, 0 };
+
+  switch (code) {
+    case SPACE:  return "SPC";
+    case BSP:    return "BSP";
+    case CLEAR:  return "CLR";
+    case OK:     return "OK";
+    case CANCEL: return "CANCEL";
+    default:
+      str[0] = code;
+      return str;
+  }
+}
+
+void
+KeyboardViewer::update_value()
+{
+  // The end of the value is shown if it doesn't fit
+
+  Dim         dim;
+  std::string shown = value;
+
+  font->get_size(shown.c_str(), &dim, FONT_SIZE);
+  while (!shown.empty() && (dim.width > (keyboard_dim.width - 20))) {
+    shown.erase(0, 1);
+    font->get_size(shown.c_str(), &dim, FONT_SIZE);
+  }
+  shown.push_back('_');
+
+  page.clear_region(Dim(keyboard_dim.width - 6, key_dim.height - 6),
+                    Pos(field_pos.x + 3, field_pos.y + 3));
+  page.put_str_at(shown,
+                  Pos(field_pos.x + (keyboard_dim.width >> 1),
+                      field_pos.y + (glyph->dim.height >> 1) + (key_dim.height >> 1)),
+                  fmt);
+}
+
+void
+KeyboardViewer::paint_key(const KeyLocation & key)
+{
+  page.put_highlight(key.dim, key.pos);
+  #if INKPLATE_6PLUS || TOUCH_TRIAL
+    if ((key.code == OK) || (key.code == CANCEL)) {
+      page.put_highlight(Dim(key.dim.width - 2, key.dim.height - 2),
+                         Pos(key.pos.x     + 1, key.pos.y      + 1));
+    }
+  #endif
+  page.put_str_at(label(key.code),
+                  Pos(key.pos.x + (key.dim.width     >> 1),
+                      key.pos.y + (glyph->dim.height >> 1) + (key.dim.height >> 1)),
+                  fmt);
+}
 
-bool 
-KeyboardViewer::get_alfanum(char * str, uint16_t len, UpdateHandler handler)
+void
+KeyboardViewer::highlight_key(const KeyLocation & key, bool show_it)
 {
-  width           = Screen::get_width() - 60;
-  current_kb_type = KBType::ALFA;
+  for (uint8_t i = 1; i <= 3; i++) {
+    Dim dim(key.dim.width - (i << 1), key.dim.height - (i << 1));
+    Pos pos(key.pos.x     +  i,       key.pos.y      +  i      );
+    if (show_it) page.put_highlight(dim, pos);
+    else       page.clear_highlight(dim, pos);
+  }
+}
+
+void
+KeyboardViewer::show(const char * the_value, const char * caption)
+{
+  client_value = the_value;
+  value        = client_value;
+  if (value.size() > MAX_SIZE) value.resize(MAX_SIZE);
+
+  font         = fonts.get(1);
+  glyph        = font->get_glyph('M', FONT_SIZE);
+
+  Dim label_dim;
+  font->get_size("BSP", &label_dim, FONT_SIZE);
+
+  key_dim      = Dim(label_dim.width  + KEY_ADDED_WIDTH,
+                     glyph->dim.height + KEY_ADDED_HEIGHT);
+
+  keyboard_dim = Dim(((key_dim.width + 2) * COLUMN_COUNT) - 2, (key_dim.height + 2) * (LINE_COUNT + 2));
+
+  keyboard_pos = Pos((Screen::get_width()  >> 1) - (keyboard_dim.width  >> 1),
+                     (Screen::get_height() >> 1) - (keyboard_dim.height >> 1));
+
+  field_pos    = Pos(keyboard_pos.x, keyboard_pos.y + key_dim.height + 2);
 
-  if (page.get_compute_mode() == Page::ComputeMode::LOCATION) return false; // Cannot be used durint location computation
+  LOG_D("Keyboard Dim: [%d, %d], Pos: [%d, %d]",
+    keyboard_dim.width, keyboard_dim.height,
+    keyboard_pos.x,     keyboard_pos.y);
 
   fmt = {
-    .line_height_factor = 1.0,
-    .font_index         =   0,
-    .font_size          =  24,
-    .indent             =   0,
-    .margin_left        =  10,
-    .margin_right       =  10,
-    .margin_top         =  30,
-    .margin_bottom      =  10,
-    .screen_left        =   0,
-    .screen_right       =   0,
-    .screen_top         =   0,
-    .screen_bottom      =   0,
-    .width              =   0,
-    .height             =   0,
-    .vertical_align     =   0,
-    .trim               = true,
+    .line_height_factor =   1.0,
+    .font_index         =     1,
+    .font_size          = FONT_SIZE,
+    .indent             =     0,
+    .margin_left        =     5,
+    .margin_right       =     5,
+    .margin_top         =     0,
+    .margin_bottom      =     0,
+    .screen_left        =    20,
+    .screen_right       =    20,
+    .screen_top         =     0,
+    .screen_bottom      =     0,
+    .width              =     0,
+    .height             =     0,
+    .vertical_align     =     0,
+    .trim               =  true,
     .pre                = false,
     .font_style         = Fonts::FaceStyle::NORMAL,
     .align              = CSS::Align::CENTER,
@@ -46,130 +126,190 @@ KeyboardViewer::get_alfanum(char * str, uint16_t len, UpdateHandler handler)
     .display            = CSS::Display::INLINE
   };
 
-  fmt.screen_left        = (Screen::get_width()  - width ) >> 1;
-  fmt.screen_right       = (Screen::get_width()  - width ) >> 1;
-  fmt.screen_top         = (Screen::get_height() - HEIGHT) >> 1;
-  fmt.screen_bottom      = (Screen::get_height() - HEIGHT) >> 1;
+  #if INKPLATE_6PLUS || TOUCH_TRIAL
+    page.start(fmt);
+  #endif
 
-  page.set_compute_mode(Page::ComputeMode::DISPLAY);
+  // The large rectangle into which the keyboard will be drawn
   
-  page.start(fmt);
-
-#if 0
   page.clear_region(
-    Dim(width, HEIGHT), 
-    Pos((Screen::get_width()  - width ) >> 1, (Screen::get_height() - HEIGHT) >> 1));
-
+    Dim(keyboard_dim.width + 26, keyboard_dim.height + 26),
+    Pos(keyboard_pos.x     - 13, keyboard_pos.y      - 13));
   page.put_highlight(
-    Dim(width - 4, HEIGHT - 4), 
-    Pos(((Screen::get_width() - width ) >> 1) + 2, ((Screen::get_height() - HEIGHT) >> 1) + 2));
-
-  TTF * font = fonts.get(0);
-
-  if (font == nullptr) {
-    LOG_E("Internal error (Drawings Font not available!");
-    return;
+    Dim(keyboard_dim.width + 20, keyboard_dim.height + 20),
+    Pos(keyboard_pos.x     - 10, keyboard_pos.y      - 10));
+
+  page.put_str_at(caption,
+                  Pos(Screen::get_width() >> 1,
+                      keyboard_pos.y + (glyph->dim.height >> 1) + (key_dim.height >> 1)),
+                  fmt);
+
+  for (uint8_t i = 0; i < 3; i++) {
+    page.put_highlight(
+      Dim(keyboard_dim.width - (i << 1), key_dim.height - (i << 1)),
+      Pos(field_pos.x        +  i,       field_pos.y    +  i      ));
   }
 
-  Font::Glyph * glyph = font->get_glyph(icon_char[severity], 24);
-
-  if (glyph != nullptr) {
-    page.put_char_at(
-      icon_char[severity], 
-      Pos(((Screen::get_width()  - width ) >> 1) + 50 - (glyph->dim.width >> 1), ( Screen::get_height() >> 1) + 20),
-      fmt);
+  update_value();
+
+  // The keys. Consecutive columns with the same code are a single key.
+
+  key_count = 0;
+  Pos the_pos = Pos(keyboard_pos.x, keyboard_pos.y + ((key_dim.height + 2) << 1));
+
+  for (uint8_t l = 0; l < LINE_COUNT; l++) {
+    for (uint8_t c = 0; c < COLUMN_COUNT; c++) {
+      if ((c > 0) && (lines[l][c] == lines[l][c - 1])) {
+        KeyLocation & key = key_locs[key_count - 1];
+        key.dim.width += key_dim.width + 2;
+        key.last_col   = c;
+      }
+      else {
+        key_locs[key_count++] = {
+          .pos       = Pos(keyboard_pos.x + ((key_dim.width + 2) * c), the_pos.y),
+          .dim       = key_dim,
+          .code      = lines[l][c],
+          .first_col = c,
+          .last_col  = c
+        };
+      }
+      matrix[l][c] = &key_locs[key_count - 1];
+    }
+    the_pos.y += key_dim.height + 2;
   }
   
-  fmt.font_index =  1;
-  fmt.font_size  = 10;
-
-  // Title
-
-  page.set_limits(fmt);
-  page.new_paragraph(fmt);
-  std::string buffer = title;
-  page.add_text(buffer, fmt);
-  page.end_paragraph(fmt);
-
-  // Message
-
-  fmt.align       = CSS::Align::LEFT;
-  fmt.margin_top  = 80;
-  fmt.margin_left = 90;
-
-  page.set_limits(fmt);
-  page.new_paragraph(fmt);
-  buffer = buff;
-  page.add_text(buffer, fmt);
-  page.end_paragraph(fmt);
-
-  // Press a Key option
-
-  if (press_a_key) {
-    fmt.align = CSS::Align::CENTER;
-    fmt.font_size   =   9;
-    fmt.margin_left =  10;
-    fmt.margin_top  = 200;
-
-    page.set_limits(fmt);
-    page.new_paragraph(fmt);
-    buffer = "[Press a key]";
-    page.add_text(buffer, fmt);
-    page.end_paragraph(fmt);
-  }
-#endif
-
-  page.paint(false);
-
-  return true;
+  for (uint8_t i = 0; i < key_count; i++) paint_key(key_locs[i]);
+
+  #if INKPLATE_6PLUS || TOUCH_TRIAL
+    page.paint(false);
+  #else
+    line         = 1;
+    col          = 0;
+    current_key  = matrix[line][col];
+    highlight_key(*current_key, true);
+    previous_key = current_key;
+  #endif
 }
 
-void
-KeyboardViewer::show_kb(KBType kb_type)
+bool
+KeyboardViewer::key_pressed(char code)
 {
-  uint16_t x, y;
-
-  switch (kb_type) {
-    case KBType::ALFA:
-      show_line(alfa_line_1_low, x, y);
-      show_line(alfa_line_2_low, x, y);
-      show_line(alfa_line_3_low, x, y);
-      show_line(alfa_line_4, x, y);
-      break;
+  switch (code) {
+    case OK:
+      client_value = value;
+      return false;
 
-    case KBType::ALFA_SHIFTED:
-      show_line(alfa_line_1_upp, x, y);
-      show_line(alfa_line_2_upp, x, y);
-      show_line(alfa_line_3_upp, x, y);
-      show_line(alfa_line_4, x, y);
+    case CANCEL:
+      return false;
+
+    case BSP:
+      if (!value.empty()) value.pop_back();
       break;
-    
-    case KBType::NUMBERS:
-      show_line(num_line_1, x, y);
-      show_line(num_line_2, x, y);
-      show_line(num_line_3, x, y);
-      show_line(num_line_4, x, y);
+
+    case CLEAR:
+      value.clear();
       break;
-      
-    case KBType::SPECIAL:
-      show_line(special_line_1, x, y);
-      show_line(special_line_2, x, y);
-      show_line(special_line_3, x, y);
-      show_line(special_line_4, x, y);
+
+    default:
+      if (value.size() < MAX_SIZE) value.push_back(code);
       break;
   }
-}
-
-void 
-KeyboardViewer::show_line(const char * line, uint16_t & x, uint16_t y)
-{
 
+  return true;
 }
 
-void 
-KeyboardViewer::show_char(char ch, uint16_t & x, uint16_t y)
-{
+#if INKPLATE_6PLUS || TOUCH_TRIAL
+
+  KeyboardViewer::KeyLocation *
+  KeyboardViewer::get_key(uint16_t x, uint16_t y)
+  {
+    for (uint8_t i = 0; i < key_count; i++) {
+      if ((x >= key_locs[i].pos.x) &&
+          (x <= key_locs[i].pos.x + key_locs[i].dim.width) &&
+          (y >= key_locs[i].pos.y) &&
+          (y <= key_locs[i].pos.y + key_locs[i].dim.height)) {
+        return &key_locs[i];
+      }
+    }
+    return nullptr;
+  }
 
-}
+  bool
+  KeyboardViewer::event(const EventMgr::Event & event)
+  {
+    if (event.kind == EventMgr::EventKind::TAP) {
+      KeyLocation * key = get_key(event.x, event.y);
+      if ((key != nullptr) && !key_pressed(key->code)) return false;
+    }
+    
+    page.start(fmt);
+    update_value();
+    page.paint(false);
+      
+    return true;
+  }
 
-#endif
\ No newline at end of file
+#else
+
+  bool
+  KeyboardViewer::event(const EventMgr::Event & event)
+  {
+    switch (event.kind) {
+      #if EXTENDED_CASE
+        case EventMgr::EventKind::PREV:
+      #else
+        case EventMgr::EventKind::DBL_PREV:
+      #endif
+        col = (current_key->first_col == 0) ? COLUMN_COUNT - 1 : current_key->first_col - 1;
+        break;
+
+      #if EXTENDED_CASE
+        case EventMgr::EventKind::NEXT:
+      #else
+        case EventMgr::EventKind::DBL_NEXT:
+      #endif
+        col = (current_key->last_col == (COLUMN_COUNT - 1)) ? 0 : current_key->last_col + 1;
+        break;
+
+      #if EXTENDED_CASE
+        case EventMgr::EventKind::DBL_PREV:
+      #else
+        case EventMgr::EventKind::PREV:
+      #endif
+        line = (line == 0) ? LINE_COUNT - 1 : line - 1;
+        break;
+
+      #if EXTENDED_CASE
+        case EventMgr::EventKind::DBL_NEXT:
+      #else
+        case EventMgr::EventKind::NEXT:
+      #endif
+        line = (line == (LINE_COUNT - 1)) ? 0 : line + 1;
+        break;
+
+      case EventMgr::EventKind::SELECT:
+        if (!key_pressed(current_key->code)) return false;
+        break;
+
+      case EventMgr::EventKind::DBL_SELECT:
+        return false;
+
+      default:
+        break;
+    }
+
+    current_key = matrix[line][col];
+
+    page.start(fmt);
+    update_value();
+    if (previous_key != current_key) {
+      highlight_key(*previous_key, false);
+      highlight_key(*current_key,  true );
+    }
+    previous_key = current_key;
+    page.paint(false);
+
+    return true;
+  }
+
+#endif
@@ -26,6 +26,8 @@ LinearBooksDirViewer::setup()
                    (BooksDir::max_cover_height + SPACE_BETWEEN_ENTRIES);
   page_count = (books_dir.get_book_count() + books_per_page - 1) / books_per_page;
 
+  books_dir.set_cover_cache_size(books_per_page);
+
   current_page_nbr = -1;
   current_book_idx = -1;
   current_item_idx = -1;
@@ -79,13 +81,17 @@ LinearBooksDirViewer::show_page(int16_t page_nbr, int16_t hightlight_item_idx)
 
     int16_t top_pos = ypos;
 
-    const BooksDir::EBookRecord * book = books_dir.get_book_data(book_idx);
+    BooksDir::BookSummary book;
 
-    if (book == nullptr) break;
+    if (!books_dir.get_book_summary(book_idx, book)) break;
     
-    Image::ImageData image(Dim(book->cover_width, book->cover_height), 
-                           (uint8_t *) book->cover_bitmap);
-    page.put_image(image, Pos(10 + books_dir.MAX_COVER_WIDTH - book->cover_width, ypos));
+    const BooksDir::CoverRecord * cover = books_dir.get_cover(book_idx);
+
+    if (cover != nullptr) {
+      Image::ImageData image(Dim(cover->cover_width, cover->cover_height),
+                             (uint8_t *) cover->cover_bitmap);
+      page.put_image(image, Pos(10 + books_dir.MAX_COVER_WIDTH - cover->cover_width, ypos), cover->cover_dithered);
+    }
 
     #if !(INKPLATE_6PLUS || TOUCH_TRIAL)
       if (item_idx == current_item_idx) {
@@ -104,9 +110,9 @@ LinearBooksDirViewer::show_page(int16_t page_nbr, int16_t hightlight_item_idx)
     page.set_limits(fmt);
     page.new_paragraph(fmt);
     #if EPUB_INKPLATE_BUILD
-      if (nvs_mgr.id_exists(book->id)) page.add_text("[Reading] ", fmt);
+      if (nvs_mgr.id_exists(book.id)) page.add_text("[Reading] ", fmt);
     #endif
-    page.add_text(book->title, fmt);
+    page.add_text(book.title, fmt);
     page.end_paragraph(fmt);
 
     fmt.font_index = AUTHOR_FONT;
@@ -114,7 +120,7 @@ LinearBooksDirViewer::show_page(int16_t page_nbr, int16_t hightlight_item_idx)
     fmt.font_style = Fonts::FaceStyle::ITALIC;
 
     page.new_paragraph(fmt);
-    page.add_text(book->author, fmt);
+    page.add_text(book.author, fmt);
     page.end_paragraph(fmt);
 
     ypos = top_pos + BooksDir::max_cover_height + SPACE_BETWEEN_ENTRIES;
@@ -140,9 +146,9 @@ LinearBooksDirViewer::highlight(int16_t item_idx)
     int16_t xpos = 20 + BooksDir::max_cover_width;
     int16_t ypos = FIRST_ENTRY_YPOS + (current_item_idx * (BooksDir::max_cover_height + SPACE_BETWEEN_ENTRIES));
 
-    const BooksDir::EBookRecord * book = books_dir.get_book_data(book_idx);
+    BooksDir::BookSummary book;
 
-    if (book == nullptr) return;
+    if (!books_dir.get_book_summary(book_idx, book)) return;
 
     // TTF * font = fonts.get(1, 9);
 
@@ -179,9 +185,9 @@ LinearBooksDirViewer::highlight(int16_t item_idx)
     page.set_limits(fmt);
     page.new_paragraph(fmt);
     #if EPUB_INKPLATE_BUILD
-      if (nvs_mgr.id_exists(book->id)) page.add_text("[Reading] ", fmt);
+      if (nvs_mgr.id_exists(book.id)) page.add_text("[Reading] ", fmt);
     #endif
-    page.add_text(book->title, fmt);
+    page.add_text(book.title, fmt);
     page.end_paragraph(fmt);
 
     fmt.font_index = AUTHOR_FONT;
@@ -189,7 +195,7 @@ LinearBooksDirViewer::highlight(int16_t item_idx)
     fmt.font_style = Fonts::FaceStyle::ITALIC;
 
     page.new_paragraph(fmt);
-    page.add_text(book->author, fmt);
+    page.add_text(book.author, fmt);
     page.end_paragraph(fmt);
     
     // Highlight the new current item
@@ -199,9 +205,7 @@ LinearBooksDirViewer::highlight(int16_t item_idx)
     book_idx = current_page_nbr * books_per_page + current_item_idx;
     ypos = FIRST_ENTRY_YPOS + (current_item_idx * (BooksDir::max_cover_height + 6));
 
-    book = books_dir.get_book_data(book_idx);
-
-    if (book == nullptr) return;
+    if (!books_dir.get_book_summary(book_idx, book)) return;
     
     page.put_highlight(
       Dim(Screen::get_width() - (25 + BooksDir::max_cover_width), BooksDir::max_cover_height),
@@ -217,9 +221,9 @@ LinearBooksDirViewer::highlight(int16_t item_idx)
     page.set_limits(fmt);
     page.new_paragraph(fmt);
     #if EPUB_INKPLATE_BUILD
-      if (nvs_mgr.id_exists(book->id)) page.add_text("[Reading] ", fmt);
+      if (nvs_mgr.id_exists(book.id)) page.add_text("[Reading] ", fmt);
     #endif
-    page.add_text(book->title, fmt);
+    page.add_text(book.title, fmt);
     page.end_paragraph(fmt);
 
     fmt.font_index = AUTHOR_FONT,
@@ -227,7 +231,7 @@ LinearBooksDirViewer::highlight(int16_t item_idx)
     fmt.font_style = Fonts::FaceStyle::ITALIC,
 
     page.new_paragraph(fmt);
-    page.add_text(book->author, fmt);
+    page.add_text(book.author, fmt);
     page.end_paragraph(fmt);
 
     #if EPUB_INKPLATE_BUILD
@@ -47,6 +47,8 @@ MatrixBooksDirViewer::setup()
   books_per_page              = line_count * column_count;
   page_count                  = (books_dir.get_book_count() + books_per_page - 1) / books_per_page;
 
+  books_dir.set_cover_cache_size(books_per_page);
+
   current_page_nbr = -1;
   current_book_idx = -1;
   current_item_idx = -1;
@@ -97,13 +99,18 @@ MatrixBooksDirViewer::show_page(int16_t page_nbr, int16_t hightlight_item_idx)
 
   for (int item_idx = 0; book_idx < last; item_idx++, book_idx++) {
 
-    const BooksDir::EBookRecord * book = books_dir.get_book_data(book_idx);
+    BooksDir::BookSummary book;
 
-    if (book == nullptr) break;
+    if (!books_dir.get_book_summary(book_idx, book)) break;
      
-    Image::ImageData image(Dim(book->cover_width, book->cover_height), (uint8_t *) book->cover_bitmap);
-    page.put_image(image, Pos(xpos + ((BooksDir::MAX_COVER_WIDTH - book->cover_width) >> 1), 
-                              ypos + ((BooksDir::MAX_COVER_HEIGHT - book->cover_height) >> 1)));
+    const BooksDir::CoverRecord * cover = books_dir.get_cover(book_idx);
+
+    if (cover != nullptr) {
+      Image::ImageData image(Dim(cover->cover_width, cover->cover_height), (uint8_t *) cover->cover_bitmap);
+      page.put_image(image, Pos(xpos + ((BooksDir::MAX_COVER_WIDTH - cover->cover_width) >> 1),
+                                ypos + ((BooksDir::MAX_COVER_HEIGHT - cover->cover_height) >> 1)),
+                     cover->cover_dithered);
+    }
 
     #if !(INKPLATE_6PLUS || TOUCH_TRIAL)
       if (item_idx == current_item_idx) {
@@ -118,15 +125,15 @@ MatrixBooksDirViewer::show_page(int16_t page_nbr, int16_t hightlight_item_idx)
 
         char title[MAX_TITLE_SIZE];
         title[MAX_TITLE_SIZE - 1] = 0;
-        strncpy(title, book->title, MAX_TITLE_SIZE - 1);
-        if (strlen(book->title) > (MAX_TITLE_SIZE - 1)) {
+        strncpy(title, book.title, MAX_TITLE_SIZE - 1);
+        if (strlen(book.title) > (MAX_TITLE_SIZE - 1)) {
           strcpy(&title[MAX_TITLE_SIZE - 5], " ...");
         }
 
         page.set_limits(fmt);
         page.new_paragraph(fmt);
         #if EPUB_INKPLATE_BUILD
-          if (nvs_mgr.id_exists(book->id)) page.add_text("[Reading] ", fmt);
+          if (nvs_mgr.id_exists(book.id)) page.add_text("[Reading] ", fmt);
         #endif
         page.add_text(title, fmt);
         page.end_paragraph(fmt);
@@ -136,7 +143,7 @@ MatrixBooksDirViewer::show_page(int16_t page_nbr, int16_t hightlight_item_idx)
         fmt.font_style = Fonts::FaceStyle::ITALIC;
 
         page.new_paragraph(fmt);
-        page.add_text(book->author, fmt);
+        page.add_text(book.author, fmt);
         page.end_paragraph(fmt);
       }
     #endif
@@ -175,7 +182,7 @@ MatrixBooksDirViewer::highlight(int16_t item_idx)
           column_idx, line_idx,
           xpos, ypos;
 
-  const BooksDir::EBookRecord * book;
+  BooksDir::BookSummary book;
 
   Page::Format fmt = {
     .line_height_factor = 0.8,
@@ -217,9 +224,7 @@ MatrixBooksDirViewer::highlight(int16_t item_idx)
     xpos = 5 + ((BooksDir::max_cover_width + horiz_space_between_entries) * column_idx);
     ypos = first_entry_ypos + ((BooksDir::max_cover_height + vert_space_between_entries) * line_idx);
 
-    book = books_dir.get_book_data(book_idx);
-
-    if (book == nullptr) return;
+    if (!books_dir.get_book_summary(book_idx, book)) return;
 
     // Font * font = fonts.get(1, 9);
 
@@ -237,9 +242,7 @@ MatrixBooksDirViewer::highlight(int16_t item_idx)
 
   book_idx = current_page_nbr * books_per_page + item_idx;
 
-  book = books_dir.get_book_data(book_idx);
-
-  if (book == nullptr) return;
+  if (!books_dir.get_book_summary(book_idx, book)) return;
   
   current_item_idx = item_idx;
 
@@ -263,15 +266,15 @@ MatrixBooksDirViewer::highlight(int16_t item_idx)
 
   char title[MAX_TITLE_SIZE];
   title[MAX_TITLE_SIZE - 1] = 0;
-  strncpy(title, book->title, MAX_TITLE_SIZE - 1);
-  if (strlen(book->title) > (MAX_TITLE_SIZE - 1)) {
+  strncpy(title, book.title, MAX_TITLE_SIZE - 1);
+  if (strlen(book.title) > (MAX_TITLE_SIZE - 1)) {
     strcpy(&title[MAX_TITLE_SIZE - 5], " ...");
   }
 
   page.set_limits(fmt);
   page.new_paragraph(fmt);
   #if EPUB_INKPLATE_BUILD
-    if (nvs_mgr.id_exists(book->id)) page.add_text("[Reading] ", fmt);
+    if (nvs_mgr.id_exists(book.id)) page.add_text("[Reading] ", fmt);
   #endif
   page.add_text(title, fmt);
   page.end_paragraph(fmt);
@@ -281,7 +284,7 @@ MatrixBooksDirViewer::highlight(int16_t item_idx)
   fmt.font_style = Fonts::FaceStyle::ITALIC;
 
   page.new_paragraph(fmt);
-  page.add_text(book->author, fmt);
+  page.add_text(book.author, fmt);
   page.end_paragraph(fmt);
 
   ScreenBottom::show(current_page_nbr, page_count);
@@ -306,9 +309,9 @@ MatrixBooksDirViewer::clear_highlight()
   int16_t xpos = 5 + ((BooksDir::max_cover_width + horiz_space_between_entries) * column_idx);
   int16_t ypos = first_entry_ypos + ((BooksDir::max_cover_height + vert_space_between_entries) * line_idx);
 
-  const BooksDir::EBookRecord * book = books_dir.get_book_data(book_idx);
+  BooksDir::BookSummary book;
 
-  if (book == nullptr) return;
+  if (!books_dir.get_book_summary(book_idx, book)) return;
 
   // Font * font = fonts.get(1, 9);
 
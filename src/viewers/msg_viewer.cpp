@@ -374,6 +374,7 @@ MsgViewer::out_of_memory(const char * raison)
   #undef MSG
 
   #if EPUB_INKPLATE_BUILD
+    screen.wait_for_update();
     inkplate_platform.deep_sleep(INT_PIN, LEVEL); // Never return
   #else
     exit(0);
@@ -42,7 +42,8 @@ void
 Page::clear_display_list()
 {
   for (auto * entry: display_list) {
-    if (entry->command == DisplayListCommand::IMAGE) {
+    if ((entry->command == DisplayListCommand::IMAGE) ||
+        (entry->command == DisplayListCommand::DITHERED_IMAGE)) {
       if (entry->kind.image_entry.image.bitmap) {
         delete [] entry->kind.image_entry.image.bitmap;
       }
@@ -294,6 +295,12 @@ Page::paint(bool clear_screen, bool no_full, bool do_it)
     }
     else if (entry->command == DisplayListCommand::IMAGE) {
       screen.draw_bitmap(
+        entry->kind.image_entry.image.bitmap,
+        entry->kind.image_entry.image.dim,
+        entry->pos);
+    }
+    else if (entry->command == DisplayListCommand::DITHERED_IMAGE) {
+      screen.draw_dithered_bitmap(
         entry->kind.image_entry.image.bitmap, 
         entry->kind.image_entry.image.dim,  
         entry->pos);
@@ -609,6 +616,13 @@ Page::add_glyph_to_line(Font::Glyph * glyph, const Format & fmt, Font & font, bo
   line_list.push_front(entry);
 }
 
+Font::Glyph *
+Page::get_fallback_glyph(uint32_t charcode, const Format & fmt)
+{
+  Font * fallback = fonts.get_fallback(charcode, fmt.font_index);
+  return (fallback == nullptr) ? nullptr : fallback->get_glyph(charcode, fmt.font_size);
+}
+
 void 
 Page::add_image_to_line(Image & image, int16_t advance, const Format & fmt)
 {
@@ -690,12 +704,20 @@ Page::add_word(const char * word,  const Format & fmt)
     uc1 = to_unicode(str,  fmt.text_transform, first, &str1);
     uc2 = to_unicode(str1, fmt.text_transform, false, &str2);
 
-    glyph = font->get_glyph(uc1, uc2, fmt.font_size, kern, ignore_next);
+    if (font->covers(uc1)) {
+      glyph = font->get_glyph(uc1, uc2, fmt.font_size, kern, ignore_next);
+    }
+    else {
+      glyph       = get_fallback_glyph(uc1, fmt);
+      ignore_next = false;
+      if (glyph != nullptr) kern = glyph->advance;
+    }
 
     str = ignore_next ? str2 : str1;    
 
     if (glyph == nullptr) {
       glyph = font->get_glyph(' ', fmt.font_size);
+      if (glyph != nullptr) kern = glyph->advance;
     }
 
     if (glyph != nullptr) {
@@ -853,7 +875,8 @@ Page::add_char(const char * ch, const Format & fmt)
   const char * s1;
   int32_t code = to_unicode(ch, fmt.text_transform, true, &s1);
 
-  glyph = font->get_glyph(code, fmt.font_size);
+  glyph = font->covers(code) ? font->get_glyph(code, fmt.font_size)
+                             : get_fallback_glyph(code, fmt);
 
   if (glyph != nullptr) {
     // Verify that there is enough space for the glyph on the line.
@@ -999,23 +1022,36 @@ Page::add_text(std::string str, const Format & fmt)
 
 void 
 Page::put_image(Image::ImageData & image, 
-                Pos                  pos)
+                Pos                  pos,
+                const uint8_t      * dithered)
 {
   DisplayListEntry * entry = display_list_entry_pool.newElement();
   if (entry == nullptr) no_mem();
 
+  // The dithered version, when available, is painted as is: no dithering
+  // at paint time.
+
+  if ((dithered != nullptr) && (screen.get_pixel_resolution() != Screen::PixelResolution::ONE_BIT)) {
+    dithered = nullptr;
+  }
+
   if (compute_mode == ComputeMode::DISPLAY) {
-    int32_t size = image.dim.width * image.dim.height;
+    const uint8_t * bitmap = (dithered != nullptr) ? dithered : image.bitmap;
+    int32_t         size   = (dithered != nullptr) ?
+                               DitheredImages::get_pitch(image.dim) * image.dim.height :
+                               image.dim.width * image.dim.height;
     if ((entry->kind.image_entry.image.bitmap = new unsigned char [size]) == nullptr) {
       msg_viewer.out_of_memory("image allocation");
     }
-    memcpy((void *)entry->kind.image_entry.image.bitmap, image.bitmap, size);
+    memcpy((void *)entry->kind.image_entry.image.bitmap, bitmap, size);
   }
   else {
     entry->kind.image_entry.image.bitmap = nullptr;
   }
 
-  entry->command                     = DisplayListCommand::IMAGE;
+  entry->command                     = (dithered != nullptr) ?
+                                         DisplayListCommand::DITHERED_IMAGE :
+                                         DisplayListCommand::IMAGE;
   entry->kind.image_entry.image.dim  = image.dim;
   entry->pos                         = pos;
 
@@ -1219,8 +1255,9 @@ Page::show_display_list(const DisplayList & list, const char * title) const
           " k:" <<  entry->kind.glyph_entry.kern <<
           " h:" <<  entry->kind.glyph_entry.glyph->dim.height << std::endl;
       }
-      else if (entry->command == DisplayListCommand::IMAGE) {
-        std::cout << "IMAGE" <<
+      else if ((entry->command == DisplayListCommand::IMAGE) ||
+               (entry->command == DisplayListCommand::DITHERED_IMAGE)) {
+        std::cout << ((entry->command == DisplayListCommand::IMAGE) ? "IMAGE" : "DITHERED_IMAGE") <<
           " x:" << entry->pos.x <<
           " y:" << entry->pos.y <<
           " w:" << entry->kind.image_entry.image.dim.width  <<
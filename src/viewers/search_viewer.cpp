@@ -0,0 +1,294 @@
+// Copyright (c) 2020 Guy Turcotte
+//
+// MIT License. Look at file licenses.txt for details.
+
+#define __SEARCH_VIEWER__ 1
+#include "viewers/search_viewer.hpp"
+
+#include "models/book_search.hpp"
+#include "models/fonts.hpp"
+#include "models/page_locs.hpp"
+#include "viewers/screen_bottom.hpp"
+
+#include "screen.hpp"
+
+void
+SearchViewer::setup()
+{
+  entry_count      = book_search.get_hits().size();
+  entries_per_page = (Screen::get_height() - FIRST_ENTRY_YPOS - 20) / ENTRY_HEIGHT;
+  page_count       = (entry_count + entries_per_page - 1) / entries_per_page;
+  if (page_count == 0) page_count = 1;
+
+  current_page_nbr    = -1;
+  current_screen_idx  = -1;
+  current_entry_idx   = -1;
+
+  LOG_D("Search hit count: %d", entry_count);
+}
+
+std::string
+SearchViewer::get_title()
+{
+  std::string title = "\"" + book_search.get_query() + "\": ";
+
+  if      (entry_count == 0)            title.append("Not found");
+  else if (book_search.is_truncated())  title.append("First " + std::to_string(entry_count) + " hits");
+  else if (entry_count == 1)            title.append("1 hit");
+  else                                  title.append(std::to_string(entry_count) + " hits");
+
+  return title;
+}
+
+std::string
+SearchViewer::get_label(int16_t entry_idx)
+{
+  const BookSearch::Hit & hit = book_search.get_hits()[entry_idx];
+
+  // Page numbers are known once the pages location is complete. The
+  // page is not looked for before, as it could require its computation.
+
+  if (page_locs.get_page_count() >= 0) {
+    const PageLocs::PageId * page_id = book_search.get_page_id(entry_idx);
+    int16_t page_nbr = (page_id == nullptr) ? -1 : page_locs.get_page_nbr(*page_id);
+    if (page_nbr >= 0) return "p. " + std::to_string(page_nbr + 1) + ": " + hit.snippet;
+  }
+
+  return hit.snippet;
+}
+
+void
+SearchViewer::show_entry(int16_t entry_idx, int16_t ypos)
+{
+  Page::Format fmt = {
+    .line_height_factor = 0.8,
+    .font_index         = ENTRY_FONT,
+    .font_size          = ENTRY_FONT_SIZE,
+    .indent             = 0,
+    .margin_left        = 0,
+    .margin_right       = 0,
+    .margin_top         = 0,
+    .margin_bottom      = 0,
+    .screen_left        = 20,
+    .screen_right       = 20,
+    .screen_top         = ypos,
+    .screen_bottom      = (int16_t)(Screen::get_height() - (ypos + ENTRY_HEIGHT)),
+    .width              = 0,
+    .height             = 0,
+    .vertical_align     = 0,
+    .trim               = true,
+    .pre                = false,
+    .font_style         = Fonts::FaceStyle::NORMAL,
+    .align              = CSS::Align::LEFT,
+    .text_transform     = CSS::TextTransform::NONE,
+    .display            = CSS::Display::INLINE
+  };
+
+  page.set_limits(fmt);
+  page.new_paragraph(fmt);
+  page.add_text(get_label(entry_idx), fmt);
+  page.end_paragraph(fmt);
+}
+
+void
+SearchViewer::show_page(int16_t page_nbr, int16_t hightlight_screen_idx)
+{
+  current_page_nbr   = page_nbr;
+  current_screen_idx = hightlight_screen_idx;
+
+  int16_t entry_idx = page_nbr  * entries_per_page; // entry idx in the current page
+  int16_t last_idx  = entry_idx + entries_per_page; // last entry idx in the current page
+
+  if (last_idx > entry_count) last_idx = entry_count;
+
+  int16_t ypos = TITLE_YPOS;
+
+  page.set_compute_mode(Page::ComputeMode::DISPLAY);
+
+  Page::Format fmt = {
+      .line_height_factor =   0.8,
+      .font_index         = TITLE_FONT,
+      .font_size          = TITLE_FONT_SIZE,
+      .indent             =     0,
+      .margin_left        =     0,
+      .margin_right       =     0,
+      .margin_top         =     0,
+      .margin_bottom      =     0,
+      .screen_left        =    20,
+      .screen_right       =    10,
+      .screen_top         =  ypos,
+      .screen_bottom      = (int16_t)(Screen::get_height() - (ypos + MAX_TITLE_SIZE + 20)),
+      .width              =     0,
+      .height             =     0,
+      .vertical_align     =     0,
+      .trim               =  true,
+      .pre                = false,
+      .font_style         = Fonts::FaceStyle::BOLD,
+      .align              = CSS::Align::CENTER,
+      .text_transform     = CSS::TextTransform::NONE,
+      .display            = CSS::Display::INLINE
+    };
+
+  page.start(fmt);
+
+  page.set_limits(fmt);
+  page.new_paragraph(fmt);
+  page.add_text(get_title(), fmt);
+  page.end_paragraph(fmt);
+
+  ypos = FIRST_ENTRY_YPOS;
+
+  for (int16_t screen_idx = 0; entry_idx < last_idx; screen_idx++, entry_idx++) {
+
+    #if !(INKPLATE_6PLUS || TOUCH_TRIAL)
+      if (screen_idx == current_screen_idx) {
+        page.put_highlight(Dim(Screen::get_width() - 30, ENTRY_HEIGHT + 5),
+                           Pos(15, ypos));
+      }
+    #endif
+
+    show_entry(entry_idx, ypos);
+
+    ypos += ENTRY_HEIGHT;
+  }
+
+  ScreenBottom::show(current_page_nbr, page_count);
+
+  page.paint();
+}
+
+void
+SearchViewer::highlight(int16_t screen_idx)
+{
+  #if !(INKPLATE_6PLUS || TOUCH_TRIAL)
+  page.set_compute_mode(Page::ComputeMode::DISPLAY);
+
+  if (current_screen_idx != screen_idx) {
+
+    // Clear the highlighting of the current item
+
+    int16_t entry_idx = current_page_nbr * entries_per_page + current_screen_idx;
+    int16_t ypos      = FIRST_ENTRY_YPOS + (current_screen_idx * ENTRY_HEIGHT);
+
+    Page::Format fmt = {
+      .line_height_factor = 0.8,
+      .font_index         = ENTRY_FONT,
+      .font_size          = ENTRY_FONT_SIZE,
+      .indent             = 0,
+      .margin_left        = 0,
+      .margin_right       = 0,
+      .margin_top         = 0,
+      .margin_bottom      = 0,
+      .screen_left        = 20,
+      .screen_right       = 20,
+      .screen_top         = ypos,
+      .screen_bottom      = (int16_t)(Screen::get_height() - (ypos + ENTRY_HEIGHT + 20)),
+      .width              = 0,
+      .height             = 0,
+      .vertical_align     = 0,
+      .trim               = true,
+      .pre                = false,
+      .font_style         = Fonts::FaceStyle::NORMAL,
+      .align              = CSS::Align::LEFT,
+      .text_transform     = CSS::TextTransform::NONE,
+      .display            = CSS::Display::INLINE
+    };
+
+    page.start(fmt);
+
+    page.clear_highlight(
+      Dim(Screen::get_width() - 30, ENTRY_HEIGHT + 5),
+      Pos(15, ypos));
+
+    show_entry(entry_idx, ypos);
+
+    // Highlight the new current entry
+
+    current_screen_idx = screen_idx;
+
+    entry_idx = current_page_nbr * entries_per_page + current_screen_idx;
+    ypos      = FIRST_ENTRY_YPOS + (current_screen_idx * ENTRY_HEIGHT);
+
+    page.put_highlight(
+      Dim(Screen::get_width() - 30, ENTRY_HEIGHT + 5),
+      Pos(15, ypos));
+
+    show_entry(entry_idx, ypos);
+
+    ScreenBottom::show(current_page_nbr, page_count);
+
+    page.paint(false);
+  }
+  #endif
+}
+
+int16_t
+SearchViewer::show_page_and_highlight(int16_t entry_idx)
+{
+  if (entry_idx < 0) entry_idx = 0;
+
+  int16_t page_nbr   = entry_idx / entries_per_page;
+  int16_t screen_idx = entry_idx % entries_per_page;
+
+  if (current_page_nbr != page_nbr) {
+    show_page(page_nbr, screen_idx);
+  }
+  else {
+    if ((screen_idx != current_screen_idx) && (entry_idx < entry_count)) highlight(screen_idx);
+  }
+
+  current_entry_idx = entry_idx;
+  return current_entry_idx;
+}
+
+int16_t
+SearchViewer::next_page()
+{
+  return next_column();
+}
+
+int16_t
+SearchViewer::prev_page()
+{
+  return prev_column();
+}
+
+int16_t
+SearchViewer::next_item()
+{
+  int16_t entry_idx = current_entry_idx + 1;
+  if (entry_idx >= entry_count) {
+    entry_idx = entry_count - 1;
+  }
+  return show_page_and_highlight(entry_idx);
+}
+
+int16_t
+SearchViewer::prev_item()
+{
+  int16_t entry_idx = current_entry_idx - 1;
+  if (entry_idx < 0) entry_idx = 0;
+  return show_page_and_highlight(entry_idx);
+}
+
+int16_t
+SearchViewer::next_column()
+{
+  int16_t entry_idx = current_entry_idx + entries_per_page;
+  if (entry_idx >= entry_count) {
+    entry_idx = entry_count - 1;
+  }
+  else {
+    entry_idx = (entry_idx / entries_per_page) * entries_per_page;
+  }
+  return show_page_and_highlight(entry_idx);
+}
+
+int16_t
+SearchViewer::prev_column()
+{
+  int16_t entry_idx = current_entry_idx - entries_per_page;
+  if (entry_idx < 0) entry_idx = 0;
+  else entry_idx = (entry_idx / entries_per_page) * entries_per_page;
+  return show_page_and_highlight(entry_idx);
+}